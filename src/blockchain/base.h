@@ -140,7 +140,7 @@ public:
     virtual bool RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress) = 0;
     virtual bool GetTxToAddressContext(const uint256& hashFork, const uint256& hashBlock, const CTransaction& tx, CAddressContext& ctxAddress) = 0;
     virtual CTemplatePtr GetTxToAddressTemplatePtr(const uint256& hashFork, const uint256& hashBlock, const CTransaction& tx) = 0;
-    virtual bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress) = 0;
+    virtual bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress) = 0;
     virtual bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress) = 0;
     virtual bool RetrieveBlsPubkeyContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, uint384& blsPubkey) = 0;
     virtual bool GetOwnerLinkTemplateAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destOwner, std::map<CDestination, uint8>& mapTemplateAddress) = 0;
@@ -173,7 +173,8 @@ public:
     virtual bool GetPrimaryForkOwnerAddress(CDestination& destForkOwner, const uint256& hashRefBlock = uint256()) = 0;
     virtual bool RetrieveContractKvValue(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, const uint256& key, bytes& value) = 0;
     virtual bool GetBlockRewardList(const uint256& hashLastBlock, const uint32 nBlockCount, std::vector<uint256>& vBlockRewardList, std::vector<std::pair<uint256, uint256>>& vBlockGasUsedList) = 0;
-    virtual bool GetBlockReceiptsByBlock(const uint256& hashFork, const uint256& hashFromBlock, const uint256& hashToBlock, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts) = 0;
+    virtual bool GetBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts) = 0;
+    virtual bool WalkThroughBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerBlockReceiptsFunc fnWalker) = 0;
     virtual bool VerifySameChain(const uint256& hashPrevBlock, const uint256& hashAfterBlock) = 0;
     virtual bool GetPrevBlockHashList(const uint256& hashBlock, const uint32 nGetCount, std::vector<uint256>& vPrevBlockhash) = 0;
     virtual uint32 GetAllForkMinLastBlockHeight(std::vector<uint256>* pForkHash = nullptr) = 0;
@@ -261,7 +262,7 @@ public:
     virtual bool AddBlockLocalVoteSignFlag(const uint256& hashBlock) = 0;
     virtual bool VerifyPrimaryBlockConfirm(const uint256& hashBlock) = 0;
 
-    virtual bool PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight) = 0;
+    virtual bool PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, const uint64 nMaxPruneNodeCount, uint64& nPruneNodeCount, uint64& nPruneBytes) = 0;
     virtual bool PruneForkContractKvData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, bool& fExit) = 0;
     virtual bool PruneForkAddressData(const uint256& hashFork, const uint32 nPruneReserveLastHeight) = 0;
     virtual bool PruneHdexData(const uint32 nPruneReserveLastHeight) = 0;
@@ -428,6 +429,7 @@ public:
     virtual bool AddNode(const hnbase::CNetHost& node) = 0;
     virtual bool RemoveNode(const hnbase::CNetHost& node) = 0;
     virtual bool GetForkRpcPort(const uint256& hashFork, uint16& nRpcPort) = 0;
+    virtual bool GetSyncStatus(const uint256& hashFork, network::CNetSyncStatus& status) = 0;
     /* Blockchain & Tx Pool*/
     virtual int GetForkCount() = 0;
     virtual bool HaveFork(const uint256& hashFork) = 0;
@@ -470,7 +472,7 @@ public:
     virtual uint256 AddLogsFilter(const uint256& hashClient, const uint256& hashFork, const CLogsFilter& logsFilter) = 0;
     virtual void RemoveFilter(const uint256& nFilterId) = 0;
     virtual bool GetTxReceiptLogsByFilterId(const uint256& nFilterId, const bool fAll, ReceiptLogsVec& receiptLogs) = 0;
-    virtual bool GetTxReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, ReceiptLogsVec& vReceiptLogs) = 0;
+    virtual bool WalkThroughReceiptLogsByFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerReceiptLogsFunc fnWalker) = 0;
     virtual uint256 AddBlockFilter(const uint256& hashClient, const uint256& hashFork) = 0;
     virtual bool GetFilterBlockHashs(const uint256& hashFork, const uint256& nFilterId, const bool fAll, std::vector<uint256>& vBlockHash) = 0;
     virtual uint256 AddPendingTxFilter(const uint256& hashClient, const uint256& hashFork) = 0;
@@ -517,7 +519,7 @@ public:
     virtual void GetWalletDestinations(std::set<CDestination>& setDest) = 0;
     virtual bool GetForkContractCodeContext(const uint256& hashFork, const uint256& hashRefBlock, const uint256& hashContractCode, CContractCodeContext& ctxtContractCode) = 0;
     virtual bool ListContractCodeContext(const uint256& hashFork, const uint256& hashRefBlock, const uint256& txid, std::map<uint256, CContractCodeContext>& mapContractCode) = 0;
-    virtual bool ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress) = 0;
+    virtual bool ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress) = 0;
     virtual bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress) = 0;
     virtual bool GetOwnerLinkTemplateAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destOwner, std::map<CDestination, uint8>& mapTemplateAddress) = 0;
     virtual bool GetDelegateLinkTemplateAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destDelegate, const uint32 nTemplateType, const uint64 nBegin, const uint64 nCount, std::vector<std::pair<CDestination, uint8>>& vTemplateAddress) = 0;
@@ -578,6 +580,8 @@ public:
     virtual bool AddP2pSynTxSynStatData(const uint256& hashFork, const uint64 nTxCount, const bool fRecv) = 0;
     virtual bool GetBlockMakerStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemBlockMaker>& vStatData) = 0;
     virtual bool GetP2pSynStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemP2pSyn>& vStatData) = 0;
+    virtual bool AddPruneDbStatData(const uint256& hashFork, const uint64 nPruneNodeCount, const uint64 nPruneBytes) = 0;
+    virtual bool GetPruneDbStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vStatData) = 0;
 };
 
 class IRecovery : public hnbase::IBase
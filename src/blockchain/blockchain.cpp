@@ -78,7 +78,11 @@ bool CBlockChain::HandleInvoke()
     nMaxBlockRewardTxCount = GetBlockInvestRewardTxMaxCount();
     StdLog("BlockChain", "HandleInvoke: Max block reward tx count: %d", nMaxBlockRewardTxCount);
 
-    if (!cntrBlock.BsInitialize(Config()->pathData, blockGenesis.GetHash(), Config()->fFullDb, Config()->fTraceDb, Config()->fCacheTrace, Config()->fRewardCheck, false, StorageConfig()->fPrune))
+    const storage::CTimeSeriesSyncPolicy syncPolicy(StorageConfig()->nBlockFileSyncMode, StorageConfig()->nBlockFileSyncParam);
+    if (!cntrBlock.BsInitialize(Config()->pathData, blockGenesis.GetHash(), Config()->fFullDb, Config()->fTraceDb, Config()->fCacheTrace,
+                                Config()->fRewardCheck, false, StorageConfig()->fPrune, syncPolicy,
+                                (std::size_t)StorageConfig()->nBlockCacheSize * 1024 * 1024, StorageConfig()->nBlockCachePinCount,
+                                StorageConfig()->fFullVerifyDb))
     {
         StdError("BlockChain", "Failed to initialize container");
         return false;
@@ -505,6 +509,9 @@ bool CBlockChain::GetForkStorageMaxHeight(const uint256& hashFork, uint32& nMaxH
 Errno CBlockChain::AddNewBlock(const uint256& hashBlock, const CBlock& block, uint256& hashFork, CBlockChainUpdate& update)
 {
     Errno err = OK;
+    const uint64 nTxHashHitPrev = CTransaction::GetHashCacheStat().GetHitCount();
+    const uint64 nTxHashCalcPrev = CTransaction::GetHashCacheStat().GetCalcCount();
+    const uint64 nTxRootHitPrev = CBlock::GetHashCacheStat().GetHitCount();
 
     if (cntrBlock.Exists(hashBlock))
     {
@@ -566,6 +573,11 @@ Errno CBlockChain::AddNewBlock(const uint256& hashBlock, const CBlock& block, ui
         return ERR_BLOCK_TRANSACTIONS_INVALID;
     }
 
+    // Counters are process wide, concurrent imports on other forks are included
+    StdTrace("BlockChain", "Add new block: Hash cache, tx hash saved: %lu, tx hash computed: %lu, tx merkle root saved: %lu, block: %s",
+             CTransaction::GetHashCacheStat().GetHitCount() - nTxHashHitPrev, CTransaction::GetHashCacheStat().GetCalcCount() - nTxHashCalcPrev,
+             CBlock::GetHashCacheStat().GetHitCount() - nTxRootHitPrev, hashBlock.GetBhString().c_str());
+
     return OK;
 }
 
@@ -2162,9 +2174,9 @@ CTemplatePtr CBlockChain::GetTxToAddressTemplatePtr(const uint256& hashFork, con
     return CTemplate::Import(ctxTemplate.btData);
 }
 
-bool CBlockChain::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CBlockChain::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
 {
-    return cntrBlock.ListContractAddress(hashFork, hashBlock, mapContractAddress);
+    return cntrBlock.ListContractAddress(hashFork, hashBlock, destBegin, nCount, mapContractAddress);
 }
 
 bool CBlockChain::ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
@@ -2341,9 +2353,14 @@ bool CBlockChain::GetBlockRewardList(const uint256& hashLastBlock, const uint32
     return true;
 }
 
-bool CBlockChain::GetBlockReceiptsByBlock(const uint256& hashFork, const uint256& hashFromBlock, const uint256& hashToBlock, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts)
+bool CBlockChain::GetBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts)
+{
+    return cntrBlock.GetBlockReceiptsByLogsFilter(hashFork, logsFilter, mapBlockReceipts);
+}
+
+bool CBlockChain::WalkThroughBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerBlockReceiptsFunc fnWalker)
 {
-    return cntrBlock.GetBlockReceiptsByBlock(hashFork, hashFromBlock, hashToBlock, mapBlockReceipts);
+    return cntrBlock.WalkThroughBlockReceiptsByLogsFilter(hashFork, logsFilter, nMaxBlockCount, fnWalker);
 }
 
 bool CBlockChain::VerifySameChain(const uint256& hashPrevBlock, const uint256& hashAfterBlock)
@@ -2856,9 +2873,9 @@ bool CBlockChain::VerifyPrimaryBlockConfirm(const uint256& hashBlock)
     return true;
 }
 
-bool CBlockChain::PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight)
+bool CBlockChain::PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, const uint64 nMaxPruneNodeCount, uint64& nPruneNodeCount, uint64& nPruneBytes)
 {
-    return cntrBlock.PruneForkStateData(hashFork, nPruneReserveLastHeight);
+    return cntrBlock.PruneForkStateData(hashFork, nPruneReserveLastHeight, nMaxPruneNodeCount, nPruneNodeCount, nPruneBytes);
 }
 
 bool CBlockChain::PruneForkContractKvData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, bool& fExit)
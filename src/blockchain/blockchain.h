@@ -80,7 +80,7 @@ public:
     bool RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress) override;
     bool GetTxToAddressContext(const uint256& hashFork, const uint256& hashBlock, const CTransaction& tx, CAddressContext& ctxAddress) override;
     CTemplatePtr GetTxToAddressTemplatePtr(const uint256& hashFork, const uint256& hashBlock, const CTransaction& tx) override;
-    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress) override;
+    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress) override;
     bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress) override;
     bool RetrieveBlsPubkeyContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, uint384& blsPubkey) override;
     bool GetOwnerLinkTemplateAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destOwner, std::map<CDestination, uint8>& mapTemplateAddress) override;
@@ -112,7 +112,8 @@ public:
     bool GetPrimaryForkOwnerAddress(CDestination& destForkOwner, const uint256& hashRefBlock = uint256()) override;
     bool RetrieveContractKvValue(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, const uint256& key, bytes& value) override;
     bool GetBlockRewardList(const uint256& hashLastBlock, const uint32 nBlockCount, std::vector<uint256>& vBlockRewardList, std::vector<std::pair<uint256, uint256>>& vBlockGasUsedList) override;
-    bool GetBlockReceiptsByBlock(const uint256& hashFork, const uint256& hashFromBlock, const uint256& hashToBlock, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts) override;
+    bool GetBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts) override;
+    bool WalkThroughBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerBlockReceiptsFunc fnWalker) override;
     bool VerifySameChain(const uint256& hashPrevBlock, const uint256& hashAfterBlock) override;
     bool GetPrevBlockHashList(const uint256& hashBlock, const uint32 nGetCount, std::vector<uint256>& vPrevBlockhash) override;
     uint32 GetAllForkMinLastBlockHeight(std::vector<uint256>* pForkHash = nullptr) override;
@@ -176,7 +177,7 @@ public:
     bool AddBlockLocalVoteSignFlag(const uint256& hashBlock) override;
     bool VerifyPrimaryBlockConfirm(const uint256& hashBlock) override;
 
-    bool PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight) override;
+    bool PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, const uint64 nMaxPruneNodeCount, uint64& nPruneNodeCount, uint64& nPruneBytes) override;
     bool PruneForkContractKvData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, bool& fExit) override;
     bool PruneForkAddressData(const uint256& hashFork, const uint32 nPruneReserveLastHeight) override;
     bool PruneHdexData(const uint32 nPruneReserveLastHeight) override;
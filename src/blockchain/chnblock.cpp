@@ -4,6 +4,7 @@
 
 #include "chnblock.h"
 
+#include <algorithm>
 #include <boost/bind.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 
@@ -15,6 +16,9 @@ using boost::asio::ip::tcp;
 #define MAX_CACHE_CHN_BLOCK_SIZE (1024 * 1024 * 1024)
 #define SINGLE_REQ_BLOCK_HASH_COUNT 32
 #define BLOCK_SYNC_TIMER_TIME 300
+#define MAX_CMPCT_BLOCK_COUNT 64
+#define MAX_CMPCT_BLOCK_TX_COUNT 200000
+#define CMPCT_BLOCK_TIMEOUT 10
 
 namespace hashahead
 {
@@ -115,6 +119,113 @@ bool CBlockChnFork::CheckPrevExist(const uint256& hashBlock)
     return true;
 }
 
+////////////////////////////////////
+// CCmpctShortIdKey
+
+static inline uint64 MixShortId(uint64 n)
+{
+    n ^= n >> 33;
+    n *= 0xff51afd7ed558ccdULL;
+    n ^= n >> 33;
+    n *= 0xc4ceb9fe1a85ec53ULL;
+    n ^= n >> 33;
+    return n;
+}
+
+CCmpctShortIdKey::CCmpctShortIdKey(const uint256& hashBlock, const uint64 nSalt)
+{
+    CBufStream ss;
+    ss << hashBlock << nSalt;
+    const uint256 hashKey = crypto::CryptoHash(ss.GetData(), ss.GetSize());
+    nKey0 = hashKey.Get64(0);
+    nKey1 = hashKey.Get64(1);
+}
+
+uint64 CCmpctShortIdKey::GetShortId(const uint256& txid) const
+{
+    // txids are already uniform, the key only has to keep collisions from being precomputed
+    uint64 n = nKey0;
+    for (int i = 0; i < 4; i++)
+    {
+        n = MixShortId((n ^ txid.Get64(i)) + nKey1);
+    }
+    return n;
+}
+
+////////////////////////////////////
+// CCmpctBlockFiller
+
+CCmpctBlockFiller::CCmpctBlockFiller(const uint256& hashBlock, const uint64 nSalt)
+  : keyShortId(hashBlock, nSalt)
+{
+}
+
+bool CCmpctBlockFiller::SetPrefilledTx(const std::vector<CTransaction>& vPrefilledTx, const std::vector<uint32>& vPrefilledIndex, const std::size_t nShortIdCount)
+{
+    if (vPrefilledTx.size() != vPrefilledIndex.size())
+    {
+        return false;
+    }
+    const std::size_t nTxCount = vPrefilledIndex.size() + nShortIdCount;
+    vtx.assign(nTxCount, CTransaction());
+    vFilled.assign(nTxCount, false);
+    for (std::size_t i = 0; i < vPrefilledIndex.size(); i++)
+    {
+        const uint32 nIndex = vPrefilledIndex[i];
+        if (nIndex >= nTxCount || vFilled[nIndex])
+        {
+            return false;
+        }
+        vtx[nIndex] = vPrefilledTx[i];
+        vFilled[nIndex] = true;
+    }
+    return true;
+}
+
+void CCmpctBlockFiller::SetPoolTxid(const std::vector<uint256>& vPoolTxid)
+{
+    mapPoolShortId.clear();
+    mapPoolShortId.reserve(vPoolTxid.size());
+    for (const uint256& txid : vPoolTxid)
+    {
+        auto ret = mapPoolShortId.insert(std::make_pair(keyShortId.GetShortId(txid), txid));
+        if (!ret.second)
+        {
+            ret.first->second = uint256();
+        }
+    }
+}
+
+void CCmpctBlockFiller::MatchShortId(const std::vector<uint64>& vShortId, std::vector<std::pair<uint32, uint256>>& vMatch) const
+{
+    std::size_t nShortIdPos = 0;
+    for (uint32 nIndex = 0; nIndex < vFilled.size() && nShortIdPos < vShortId.size(); nIndex++)
+    {
+        if (vFilled[nIndex])
+        {
+            continue;
+        }
+        auto it = mapPoolShortId.find(vShortId[nShortIdPos++]);
+        vMatch.push_back(std::make_pair(nIndex, (it == mapPoolShortId.end() ? uint256() : it->second)));
+    }
+}
+
+bool CCmpctBlockFiller::CheckTxIndex(const std::vector<uint32>& vTxIndex, const std::size_t nTxCount)
+{
+    if (vTxIndex.size() > nTxCount)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < vTxIndex.size(); i++)
+    {
+        if (vTxIndex[i] >= nTxCount || (i > 0 && vTxIndex[i] <= vTxIndex[i - 1]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 ////////////////////////////////////
 // CBlockChannel
 
@@ -126,6 +237,7 @@ CBlockChannel::CBlockChannel()
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
     pBlockFilter = nullptr;
+    pTxPool = nullptr;
 }
 
 CBlockChannel::~CBlockChannel()
@@ -163,6 +275,12 @@ bool CBlockChannel::HandleInitialize()
         Error("Failed to request blockfilter");
         return false;
     }
+
+    if (!GetObject("txpool", pTxPool))
+    {
+        Error("Failed to request txpool");
+        return false;
+    }
     return true;
 }
 
@@ -173,6 +291,7 @@ void CBlockChannel::HandleDeinitialize()
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
     pBlockFilter = nullptr;
+    pTxPool = nullptr;
 }
 
 bool CBlockChannel::HandleInvoke()
@@ -301,54 +420,7 @@ bool CBlockChannel::HandleEvent(network::CEventPeerBlockBks& eventBks)
         return false;
     }
 
-    pBlockFilter->AddMaxPeerBlockNumber(hashFork, block.GetBlockNumber());
-
-    if (!pBlockChain->Exists(eventBks.data.hashPrev))
-    {
-        StdDebug("CBlockChannel", "CEvent peer block bks: Prev block not exist, block: %s, prev: %s",
-                 eventBks.data.hashBlock.GetBhString().c_str(), eventBks.data.hashPrev.GetBhString().c_str());
-
-        uint256 hashForkLastBlock;
-        if (pBlockChain->RetrieveForkLast(hashFork, hashForkLastBlock)
-            && CBlock::GetBlockChainIdByHash(hashBlock) > CBlock::GetBlockChainIdByHash(hashForkLastBlock) + 256)
-        {
-            StdDebug("CBlockChannel", "CEvent peer block bks: Block height is too recent, block: %s, last block: %s",
-                     eventBks.data.hashBlock.GetBhString().c_str(), hashForkLastBlock.GetBhString().c_str());
-            return true;
-        }
-
-        AddCacheBlock(hashBlock, block, eventBks.data.btBlockData.size(), nRecvPeerNonce);
-
-        auto it = mapChnFork.find(hashFork);
-        if (it != mapChnFork.end())
-        {
-            it->second.AddPrevBlockHash(block.hashPrev, hashBlock);
-            if (!it->second.CheckPrevExist(hashBlock))
-            {
-                SendNextPrevBlockReq(hashFork, hashBlock, nRecvPeerNonce);
-            }
-        }
-    }
-    else if (pBlockChain->Exists(eventBks.data.hashBlock))
-    {
-        StdDebug("CBlockChannel", "CEvent peer block bks: Block existed, block: %s, prev: %s",
-                 eventBks.data.hashBlock.GetBhString().c_str(), eventBks.data.hashPrev.GetBhString().c_str());
-    }
-    else
-    {
-        if (pDispatcher->AddNewBlock(block, nRecvPeerNonce, true) != OK)
-        {
-            StdLog("CBlockChannel", "CEvent peer block bks: Add new block fail, block: %s, fork: %s",
-                   eventBks.data.hashBlock.GetBhString().c_str(), hashFork.GetBhString().c_str());
-        }
-        else
-        {
-            StdDebug("CBlockChannel", "CEvent peer block bks: Add block success, block: %s, fork: %s",
-                     eventBks.data.hashBlock.GetBhString().c_str(), hashFork.GetBhString().c_str());
-
-            AddNextBlock(hashBlock);
-        }
-    }
+    ProcessRecvBlock(hashFork, hashBlock, block, eventBks.data.btBlockData.size(), nRecvPeerNonce);
     return true;
 }
 
@@ -493,8 +565,178 @@ bool CBlockChannel::HandleEvent(network::CEventPeerBlockGetBlockRsp& eventData)
     return true;
 }
 
+bool CBlockChannel::HandleEvent(network::CEventPeerBlockCmpct& eventCmpct)
+{
+    const uint256& hashFork = eventCmpct.hashFork;
+    const uint64 nRecvPeerNonce = eventCmpct.nNonce;
+    const network::CPeerCmpctBlockData& data = eventCmpct.data;
+
+    if (mapCmpctBlock.count(data.hashBlock) > 0 || pBlockChain->Exists(data.hashBlock))
+    {
+        return true;
+    }
+
+    CBlock block;
+    try
+    {
+        CBufStream ss(data.btBlockData);
+        ss >> block;
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    const std::size_t nTxCount = data.vPrefilledIndex.size() + data.vShortId.size();
+    if (block.vtx.size() != data.vPrefilledIndex.size() || nTxCount > MAX_CMPCT_BLOCK_TX_COUNT)
+    {
+        StdLog("CBlockChannel", "CEvent peer block cmpct: Tx count error, prefilled: %lu, short id: %lu, block: %s",
+               data.vPrefilledIndex.size(), data.vShortId.size(), data.hashBlock.GetBhString().c_str());
+        return false;
+    }
+
+    CCmpctBlockFiller filler(data.hashBlock, data.nSalt);
+    if (!filler.SetPrefilledTx(block.vtx, data.vPrefilledIndex, data.vShortId.size()))
+    {
+        StdLog("CBlockChannel", "CEvent peer block cmpct: Prefilled index error, block: %s", data.hashBlock.GetBhString().c_str());
+        return false;
+    }
+    if (!data.vShortId.empty())
+    {
+        std::vector<uint256> vPoolTxid;
+        pTxPool->ListTx(hashFork, vPoolTxid);
+        filler.SetPoolTxid(vPoolTxid);
+    }
+
+    std::vector<std::pair<uint32, uint256>> vMatch;
+    filler.MatchShortId(data.vShortId, vMatch);
+    std::vector<uint32> vMissIndex;
+    for (const auto& match : vMatch)
+    {
+        uint256 hashAtFork;
+        if (match.second == 0 || !pTxPool->Get(hashFork, match.second, filler.vtx[match.first], hashAtFork))
+        {
+            vMissIndex.push_back(match.first);
+        }
+    }
+    block.vtx.swap(filler.vtx);
+
+    StdDebug("CBlockChannel", "CEvent peer block cmpct: Recv compact block, txs: %lu, prefilled: %lu, missing: %lu, block: %s",
+             nTxCount, data.vPrefilledIndex.size(), vMissIndex.size(), data.hashBlock.GetBhString().c_str());
+
+    if (vMissIndex.empty())
+    {
+        CompleteCmpctBlock(hashFork, data.hashBlock, block, nRecvPeerNonce);
+        return true;
+    }
+
+    while (mapCmpctBlock.size() >= MAX_CMPCT_BLOCK_COUNT)
+    {
+        // the longest waiting block gives way and falls back to the full block
+        auto mt = std::min_element(mapCmpctBlock.begin(), mapCmpctBlock.end(),
+                                   [](const std::pair<const uint256, CChnCmpctBlock>& a, const std::pair<const uint256, CChnCmpctBlock>& b) { return a.second.nRecvTime < b.second.nRecvTime; });
+        StdLog("CBlockChannel", "CEvent peer block cmpct: Too many compact blocks waiting, request full block, block: %s", mt->first.GetBhString().c_str());
+        SendGetBlockReq(mt->second.hashFork, mt->first, mt->second.nRecvNonce);
+        mapCmpctBlock.erase(mt);
+    }
+    mapCmpctBlock.insert(std::make_pair(data.hashBlock, CChnCmpctBlock(hashFork, block, vMissIndex, nRecvPeerNonce)));
+
+    network::CEventPeerBlockGetBlockTxs eventGetTxs(nRecvPeerNonce, hashFork);
+    eventGetTxs.data.hashBlock = data.hashBlock;
+    eventGetTxs.data.vTxIndex = vMissIndex;
+    pPeerNet->DispatchEvent(&eventGetTxs);
+    return true;
+}
+
+bool CBlockChannel::HandleEvent(network::CEventPeerBlockGetBlockTxs& eventData)
+{
+    const uint256& hashFork = eventData.hashFork;
+    const uint64 nRecvPeerNonce = eventData.nNonce;
+    const uint256& hashBlock = eventData.data.hashBlock;
+    const std::vector<uint32>& vTxIndex = eventData.data.vTxIndex;
+
+    if (vTxIndex.size() > MAX_CMPCT_BLOCK_TX_COUNT)
+    {
+        StdLog("CBlockChannel", "CEvent peer block get block txs: Tx index count error, count: %lu, block: %s",
+               vTxIndex.size(), hashBlock.GetBhString().c_str());
+        return false;
+    }
+
+    // an empty reply makes the peer fall back to the full block
+    std::vector<CTransaction> vtx;
+    CBlock block;
+    if (pBlockChain->GetBlock(hashBlock, block))
+    {
+        // the missing indexes of a compact block are unique and ascending, anything else is not a real request
+        if (!CCmpctBlockFiller::CheckTxIndex(vTxIndex, block.vtx.size()))
+        {
+            StdLog("CBlockChannel", "CEvent peer block get block txs: Tx index error, count: %lu, block tx count: %lu, block: %s",
+                   vTxIndex.size(), block.vtx.size(), hashBlock.GetBhString().c_str());
+            return false;
+        }
+        vtx.reserve(vTxIndex.size());
+        for (const uint32 nIndex : vTxIndex)
+        {
+            vtx.push_back(block.vtx[nIndex]);
+        }
+    }
+
+    network::CEventPeerBlockBlockTxs eventTxs(nRecvPeerNonce, hashFork);
+    eventTxs.data.hashBlock = hashBlock;
+    CBufStream ss;
+    ss << vtx;
+    ss.GetData(eventTxs.data.btTxData);
+    pPeerNet->DispatchEvent(&eventTxs);
+    return true;
+}
+
+bool CBlockChannel::HandleEvent(network::CEventPeerBlockBlockTxs& eventData)
+{
+    const uint256& hashFork = eventData.hashFork;
+    const uint64 nRecvPeerNonce = eventData.nNonce;
+    const uint256& hashBlock = eventData.data.hashBlock;
+
+    auto it = mapCmpctBlock.find(hashBlock);
+    if (it == mapCmpctBlock.end() || it->second.nRecvNonce != nRecvPeerNonce)
+    {
+        return true;
+    }
+
+    std::vector<CTransaction> vtx;
+    try
+    {
+        CBufStream ss(eventData.data.btTxData);
+        ss >> vtx;
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        mapCmpctBlock.erase(it);
+        return false;
+    }
+
+    CChnCmpctBlock& cmpctBlock = it->second;
+    if (vtx.size() != cmpctBlock.vMissIndex.size())
+    {
+        StdLog("CBlockChannel", "CEvent peer block block txs: Tx count error, count: %lu, missing: %lu, block: %s",
+               vtx.size(), cmpctBlock.vMissIndex.size(), hashBlock.GetBhString().c_str());
+        mapCmpctBlock.erase(it);
+        SendGetBlockReq(hashFork, hashBlock, nRecvPeerNonce);
+        return true;
+    }
+    for (std::size_t i = 0; i < vtx.size(); i++)
+    {
+        cmpctBlock.block.vtx[cmpctBlock.vMissIndex[i]] = vtx[i];
+    }
+    CompleteCmpctBlock(hashFork, hashBlock, cmpctBlock.block, nRecvPeerNonce);
+    mapCmpctBlock.erase(it);
+    return true;
+}
+
 bool CBlockChannel::HandleEvent(network::CEventLocalBlockSyncTimer& eventData)
 {
+    ClearCmpctBlockTimeout();
+
     for (auto& kv : mapChnFork)
     {
         const uint256& hashFork = kv.first;
@@ -541,27 +783,59 @@ bool CBlockChannel::HandleEvent(network::CEventLocalBlockBroadcastBks& eventBroa
 {
     const uint64 nRecvPeerNonce = eventBroadBks.nNonce;
     const uint256& hashFork = eventBroadBks.hashFork;
+    const uint256& hashBlock = eventBroadBks.data.hashBlock;
+    CBlock& block = eventBroadBks.data.block;
 
     network::CEventPeerBlockBks eventBks(0, hashFork);
-
-    eventBks.data.hashBlock = eventBroadBks.data.hashBlock;
+    eventBks.data.hashBlock = hashBlock;
     eventBks.data.hashPrev = eventBroadBks.data.hashPrev;
-    CBufStream ss;
-    ss << eventBroadBks.data.block;
-    ss.GetData(eventBks.data.btBlockData);
+
+    network::CEventPeerBlockCmpct eventCmpct(0, hashFork);
+    eventCmpct.data.hashBlock = hashBlock;
+    eventCmpct.data.hashPrev = eventBroadBks.data.hashPrev;
+    std::vector<uint256> vShortTxid;
 
     for (auto& kv : mapChnPeer)
     {
-        if (kv.second.IsSubscribe(hashFork) && (nRecvPeerNonce == 0 || nRecvPeerNonce != kv.first))
+        if (!kv.second.IsSubscribe(hashFork) || (nRecvPeerNonce != 0 && nRecvPeerNonce == kv.first))
+        {
+            continue;
+        }
+        if (kv.second.IsCmpctBlock())
+        {
+            if (eventCmpct.data.btBlockData.empty())
+            {
+                BuildCmpctBlock(block, eventCmpct.data.btBlockData, eventCmpct.data.vPrefilledIndex, vShortTxid);
+            }
+            const CCmpctShortIdKey keyShortId(hashBlock, kv.second.nCmpctSalt);
+            eventCmpct.data.nSalt = kv.second.nCmpctSalt;
+            eventCmpct.data.vShortId.clear();
+            eventCmpct.data.vShortId.reserve(vShortTxid.size());
+            for (const uint256& txid : vShortTxid)
+            {
+                eventCmpct.data.vShortId.push_back(keyShortId.GetShortId(txid));
+            }
+            eventCmpct.nNonce = kv.first;
+            pPeerNet->DispatchEvent(&eventCmpct);
+            StdDebug("CBlockChannel", "CEvent local block broadcast bks: Broadcast compact block, peer nonce: 0x%x, txs: %lu, prefilled: %lu, block: %s",
+                     kv.first, block.vtx.size(), eventCmpct.data.vPrefilledIndex.size(), hashBlock.GetBhString().c_str());
+        }
+        else
         {
+            if (eventBks.data.btBlockData.empty())
+            {
+                CBufStream ss;
+                ss << block;
+                ss.GetData(eventBks.data.btBlockData);
+            }
             eventBks.nNonce = kv.first;
             pPeerNet->DispatchEvent(&eventBks);
             StdDebug("CBlockChannel", "CEvent local block broadcast bks: Broadcast block, peer nonce: 0x%x, txs: %lu, block: %s",
-                     kv.first, eventBroadBks.data.block.vtx.size(), eventBroadBks.data.hashBlock.GetBhString().c_str());
+                     kv.first, block.vtx.size(), hashBlock.GetBhString().c_str());
         }
     }
 
-    AddNextBlock(eventBroadBks.data.hashBlock);
+    AddNextBlock(hashBlock);
     return true;
 }
 
@@ -734,5 +1008,111 @@ void CBlockChannel::ClearCacheTimeout()
     }
 }
 
+void CBlockChannel::ProcessRecvBlock(const uint256& hashFork, const uint256& hashBlock, const CBlock& block, const uint64 nBlockSize, const uint64 nRecvPeerNonce)
+{
+    pBlockFilter->AddMaxPeerBlockNumber(hashFork, block.GetBlockNumber());
+
+    if (!pBlockChain->Exists(block.hashPrev))
+    {
+        StdDebug("CBlockChannel", "Process recv block: Prev block not exist, block: %s, prev: %s",
+                 hashBlock.GetBhString().c_str(), block.hashPrev.GetBhString().c_str());
+
+        uint256 hashForkLastBlock;
+        if (pBlockChain->RetrieveForkLast(hashFork, hashForkLastBlock)
+            && CBlock::GetBlockChainIdByHash(hashBlock) > CBlock::GetBlockChainIdByHash(hashForkLastBlock) + 256)
+        {
+            StdDebug("CBlockChannel", "Process recv block: Block height is too recent, block: %s, last block: %s",
+                     hashBlock.GetBhString().c_str(), hashForkLastBlock.GetBhString().c_str());
+            return;
+        }
+
+        AddCacheBlock(hashBlock, block, nBlockSize, nRecvPeerNonce);
+
+        auto it = mapChnFork.find(hashFork);
+        if (it != mapChnFork.end())
+        {
+            it->second.AddPrevBlockHash(block.hashPrev, hashBlock);
+            if (!it->second.CheckPrevExist(hashBlock))
+            {
+                SendNextPrevBlockReq(hashFork, hashBlock, nRecvPeerNonce);
+            }
+        }
+    }
+    else if (pBlockChain->Exists(hashBlock))
+    {
+        StdDebug("CBlockChannel", "Process recv block: Block existed, block: %s, prev: %s",
+                 hashBlock.GetBhString().c_str(), block.hashPrev.GetBhString().c_str());
+    }
+    else
+    {
+        if (pDispatcher->AddNewBlock(block, nRecvPeerNonce, true) != OK)
+        {
+            StdLog("CBlockChannel", "Process recv block: Add new block fail, block: %s, fork: %s",
+                   hashBlock.GetBhString().c_str(), hashFork.GetBhString().c_str());
+        }
+        else
+        {
+            StdDebug("CBlockChannel", "Process recv block: Add block success, block: %s, fork: %s",
+                     hashBlock.GetBhString().c_str(), hashFork.GetBhString().c_str());
+
+            AddNextBlock(hashBlock);
+        }
+    }
+}
+
+void CBlockChannel::BuildCmpctBlock(CBlock& block, bytes& btCmpctBlockData, std::vector<uint32>& vPrefilledIndex, std::vector<uint256>& vShortTxid)
+{
+    // txs that never pass through the tx pool are prefilled, the block goes out with only those in vtx
+    std::vector<CTransaction> vtx;
+    vtx.swap(block.vtx);
+    for (std::size_t i = 0; i < vtx.size(); i++)
+    {
+        if (vtx[i].IsUserTx())
+        {
+            vShortTxid.push_back(vtx[i].GetHash());
+        }
+        else
+        {
+            vPrefilledIndex.push_back(i);
+            block.vtx.push_back(vtx[i]);
+        }
+    }
+    CBufStream ss;
+    ss << block;
+    ss.GetData(btCmpctBlockData);
+    block.vtx.swap(vtx);
+}
+
+void CBlockChannel::CompleteCmpctBlock(const uint256& hashFork, const uint256& hashBlock, const CBlock& block, const uint64 nRecvPeerNonce)
+{
+    // the block hash covers the tx merkle root, so a short id collision shows up here
+    if (block.GetHash() != hashBlock)
+    {
+        StdLog("CBlockChannel", "Complete cmpct block: Block hash error, request full block, block: %s, peer: %s",
+               hashBlock.GetBhString().c_str(), GetPeerAddressInfo(nRecvPeerNonce).c_str());
+        SendGetBlockReq(hashFork, hashBlock, nRecvPeerNonce);
+        return;
+    }
+    ProcessRecvBlock(hashFork, hashBlock, block, GetSerializeSize(block), nRecvPeerNonce);
+}
+
+void CBlockChannel::ClearCmpctBlockTimeout()
+{
+    const int64 nCurrTime = GetTime();
+    for (auto it = mapCmpctBlock.begin(); it != mapCmpctBlock.end();)
+    {
+        if (it->second.nRecvTime + CMPCT_BLOCK_TIMEOUT < nCurrTime)
+        {
+            StdLog("CBlockChannel", "Clear cmpct block timeout: Missing txs timeout, request full block, block: %s", it->first.GetBhString().c_str());
+            SendGetBlockReq(it->second.hashFork, it->first, it->second.nRecvNonce);
+            mapCmpctBlock.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
 void CBlockChannel::RequestNextBlockData(const uint256& hashFork, const uint256& hashPrevBlock, const uint64 nNonce)
 } // namespace hashahead
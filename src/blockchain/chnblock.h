@@ -5,6 +5,8 @@
 #ifndef HASHAHEAD_CHNBLOCK_H
 #define HASHAHEAD_CHNBLOCK_H
 
+#include <unordered_map>
+
 #include "base.h"
 #include "peernet.h"
 #include "schedule.h"
@@ -16,9 +18,9 @@ class CBlockChnPeer
 {
 public:
     CBlockChnPeer()
-      : nService(0) {}
+      : nService(0), nCmpctSalt(0) {}
     CBlockChnPeer(uint64 nServiceIn, const network::CAddress& addr)
-      : nService(nServiceIn), addressRemote(addr) {}
+      : nService(nServiceIn), addressRemote(addr), nCmpctSalt(crypto::CryptoGetRand64()) {}
 
     const std::string GetRemoteAddress()
     {
@@ -48,11 +50,16 @@ public:
     {
         return (setSubscribeFork.count(hashFork) > 0);
     }
+    bool IsCmpctBlock() const
+    {
+        return ((nService & network::NODE_CMPCT_BLOCK) != 0);
+    }
 
 public:
     uint64 nService;
     network::CAddress addressRemote;
     std::set<uint256> setSubscribeFork;
+    uint64 nCmpctSalt; // salt of the short tx ids in compact blocks sent to this peer
 };
 
 class CBlockChnFork
@@ -89,6 +96,56 @@ public:
     const uint64 nRecvNonce;
 };
 
+// Short tx ids of one compact block, keyed by the block hash and the salt of the connection
+class CCmpctShortIdKey
+{
+public:
+    CCmpctShortIdKey(const uint256& hashBlock, const uint64 nSalt);
+    uint64 GetShortId(const uint256& txid) const;
+
+protected:
+    uint64 nKey0;
+    uint64 nKey1;
+};
+
+// Rebuilds the full tx list of a compact block from its prefilled txs and the short ids matched in the pool
+class CCmpctBlockFiller
+{
+public:
+    CCmpctBlockFiller(const uint256& hashBlock, const uint64 nSalt);
+
+    // Puts the prefilled txs at their indexes, false if an index is out of range or repeated
+    bool SetPrefilledTx(const std::vector<CTransaction>& vPrefilledTx, const std::vector<uint32>& vPrefilledIndex, const std::size_t nShortIdCount);
+    // A short id shared by several pool txs matches none of them
+    void SetPoolTxid(const std::vector<uint256>& vPoolTxid);
+    // Tx index and pool txid of each short id in tx order, the txid is null if no single pool tx matches
+    void MatchShortId(const std::vector<uint64>& vShortId, std::vector<std::pair<uint32, uint256>>& vMatch) const;
+    // Indexes requested from a block of nTxCount txs must be in range and strictly ascending
+    static bool CheckTxIndex(const std::vector<uint32>& vTxIndex, const std::size_t nTxCount);
+
+public:
+    std::vector<CTransaction> vtx;
+
+protected:
+    CCmpctShortIdKey keyShortId;
+    std::vector<bool> vFilled;
+    std::unordered_map<uint64, uint256> mapPoolShortId;
+};
+
+class CChnCmpctBlock
+{
+public:
+    CChnCmpctBlock(const uint256& hashForkIn, const CBlock& blockIn, const std::vector<uint32>& vMissIndexIn, const uint64 nRecvNonceIn)
+      : hashFork(hashForkIn), block(blockIn), vMissIndex(vMissIndexIn), nRecvNonce(nRecvNonceIn), nRecvTime(GetTime()) {}
+
+public:
+    uint256 hashFork;
+    CBlock block; // vtx has its full size, the missing txs are still null
+    std::vector<uint32> vMissIndex;
+    uint64 nRecvNonce;
+    int64 nRecvTime;
+};
+
 class CBlockChannel : public network::IBlockChannel
 {
 public:
@@ -111,6 +168,9 @@ protected:
     bool HandleEvent(network::CEventPeerBlockPrevBlocks& eventData) override;
     bool HandleEvent(network::CEventPeerBlockGetBlockReq& eventData) override;
     bool HandleEvent(network::CEventPeerBlockGetBlockRsp& eventData) override;
+    bool HandleEvent(network::CEventPeerBlockCmpct& eventCmpct) override;
+    bool HandleEvent(network::CEventPeerBlockGetBlockTxs& eventData) override;
+    bool HandleEvent(network::CEventPeerBlockBlockTxs& eventData) override;
 
     bool HandleEvent(network::CEventLocalBlockSyncTimer& eventData) override;
     bool HandleEvent(network::CEventLocalBlockSubscribeFork& eventSubsFork) override;
@@ -123,6 +183,10 @@ public:
 protected:
     const string GetPeerAddressInfo(const uint64 nNonce);
     void BlockSyncTimerFunc(uint32 nTimerId);
+    void ProcessRecvBlock(const uint256& hashFork, const uint256& hashBlock, const CBlock& block, const uint64 nBlockSize, const uint64 nRecvPeerNonce);
+    void BuildCmpctBlock(CBlock& block, bytes& btCmpctBlockData, std::vector<uint32>& vPrefilledIndex, std::vector<uint256>& vShortTxid);
+    void CompleteCmpctBlock(const uint256& hashFork, const uint256& hashBlock, const CBlock& block, const uint64 nRecvPeerNonce);
+    void ClearCmpctBlockTimeout();
     void AddCacheBlock(const uint256& hashBlock, const CBlock& block, const uint64 nBlockSize, const uint64 nRecvNonce);
     void RemoveCacheBlock(const uint256& hashBlock);
     void AddNextBlock(const uint256& hashPrev);
@@ -137,11 +201,13 @@ protected:
     ICoreProtocol* pCoreProtocol;
     IBlockChain* pBlockChain;
     IBlockFilter* pBlockFilter;
+    ITxPool* pTxPool;
 
     std::map<uint64, CBlockChnPeer> mapChnPeer;                                   // key: peer nonce
     std::map<uint256, CBlockChnFork> mapChnFork;                                  // key: fork hash
     std::map<uint256, CChnCacheBlock, CustomBlockHashCompare> mapChnBlock;        // key: block hash
     std::map<uint256, std::set<uint256>, CustomBlockHashCompare> mapChnPrevBlock; // key: prev block, value: next block
+    std::map<uint256, CChnCmpctBlock, CustomBlockHashCompare> mapCmpctBlock;      // key: block hash, compact blocks waiting for missing txs
 
     uint64 nPrevCheckCacheTimeoutTime;
     uint64 nCacheBlockByteCount;
@@ -4,6 +4,7 @@
 
 #include "chnusertx.h"
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 using namespace std;
@@ -11,12 +12,71 @@ using namespace hnbase;
 using boost::asio::ip::tcp;
 
 #define USER_TX_CHANNEL_THREAD_COUNT 1
+#define USER_TX_RELAY_TIMER_TIME 100
+#define USER_TX_ASK_TIMEOUT 2000
+#define USER_TX_RELAY_TX_EXPIRY 120
+#define USER_TX_RELAY_STAT_TIME 600
+#define MAX_USER_TX_RELAY_TX_COUNT 100000
+#define MAX_USER_TX_ASKFOR_COUNT 50000
+#define MAX_USER_TX_ANNOUNCER_COUNT 8
+#define MAX_USER_TX_INV_COUNT 4096
+#define MAX_USER_TX_GETTXS_COUNT 1024
+#define MAX_USER_TX_TXS_PAYLOAD_SIZE (2 * 1024 * 1024)
 
 namespace hashahead
 {
 
+////////////////////////////////////
+// CUserTxKnownFilter
+
+void CUserTxKnownFilter::Insert(const uint64 nShortId)
+{
+    if (nEntryCount >= GENERATION_ENTRY_COUNT)
+    {
+        nCurrent ^= 1;
+        nEntryCount = 0;
+        vGeneration[nCurrent].assign(GENERATION_BIT_COUNT / 64, 0);
+    }
+    std::vector<uint64>& vBits = vGeneration[nCurrent];
+    if (vBits.empty())
+    {
+        vBits.assign(GENERATION_BIT_COUNT / 64, 0);
+    }
+    for (uint32 n = 0; n < HASH_COUNT; n++)
+    {
+        const std::size_t nBit = GetBitIndex(nShortId, n);
+        vBits[nBit / 64] |= ((uint64)1 << (nBit % 64));
+    }
+    nEntryCount++;
+}
+
+bool CUserTxKnownFilter::Contains(const uint64 nShortId) const
+{
+    return (TestBits(vGeneration[nCurrent], nShortId) || TestBits(vGeneration[nCurrent ^ 1], nShortId));
+}
+
+bool CUserTxKnownFilter::TestBits(const std::vector<uint64>& vBits, const uint64 nShortId)
+{
+    if (vBits.empty())
+    {
+        return false;
+    }
+    for (uint32 n = 0; n < HASH_COUNT; n++)
+    {
+        const std::size_t nBit = GetBitIndex(nShortId, n);
+        if ((vBits[nBit / 64] & ((uint64)1 << (nBit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////
+// CUserTxChannel
+
 CUserTxChannel::CUserTxChannel()
-  : network::IUserTxChannel(USER_TX_CHANNEL_THREAD_COUNT)
+  : network::IUserTxChannel(USER_TX_CHANNEL_THREAD_COUNT), nRelayTimerId(0), nPrevStatLogTime(0)
 {
     pPeerNet = nullptr;
     pCoreProtocol = nullptr;
@@ -66,12 +126,27 @@ void CUserTxChannel::HandleDeinitialize()
 
 bool CUserTxChannel::HandleInvoke()
 {
+    nPrevStatLogTime = GetTime();
+    nRelayTimerId = SetTimer(USER_TX_RELAY_TIMER_TIME, boost::bind(&CUserTxChannel::RelayTimerFunc, this, _1));
+    if (nRelayTimerId == 0)
+    {
+        StdLog("CUserTxChannel", "Handle Invoke: Set timer fail");
+        return false;
+    }
     return network::IUserTxChannel::HandleInvoke();
 }
 
 void CUserTxChannel::HandleHalt()
 {
+    if (nRelayTimerId != 0)
+    {
+        CancelTimer(nRelayTimerId);
+        nRelayTimerId = 0;
+    }
     network::IUserTxChannel::HandleHalt();
+    mapAskFor.clear();
+    mapRelayTx.clear();
+    queRelayTxExpiry.clear();
 }
 
 bool CUserTxChannel::HandleEvent(network::CEventPeerActive& eventActive)
@@ -167,6 +242,17 @@ bool CUserTxChannel::HandleEvent(network::CEventPeerUsertxTxs& eventTxs)
         hnbase::StdError(__PRETTY_FUNCTION__, e.what());
         return false;
     }
+    auto it = mapChnPeer.find(nRecvPeerNonce);
+    for (const CTransaction& tx : vTxs)
+    {
+        const uint64 nShortId = GetShortId(tx.GetHash());
+        mapAskFor.erase(nShortId);
+        filterSeen.Insert(nShortId);
+        if (it != mapChnPeer.end())
+        {
+            it->second.filterKnown.Insert(nShortId);
+        }
+    }
     if (!vTxs.empty())
     {
         pTxPool->PushUserTx(nRecvPeerNonce, hashFork, vTxs);
@@ -174,6 +260,110 @@ bool CUserTxChannel::HandleEvent(network::CEventPeerUsertxTxs& eventTxs)
     return true;
 }
 
+bool CUserTxChannel::HandleEvent(network::CEventPeerUsertxInv& eventInv)
+{
+    const uint64 nRecvPeerNonce = eventInv.nNonce;
+    const uint256& hashFork = eventInv.hashFork;
+
+    auto it = mapChnPeer.find(nRecvPeerNonce);
+    if (it == mapChnPeer.end())
+    {
+        return true;
+    }
+    if (eventInv.data.size() > MAX_USER_TX_INV_COUNT)
+    {
+        StdLog("CUserTxChannel", "CEvent Peer Usertx Inv: Inv count error, count: %lu, peer: %s", eventInv.data.size(), GetPeerAddressInfo(nRecvPeerNonce).c_str());
+        return false;
+    }
+    if (mapChnFork.count(hashFork) == 0)
+    {
+        return true;
+    }
+
+    std::vector<uint64> vGetShortId;
+    const int64 nNow = GetTimeMillis();
+    for (const uint64 nShortId : eventInv.data)
+    {
+        it->second.filterKnown.Insert(nShortId);
+        if (filterSeen.Contains(nShortId))
+        {
+            continue;
+        }
+        auto mt = mapAskFor.find(nShortId);
+        if (mt != mapAskFor.end())
+        {
+            // already asked another peer, keep this one in case that ask times out
+            CUserTxAskFor& askFor = mt->second;
+            if (askFor.nAskNonce != nRecvPeerNonce && askFor.queAnnouncer.size() < MAX_USER_TX_ANNOUNCER_COUNT
+                && std::find(askFor.queAnnouncer.begin(), askFor.queAnnouncer.end(), nRecvPeerNonce) == askFor.queAnnouncer.end())
+            {
+                askFor.queAnnouncer.push_back(nRecvPeerNonce);
+            }
+            continue;
+        }
+        if (mapAskFor.size() >= MAX_USER_TX_ASKFOR_COUNT)
+        {
+            continue;
+        }
+        CUserTxAskFor& askFor = mapAskFor[nShortId];
+        askFor.hashFork = hashFork;
+        askFor.nAskNonce = nRecvPeerNonce;
+        askFor.nAskTime = nNow;
+        vGetShortId.push_back(nShortId);
+    }
+    SendGetTxs(nRecvPeerNonce, hashFork, vGetShortId);
+    return true;
+}
+
+bool CUserTxChannel::HandleEvent(network::CEventPeerUsertxGetTxs& eventGetTxs)
+{
+    const uint64 nRecvPeerNonce = eventGetTxs.nNonce;
+    const uint256& hashFork = eventGetTxs.hashFork;
+
+    auto it = mapChnPeer.find(nRecvPeerNonce);
+    if (it == mapChnPeer.end())
+    {
+        return true;
+    }
+    if (eventGetTxs.data.size() > MAX_USER_TX_GETTXS_COUNT)
+    {
+        StdLog("CUserTxChannel", "CEvent Peer Usertx GetTxs: Get count error, count: %lu, peer: %s", eventGetTxs.data.size(), GetPeerAddressInfo(nRecvPeerNonce).c_str());
+        return false;
+    }
+
+    // txs no longer cached are left out, the peer asks another announcer after a timeout
+    std::vector<CTransaction> vTxs;
+    std::size_t nPayloadSize = 0;
+    for (const uint64 nShortId : eventGetTxs.data)
+    {
+        auto mt = mapRelayTx.find(nShortId);
+        if (mt == mapRelayTx.end() || mt->second.hashFork != hashFork)
+        {
+            continue;
+        }
+        const std::size_t nTxSize = GetSerializeSize(mt->second.tx);
+        if (!vTxs.empty() && nPayloadSize + nTxSize > MAX_USER_TX_TXS_PAYLOAD_SIZE)
+        {
+            break;
+        }
+        it->second.filterKnown.Insert(nShortId);
+        vTxs.push_back(mt->second.tx);
+        nPayloadSize += nTxSize;
+    }
+    if (vTxs.empty())
+    {
+        return true;
+    }
+
+    network::CEventPeerUsertxTxs eventUserTxs(nRecvPeerNonce, hashFork);
+    CBufStream ss;
+    ss << vTxs;
+    ss.GetData(eventUserTxs.data);
+    statRelay.nTxBytes += MESSAGE_HEADER_SIZE + GetSerializeSize(eventUserTxs);
+    pPeerNet->DispatchEvent(&eventUserTxs);
+    return true;
+}
+
 bool CUserTxChannel::HandleEvent(network::CEventLocalUsertxSubscribeFork& eventSubsFork)
 {
     network::CEventPeerUsertxSubscribe eventSubscribe(0, pCoreProtocol->GetGenesisBlockHash());
@@ -204,19 +394,94 @@ bool CUserTxChannel::HandleEvent(network::CEventLocalUsertxBroadcastTxs& eventBr
     const uint64 nRecvPeerNonce = eventBroadTxs.nNonce;
     const uint256& hashFork = eventBroadTxs.hashFork;
 
-    network::CEventPeerUsertxTxs eventCertTxs(0, hashFork);
+    std::vector<uint64> vShortId;
+    std::size_t nTxBytes = 0;
+    vShortId.reserve(eventBroadTxs.data.size());
+    for (const CTransaction& tx : eventBroadTxs.data)
+    {
+        const uint64 nShortId = GetShortId(tx.GetHash());
+        filterSeen.Insert(nShortId);
+        AddRelayTx(hashFork, tx, nShortId);
+        vShortId.push_back(nShortId);
+        nTxBytes += GetSerializeSize(tx);
+    }
 
-    CBufStream ss;
-    ss << eventBroadTxs.data;
-    ss.GetData(eventCertTxs.data);
+    auto it = mapChnPeer.find(nRecvPeerNonce);
+    if (it != mapChnPeer.end())
+    {
+        for (const uint64 nShortId : vShortId)
+        {
+            it->second.filterKnown.Insert(nShortId);
+        }
+    }
+
+    network::CEventPeerUsertxTxs eventUserTxs(0, hashFork);
+    for (auto& kv : mapChnPeer)
+    {
+        CUserTxChnPeer& peer = kv.second;
+        if (!peer.IsSubscribe(hashFork) || (nRecvPeerNonce != 0 && nRecvPeerNonce == kv.first))
+        {
+            continue;
+        }
+        statRelay.nFullPushBytes += nTxBytes;
+
+        if (!peer.IsTxInv())
+        {
+            // peer without tx inventory support, push the txs in full as before
+            if (eventUserTxs.data.empty())
+            {
+                CBufStream ss;
+                ss << eventBroadTxs.data;
+                ss.GetData(eventUserTxs.data);
+            }
+            eventUserTxs.nNonce = kv.first;
+            statRelay.nTxBytes += MESSAGE_HEADER_SIZE + GetSerializeSize(eventUserTxs);
+            pPeerNet->DispatchEvent(&eventUserTxs);
+            continue;
+        }
+
+        std::vector<uint64>& vAnnounce = peer.mapAnnounce[hashFork];
+        for (const uint64 nShortId : vShortId)
+        {
+            if (!peer.filterKnown.Contains(nShortId))
+            {
+                peer.filterKnown.Insert(nShortId);
+                vAnnounce.push_back(nShortId);
+            }
+        }
+        if (vAnnounce.size() >= MAX_USER_TX_INV_COUNT)
+        {
+            FlushAnnounce(kv.first, peer);
+        }
+    }
+    statRelay.nRelayTxCount += vShortId.size();
+    return true;
+}
 
+bool CUserTxChannel::HandleEvent(network::CEventLocalUsertxRelayTimer& eventTimer)
+{
     for (auto& kv : mapChnPeer)
     {
-        if (kv.second.IsSubscribe(hashFork) && (nRecvPeerNonce == 0 || nRecvPeerNonce != kv.first))
+        FlushAnnounce(kv.first, kv.second);
+    }
+
+    ReaskTimeoutTx();
+
+    const int64 nNow = GetTime();
+    while (!queRelayTxExpiry.empty() && (queRelayTxExpiry.front().first + USER_TX_RELAY_TX_EXPIRY < nNow || queRelayTxExpiry.size() > MAX_USER_TX_RELAY_TX_COUNT))
+    {
+        auto it = mapRelayTx.find(queRelayTxExpiry.front().second);
+        if (it != mapRelayTx.end() && it->second.nTime == queRelayTxExpiry.front().first)
         {
-            eventCertTxs.nNonce = kv.first;
-            pPeerNet->DispatchEvent(&eventCertTxs);
+            mapRelayTx.erase(it);
         }
+        queRelayTxExpiry.pop_front();
+    }
+
+    if (nNow - nPrevStatLogTime >= USER_TX_RELAY_STAT_TIME)
+    {
+        LogRelayStat();
+        nPrevStatLogTime = nNow;
     }
     return true;
 }
@@ -252,4 +517,116 @@ const string CUserTxChannel::GetPeerAddressInfo(uint64 nNonce)
     return string("0.0.0.0");
 }
 
+void CUserTxChannel::AddRelayTx(const uint256& hashFork, const CTransaction& tx, const uint64 nShortId)
+{
+    const int64 nNow = GetTime();
+    mapRelayTx[nShortId] = CUserTxRelayTx(hashFork, tx, nNow);
+    queRelayTxExpiry.push_back(std::make_pair(nNow, nShortId));
+}
+
+void CUserTxChannel::FlushAnnounce(const uint64 nNonce, CUserTxChnPeer& peer)
+{
+    for (auto& kv : peer.mapAnnounce)
+    {
+        std::vector<uint64>& vAnnounce = kv.second;
+        std::size_t nPos = 0;
+        while (nPos < vAnnounce.size())
+        {
+            const std::size_t nCount = std::min(vAnnounce.size() - nPos, (std::size_t)MAX_USER_TX_INV_COUNT);
+            network::CEventPeerUsertxInv eventInv(nNonce, kv.first);
+            eventInv.data.assign(vAnnounce.begin() + nPos, vAnnounce.begin() + nPos + nCount);
+            statRelay.nInvBytes += MESSAGE_HEADER_SIZE + GetSerializeSize(eventInv);
+            pPeerNet->DispatchEvent(&eventInv);
+            nPos += nCount;
+        }
+    }
+    peer.mapAnnounce.clear();
+}
+
+void CUserTxChannel::SendGetTxs(const uint64 nNonce, const uint256& hashFork, std::vector<uint64>& vShortId)
+{
+    std::size_t nPos = 0;
+    while (nPos < vShortId.size())
+    {
+        const std::size_t nCount = std::min(vShortId.size() - nPos, (std::size_t)MAX_USER_TX_GETTXS_COUNT);
+        network::CEventPeerUsertxGetTxs eventGetTxs(nNonce, hashFork);
+        eventGetTxs.data.assign(vShortId.begin() + nPos, vShortId.begin() + nPos + nCount);
+        statRelay.nGetBytes += MESSAGE_HEADER_SIZE + GetSerializeSize(eventGetTxs);
+        pPeerNet->DispatchEvent(&eventGetTxs);
+        nPos += nCount;
+    }
+}
+
+void CUserTxChannel::ReaskTimeoutTx()
+{
+    // key: peer nonce, value: fork and short ids to ask it again
+    std::map<uint64, std::map<uint256, std::vector<uint64>>> mapReask;
+    const int64 nNow = GetTimeMillis();
+    for (auto it = mapAskFor.begin(); it != mapAskFor.end();)
+    {
+        CUserTxAskFor& askFor = it->second;
+        if (askFor.nAskTime + USER_TX_ASK_TIMEOUT > nNow)
+        {
+            ++it;
+            continue;
+        }
+        askFor.nAskNonce = 0;
+        while (!askFor.queAnnouncer.empty())
+        {
+            const uint64 nNonce = askFor.queAnnouncer.front();
+            askFor.queAnnouncer.pop_front();
+            if (mapChnPeer.count(nNonce))
+            {
+                askFor.nAskNonce = nNonce;
+                break;
+            }
+        }
+        if (askFor.nAskNonce == 0)
+        {
+            // nobody else announced it, a later announcement starts over
+            mapAskFor.erase(it++);
+            continue;
+        }
+        askFor.nAskTime = nNow;
+        mapReask[askFor.nAskNonce][askFor.hashFork].push_back(it->first);
+        ++it;
+    }
+    for (auto& kv : mapReask)
+    {
+        for (auto& kvFork : kv.second)
+        {
+            SendGetTxs(kv.first, kvFork.first, kvFork.second);
+        }
+    }
+}
+
+void CUserTxChannel::LogRelayStat()
+{
+    if (statRelay.nRelayTxCount == 0)
+    {
+        return;
+    }
+    const uint64 nSentBytes = statRelay.nInvBytes + statRelay.nGetBytes + statRelay.nTxBytes;
+    StdLog("CUserTxChannel", "Relay stat: relay tx: %lu, sent bytes per tx: %lu (inv: %lu, get: %lu, txs: %lu), full push bytes per tx: %lu, pending ask: %lu",
+           statRelay.nRelayTxCount, nSentBytes / statRelay.nRelayTxCount,
+           statRelay.nInvBytes / statRelay.nRelayTxCount, statRelay.nGetBytes / statRelay.nRelayTxCount,
+           statRelay.nTxBytes / statRelay.nRelayTxCount, statRelay.nFullPushBytes / statRelay.nRelayTxCount,
+           mapAskFor.size());
+    statRelay = CUserTxRelayStat();
+}
+
+void CUserTxChannel::RelayTimerFunc(uint32 nTimerId)
+{
+    if (nTimerId == nRelayTimerId)
+    {
+        nRelayTimerId = SetTimer(USER_TX_RELAY_TIMER_TIME, boost::bind(&CUserTxChannel::RelayTimerFunc, this, _1));
+        network::CEventLocalUsertxRelayTimer* pEvent = new network::CEventLocalUsertxRelayTimer(0, pCoreProtocol->GetGenesisBlockHash());
+        if (pEvent)
+        {
+            pEvent->data = nTimerId;
+            PostEvent(pEvent);
+        }
+    }
+}
+
 } // namespace hashahead
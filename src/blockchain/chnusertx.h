@@ -5,6 +5,8 @@
 #ifndef HASHAHEAD_CHNUSERTX_H
 #define HASHAHEAD_CHNUSERTX_H
 
+#include <deque>
+
 #include "base.h"
 #include "peernet.h"
 #include "schedule.h"
@@ -12,6 +14,80 @@
 namespace hashahead
 {
 
+// Rolling bloom filter of tx short ids, two generations so the oldest half is forgotten as a whole
+class CUserTxKnownFilter
+{
+public:
+    enum
+    {
+        GENERATION_ENTRY_COUNT = 16384,
+        GENERATION_BIT_COUNT = GENERATION_ENTRY_COUNT * 32,
+        HASH_COUNT = 16
+    };
+
+    CUserTxKnownFilter()
+      : nCurrent(0), nEntryCount(0) {}
+
+    void Insert(const uint64 nShortId);
+    bool Contains(const uint64 nShortId) const;
+
+protected:
+    static std::size_t GetBitIndex(const uint64 nShortId, const uint32 n)
+    {
+        const uint32 h1 = (uint32)nShortId;
+        const uint32 h2 = (uint32)(nShortId >> 32) | 1;
+        return (std::size_t)(h1 + n * h2) % GENERATION_BIT_COUNT;
+    }
+    static bool TestBits(const std::vector<uint64>& vBits, const uint64 nShortId);
+
+protected:
+    std::vector<uint64> vGeneration[2];
+    uint8 nCurrent;
+    std::size_t nEntryCount;
+};
+
+class CUserTxAskFor
+{
+public:
+    CUserTxAskFor()
+      : nAskNonce(0), nAskTime(0) {}
+    CUserTxAskFor(const uint256& hashForkIn)
+      : hashFork(hashForkIn), nAskNonce(0), nAskTime(0) {}
+
+public:
+    uint256 hashFork;
+    uint64 nAskNonce;
+    int64 nAskTime;
+    std::deque<uint64> queAnnouncer;
+};
+
+class CUserTxRelayTx
+{
+public:
+    CUserTxRelayTx() {}
+    CUserTxRelayTx(const uint256& hashForkIn, const CTransaction& txIn, const int64 nTimeIn)
+      : hashFork(hashForkIn), tx(txIn), nTime(nTimeIn) {}
+
+public:
+    uint256 hashFork;
+    CTransaction tx;
+    int64 nTime;
+};
+
+class CUserTxRelayStat
+{
+public:
+    CUserTxRelayStat()
+      : nRelayTxCount(0), nInvBytes(0), nGetBytes(0), nTxBytes(0), nFullPushBytes(0) {}
+
+public:
+    uint64 nRelayTxCount;
+    uint64 nInvBytes;
+    uint64 nGetBytes;
+    uint64 nTxBytes;
+    uint64 nFullPushBytes; // what pushing every tx in full to every peer would have sent
+};
+
 class CUserTxChnPeer
 {
 public:
@@ -48,11 +124,17 @@ public:
     {
         return (setSubscribeFork.count(hashFork) > 0);
     }
+    bool IsTxInv() const
+    {
+        return ((nService & network::NODE_TX_INV) != 0);
+    }
 
 public:
     uint64 nService;
     network::CAddress addressRemote;
     std::set<uint256> setSubscribeFork;
+    CUserTxKnownFilter filterKnown;
+    std::map<uint256, std::vector<uint64>> mapAnnounce; // key: fork hash, value: short ids waiting to be announced
 };
 
 class CUserTxChnFork
@@ -84,9 +166,12 @@ protected:
     bool HandleEvent(network::CEventPeerUsertxSubscribe& eventSubscribe) override;
     bool HandleEvent(network::CEventPeerUsertxUnsubscribe& eventUnsubscribe) override;
     bool HandleEvent(network::CEventPeerUsertxTxs& eventTxs) override;
+    bool HandleEvent(network::CEventPeerUsertxInv& eventInv) override;
+    bool HandleEvent(network::CEventPeerUsertxGetTxs& eventGetTxs) override;
 
     bool HandleEvent(network::CEventLocalUsertxSubscribeFork& eventSubsFork) override;
     bool HandleEvent(network::CEventLocalUsertxBroadcastTxs& eventBroadTxs) override;
+    bool HandleEvent(network::CEventLocalUsertxRelayTimer& eventTimer) override;
 
 public:
     void SubscribeFork(const uint256& hashFork, const uint64 nNonce) override;
@@ -94,6 +179,16 @@ public:
 
 protected:
     const string GetPeerAddressInfo(uint64 nNonce);
+    static uint64 GetShortId(const uint256& txid)
+    {
+        return txid.Get64();
+    }
+    void AddRelayTx(const uint256& hashFork, const CTransaction& tx, const uint64 nShortId);
+    void FlushAnnounce(const uint64 nNonce, CUserTxChnPeer& peer);
+    void SendGetTxs(const uint64 nNonce, const uint256& hashFork, std::vector<uint64>& vShortId);
+    void ReaskTimeoutTx();
+    void LogRelayStat();
+    void RelayTimerFunc(uint32 nTimerId);
 
 protected:
     network::CBbPeerNet* pPeerNet;
@@ -103,6 +198,14 @@ protected:
 
     std::map<uint64, CUserTxChnPeer> mapChnPeer;
     std::map<uint256, CUserTxChnFork> mapChnFork;
+
+    uint32 nRelayTimerId;
+    CUserTxKnownFilter filterSeen;                        // txs this node has already received or relayed
+    std::map<uint64, CUserTxAskFor> mapAskFor;            // key: short id
+    std::map<uint64, CUserTxRelayTx> mapRelayTx;          // key: short id, announced txs kept for GETTXS
+    std::deque<std::pair<int64, uint64>> queRelayTxExpiry; // value: announce time, short id
+    CUserTxRelayStat statRelay;
+    int64 nPrevStatLogTime;
 };
 
 } // namespace hashahead
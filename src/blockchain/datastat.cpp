@@ -197,6 +197,77 @@ bool CStatP2pSynFork::CumulativeStatData(uint32 nBeginTime, uint32 nGetCount, st
     return true;
 }
 
+//////////////////////////////
+// CStatPruneDbFork
+
+CStatPruneDbFork::CStatPruneDbFork()
+  : nStatPruneNodeCount(0), nStatPruneBytes(0)
+{
+    vStatTable.resize(STAT_MAX_ITEM_COUNT);
+    for (uint32 i = 0; i < STAT_MAX_ITEM_COUNT; i++)
+    {
+        vStatTable[i].nTimeValue = i;
+    }
+}
+
+CStatPruneDbFork::~CStatPruneDbFork()
+{
+    vStatTable.clear();
+}
+
+void CStatPruneDbFork::AddStatData(const uint64 nPruneNodeCount, const uint64 nPruneBytes)
+{
+    nStatPruneNodeCount += nPruneNodeCount;
+    nStatPruneBytes += nPruneBytes;
+}
+
+void CStatPruneDbFork::TimerStatData(uint32 nTimeValue)
+{
+    if (nTimeValue < STAT_MAX_ITEM_COUNT)
+    {
+        CStatItemPruneDb& data = vStatTable[nTimeValue];
+
+        data.nPruneNodeCount = nStatPruneNodeCount;
+        data.nPruneBytes = nStatPruneBytes;
+    }
+    nStatPruneNodeCount = 0;
+    nStatPruneBytes = 0;
+}
+
+bool CStatPruneDbFork::GetStatData(uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vOut)
+{
+    if (nBeginTime >= STAT_MAX_ITEM_COUNT || nGetCount == 0 || nGetCount > STAT_MAX_ITEM_COUNT)
+    {
+        return false;
+    }
+    uint32 nGetPos = nBeginTime;
+    for (uint32 i = 0; i < nGetCount; i++)
+    {
+        vOut.push_back(vStatTable[nGetPos]);
+        nGetPos = (nGetPos + 1) % STAT_MAX_ITEM_COUNT;
+    }
+    return true;
+}
+
+bool CStatPruneDbFork::CumulativeStatData(uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vOut)
+{
+    if (nBeginTime >= STAT_MAX_ITEM_COUNT || nGetCount == 0 || nGetCount > STAT_MAX_ITEM_COUNT || nGetCount != vOut.size())
+    {
+        return false;
+    }
+    uint32 nGetPos = nBeginTime;
+    for (uint32 i = 0; i < nGetCount; i++)
+    {
+        CStatItemPruneDb& out = vOut[i];
+        CStatItemPruneDb& get = vStatTable[nGetPos];
+        nGetPos = (nGetPos + 1) % STAT_MAX_ITEM_COUNT;
+
+        out.nPruneNodeCount += get.nPruneNodeCount;
+        out.nPruneBytes += get.nPruneBytes;
+    }
+    return true;
+}
+
 //////////////////////////////
 // CDataStat
 
@@ -281,6 +352,7 @@ void CDataStat::Clear()
     boost::unique_lock<boost::mutex> lock(mutex);
     mapStatBlockMaker.clear();
     mapStatP2pSyn.clear();
+    mapStatPruneDb.clear();
 }
 
 void CDataStat::StatTimerProc()
@@ -308,6 +380,7 @@ void CDataStat::StatTimerProc()
 
                 BlockMakerTimerStat(nTimeValue);
                 P2pSynTimerStat(nTimeValue);
+                PruneDbTimerStat(nTimeValue);
             }
         }
     }
@@ -331,6 +404,15 @@ void CDataStat::P2pSynTimerStat(uint32 nTimeValue)
     }
 }
 
+void CDataStat::PruneDbTimerStat(uint32 nTimeValue)
+{
+    map<uint256, CStatPruneDbFork>::iterator it = mapStatPruneDb.begin();
+    for (; it != mapStatPruneDb.end(); ++it)
+    {
+        (*it).second.TimerStatData(nTimeValue);
+    }
+}
+
 bool CDataStat::AddBlockMakerStatData(const uint256& hashFork, bool fPOW, uint64 nTxCountIn)
 {
     if (fStatWork)
@@ -407,6 +489,25 @@ bool CDataStat::AddP2pSynTxSynStatData(const uint256& hashFork, const uint64 nTx
     return true;
 }
 
+bool CDataStat::AddPruneDbStatData(const uint256& hashFork, const uint64 nPruneNodeCount, const uint64 nPruneBytes)
+{
+    if (fStatWork)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        map<uint256, CStatPruneDbFork>::iterator it = mapStatPruneDb.find(hashFork);
+        if (it == mapStatPruneDb.end())
+        {
+            it = mapStatPruneDb.insert(make_pair(hashFork, CStatPruneDbFork())).first;
+            if (it == mapStatPruneDb.end())
+            {
+                return false;
+            }
+        }
+        (*it).second.AddStatData(nPruneNodeCount, nPruneBytes);
+    }
+    return true;
+}
+
 bool CDataStat::GetBlockMakerStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemBlockMaker>& vStatData)
 {
     if (nBeginTime >= STAT_MAX_ITEM_COUNT || nGetCount == 0 || nGetCount > STAT_MAX_ITEM_COUNT)
@@ -517,4 +618,61 @@ bool CDataStat::GetP2pSynStatData(const uint256& hashFork, uint32 nBeginTime, ui
     return false;
 }
 
+bool CDataStat::GetPruneDbStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vStatData)
+{
+    if (nBeginTime >= STAT_MAX_ITEM_COUNT || nGetCount == 0 || nGetCount > STAT_MAX_ITEM_COUNT)
+    {
+        StdDebug("STAT", (string("GetPruneDbStatData fail: nBeginTime: ") + to_string(nBeginTime) + string(", nGetCount: ") + to_string(nGetCount) + string(".")).c_str());
+        return false;
+    }
+    if (fStatWork)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        vStatData.clear();
+        if (hashFork == 0)
+        {
+            bool fGetFirst = false;
+            map<uint256, CStatPruneDbFork>::iterator it = mapStatPruneDb.begin();
+            for (; it != mapStatPruneDb.end(); ++it)
+            {
+                if (!fGetFirst)
+                {
+                    fGetFirst = true;
+                    if (!(*it).second.GetStatData(nBeginTime, nGetCount, vStatData))
+                    {
+                        StdDebug("STAT", "GetPruneDbStatData: GetStatData fail.");
+                        return false;
+                    }
+                }
+                else
+                {
+                    if (!(*it).second.CumulativeStatData(nBeginTime, nGetCount, vStatData))
+                    {
+                        StdDebug("STAT", "GetPruneDbStatData: CumulativeStatData fail.");
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+        else
+        {
+            map<uint256, CStatPruneDbFork>::iterator it = mapStatPruneDb.find(hashFork);
+            if (it != mapStatPruneDb.end())
+            {
+                (*it).second.GetStatData(nBeginTime, nGetCount, vStatData);
+                return true;
+            }
+            else
+            {
+                // Nothing pruned on this fork yet: report empty slots.
+                CStatPruneDbFork statEmpty;
+                statEmpty.GetStatData(nBeginTime, nGetCount, vStatData);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 } // namespace hashahead
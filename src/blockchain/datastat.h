@@ -63,6 +63,26 @@ protected:
     std::vector<CStatItemP2pSyn> vStatTable;
 };
 
+//////////////////////////////////
+// CStatPruneDbFork
+
+class CStatPruneDbFork
+{
+public:
+    CStatPruneDbFork();
+    ~CStatPruneDbFork();
+
+    void AddStatData(const uint64 nPruneNodeCount, const uint64 nPruneBytes);
+    void TimerStatData(uint32 nTimeValue);
+    bool GetStatData(uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vOut);
+    bool CumulativeStatData(uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vOut);
+
+protected:
+    uint64 nStatPruneNodeCount;
+    uint64 nStatPruneBytes;
+    std::vector<CStatItemPruneDb> vStatTable;
+};
+
 //////////////////////////////
 // CDataStat
 
@@ -81,6 +101,9 @@ public:
     bool GetBlockMakerStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemBlockMaker>& vStatData) override;
     bool GetP2pSynStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemP2pSyn>& vStatData) override;
 
+    bool AddPruneDbStatData(const uint256& hashFork, const uint64 nPruneNodeCount, const uint64 nPruneBytes) override;
+    bool GetPruneDbStatData(const uint256& hashFork, uint32 nBeginTime, uint32 nGetCount, std::vector<CStatItemPruneDb>& vStatData) override;
+
 protected:
     const CRPCServerConfig* RPCServerConfig();
 
@@ -94,6 +117,7 @@ protected:
     void StatTimerProc();
     void BlockMakerTimerStat(uint32 nTimeValue);
     void P2pSynTimerStat(uint32 nTimeValue);
+    void PruneDbTimerStat(uint32 nTimeValue);
 
 protected:
     ICoreProtocol* pCoreProtocol;
@@ -107,6 +131,7 @@ protected:
 
     std::map<uint256, CStatBlockMakerFork> mapStatBlockMaker;
     std::map<uint256, CStatP2pSynFork> mapStatP2pSyn;
+    std::map<uint256, CStatPruneDbFork> mapStatPruneDb;
 };
 
 } // namespace hashahead
@@ -361,6 +361,11 @@ bool CBbEntry::InitializeModules(const EModeType& mode)
             {
                 dynamic_cast<CHttpServer*>(pBase)->AddNewHost(cfg);
             }
+            const CRPCServerConfig* pRPCConfig = CastConfigPtr<CRPCServerConfig*>(config.GetConfig());
+            if (pRPCConfig->nRPCIOThreads > 1)
+            {
+                dynamic_cast<CHttpServer*>(pBase)->AddIOThread(pRPCConfig->nRPCIOThreads - 1);
+            }
 
             if (!AttachModule(new CRPCMod()))
             {
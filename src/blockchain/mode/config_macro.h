@@ -17,7 +17,10 @@
 #define DEFAULT_WSPORT 8817
 #define DEFAULT_TESTNET_WSPORT 8818
 #define DEFAULT_RPC_MAX_CONNECTIONS 30
+#define DEFAULT_RPC_IO_THREADS 1
 #define DEFAULT_RPC_CONNECT_TIMEOUT 600 //120
+#define DEFAULT_RPC_MAX_LOGS_BLOCK_RANGE 5000
+#define DEFAULT_RPC_MAX_LOGS_RESULT_COUNT 10000
 
 // network config
 #define DEFAULT_P2PPORT 8811
@@ -26,6 +29,7 @@
 #define DEFAULT_MAX_INBOUNDS 155
 #define DEFAULT_MAX_OUTBOUNDS 30
 #define DEFAULT_CONNECT_TIMEOUT 5
+#define DEFAULT_NET_IO_THREADS 4
 
 // storage config
 #define DEFAULT_DB_CONNECTION 8
@@ -46,6 +46,11 @@ bool CNetworkConfig::PostLoad()
         nMaxInBounds = nMaxConnection - DEFAULT_MAX_OUTBOUNDS;
     }
 
+    if (nNetIOThreads == 0)
+    {
+        nNetIOThreads = 1;
+    }
+
     if (nConnectTimeout == 0)
     {
         nConnectTimeout = 1;
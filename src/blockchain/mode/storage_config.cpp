@@ -5,6 +5,7 @@
 #include "mode/storage_config.h"
 
 #include "mode/config_macro.h"
+#include "timeseries.h"
 
 namespace hashahead
 {
@@ -13,6 +14,8 @@ namespace po = boost::program_options;
 CStorageConfig::CStorageConfig()
 {
     fIsRecoveryBlock = false;
+    nBlockFileSyncMode = 0;
+    nBlockFileSyncParam = 0;
 
     po::options_description desc("Storage");
 
@@ -40,6 +43,26 @@ bool CStorageConfig::PostLoad()
         fIsRecoveryBlock = true;
     }
 
+    storage::CTimeSeriesSyncPolicy policy;
+    if (!policy.Parse(strBlockFileSync))
+    {
+        printf("blockfilesync is invalid, must be none, block, ms:<n> or bytes:<n>!\n");
+        return false;
+    }
+    nBlockFileSyncMode = policy.nMode;
+    nBlockFileSyncParam = policy.nParam;
+
+    if (nBlockCacheSize < 4 || nBlockCacheSize > 4096)
+    {
+        printf("blockcachesize is out of range, range: 4~4096!\n");
+        return false;
+    }
+    if (nBlockCachePinCount < 0 || nBlockCachePinCount > 1024)
+    {
+        printf("blockcachepin is out of range, range: 0~1024!\n");
+        return false;
+    }
+
     return true;
 }
 
@@ -22,6 +22,8 @@ public:
 
 public:
     bool fIsRecoveryBlock;
+    uint8 nBlockFileSyncMode;
+    uint32 nBlockFileSyncParam;
 };
 
 } // namespace hashahead
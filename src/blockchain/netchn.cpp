@@ -595,6 +595,24 @@ bool CNetChannel::AddCacheLocalPoaBlock(const CBlock& block)
     return ret;
 }
 
+bool CNetChannel::GetSyncStatus(const uint256& hashFork, network::CNetSyncStatus& status)
+{
+    {
+        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        map<uint256, CSchedule>::iterator it = mapSched.find(hashFork);
+        if (it == mapSched.end())
+        {
+            return false;
+        }
+        it->second.GetSyncStatus(status);
+    }
+    for (network::CNetSyncPeerStatus& peerStatus : status.vPeer)
+    {
+        peerStatus.strAddress = GetPeerAddressInfo(peerStatus.nNonce);
+    }
+    return true;
+}
+
 bool CNetChannel::HandleEvent(network::CEventPeerActive& eventActive)
 {
     uint64 nNonce = eventActive.nNonce;
@@ -767,6 +785,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerInv& eventInv)
                          GetPeerAddressInfo(nNonce).c_str(), hashFork.GetHex().c_str());
                 throw runtime_error(string("Get fork max height fail"));
             }
+            sched.SetSyncHeight(nForkMaxHeight);
 
             for (const network::CInv& inv : eventInv.data)
             {
@@ -1159,11 +1178,22 @@ bool CNetChannel::HandleEvent(network::CEventPeerBlock& eventBlock)
     uint32 nBlockHeight = block.GetBlockHeight();
     try
     {
+        // The checkpoint lookup only reads the block chain, keep it out of the schedule lock
+        //if (Config()->nMagicNum == MAINNET_MAGICNUM)
+        if (!TESTNET_FLAG)
+        {
+            if (!block.IsExtended() && !pBlockChain->VerifyCheckPoint(hashFork, (int)nBlockHeight, hash))
+            {
+                StdError("NetChannel", "Fork %s block at height %d does not match checkpoint hash", hashFork.ToString().c_str(), (int)nBlockHeight);
+                throw std::runtime_error("block doest not match checkpoint hash");
+            }
+        }
+
         boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
         set<uint64> setSchedPeer, setMisbehavePeer;
         CSchedule& sched = GetSchedule(hashFork);
 
-        if (!sched.ReceiveBlock(nNonce, hash, block, setSchedPeer))
+        if (!sched.ReceiveBlock(nNonce, hash, block, eventBlock.data.block.size(), setSchedPeer))
         {
             StdLog("NetChannel", "CEventPeerBlock: ReceiveBlock fail, block: %s", hash.GetHex().c_str());
             return true;
@@ -1171,16 +1201,6 @@ bool CNetChannel::HandleEvent(network::CEventPeerBlock& eventBlock)
         StdTrace("NetChannel", "CEventPeerBlock: receive block success, peer: %s, height: %d, block hash: %s",
                  GetPeerAddressInfo(nNonce).c_str(), CBlock::GetBlockHeightByHash(hash), hash.GetHex().c_str());
 
-        //if (Config()->nMagicNum == MAINNET_MAGICNUM)
-        if (!TESTNET_FLAG)
-        {
-            if (!block.IsExtended() && !pBlockChain->VerifyCheckPoint(hashFork, (int)nBlockHeight, hash))
-            {
-                StdError("NetChannel", "Fork %s block at height %d does not match checkpoint hash", hashFork.ToString().c_str(), (int)nBlockHeight);
-                throw std::runtime_error("block doest not match checkpoint hash");
-            }
-        }
-
         if (hashFork != pCoreProtocol->GetGenesisBlockHash() && !pBlockChain->IsVacantBlockBeforeCreatedForkHeight(hashFork, block))
         {
             StdError("NetChannel", "Fork %s block at height %d is not vacant block", hashFork.ToString().c_str(), (int)nBlockHeight);
@@ -1467,7 +1487,7 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     network::CEventPeerGetData eventGetData(nNonce, hashFork);
     bool fMissingPrev = false;
     bool fEmpty = true;
-    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, 2, fMissingPrev, fEmpty))
+    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, fMissingPrev, fEmpty))
     {
         if (fMissingPrev)
         {
@@ -1788,7 +1808,12 @@ void CNetChannel::AddNewBlock(const uint256& hashFork, const uint256& hash, CSch
                 if (pBlockChain->GetBlockLocation(hashBlock, nChainId, hashGetFork, nGetHeight, hashGetNext))
                 {
                     sched.SetLocatorInvBlockHash(nNonceSender, nGetHeight, hashBlock, hashGetNext);
+                    if (nGetHeight > sched.GetSyncHeight())
+                    {
+                        sched.SetSyncHeight(nGetHeight);
+                    }
                 }
+                sched.AddSyncBlock();
 
                 set<uint64> setKnownPeer;
                 sched.GetNextBlock(hashBlock, vBlockHash);
@@ -257,6 +257,7 @@ public:
     bool SubmitCachePoaBlock(const CConsensusParam& consParam) override;
     bool IsLocalCachePoaBlock(int nHeight, bool& fIsPos) override;
     bool AddCacheLocalPoaBlock(const CBlock& block) override;
+    bool GetSyncStatus(const uint256& hashFork, network::CNetSyncStatus& status) override;
 
 protected:
     enum
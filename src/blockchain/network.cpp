@@ -37,7 +37,7 @@ bool CNetwork::HandleInitialize()
         return false;
     }
 
-    Configure(NETWORK_NETID /*NetworkConfig()->nMagicNum*/, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED,
+    Configure(NETWORK_NETID /*NetworkConfig()->nMagicNum*/, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED | network::NODE_LARGE_FRAME | network::NODE_TX_INV | network::NODE_CMPCT_BLOCK,
               FormatSubVersion(), !NetworkConfig()->vConnectTo.empty(), pCoreProtocol->GetGenesisBlockHash());
 
     CPeerNetConfig config;
@@ -81,6 +81,10 @@ bool CNetwork::HandleInitialize()
         }
     }
     config.nMaxOutBounds = NetworkConfig()->nMaxOutBounds;
+    if (NetworkConfig()->nNetIOThreads > 1)
+    {
+        AddIOThread(NetworkConfig()->nNetIOThreads - 1);
+    }
     config.nPortDefault = (NetworkConfig()->fTestNet ? DEFAULT_TESTNET_P2PPORT : DEFAULT_P2PPORT);
     if (!NetworkConfig()->strSnapDownAddress.empty())
     {
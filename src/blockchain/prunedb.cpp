@@ -11,6 +11,9 @@ using namespace hnbase;
 namespace hashahead
 {
 
+// State nodes deleted per prune pass at most; passes run every 10 seconds.
+#define PRUNE_STATE_MAX_NODE_PER_PASS 200000
+
 /////////////////////////////////////////////////
 // CPruneDb
 
@@ -25,6 +28,7 @@ CPruneDb::CPruneDb()
 
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
+    pDataStat = nullptr;
 }
 
 CPruneDb::~CPruneDb()
@@ -43,6 +47,11 @@ bool CPruneDb::HandleInitialize()
         Error("Failed to request blockchain");
         return false;
     }
+    if (!GetObject("datastat", pDataStat))
+    {
+        Error("Failed to request datastat");
+        return false;
+    }
 
     fCfgPruneStateData = StorageConfig()->fPrune;
     nCfgPruneRetentionDays = StorageConfig()->nPruneRetentionDays;
@@ -76,6 +85,7 @@ void CPruneDb::HandleDeinitialize()
 {
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
+    pDataStat = nullptr;
 
     fExit = false;
     fCfgPruneStateData = false;
@@ -154,11 +164,33 @@ void CPruneDb::PruneStateWork()
     }
     for (auto& hashFork : vForkHash)
     {
+        PruneForkStateData(hashFork, nMinLastHeight);
         PruneForkData(hashFork, nMinLastHeight);
         PruneForkKvData(hashFork, nMinLastHeight);
     }
 }
 
+void CPruneDb::PruneForkStateData(const uint256& hashFork, const uint32 nRefLastHeight)
+{
+    if (nRefLastHeight <= nCfgPruneReserveHeight + CBlock::GetBlockHeightByHash(hashFork))
+    {
+        return;
+    }
+    const uint32 nPruneLastHeight = nRefLastHeight - nCfgPruneReserveHeight;
+
+    uint64 nPruneNodeCount = 0;
+    uint64 nPruneBytes = 0;
+    if (!pBlockChain->PruneForkStateData(hashFork, nPruneLastHeight, PRUNE_STATE_MAX_NODE_PER_PASS, nPruneNodeCount, nPruneBytes))
+    {
+        StdLog("CPruneDb", "Prune fork state data: Prune state fail, prune last height: %d, last height: %d, fork chainid: %d", nPruneLastHeight, nRefLastHeight, CBlock::GetBlockChainIdByHash(hashFork));
+        return;
+    }
+    if (nPruneNodeCount > 0)
+    {
+        pDataStat->AddPruneDbStatData(hashFork, nPruneNodeCount, nPruneBytes);
+    }
+}
+
 void CPruneDb::PruneForkData(const uint256& hashFork, const uint32 nRefLastHeight)
 {
     uint32& nPrevHeight = mapPrevPruneHeight[hashFork];
@@ -170,16 +202,6 @@ void CPruneDb::PruneForkData(const uint256& hashFork, const uint32 nRefLastHeigh
     {
         const uint32 nPruneLastHeight = nRefLastHeight - nCfgPruneReserveHeight;
 
-        StdDebug("CPruneDb", "Prune fork data: Prune state begin, prune last height: %d, last height: %d, fork chainid: %d", nPruneLastHeight, nRefLastHeight, CBlock::GetBlockChainIdByHash(hashFork));
-        if (!pBlockChain->PruneForkStateData(hashFork, nPruneLastHeight))
-        {
-            StdLog("CPruneDb", "Prune fork data: Prune state fail, prune last height: %d, last height: %d, fork chainid: %d", nPruneLastHeight, nRefLastHeight, CBlock::GetBlockChainIdByHash(hashFork));
-        }
-        else
-        {
-            StdDebug("CPruneDb", "Prune fork data: Prune state success, prune last height: %d, last height: %d, fork chainid: %d", nPruneLastHeight, nRefLastHeight, CBlock::GetBlockChainIdByHash(hashFork));
-        }
-
         if (hashFork != pCoreProtocol->GetGenesisBlockHash())
         {
             StdDebug("CPruneDb", "Prune fork data: Prune address begin, prune last height: %d, last height: %d, fork chainid: %d", nPruneLastHeight, nRefLastHeight, CBlock::GetBlockChainIdByHash(hashFork));
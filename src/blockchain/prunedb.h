@@ -26,12 +26,14 @@ protected:
     bool WaitExitEvent(const int64 nSeconds);
 
     void PruneStateWork();
+    void PruneForkStateData(const uint256& hashFork, const uint32 nRefLastHeight);
     void PruneForkData(const uint256& hashFork, const uint32 nRefLastHeight);
     void PruneForkKvData(const uint256& hashFork, const uint32 nRefLastHeight);
 
 protected:
     ICoreProtocol* pCoreProtocol;
     IBlockChain* pBlockChain;
+    IDataStat* pDataStat;
 
     bool fCfgPruneStateData;
     bool fCfgTraceDb;
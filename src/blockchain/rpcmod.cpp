@@ -41,7 +41,6 @@ namespace hashahead
 {
 
 #define UNLOCKKEY_RELEASE_DEFAULT_TIME 60
-#define MAX_FILTER_BLOCK_HEIGHT 5000
 
 const char* GetGitVersion();
 
@@ -919,6 +918,8 @@ CRPCMod::CRPCMod()
         ("removenode", &CRPCMod::RPCRemoveNode)
         //
         ("getforkport", &CRPCMod::RPCGetForkPort)
+        //
+        ("getsyncstatus", &CRPCMod::RPCGetSyncStatus)
         /* Blockchain & TxPool */
         ("getforkcount", &CRPCMod::RPCGetForkCount)
         //
@@ -1802,7 +1803,7 @@ CLogsFilter CRPCMod::GetLogFilterFromJson(const uint256& hashFork, const std::st
     {
         nToHeight = nLastHeight; // 0 is last block height
     }
-    if (nFromHeight > nToHeight || nToHeight - nFromHeight > MAX_FILTER_BLOCK_HEIGHT)
+    if (nFromHeight > nToHeight || nToHeight - nFromHeight > RPCServerConfig()->nRPCMaxLogsBlockRange)
     {
         throw CRPCException(RPC_ETH_ERROR_TRACE_REQUESTS_LIMITED, "invalid fromBlock or toBlock");
     }
@@ -2051,6 +2052,46 @@ CRPCResultPtr CRPCMod::RPCGetForkPort(const CReqContext& ctxReq, CRPCParamPtr pa
     return MakeCGetForkPortResultPtr(nPort);
 }
 
+CRPCResultPtr CRPCMod::RPCGetSyncStatus(const CReqContext& ctxReq, CRPCParamPtr param)
+{
+    if (!VerifyClientOrder(ctxReq))
+    {
+        throw CRPCException(RPC_FORBIDDEN_BY_SAFE_MODE, "Permission denied");
+    }
+    auto spParam = CastParamPtr<CGetSyncStatusParam>(param);
+
+    //getsyncstatus (-f="fork")
+    uint256 hashFork;
+    if (!GetForkHashOfDef(spParam->strFork, ctxReq.hashFork, hashFork))
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid fork");
+    }
+
+    network::CNetSyncStatus status;
+    if (!pService->HaveFork(hashFork) || !pService->GetSyncStatus(hashFork, status))
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Unknown fork");
+    }
+
+    auto rateToString = [](double dRate) -> std::string {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2) << dRate;
+        return oss.str();
+    };
+
+    auto spResult = MakeCGetSyncStatusResultPtr();
+    spResult->nHeight = status.nSyncHeight;
+    spResult->nSyncblocks = status.nSyncBlockCount;
+    spResult->strBlockspersec = rateToString(status.dBlockRate);
+    spResult->nReorderblocks = status.nReorderBlock;
+    for (const network::CNetSyncPeerStatus& peer : status.vPeer)
+    {
+        spResult->vecPeers.push_back({ peer.strAddress, peer.nBlockWindow, peer.nAssignedBlock, peer.nRecvBlockCount,
+                                       rateToString(peer.dBlockRate), (uint64)peer.dBytesRate });
+    }
+    return spResult;
+}
+
 CRPCResultPtr CRPCMod::RPCGetForkCount(const CReqContext& ctxReq, CRPCParamPtr param)
 {
     return MakeCGetForkCountResultPtr(pService->GetForkCount());
@@ -6789,8 +6830,18 @@ CRPCResultPtr CRPCMod::RPCListContractAddress(const CReqContext& ctxReq, CRPCPar
 
     uint256 hashBlock = GetRefBlock(hashFork, spParam->strBlock);
 
+    CDestination destBegin;
+    if (spParam->strBegin.IsValid() && !spParam->strBegin.empty())
+    {
+        if (!destBegin.ParseString(spParam->strBegin))
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Invalid begin address");
+        }
+    }
+    uint32 nCount = spParam->nCount;
+
     std::map<CDestination, CContractAddressContext> mapContractAddress;
-    if (!pService->ListContractAddress(hashFork, hashBlock, mapContractAddress))
+    if (!pService->ListContractAddress(hashFork, hashBlock, destBegin, nCount, mapContractAddress))
     {
         throw CRPCException(RPC_INVALID_PARAMETER, "Unknown fork");
     }
@@ -7856,7 +7907,8 @@ CRPCResultPtr CRPCMod::RPCQueryStat(const CReqContext& ctxReq, CRPCParamPtr para
     {
         TYPE_NON,
         TYPE_MAKER,
-        TYPE_P2PSYN
+        TYPE_P2PSYN,
+        TYPE_PRUNEDB
     } eType
         = TYPE_NON;
     uint32 nDefQueryCount = 20;
@@ -7878,6 +7930,10 @@ CRPCResultPtr CRPCMod::RPCQueryStat(const CReqContext& ctxReq, CRPCParamPtr para
     {
         eType = TYPE_P2PSYN;
     }
+    else if (spParam->strType == "prunedb")
+    {
+        eType = TYPE_PRUNEDB;
+    }
     else
     {
         throw CRPCException(RPC_INVALID_PARAMETER, "Invalid type");
@@ -8098,6 +8154,62 @@ CRPCResultPtr CRPCMod::RPCQueryStat(const CReqContext& ctxReq, CRPCParamPtr para
         }
         return MakeCQueryStatResultPtr(strResult);
     }
+    case TYPE_PRUNEDB:
+    {
+        std::vector<CStatItemPruneDb> vStatData;
+        if (nGetCount > 0)
+        {
+            if (!pDataStat->GetPruneDbStatData(hashFork, nBeginTimeValue, nGetCount, vStatData))
+            {
+                throw CRPCException(RPC_INTERNAL_ERROR, "query error");
+            }
+        }
+
+        int nTimeWidth = 8 + 2;                                 //hh:mm:ss + two spaces
+        int nPruneNodesWidth = string("prunenodes").size() + 2; //+ two spaces
+        int nPruneBytesWidth = string("prunebytes").size() + 2; //+ two spaces
+        for (const CStatItemPruneDb& item : vStatData)
+        {
+            int nTempValue;
+            nTempValue = to_string(item.nPruneNodeCount).size() + 2; //+ two spaces
+            if (nTempValue > nPruneNodesWidth)
+            {
+                nPruneNodesWidth = nTempValue;
+            }
+            nTempValue = to_string(item.nPruneBytes).size() + 2; //+ two spaces
+            if (nTempValue > nPruneBytesWidth)
+            {
+                nPruneBytesWidth = nTempValue;
+            }
+        }
+
+        int64 nTimeOffset = GetLocalTimeSeconds() - GetTime();
+
+        string strResult;
+        strResult += GetWidthString("time", nTimeWidth);
+        strResult += GetWidthString("prunenodes", nPruneNodesWidth);
+        strResult += GetWidthString("prunebytes", nPruneBytesWidth);
+        strResult += string("\r\n");
+        for (const CStatItemPruneDb& item : vStatData)
+        {
+            int nLocalTimeValue = item.nTimeValue * 60 + nTimeOffset;
+            if (nLocalTimeValue >= 0)
+            {
+                nLocalTimeValue %= (24 * 3600);
+            }
+            else
+            {
+                nLocalTimeValue += (24 * 3600);
+            }
+            char sTimeBuf[128] = { 0 };
+            sprintf(sTimeBuf, "%2.2d:%2.2d:59", nLocalTimeValue / 3600, nLocalTimeValue % 3600 / 60);
+            strResult += GetWidthString(sTimeBuf, nTimeWidth);
+            strResult += GetWidthString(to_string(item.nPruneNodeCount), nPruneNodesWidth);
+            strResult += GetWidthString(to_string(item.nPruneBytes), nPruneBytesWidth);
+            strResult += string("\r\n");
+        }
+        return MakeCQueryStatResultPtr(strResult);
+    }
     default:
         break;
     }
@@ -9707,18 +9819,19 @@ CRPCResultPtr CRPCMod::RPCEthGetLogs(const CReqContext& ctxReq, CRPCParamPtr par
     //     }
     // }
 
-    ReceiptLogsVec vReceiptLogs;
-    if (!pService->GetTxReceiptsByLogsFilter(ctxReq.hashFork, logsFilter, vReceiptLogs))
-    {
-        StdLog("CRPCMod", "RPC EthGetLogs: Get logs fail");
-        return MakeCeth_getLogsResultPtr();
-    }
-
+    // logs are converted as the blocks are walked, the walk stops once the result limit is passed
+    const std::size_t nMaxLogsCount = RPCServerConfig()->nRPCMaxLogsResultCount;
+    bool fExceedLimit = false;
     auto spResult = MakeCeth_getLogsResultPtr();
-    for (auto& v : vReceiptLogs)
-    {
+    auto funcWalker = [&](const CReceiptLogs& v) -> bool {
         for (auto& d : v.matchLogs)
         {
+            if (nMaxLogsCount > 0 && spResult->vecResult.size() >= nMaxLogsCount)
+            {
+                fExceedLimit = true;
+                return false;
+            }
+
             CTxReceiptLogs txLogs;
 
             txLogs.fRemoved = d.fRemoved;
@@ -9743,6 +9856,17 @@ CRPCResultPtr CRPCMod::RPCEthGetLogs(const CReqContext& ctxReq, CRPCParamPtr par
 
             spResult->vecResult.push_back(txLogs);
         }
+        return true;
+    };
+
+    if (!pService->WalkThroughReceiptLogsByFilter(ctxReq.hashFork, logsFilter, RPCServerConfig()->nRPCMaxLogsBlockRange + 1, funcWalker))
+    {
+        StdLog("CRPCMod", "RPC EthGetLogs: Get logs fail");
+        return MakeCeth_getLogsResultPtr();
+    }
+    if (fExceedLimit)
+    {
+        throw CRPCException(RPC_ETH_ERROR_TRACE_REQUESTS_LIMITED, std::string("query returned more than ") + to_string(nMaxLogsCount) + " results");
     }
     return spResult;
 }
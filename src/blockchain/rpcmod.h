@@ -87,6 +87,7 @@ private:
     rpc::CRPCResultPtr RPCAddNode(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCRemoveNode(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCGetForkPort(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
+    rpc::CRPCResultPtr RPCGetSyncStatus(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
     /* Worldline & TxPool */
     rpc::CRPCResultPtr RPCGetForkCount(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCListFork(const CReqContext& ctxReq, rpc::CRPCParamPtr param);
@@ -10,6 +10,80 @@ using namespace hnbase;
 namespace hashahead
 {
 
+///////////////////////////////
+// CSyncRateStat
+
+void CSyncRateStat::Add(uint64 nCount, uint64 nBytes)
+{
+    int64 nCurTime = GetTime();
+    pair<uint64, uint64>& slot = mapSlot[nCurTime];
+    slot.first += nCount;
+    slot.second += nBytes;
+    nTotalCount += nCount;
+    nTotalBytes += nBytes;
+    Trim(nCurTime);
+}
+
+double CSyncRateStat::GetCountRate() const
+{
+    int64 nBeginTime = GetTime() - RATE_STAT_WINDOW_TIME;
+    uint64 nCount = 0;
+    for (auto it = mapSlot.upper_bound(nBeginTime); it != mapSlot.end(); ++it)
+    {
+        nCount += it->second.first;
+    }
+    return (double)nCount / RATE_STAT_WINDOW_TIME;
+}
+
+double CSyncRateStat::GetBytesRate() const
+{
+    int64 nBeginTime = GetTime() - RATE_STAT_WINDOW_TIME;
+    uint64 nBytes = 0;
+    for (auto it = mapSlot.upper_bound(nBeginTime); it != mapSlot.end(); ++it)
+    {
+        nBytes += it->second.second;
+    }
+    return (double)nBytes / RATE_STAT_WINDOW_TIME;
+}
+
+void CSyncRateStat::Trim(int64 nCurTime)
+{
+    mapSlot.erase(mapSlot.begin(), mapSlot.upper_bound(nCurTime - RATE_STAT_WINDOW_TIME));
+}
+
+///////////////////////////////
+// CInvPeer
+
+void CInvPeer::ReceivedBlock(size_t nSize)
+{
+    statBlock.Add(1, nSize);
+    if (!GetAssigned(network::CInv::MSG_BLOCK).empty() || nWindowBlockCount == 0)
+    {
+        return;
+    }
+
+    // The whole window arrived: size the next one to what this peer delivers in BLOCK_WINDOW_TARGET_TIME,
+    // growing at most twofold per window so one fast burst does not over-commit a peer
+    int64 nUsedTime = GetTimeMillis() - nWindowStartTime;
+    if (nUsedTime <= 0)
+    {
+        nUsedTime = 1;
+    }
+    size_t nTarget = (size_t)(nWindowBlockCount * BLOCK_WINDOW_TARGET_TIME / nUsedTime);
+    nBlockWindow = std::min(std::min(nTarget, nBlockWindow * 2), (size_t)MAX_PEER_BLOCK_WINDOW);
+    if (nBlockWindow < MIN_PEER_BLOCK_WINDOW)
+    {
+        nBlockWindow = MIN_PEER_BLOCK_WINDOW;
+    }
+    nWindowBlockCount = 0;
+}
+
+void CInvPeer::ShrinkBlockWindow()
+{
+    nBlockWindow = std::max(nBlockWindow / 2, (size_t)MIN_PEER_BLOCK_WINDOW);
+    nWindowBlockCount = 0;
+}
+
 ///////////////////////////////
 // COrphan
 
@@ -209,7 +283,7 @@ void CSchedule::RemoveInvState(const network::CInv& inv)
     mapState.erase(inv);
 }
 
-bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, set<uint64>& setSchedPeer)
+bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, size_t nBlockSize, set<uint64>& setSchedPeer)
 {
     map<network::CInv, CInvState>::iterator it = mapState.find(network::CInv(network::CInv::MSG_BLOCK, hash));
     if (it != mapState.end())
@@ -221,7 +295,9 @@ bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBloc
             state.nRecvObjTime = GetTime();
             state.nClearObjTime = GetTime() + MAX_OBJ_WAIT_TIME;
             setSchedPeer.insert(state.setKnownPeer.begin(), state.setKnownPeer.end());
-            mapPeer[nPeerNonce].Completed((*it).first);
+            CInvPeer& peer = mapPeer[nPeerNonce];
+            peer.Completed((*it).first);
+            peer.ReceivedBlock(nBlockSize);
             if (block.IsPrimary() && block.IsProofOfPoa())
             {
                 mapHeightBlock[block.GetBlockHeight()].push_back(make_pair(hash, CACHE_POW_BLOCK_TYPE_REMOTE));
@@ -335,7 +411,7 @@ void CSchedule::InvalidateTx(const uint256& txid, set<uint64>& setMisbehavePeer)
     RemoveInv(network::CInv(network::CInv::MSG_TX, txid), setMisbehavePeer);
 }
 
-bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv, size_t nMaxCount, bool& fMissingPrev, bool& fEmpty)
+bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv, bool& fMissingPrev, bool& fEmpty)
 {
     fMissingPrev = false;
     fEmpty = true;
@@ -348,7 +424,7 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
         if (!peer.IsAssigned())
         {
             bool fReceivedAll;
-            if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, nMaxCount, fReceivedAll))
+            if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, peer.GetBlockWindow(), fReceivedAll))
             {
                 if (fReceivedAll && peer.CheckNextGetBlocksTime() && CheckAddInvIdleLocation(nPeerNonce, network::CInv::MSG_BLOCK))
                 {
@@ -358,6 +434,10 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
             }
             else
             {
+                if (!vInv.empty())
+                {
+                    peer.StartBlockWindow(vInv.size());
+                }
                 if (fEmpty && peer.CheckNextGetBlocksTime())
                 {
                     fMissingPrev = true;
@@ -419,6 +499,10 @@ bool CSchedule::CancelAssignedInv(uint64 nPeerNonce, const network::CInv& inv)
         else
         {
             (*mt).second.RemoveInv(inv);
+            if (inv.nType == network::CInv::MSG_BLOCK)
+            {
+                (*mt).second.ShrinkBlockWindow();
+            }
         }
     }
     return true;
@@ -787,6 +871,26 @@ void CSchedule::RemoveOrphan(const network::CInv& inv)
     }
 }
 
+void CSchedule::GetSyncStatus(network::CNetSyncStatus& status)
+{
+    status.nSyncHeight = nSyncHeight;
+    status.nSyncBlockCount = statSync.nTotalCount;
+    status.dBlockRate = statSync.GetCountRate();
+    status.nReorderBlock = orphanBlock.GetSize();
+    for (auto& vd : mapPeer)
+    {
+        CInvPeer& peer = vd.second;
+        network::CNetSyncPeerStatus peerStatus;
+        peerStatus.nNonce = vd.first;
+        peerStatus.nBlockWindow = peer.GetBlockWindow();
+        peerStatus.nAssignedBlock = peer.GetAssigned(network::CInv::MSG_BLOCK).size();
+        peerStatus.nRecvBlockCount = peer.statBlock.nTotalCount;
+        peerStatus.dBlockRate = peer.statBlock.GetCountRate();
+        peerStatus.dBytesRate = peer.statBlock.GetBytesRate();
+        status.vPeer.push_back(peerStatus);
+    }
+}
+
 bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                                  vector<network::CInv>& vInv, size_t nMaxCount, bool& fReceivedAll)
 {
@@ -820,6 +924,7 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                         continue;
                     }
                     state.nAssigned = nPeerNonce;
+                    state.nAssignTime = nCurTime;
                     vInv.push_back(inv);
                     peer.Assign(inv);
                     state.nGetDataCount++;
@@ -845,6 +950,11 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
             if (it != mapState.end())
             {
                 CInvState& state = it->second;
+                if (type == network::CInv::MSG_BLOCK && !state.IsReceived()
+                    && (int64)CBlock::GetBlockHeightByHash(hash) > (int64)nSyncHeight + MAX_REORDER_BLOCK_HEIGHT)
+                {
+                    continue;
+                }
                 if (state.nAssigned == 0)
                 {
                     if (state.nGetDataCount >= MAX_REGETDATA_COUNT
@@ -857,6 +967,7 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                         continue;
                     }
                     state.nAssigned = nPeerNonce;
+                    state.nAssignTime = nCurTime;
                     vInv.push_back(inv);
                     peer.Assign(inv);
                     state.nGetDataCount++;
@@ -877,6 +988,38 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                     }
                     nReceived++;
                 }
+                else if (type == network::CInv::MSG_BLOCK && state.nAssigned != nPeerNonce
+                         && nCurTime - state.nAssignTime >= MAX_BLOCK_ASSIGN_WAIT_TIME)
+                {
+                    // a block no peer delivers within the regetdata limits is dropped instead of moving between peers
+                    if (state.nGetDataCount >= MAX_REGETDATA_COUNT
+                        || (state.nGetDataCount >= 1 && nCurTime - state.nRecvInvTime >= MAX_INV_WAIT_TIME)
+                        || nCurTime - state.nRecvInvTime >= MAX_INV_WAIT_TIME * 12)
+                    {
+                        StdLog("Schedule", "ScheduleKnownInv: inv timeout, peer nonce: 0x%lx, inv: [%d] %s, getcount: %d, waittime: %ld",
+                               nPeerNonce, inv.nType, inv.nHash.GetHex().c_str(), state.nGetDataCount, nCurTime - state.nRecvInvTime);
+                        setRemoveInv.insert(inv);
+                        continue;
+                    }
+                    // A stalled peer must not hold the bottom of the reorder window, move the block to this peer
+                    StdLog("Schedule", "ScheduleKnownInv: block assign timeout, prev peer nonce: 0x%lx, peer nonce: 0x%lx, inv: [%d] %s, waittime: %ld",
+                           state.nAssigned, nPeerNonce, inv.nType, inv.nHash.GetHex().c_str(), nCurTime - state.nAssignTime);
+                    map<uint64, CInvPeer>::iterator mt = mapPeer.find(state.nAssigned);
+                    if (mt != mapPeer.end())
+                    {
+                        mt->second.Completed(inv);
+                        mt->second.ShrinkBlockWindow();
+                    }
+                    state.nAssigned = nPeerNonce;
+                    state.nAssignTime = nCurTime;
+                    vInv.push_back(inv);
+                    peer.Assign(inv);
+                    state.nGetDataCount++;
+                    if (vInv.size() >= nMaxCount)
+                    {
+                        break;
+                    }
+                }
             }
             else
             {
@@ -8,6 +8,7 @@
 #include <boost/variant.hpp>
 
 #include "block.h"
+#include "peer.h"
 #include "proto.h"
 #include "struct.h"
 #include "transaction.h"
@@ -18,6 +19,31 @@ using namespace hnbase;
 namespace hashahead
 {
 
+class CSyncRateStat
+{
+public:
+    CSyncRateStat()
+      : nTotalCount(0), nTotalBytes(0) {}
+    void Add(uint64 nCount, uint64 nBytes);
+    double GetCountRate() const;
+    double GetBytesRate() const;
+
+protected:
+    void Trim(int64 nCurTime);
+
+public:
+    enum
+    {
+        RATE_STAT_WINDOW_TIME = 30
+    };
+
+    uint64 nTotalCount;
+    uint64 nTotalBytes;
+
+protected:
+    std::map<int64, std::pair<uint64, uint64>> mapSlot;
+};
+
 class CInvPeer
 {
     class CInvPeerState
@@ -33,8 +59,15 @@ class CInvPeer
     };
 
 public:
+    enum
+    {
+        MIN_PEER_BLOCK_WINDOW = 2,
+        MAX_PEER_BLOCK_WINDOW = 32,
+        BLOCK_WINDOW_TARGET_TIME = 2000
+    };
+
     CInvPeer()
-      : nInvHeight(0)
+      : nInvHeight(0), nBlockWindow(MIN_PEER_BLOCK_WINDOW), nWindowStartTime(0), nWindowBlockCount(0)
     {
     }
     ~CInvPeer()
@@ -162,6 +195,17 @@ public:
     {
         return (GetTime() >= invKnown[network::CInv::MSG_BLOCK - network::CInv::MSG_TX].nNextGetBlocksTime);
     }
+    std::size_t GetBlockWindow() const
+    {
+        return nBlockWindow;
+    }
+    void StartBlockWindow(std::size_t nCount)
+    {
+        nWindowStartTime = GetTimeMillis();
+        nWindowBlockCount = nCount;
+    }
+    void ReceivedBlock(std::size_t nSize);
+    void ShrinkBlockWindow();
     int64 AddRepeatBlock(const uint256& hash)
     {
         if (KnownInvExists(network::CInv(network::CInv::MSG_BLOCK, hash)))
@@ -178,6 +222,10 @@ public:
     uint256 hashGetBlockLocatorDepth;
     int nInvHeight;
     uint256 hashInvBlock;
+    std::size_t nBlockWindow;
+    int64 nWindowStartTime;
+    std::size_t nWindowBlockCount;
+    CSyncRateStat statBlock;
 };
 
 class COrphan
@@ -201,7 +249,7 @@ class CSchedule
     {
     public:
         CInvState()
-          : nAssigned(0), objReceived(CNil()), nRecvInvTime(0), nRecvObjTime(0), nClearObjTime(0),
+          : nAssigned(0), objReceived(CNil()), nRecvInvTime(0), nAssignTime(0), nRecvObjTime(0), nClearObjTime(0),
             nGetDataCount(0), fRepeatMintBlock(false), fVerifyPoaBlock(false) {}
         bool IsReceived()
         {
@@ -213,6 +261,7 @@ class CSchedule
         CInvObject objReceived;
         std::set<uint64> setKnownPeer;
         int64 nRecvInvTime;
+        int64 nAssignTime;
         int64 nRecvObjTime;
         int64 nClearObjTime;
         int nGetDataCount;
@@ -235,7 +284,9 @@ public:
         MAX_SUB_BLOCK_DELAYED_TIME = 120,
         MAX_CERTTX_DELAYED_TIME = 180,
         //MAX_SUBMIT_POW_TIMEOUT = 10,
-        MAX_MINTTX_DELAYED_TIME = 180
+        MAX_MINTTX_DELAYED_TIME = 180,
+        MAX_BLOCK_ASSIGN_WAIT_TIME = 60,
+        MAX_REORDER_BLOCK_HEIGHT = 256
     };
 
     enum
@@ -245,6 +296,8 @@ public:
     };
 
 public:
+    CSchedule()
+      : nSyncHeight(0) {}
     bool Exists(const network::CInv& inv);
     bool CheckPrevTxInv(const network::CInv& inv);
     void GetKnownPeer(const network::CInv& inv, std::set<uint64>& setKnownPeer);
@@ -252,7 +305,7 @@ public:
     bool CheckAddInvIdleLocation(uint64 nPeerNonce, uint32 nInvType);
     bool AddNewInv(const network::CInv& inv, uint64 nPeerNonce);
     bool RemoveInv(const network::CInv& inv, std::set<uint64>& setKnownPeer);
-    bool ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, std::set<uint64>& setSchedPeer);
+    bool ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, std::size_t nBlockSize, std::set<uint64>& setSchedPeer);
     void RemoveInvState(const network::CInv& inv);
     bool ReceiveTx(uint64 nPeerNonce, const uint256& txid, const CTransaction& tx, std::set<uint64>& setSchedPeer);
     CBlock* GetBlock(const uint256& hash, uint64& nNonceSender);
@@ -263,7 +316,7 @@ public:
     uint256 GetNextTx(const CDestination& destFrom, const uint64 nNextTxNonce);
     void InvalidateBlock(const uint256& hash, std::set<uint64>& setMisbehavePeer);
     void InvalidateTx(const uint256& txid, std::set<uint64>& setMisbehavePeer);
-    bool ScheduleBlockInv(uint64 nPeerNonce, std::vector<network::CInv>& vInv, std::size_t nMaxCount, bool& fMissingPrev, bool& fEmpty);
+    bool ScheduleBlockInv(uint64 nPeerNonce, std::vector<network::CInv>& vInv, bool& fMissingPrev, bool& fEmpty);
     bool ScheduleTxInv(uint64 nPeerNonce, std::vector<network::CInv>& vInv, std::size_t nMaxCount, bool& fReceivedAll);
     bool CancelAssignedInv(uint64 nPeerNonce, const network::CInv& inv);
     bool GetLocatorDepthHash(uint64 nPeerNonce, uint256& hashDepth);
@@ -288,6 +341,19 @@ public:
     void RemoveHeightBlock(int nHeight, const uint256& hash);
     bool GetPoaBlockState(const uint256& hash, bool& fVerifyPoaBlockOut);
     void SetPoaBlockVerifyState(const uint256& hash, bool fVerifyPoaBlockIn);
+    int GetSyncHeight() const
+    {
+        return nSyncHeight;
+    }
+    void SetSyncHeight(int nHeight)
+    {
+        nSyncHeight = nHeight;
+    }
+    void AddSyncBlock()
+    {
+        statSync.Add(1, 0);
+    }
+    void GetSyncStatus(network::CNetSyncStatus& status);
 
 protected:
     void RemoveOrphan(const network::CInv& inv);
@@ -304,6 +370,8 @@ protected:
     std::map<uint256, std::map<uint256, uint256>> mapRefBlock;
     std::map<int, std::vector<std::pair<uint256, int>>> mapHeightBlock;
     std::map<int, CBlock> mapKcPoaBlock;
+    int nSyncHeight;
+    CSyncRateStat statSync;
 };
 
 } // namespace hashahead
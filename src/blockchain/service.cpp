@@ -188,6 +188,11 @@ bool CService::GetForkRpcPort(const uint256& hashFork, uint16& nRpcPort)
     return (nRpcPort != 0);
 }
 
+bool CService::GetSyncStatus(const uint256& hashFork, network::CNetSyncStatus& status)
+{
+    return pNetChannel->GetSyncStatus(hashFork, status);
+}
+
 int CService::GetForkCount()
 {
     map<uint256, CForkContext> mapForkCtxt;
@@ -717,7 +722,7 @@ bool CService::GetBlockRewardList(const uint256& hashLastBlock, const uint32 nBl
 uint256 CService::AddLogsFilter(const uint256& hashClient, const uint256& hashFork, const CLogsFilter& logsFilter)
 {
     std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare> mapBlockReceipts; // key: block hash
-    pBlockChain->GetBlockReceiptsByBlock(hashFork, logsFilter.hashFromBlock, logsFilter.hashToBlock, mapBlockReceipts);
+    pBlockChain->GetBlockReceiptsByLogsFilter(hashFork, logsFilter, mapBlockReceipts);
     return pBlockFilter->AddLogsFilter(hashClient, hashFork, logsFilter, mapBlockReceipts);
 }
 
@@ -731,17 +736,10 @@ bool CService::GetTxReceiptLogsByFilterId(const uint256& nFilterId, const bool f
     return pBlockFilter->GetTxReceiptLogsByFilterId(nFilterId, fAll, receiptLogs);
 }
 
-bool CService::GetTxReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, ReceiptLogsVec& vReceiptLogs)
+bool CService::WalkThroughReceiptLogsByFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerReceiptLogsFunc fnWalker)
 {
-    std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare> mapBlockReceipts; // key: block hash
-    if (!pBlockChain->GetBlockReceiptsByBlock(hashFork, logsFilter.hashFromBlock, logsFilter.hashToBlock, mapBlockReceipts))
-    {
-        return false;
-    }
-    for (const auto& kv : mapBlockReceipts)
-    {
-        const uint256& hashBlock = kv.first;
-        for (const auto& receipt : kv.second)
+    auto funcWalker = [&](const uint256& hashBlock, const std::vector<CTransactionReceipt>& vTxReceipt) -> bool {
+        for (const auto& receipt : vTxReceipt)
         {
             MatchLogsVec vLogs;
             logsFilter.matchesLogs(receipt, vLogs);
@@ -752,17 +750,15 @@ bool CService::GetTxReceiptsByLogsFilter(const uint256& hashFork, const CLogsFil
                 r.txid = receipt.txid;
                 r.nBlockNumber = receipt.nBlockNumber;
                 r.hashBlock = hashBlock;
-                vReceiptLogs.push_back(r);
-
-                if (vReceiptLogs.size() > MAX_FILTER_CACHE_COUNT)
+                if (!fnWalker(r))
                 {
-                    StdLog("CService", "Get tx receipts by logs filter: Query returned more than %lu results", MAX_FILTER_CACHE_COUNT);
                     return false;
                 }
             }
         }
-    }
-    return true;
+        return true;
+    };
+    return pBlockChain->WalkThroughBlockReceiptsByLogsFilter(hashFork, logsFilter, nMaxBlockCount, funcWalker);
 }
 
 uint256 CService::AddBlockFilter(const uint256& hashClient, const uint256& hashFork)
@@ -1381,7 +1377,7 @@ bool CService::ListContractCodeContext(const uint256& hashFork, const uint256& h
     return pBlockChain->ListContractCreateCodeContext(hashFork, hashLastBlock, txid, mapContractCode);
 }
 
-bool CService::ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CService::ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
 {
     uint256 hashLastBlock = hashRefBlock;
     if (hashRefBlock == 0)
@@ -1391,7 +1387,7 @@ bool CService::ListContractAddress(const uint256& hashFork, const uint256& hashR
             return false;
         }
     }
-    return pBlockChain->ListContractAddress(hashFork, hashLastBlock, mapContractAddress);
+    return pBlockChain->ListContractAddress(hashFork, hashLastBlock, destBegin, nCount, mapContractAddress);
 }
 
 bool CService::ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
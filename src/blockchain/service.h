@@ -26,6 +26,7 @@ public:
     bool AddNode(const hnbase::CNetHost& node) override;
     bool RemoveNode(const hnbase::CNetHost& node) override;
     bool GetForkRpcPort(const uint256& hashFork, uint16& nRpcPort) override;
+    bool GetSyncStatus(const uint256& hashFork, network::CNetSyncStatus& status) override;
     /* Blockchain & Tx Pool*/
     int GetForkCount() override;
     bool HaveFork(const uint256& hashFork) override;
@@ -88,7 +89,7 @@ public:
     uint256 AddLogsFilter(const uint256& hashClient, const uint256& hashFork, const CLogsFilter& logsFilter) override;
     void RemoveFilter(const uint256& nFilterId) override;
     bool GetTxReceiptLogsByFilterId(const uint256& nFilterId, const bool fAll, ReceiptLogsVec& receiptLogs) override;
-    bool GetTxReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, ReceiptLogsVec& vReceiptLogs) override;
+    bool WalkThroughReceiptLogsByFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerReceiptLogsFunc fnWalker) override;
     uint256 AddBlockFilter(const uint256& hashClient, const uint256& hashFork) override;
     bool GetFilterBlockHashs(const uint256& hashFork, const uint256& nFilterId, const bool fAll, std::vector<uint256>& vBlockHash) override;
     uint256 AddPendingTxFilter(const uint256& hashClient, const uint256& hashFork) override;
@@ -129,7 +130,7 @@ public:
     void GetWalletDestinations(std::set<CDestination>& setDest) override;
     bool GetForkContractCodeContext(const uint256& hashFork, const uint256& hashRefBlock, const uint256& hashContractCode, CContractCodeContext& ctxtContractCode) override;
     bool ListContractCodeContext(const uint256& hashFork, const uint256& hashRefBlock, const uint256& txid, std::map<uint256, CContractCodeContext>& mapContractCode) override;
-    bool ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress) override;
+    bool ListContractAddress(const uint256& hashFork, const uint256& hashRefBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress) override;
     bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress) override;
     bool GetAddressCount(const uint256& hashFork, const uint256& hashBlock, uint64& nAddressCount, uint64& nNewAddressCount) override;
     bool GetOwnerLinkTemplateAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destOwner, std::map<CDestination, uint8>& mapTemplateAddress) override;
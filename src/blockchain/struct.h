@@ -311,7 +311,7 @@ typedef boost::multi_index_container<
     CUInt256List;
 typedef CUInt256List::nth_index<1>::type CUInt256ByValue;
 
-/* CStatItemBlockMaker & CStatItemP2pSyn */
+/* CStatItemBlockMaker & CStatItemP2pSyn & CStatItemPruneDb */
 class CStatItemBlockMaker
 {
 public:
@@ -343,6 +343,18 @@ public:
     uint64 nSynSendTxTPS;
 };
 
+class CStatItemPruneDb
+{
+public:
+    CStatItemPruneDb()
+      : nTimeValue(0), nPruneNodeCount(0), nPruneBytes(0) {}
+
+    uint32 nTimeValue;
+
+    uint64 nPruneNodeCount;
+    uint64 nPruneBytes;
+};
+
 } // namespace hashahead
 
 #endif // HASHAHEAD_STRUCT_H
@@ -17,6 +17,8 @@ namespace hashahead
 //////////////////////////////
 // CBlock
 
+CHashCacheStat CBlock::statHashCache;
+
 void CBlock::SetNull()
 {
     nVersion = 1;
@@ -39,6 +41,8 @@ void CBlock::SetNull()
     btBloomData.clear();
     vtx.clear();
     mapProve.clear();
+
+    cacheTxMerkleRoot.Reset();
 }
 
 bool CBlock::IsNull() const
@@ -114,9 +118,9 @@ std::size_t CBlock::GetTxSerializedOffset() const
     {
         btCrosschainMerkleRoot = hashCrosschainMerkleRoot.GetBytes();
     }
-    hnbase::CBufStream ss;
+    hnbase::CFlatWriteStream ss;
     ss << nVersion << nType << CVarInt(nTimeStamp) << CVarInt(nNumber) << nHeight << nSlot << hashPrev << btMerkleRoot << hashStateRoot << btReceiptsRoot << btCrosschainMerkleRoot << btBloomData << btGasLimit << btGasUsed << mapProof;
-    return ss.GetSize();
+    return ss.GetWritePos();
 }
 
 void CBlock::GetSerializedProofOfWorkData(std::vector<unsigned char>& vchProofOfWork) const
@@ -574,6 +578,11 @@ bool CBlock::VerifyBlockMerkleProve(const uint256& hashBlock, const hnbase::MERK
     return (hashBlock == uint256(GetBlockChainIdByHash(hashBlock), GetBlockHeightByHash(hashBlock), GetBlockSlotByHash(hashBlock), CMerkleTree::GetMerkleRootByProve(merkleProve, hashVerify)));
 }
 
+const CHashCacheStat& CBlock::GetHashCacheStat()
+{
+    return statHashCache;
+}
+
 //-------------------------------------------------------
 uint256 CBlock::CalcMerkleTreeRoot() const
 {
@@ -690,13 +699,24 @@ uint256 CBlock::CalcBlockBaseMerkleTreeRoot(SHP_MERKLE_PROVE_DATA ptrMerkleProve
 
 uint256 CBlock::CalcTxMerkleTreeRoot() const
 {
-    std::vector<uint256> vMerkleTree;
-    vMerkleTree.push_back(txMint.GetHash());
+    std::vector<uint256> vLeaf;
+    vLeaf.reserve(vtx.size() + 1);
+    vLeaf.push_back(txMint.GetHash());
     for (const CTransaction& tx : vtx)
     {
-        vMerkleTree.push_back(tx.GetHash());
+        vLeaf.push_back(tx.GetHash());
     }
-    return CMerkleTree::BuildMerkleTree(vMerkleTree);
+
+    uint256 hashRoot;
+    if (cacheTxMerkleRoot.Get(vLeaf, hashRoot))
+    {
+        statHashCache.AddHit();
+        return hashRoot;
+    }
+    hashRoot = CMerkleTree::CalcMerkleTreeRoot(vLeaf);
+    cacheTxMerkleRoot.Set(vLeaf, hashRoot);
+    statHashCache.AddCalc();
+    return hashRoot;
 }
 
 //-------------------------------------------------------
@@ -761,7 +781,7 @@ void CBlock::Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         btCrosschainMerkleRoot = hashCrosschainMerkleRoot.GetBytes();
     }
-    hnbase::CBufStream ss;
+    hnbase::CFlatWriteStream ss;
     ss << nVersion << nType << CVarInt(nTimeStamp) << CVarInt(nNumber) << nHeight << nSlot << hashPrev << btMerkleRoot << hashStateRoot << btReceiptsRoot << btCrosschainMerkleRoot << btBloomData << btGasLimit << btGasUsed << mapProof << txMint << vtx << mapProve << vchSig;
     serSize = ss.GetSize();
 }
@@ -891,7 +911,7 @@ void CBlockDexOrderProve::Serialize(hnbase::CStream& s, hnbase::LoadType&)
 void CBlockDexOrderProve::Serialize(hnbase::CStream& s, std::size_t& serSize) const
 {
     (void)s;
-    hnbase::CBufStream ss;
+    hnbase::CFlatWriteStream ss;
     ss << destOrder << nChainIdOwner << nChainIdPeer << strCoinSymbolOwner << strCoinSymbolPeer << hnbase::CVarInt(nOrderNumber) << nOrderAmount.ToValidBigEndianData() << nOrderPrice.ToValidBigEndianData();
     serSize = ss.GetSize();
 }
@@ -919,9 +939,9 @@ bool CBlockCrosschainProve::IsCrossProveNull() const
 
 uint256 CBlockCrosschainProve::GetHash() const
 {
-    hnbase::CBufStream ss;
-    ss << *this;
-    return crypto::CryptoHash(ss.GetData(), ss.GetSize());
+    bytes btData;
+    hnbase::FlatSerialize(*this, btData);
+    return crypto::CryptoHash(btData.data(), btData.size());
 }
 
 void CBlockCrosschainProve::AddCoinTransferProve(const CDestination& destTransIn, const std::string& strCoinSymbolIn, const CChainId nOriChainIdIn, const CChainId nDestChainIdIn, const uint256& nTransferAmountIn)
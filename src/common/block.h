@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "crc24q.h"
+#include "hashcache.h"
 #include "profile.h"
 #include "proof.h"
 #include "template/template.h"
@@ -134,6 +135,7 @@ public:
 
     static bool BlockHashCompare(const uint256& a, const uint256& b); // return true: a < b, false: a >= b
     static bool VerifyBlockMerkleProve(const uint256& hashBlock, const hnbase::MERKLE_PROVE_DATA& merkleProve, const uint256& hashVerify);
+    static const CHashCacheStat& GetHashCacheStat();
 
 protected:
     uint256 CalcMerkleTreeRoot() const;
@@ -141,6 +143,11 @@ protected:
     uint256 CalcBlockBaseMerkleTreeRoot(hnbase::SHP_MERKLE_PROVE_DATA ptrMerkleProvePrevBlock, hnbase::SHP_MERKLE_PROVE_DATA ptrMerkleProveRefBlock) const;
     uint256 CalcTxMerkleTreeRoot() const;
 
+protected:
+    // Header fields are public, so the tx merkle root is checked against the current tx hashes rather than reset by mutators
+    CMerkleRootCache cacheTxMerkleRoot;
+    static CHashCacheStat statHashCache;
+
 protected:
     void Serialize(hnbase::CStream& s, hnbase::SaveType&) const;
     void Serialize(hnbase::CStream& s, hnbase::LoadType&);
@@ -949,7 +956,7 @@ protected:
     void Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         (void)s;
-        hnbase::CBufStream ss;
+        hnbase::CFlatWriteStream ss;
         ss << destTransfer << strCoinSymbol << nOriChainId << nDestChainId << nTransferAmount.ToValidBigEndianData();
         serSize = ss.GetSize();
     }
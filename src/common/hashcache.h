@@ -0,0 +1,171 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMON_HASHCACHE_H
+#define COMMON_HASHCACHE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "uint256.h"
+
+namespace hashahead
+{
+
+// Counts hash computations against memoized hits, shared by all objects of one type
+class CHashCacheStat
+{
+public:
+    CHashCacheStat()
+      : nCalcCount(0), nHitCount(0) {}
+
+    void AddCalc()
+    {
+        nCalcCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void AddHit()
+    {
+        nHitCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64 GetCalcCount() const
+    {
+        return nCalcCount.load(std::memory_order_relaxed);
+    }
+    uint64 GetHitCount() const
+    {
+        return nHitCount.load(std::memory_order_relaxed);
+    }
+
+protected:
+    std::atomic<uint64> nCalcCount;
+    std::atomic<uint64> nHitCount;
+};
+
+// Memoized hash of the owning object, the owner resets it in every mutator.
+// Concurrent const readers may compute the hash at the same time, only the first one publishes it.
+class CHashCache
+{
+public:
+    CHashCache()
+      : nState(HC_EMPTY) {}
+    CHashCache(const CHashCache& other)
+      : nState(HC_EMPTY)
+    {
+        CopyFrom(other);
+    }
+    CHashCache& operator=(const CHashCache& other)
+    {
+        if (this != &other)
+        {
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    bool Get(uint256& hashOut) const
+    {
+        if (nState.load(std::memory_order_acquire) != HC_READY)
+        {
+            return false;
+        }
+        hashOut = hashCached;
+        return true;
+    }
+    void Set(const uint256& hashIn) const
+    {
+        uint8 nExpected = HC_EMPTY;
+        if (nState.compare_exchange_strong(nExpected, HC_WRITING, std::memory_order_acquire))
+        {
+            hashCached = hashIn;
+            nState.store(HC_READY, std::memory_order_release);
+        }
+    }
+    void Reset()
+    {
+        nState.store(HC_EMPTY, std::memory_order_relaxed);
+    }
+
+protected:
+    enum : uint8
+    {
+        HC_EMPTY = 0,
+        HC_WRITING = 1,
+        HC_READY = 2
+    };
+
+    void CopyFrom(const CHashCache& other)
+    {
+        uint256 hash;
+        if (other.Get(hash))
+        {
+            hashCached = hash;
+            nState.store(HC_READY, std::memory_order_release);
+        }
+        else
+        {
+            nState.store(HC_EMPTY, std::memory_order_relaxed);
+        }
+    }
+
+protected:
+    mutable std::atomic<uint8> nState;
+    mutable uint256 hashCached;
+};
+
+// Merkle root memoized together with its leaves, valid only while the owner still yields the same leaves.
+// Copies share the immutable entry.
+class CMerkleRootCache
+{
+public:
+    CMerkleRootCache() {}
+    CMerkleRootCache(const CMerkleRootCache& other)
+      : ptrEntry(std::atomic_load(&other.ptrEntry)) {}
+    CMerkleRootCache& operator=(const CMerkleRootCache& other)
+    {
+        if (this != &other)
+        {
+            std::atomic_store(&ptrEntry, std::atomic_load(&other.ptrEntry));
+        }
+        return *this;
+    }
+
+    bool Get(const std::vector<uint256>& vLeaf, uint256& hashRoot) const
+    {
+        std::shared_ptr<const CEntry> ptr = std::atomic_load(&ptrEntry);
+        if (!ptr || ptr->vLeaf != vLeaf)
+        {
+            return false;
+        }
+        hashRoot = ptr->hashRoot;
+        return true;
+    }
+    void Set(const std::vector<uint256>& vLeaf, const uint256& hashRoot) const
+    {
+        std::atomic_store(&ptrEntry, std::shared_ptr<const CEntry>(std::make_shared<CEntry>(vLeaf, hashRoot)));
+    }
+    void Reset()
+    {
+        std::atomic_store(&ptrEntry, std::shared_ptr<const CEntry>());
+    }
+
+protected:
+    class CEntry
+    {
+    public:
+        CEntry(const std::vector<uint256>& vLeafIn, const uint256& hashRootIn)
+          : vLeaf(vLeafIn), hashRoot(hashRootIn) {}
+
+    public:
+        const std::vector<uint256> vLeaf;
+        const uint256 hashRoot;
+    };
+
+protected:
+    mutable std::shared_ptr<const CEntry> ptrEntry;
+};
+
+} // namespace hashahead
+
+#endif //COMMON_HASHCACHE_H
@@ -70,7 +70,7 @@ void CProfile::Serialize(hnbase::CStream& s, std::size_t& serSize) const
     bytes btAmount = nAmount.ToValidBigEndianData();
     bytes btMintReward = nMintReward.ToValidBigEndianData();
     bytes btMinTxFee = nMinTxFee.ToValidBigEndianData();
-    hnbase::CBufStream ss;
+    hnbase::CFlatWriteStream ss;
     ss << nVersion << nType << strName << strSymbol << CVarInt((uint64)nChainId) << btAmount << btMintReward << btMinTxFee << CVarInt((uint64)nHalveCycle) << destOwner << hashParent << CVarInt((uint64)nJointHeight) << nAttachExtdataType;
     serSize = ss.GetSize();
 }
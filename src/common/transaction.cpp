@@ -22,6 +22,8 @@ namespace hashahead
 //////////////////////////////
 // CTransaction
 
+CHashCacheStat CTransaction::statHashCache;
+
 void CTransaction::SetNull()
 {
     nType = 0;
@@ -37,6 +39,8 @@ void CTransaction::SetNull()
 
     btEthTx.clear();
     txidEthTx = 0;
+
+    cacheHash.Reset();
 }
 
 bool CTransaction::IsNull() const
@@ -95,12 +99,19 @@ uint256 CTransaction::GetHash() const
     {
         return txidEthTx;
     }
-    else
+
+    uint256 txid;
+    if (cacheHash.Get(txid))
     {
-        hnbase::CBufStream ss;
-        ss << (*this);
-        return CryptoHash(ss.GetData(), ss.GetSize());
+        statHashCache.AddHit();
+        return txid;
     }
+    bytes btData;
+    hnbase::FlatSerialize(*this, btData);
+    txid = CryptoHash(btData.data(), btData.size());
+    cacheHash.Set(txid);
+    statHashCache.AddCalc();
+    return txid;
 }
 
 uint256 CTransaction::GetSignatureHash() const
@@ -124,6 +135,7 @@ void CTransaction::AddTxData(const uint16 nTypeIn, const bytes& btDataIn)
         return;
     }
     mapTxData[nTypeIn] = btDataIn;
+    cacheHash.Reset();
 }
 
 bool CTransaction::GetTxData(const uint16 nTypeIn, bytes& btDataOut) const
@@ -197,6 +209,7 @@ bool CTransaction::SetTxExtData(const bytes& btExtData)
     {
         return false;
     }
+    cacheHash.Reset();
     try
     {
         hnbase::CBufStream ss(btExtData);
@@ -263,6 +276,7 @@ void CTransaction::SetTxType(const uint8 n)
         return;
     }
     nType = n;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetChainId(const CChainId nChainIdIn)
@@ -272,6 +286,7 @@ void CTransaction::SetChainId(const CChainId nChainIdIn)
         return;
     }
     nChainId = nChainIdIn;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetNonce(const uint64 n)
@@ -281,6 +296,7 @@ void CTransaction::SetNonce(const uint64 n)
         return;
     }
     nTxNonce = n;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetFromAddress(const CDestination& dest)
@@ -290,6 +306,7 @@ void CTransaction::SetFromAddress(const CDestination& dest)
         return;
     }
     destFrom = dest;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetToAddress(const CDestination& dest)
@@ -299,6 +316,7 @@ void CTransaction::SetToAddress(const CDestination& dest)
         return;
     }
     destTo = dest;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetAmount(const uint256& n)
@@ -308,6 +326,7 @@ void CTransaction::SetAmount(const uint256& n)
         return;
     }
     nAmount = n;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetGasPrice(const uint256& n)
@@ -317,6 +336,7 @@ void CTransaction::SetGasPrice(const uint256& n)
         return;
     }
     nGasPrice = n;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetGasLimit(const uint256& n)
@@ -326,6 +346,7 @@ void CTransaction::SetGasLimit(const uint256& n)
         return;
     }
     nGasLimit = n;
+    cacheHash.Reset();
 }
 
 void CTransaction::SetSignData(const bytes& d)
@@ -335,6 +356,7 @@ void CTransaction::SetSignData(const bytes& d)
         return;
     }
     vchSig = d;
+    cacheHash.Reset();
 }
 
 //------------------------------------
@@ -478,9 +500,15 @@ uint256 CTransaction::GetTxBaseGasStatic(const uint64 nTxDataSize)
     return (TX_BASE_GAS + GetTxDataGasStatic(nTxDataSize));
 }
 
+const CHashCacheStat& CTransaction::GetHashCacheStat()
+{
+    return statHashCache;
+}
+
 //-------------------------------------
 bool CTransaction::SetEthTxPacket(const bytes& btTxPacket)
 {
+    cacheHash.Reset();
     try
     {
         /// Constructs a transaction from the given RLP.
@@ -533,6 +561,7 @@ void CTransaction::PrSetToAddressData(const CAddressContext& ctxAddress)
     CBufStream ss;
     ss << ctxAddress;
     mapTxData[DF_TO_ADDRESS_DATA] = ss.GetBytes();
+    cacheHash.Reset();
 }
 
 //-------------------------------------
@@ -564,6 +593,7 @@ void CTransaction::Serialize(hnbase::CStream& s, hnbase::SaveType&) const
 
 void CTransaction::Serialize(hnbase::CStream& s, hnbase::LoadType&)
 {
+    cacheHash.Reset();
     s >> nType;
     if (nType == TX_ETH_CREATE_CONTRACT || nType == TX_ETH_MESSAGE_CALL)
     {
@@ -606,7 +636,7 @@ void CTransaction::Serialize(hnbase::CStream& s, hnbase::LoadType&)
 void CTransaction::Serialize(hnbase::CStream& s, std::size_t& serSize) const
 {
     (void)s;
-    hnbase::CBufStream ss;
+    hnbase::CFlatWriteStream ss;
     if (nType == TX_ETH_CREATE_CONTRACT || nType == TX_ETH_MESSAGE_CALL)
     {
         bool fLinkPubkeyAddress = true;
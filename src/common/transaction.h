@@ -5,12 +5,14 @@
 #ifndef COMMON_TRANSACTION_H
 #define COMMON_TRANSACTION_H
 
+#include <boost/function.hpp>
 #include <set>
 #include <stream/stream.h>
 #include <vector>
 
 #include "crypto.h"
 #include "destination.h"
+#include "hashcache.h"
 #include "param.h"
 #include "uint256.h"
 
@@ -44,6 +46,8 @@ protected:
     bytes btEthTx;
     uint256 txidEthTx;
 
+    CHashCache cacheHash;
+
 public:
     enum
     {
@@ -147,6 +151,7 @@ public:
     static std::string GetTypeStringStatic(uint16 nTxType);
     static uint256 GetTxDataGasStatic(const uint64 nTxDataSize);
     static uint256 GetTxBaseGasStatic(const uint64 nTxDataSize);
+    static const CHashCacheStat& GetHashCacheStat();
 
     friend bool operator==(const CTransaction& a, const CTransaction& b)
     {
@@ -171,6 +176,9 @@ protected:
     uint256 GetEthSignatureHash() const;
     void PrSetToAddressData(const CAddressContext& ctxAddress);
 
+protected:
+    static CHashCacheStat statHashCache;
+
 protected:
     void Serialize(hnbase::CStream& s, hnbase::SaveType&) const;
     void Serialize(hnbase::CStream& s, hnbase::LoadType&);
@@ -406,7 +414,7 @@ protected:
     void Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         (void)s;
-        hnbase::CBufStream ss;
+        hnbase::CFlatWriteStream ss;
         ss << nDirection << hnbase::CVarInt(nBlockNumber) << txid << nTxType << hnbase::CVarInt(nTimeStamp) << destPeer << nAmount.ToValidBigEndianData() << nTxFee.ToValidBigEndianData();
         serSize = ss.GetSize();
     }
@@ -472,7 +480,7 @@ protected:
     void Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         (void)s;
-        hnbase::CBufStream ss;
+        hnbase::CFlatWriteStream ss;
         ss << nType << destFrom << destTo << nAmount.ToValidBigEndianData();
         serSize = ss.GetSize();
     }
@@ -676,7 +684,7 @@ protected:
     void Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         (void)s;
-        hnbase::CBufStream ss;
+        hnbase::CFlatWriteStream ss;
         ss << nReceiptType << nContractStatus << nTxGasUsed.ToValidBigEndianData() << nTvGasUsed.ToValidBigEndianData() << vTransfer;
         if (nReceiptType == RECEIPT_TYPE_CONTRACT)
         {
@@ -790,7 +798,7 @@ protected:
     void Serialize(hnbase::CStream& s, std::size_t& serSize) const
     {
         (void)s;
-        hnbase::CBufStream ss;
+        hnbase::CFlatWriteStream ss;
         ss << nCallType << destFrom << destTo << nValue.ToValidBigEndianData() << hnbase::CVarInt(nGasLimit) << hnbase::CVarInt(nGasUsed) << btInput << btOutput << nStatus << strError << strRevertReason << destParentCodeContract.GetCompressData() << destCodeContract.GetCompressData() << vTraceAddress;
         serSize = ss.GetSize();
     }
@@ -1211,6 +1219,11 @@ public:
     std::array<std::set<uint256>, 4> arrayTopics;
 };
 
+// Called per block in ascending order, returning false stops the walk
+typedef boost::function<bool(const uint256& hashBlock, const std::vector<CTransactionReceipt>& vTxReceipt)> WalkerBlockReceiptsFunc;
+// Called per transaction with matched logs, returning false stops the walk
+typedef boost::function<bool(const CReceiptLogs& receiptLogs)> WalkerReceiptLogsFunc;
+
 class CFilterId
 {
 public:
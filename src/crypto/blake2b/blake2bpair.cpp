@@ -0,0 +1,276 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blake2bpair.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BLAKE2B_PAIR_AVX2
+#include <immintrin.h>
+#endif
+
+namespace hashahead
+{
+namespace crypto
+{
+
+static const uint64_t BLAKE2B_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t BLAKE2B_SIGMA[12][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+    { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+    { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+    { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+    { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+    { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+    { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+    { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+    { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+// Parameter block word 0: digest length 32, no key, fanout 1, depth 1
+static const uint64_t BLAKE2B_PARAM_256 = 0x01010020ULL;
+static const uint64_t BLAKE2B_INPUT_SIZE = 64;
+
+//////////////////////////////
+// Scalar
+
+static inline uint64_t Load64(const uint8_t* p)
+{
+    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+           | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void Store64(uint8_t* p, const uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint64_t Rotr64(const uint64_t v, const int n)
+{
+    return (v >> n) | (v << (64 - n));
+}
+
+static void Blake2b256Of64One(const uint8_t* pIn, uint8_t* pOut)
+{
+    uint64_t m[16] = { 0 };
+    for (int i = 0; i < 8; i++)
+    {
+        m[i] = Load64(pIn + i * 8);
+    }
+
+    uint64_t v[16];
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = BLAKE2B_IV[i];
+        v[i + 8] = BLAKE2B_IV[i];
+    }
+    v[0] ^= BLAKE2B_PARAM_256;
+    v[12] ^= BLAKE2B_INPUT_SIZE;
+    v[14] = ~v[14];
+
+#define BLAKE2B_G(a, b, c, d, x, y)  \
+    do                               \
+    {                                \
+        a = a + b + x;               \
+        d = Rotr64(d ^ a, 32);       \
+        c = c + d;                   \
+        b = Rotr64(b ^ c, 24);       \
+        a = a + b + y;               \
+        d = Rotr64(d ^ a, 16);       \
+        c = c + d;                   \
+        b = Rotr64(b ^ c, 63);       \
+    } while (0)
+
+    for (int r = 0; r < 12; r++)
+    {
+        const uint8_t* s = BLAKE2B_SIGMA[r];
+        BLAKE2B_G(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        BLAKE2B_G(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        BLAKE2B_G(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        BLAKE2B_G(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        BLAKE2B_G(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        BLAKE2B_G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        BLAKE2B_G(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        BLAKE2B_G(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+#undef BLAKE2B_G
+
+    for (int i = 0; i < 4; i++)
+    {
+        const uint64_t h = (i == 0 ? BLAKE2B_IV[0] ^ BLAKE2B_PARAM_256 : BLAKE2B_IV[i]);
+        Store64(pOut + i * 8, h ^ v[i] ^ v[i + 8]);
+    }
+}
+
+void Blake2b256Of64Scalar(const uint8_t* pIn, const std::size_t nCount, uint8_t* pOut)
+{
+    for (std::size_t i = 0; i < nCount; i++)
+    {
+        Blake2b256Of64One(pIn + i * 64, pOut + i * 32);
+    }
+}
+
+//////////////////////////////
+// AVX2, one input per 64-bit lane
+
+#ifdef BLAKE2B_PAIR_AVX2
+
+#define BLAKE2B_AVX2 __attribute__((target("avx2")))
+
+BLAKE2B_AVX2 static inline __m256i Rotr32x4(const __m256i x)
+{
+    return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+BLAKE2B_AVX2 static inline __m256i Rotr24x4(const __m256i x)
+{
+    const __m256i mask = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                          3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+BLAKE2B_AVX2 static inline __m256i Rotr16x4(const __m256i x)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                          2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+BLAKE2B_AVX2 static inline __m256i Rotr63x4(const __m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x));
+}
+
+// r0..r3 rows in, columns out: lane j of output i is lane i of input j
+BLAKE2B_AVX2 static inline void Transpose4x4(__m256i& r0, __m256i& r1, __m256i& r2, __m256i& r3)
+{
+    const __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+    const __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+    const __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+    const __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+    r0 = _mm256_permute2x128_si256(t0, t2, 0x20);
+    r1 = _mm256_permute2x128_si256(t1, t3, 0x20);
+    r2 = _mm256_permute2x128_si256(t0, t2, 0x31);
+    r3 = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+BLAKE2B_AVX2 static void Blake2b256Of64Four(const uint8_t* pIn, uint8_t* pOut)
+{
+    __m256i m[16];
+    for (int half = 0; half < 2; half++)
+    {
+        __m256i r0 = _mm256_loadu_si256((const __m256i*)(pIn + 0 * 64 + half * 32));
+        __m256i r1 = _mm256_loadu_si256((const __m256i*)(pIn + 1 * 64 + half * 32));
+        __m256i r2 = _mm256_loadu_si256((const __m256i*)(pIn + 2 * 64 + half * 32));
+        __m256i r3 = _mm256_loadu_si256((const __m256i*)(pIn + 3 * 64 + half * 32));
+        Transpose4x4(r0, r1, r2, r3);
+        m[half * 4 + 0] = r0;
+        m[half * 4 + 1] = r1;
+        m[half * 4 + 2] = r2;
+        m[half * 4 + 3] = r3;
+    }
+    for (int i = 8; i < 16; i++)
+    {
+        m[i] = _mm256_setzero_si256();
+    }
+
+    __m256i v[16];
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = _mm256_set1_epi64x((long long)BLAKE2B_IV[i]);
+        v[i + 8] = v[i];
+    }
+    v[0] = _mm256_set1_epi64x((long long)(BLAKE2B_IV[0] ^ BLAKE2B_PARAM_256));
+    const __m256i h0 = v[0];
+    v[12] = _mm256_set1_epi64x((long long)(BLAKE2B_IV[4] ^ BLAKE2B_INPUT_SIZE));
+    v[14] = _mm256_set1_epi64x((long long)(~BLAKE2B_IV[6]));
+
+#define BLAKE2B_G4(a, b, c, d, x, y)                         \
+    do                                                       \
+    {                                                        \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), x);     \
+        d = Rotr32x4(_mm256_xor_si256(d, a));                \
+        c = _mm256_add_epi64(c, d);                          \
+        b = Rotr24x4(_mm256_xor_si256(b, c));                \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), y);     \
+        d = Rotr16x4(_mm256_xor_si256(d, a));                \
+        c = _mm256_add_epi64(c, d);                          \
+        b = Rotr63x4(_mm256_xor_si256(b, c));                \
+    } while (0)
+
+    for (int r = 0; r < 12; r++)
+    {
+        const uint8_t* s = BLAKE2B_SIGMA[r];
+        BLAKE2B_G4(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        BLAKE2B_G4(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        BLAKE2B_G4(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        BLAKE2B_G4(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        BLAKE2B_G4(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        BLAKE2B_G4(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        BLAKE2B_G4(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        BLAKE2B_G4(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+#undef BLAKE2B_G4
+
+    __m256i o0 = _mm256_xor_si256(h0, _mm256_xor_si256(v[0], v[8]));
+    __m256i o1 = _mm256_xor_si256(_mm256_set1_epi64x((long long)BLAKE2B_IV[1]), _mm256_xor_si256(v[1], v[9]));
+    __m256i o2 = _mm256_xor_si256(_mm256_set1_epi64x((long long)BLAKE2B_IV[2]), _mm256_xor_si256(v[2], v[10]));
+    __m256i o3 = _mm256_xor_si256(_mm256_set1_epi64x((long long)BLAKE2B_IV[3]), _mm256_xor_si256(v[3], v[11]));
+    Transpose4x4(o0, o1, o2, o3);
+    _mm256_storeu_si256((__m256i*)(pOut + 0 * 32), o0);
+    _mm256_storeu_si256((__m256i*)(pOut + 1 * 32), o1);
+    _mm256_storeu_si256((__m256i*)(pOut + 2 * 32), o2);
+    _mm256_storeu_si256((__m256i*)(pOut + 3 * 32), o3);
+}
+
+BLAKE2B_AVX2 static void Blake2b256Of64Avx2(const uint8_t* pIn, const std::size_t nCount, uint8_t* pOut)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= nCount; i += 4)
+    {
+        Blake2b256Of64Four(pIn + i * 64, pOut + i * 32);
+    }
+    Blake2b256Of64Scalar(pIn + i * 64, nCount - i, pOut + i * 32);
+}
+
+#endif // BLAKE2B_PAIR_AVX2
+
+//////////////////////////////
+// Dispatch
+
+bool Blake2b256Of64HasAvx2()
+{
+#ifdef BLAKE2B_PAIR_AVX2
+    static const bool fAvx2 = __builtin_cpu_supports("avx2");
+    return fAvx2;
+#else
+    return false;
+#endif
+}
+
+void Blake2b256Of64(const uint8_t* pIn, const std::size_t nCount, uint8_t* pOut)
+{
+#ifdef BLAKE2B_PAIR_AVX2
+    if (nCount >= 4 && Blake2b256Of64HasAvx2())
+    {
+        Blake2b256Of64Avx2(pIn, nCount, pOut);
+        return;
+    }
+#endif
+    Blake2b256Of64Scalar(pIn, nCount, pOut);
+}
+
+} // namespace crypto
+} // namespace hashahead
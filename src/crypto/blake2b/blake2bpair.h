@@ -0,0 +1,27 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CRYPTO_BLAKE2B_BLAKE2BPAIR_H
+#define CRYPTO_BLAKE2B_BLAKE2BPAIR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hashahead
+{
+namespace crypto
+{
+
+// Unkeyed blake2b with a 32-byte digest over fixed 64-byte inputs, one compression per input.
+// pIn holds nCount inputs back to back, pOut receives nCount digests back to back.
+void Blake2b256Of64(const uint8_t* pIn, const std::size_t nCount, uint8_t* pOut);
+void Blake2b256Of64Scalar(const uint8_t* pIn, const std::size_t nCount, uint8_t* pOut);
+
+// True if Blake2b256Of64 hashes four inputs per pass with AVX2
+bool Blake2b256Of64HasAvx2();
+
+} // namespace crypto
+} // namespace hashahead
+
+#endif // CRYPTO_BLAKE2B_BLAKE2BPAIR_H
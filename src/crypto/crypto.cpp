@@ -7,6 +7,7 @@
 #include <iostream>
 #include <sodium.h>
 
+#include "blake2b/blake2bpair.h"
 #include "bls.hpp"
 #include "curve25519/curve25519.h"
 #include "devcommon/util.h"
@@ -123,6 +124,24 @@ uint256 CryptoHash(const uint256& h1, const uint256& h2)
     return hash;
 }
 
+void CryptoHashPairs(const uint256* pNode, const std::size_t nPairCount, uint256* pHash)
+{
+    static_assert(sizeof(uint256) == 32, "uint256 must be packed for contiguous pair hashing");
+    if (nPairCount == 0)
+    {
+        return;
+    }
+    if (Blake2b256Of64HasAvx2())
+    {
+        Blake2b256Of64(pNode[0].begin(), nPairCount, pHash[0].begin());
+        return;
+    }
+    for (std::size_t i = 0; i < nPairCount; i++)
+    {
+        crypto_generichash_blake2b(pHash[i].begin(), sizeof(uint256), pNode[i * 2].begin(), sizeof(uint256) * 2, nullptr, 0);
+    }
+}
+
 uint256 CryptoPowHash(const void* msg, size_t len)
 {
     return CryptoHash(msg, len);
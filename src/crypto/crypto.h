@@ -95,6 +95,8 @@ void CryptoGetRand256(uint256& u);
 // Hash
 uint256 CryptoHash(const void* msg, std::size_t len);
 uint256 CryptoHash(const uint256& h1, const uint256& h2);
+// pHash[i] = CryptoHash(pNode[2 * i], pNode[2 * i + 1]), the output must not overlap the input
+void CryptoHashPairs(const uint256* pNode, const std::size_t nPairCount, uint256* pHash);
 uint256 CryptoPowHash(const void* msg, size_t len);
 
 // SHA256
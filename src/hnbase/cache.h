@@ -5,13 +5,20 @@
 #ifndef HNBASE_CACHE_H
 #define HNBASE_CACHE_H
 
+#include <algorithm>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "rwlock.h"
+#include "type.h"
 
 namespace hnbase
 {
@@ -81,6 +88,11 @@ public:
         CWriteLock wlock(rwAccess);
         cntrCache.clear();
     }
+    std::size_t GetCount() const
+    {
+        CReadLock rlock(rwAccess);
+        return cntrCache.size();
+    }
 
 protected:
     mutable CRWAccess rwAccess;
@@ -88,6 +100,450 @@ protected:
     std::size_t nMaxCount;
 };
 
+// Byte-budgeted LRU split into independently locked shards.
+// The caller supplies the approximate size of each value on insert.
+template <typename K, typename V, typename ShardOf = std::hash<K>>
+class CShardedLruCache
+{
+    typedef std::pair<K, V> CKeyValue;
+    typedef std::list<CKeyValue> CKeyValueList;
+
+    class CShard
+    {
+    public:
+        CShard()
+          : nBytes(0) {}
+
+    public:
+        boost::mutex mtx;
+        CKeyValueList listLru;
+        std::map<K, std::pair<typename CKeyValueList::iterator, std::size_t>> mapIndex;
+        std::size_t nBytes;
+    };
+
+public:
+    class CStat
+    {
+    public:
+        CStat()
+          : nHit(0), nMiss(0), nCount(0), nBytes(0) {}
+
+    public:
+        uint64 nHit;
+        uint64 nMiss;
+        std::size_t nCount;
+        std::size_t nBytes;
+    };
+
+public:
+    CShardedLruCache(std::size_t nMaxBytesIn, std::size_t nShardCountIn = 16)
+      : vShard(std::max(nShardCountIn, (std::size_t)1)), nShardMaxBytes(nMaxBytesIn / std::max(nShardCountIn, (std::size_t)1)), nHit(0), nMiss(0)
+    {
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            ptr.reset(new CShard());
+        }
+    }
+    bool Retrieve(const K& key, V& value)
+    {
+        CShard& shard = GetShard(key);
+        {
+            boost::unique_lock<boost::mutex> lock(shard.mtx);
+            auto it = shard.mapIndex.find(key);
+            if (it != shard.mapIndex.end())
+            {
+                shard.listLru.splice(shard.listLru.begin(), shard.listLru, it->second.first);
+                value = it->second.first->second;
+                ++nHit;
+                return true;
+            }
+        }
+        ++nMiss;
+        return false;
+    }
+    void AddNew(const K& key, const V& value, const std::size_t nSize)
+    {
+        if (nSize > nShardMaxBytes)
+        {
+            return;
+        }
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtx);
+        auto it = shard.mapIndex.find(key);
+        if (it != shard.mapIndex.end())
+        {
+            shard.nBytes -= it->second.second;
+            shard.listLru.erase(it->second.first);
+            shard.mapIndex.erase(it);
+        }
+        shard.listLru.push_front(CKeyValue(key, value));
+        shard.mapIndex.insert(std::make_pair(key, std::make_pair(shard.listLru.begin(), nSize)));
+        shard.nBytes += nSize;
+        while (shard.nBytes > nShardMaxBytes && !shard.listLru.empty())
+        {
+            auto mt = shard.mapIndex.find(shard.listLru.back().first);
+            shard.nBytes -= mt->second.second;
+            shard.mapIndex.erase(mt);
+            shard.listLru.pop_back();
+        }
+    }
+    void Remove(const K& key)
+    {
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtx);
+        auto it = shard.mapIndex.find(key);
+        if (it != shard.mapIndex.end())
+        {
+            shard.nBytes -= it->second.second;
+            shard.listLru.erase(it->second.first);
+            shard.mapIndex.erase(it);
+        }
+    }
+    // Removes the keys in [keyBegin, keyEnd) of every shard
+    void RemoveRange(const K& keyBegin, const K& keyEnd)
+    {
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(ptr->mtx);
+            auto it = ptr->mapIndex.lower_bound(keyBegin);
+            while (it != ptr->mapIndex.end() && it->first < keyEnd)
+            {
+                ptr->nBytes -= it->second.second;
+                ptr->listLru.erase(it->second.first);
+                ptr->mapIndex.erase(it++);
+            }
+        }
+    }
+    void Clear()
+    {
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(ptr->mtx);
+            ptr->listLru.clear();
+            ptr->mapIndex.clear();
+            ptr->nBytes = 0;
+        }
+    }
+    void GetStat(CStat& stat)
+    {
+        stat.nHit = nHit;
+        stat.nMiss = nMiss;
+        stat.nCount = 0;
+        stat.nBytes = 0;
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(ptr->mtx);
+            stat.nCount += ptr->mapIndex.size();
+            stat.nBytes += ptr->nBytes;
+        }
+    }
+
+protected:
+    CShard& GetShard(const K& key)
+    {
+        return *vShard[ShardOf()(key) % vShard.size()];
+    }
+
+protected:
+    std::vector<std::unique_ptr<CShard>> vShard;
+    const std::size_t nShardMaxBytes;
+    std::atomic<uint64> nHit;
+    std::atomic<uint64> nMiss;
+};
+
+// Byte-budgeted segmented LRU split into independently locked shards.
+// New entries enter the probation segment and move to the protected segment
+// on a second hit, so a one-pass scan only churns probation. The shards share
+// one budget, an insert evicts from its own shard and keeps the new entry, so
+// an entry larger than its share of the budget is still cached. Pinned entries
+// count against the budget but are not evicted, the oldest pin is released to
+// probation once more than nMaxPinCount entries are pinned.
+template <typename K, typename V, typename ShardOf = std::hash<K>>
+class CSegmentedLruCache
+{
+    enum
+    {
+        SEG_PROBATION = 0,
+        SEG_PROTECTED = 1,
+        SEG_PINNED = 2,
+        SEG_COUNT = 3
+    };
+    class CEntry
+    {
+    public:
+        CEntry(const K& keyIn, const V& valueIn, const std::size_t nSizeIn, const int nSegmentIn)
+          : key(keyIn), value(valueIn), nSize(nSizeIn), nSegment(nSegmentIn) {}
+
+    public:
+        K key;
+        V value;
+        std::size_t nSize;
+        int nSegment;
+    };
+    typedef std::list<CEntry> CEntryList;
+
+    class CShard
+    {
+    public:
+        CShard()
+        {
+            std::fill(nBytes, nBytes + SEG_COUNT, 0);
+        }
+
+    public:
+        boost::mutex mtx;
+        CEntryList listSegment[SEG_COUNT];
+        std::size_t nBytes[SEG_COUNT];
+        std::map<K, typename CEntryList::iterator> mapIndex;
+    };
+
+public:
+    class CStat
+    {
+    public:
+        CStat()
+          : nHit(0), nMiss(0), nInsert(0), nEviction(0), nCount(0), nBytes(0), nProtectedBytes(0), nPinnedCount(0), nPinnedBytes(0) {}
+
+    public:
+        uint64 nHit;
+        uint64 nMiss;
+        uint64 nInsert;
+        uint64 nEviction;
+        std::size_t nCount;
+        std::size_t nBytes;
+        std::size_t nProtectedBytes;
+        std::size_t nPinnedCount;
+        std::size_t nPinnedBytes;
+    };
+
+public:
+    CSegmentedLruCache(std::size_t nMaxBytesIn, std::size_t nMaxPinCountIn = 0, std::size_t nShardCountIn = 16)
+      : nTotalBytes(0), nHit(0), nMiss(0), nInsert(0), nEviction(0)
+    {
+        Reset(nMaxBytesIn, nMaxPinCountIn, nShardCountIn);
+    }
+    // Drops all entries, not thread safe against concurrent access
+    void Reset(std::size_t nMaxBytesIn, std::size_t nMaxPinCountIn, std::size_t nShardCountIn)
+    {
+        nShardCountIn = std::max(nShardCountIn, (std::size_t)1);
+        vShard.clear();
+        vShard.resize(nShardCountIn);
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            ptr.reset(new CShard());
+        }
+        nMaxBytes = nMaxBytesIn;
+        nProtectedMaxBytes = nMaxBytesIn / nShardCountIn / 5 * 4;
+        nMaxPinCount = nMaxPinCountIn;
+        nTotalBytes = 0;
+        listPin.clear();
+        mapPin.clear();
+    }
+    bool Retrieve(const K& key, V& value)
+    {
+        CShard& shard = GetShard(key);
+        {
+            boost::unique_lock<boost::mutex> lock(shard.mtx);
+            auto it = shard.mapIndex.find(key);
+            if (it != shard.mapIndex.end())
+            {
+                typename CEntryList::iterator mt = it->second;
+                if (mt->nSegment != SEG_PINNED)
+                {
+                    MoveEntry(shard, mt, SEG_PROTECTED);
+                    while (shard.nBytes[SEG_PROTECTED] > nProtectedMaxBytes)
+                    {
+                        MoveEntry(shard, std::prev(shard.listSegment[SEG_PROTECTED].end()), SEG_PROBATION);
+                    }
+                }
+                value = mt->value;
+                ++nHit;
+                return true;
+            }
+        }
+        ++nMiss;
+        return false;
+    }
+    void AddNew(const K& key, const V& value, const std::size_t nSize, const bool fPin = false)
+    {
+        if (!fPin && nSize > nMaxBytes)
+        {
+            return;
+        }
+        {
+            CShard& shard = GetShard(key);
+            boost::unique_lock<boost::mutex> lock(shard.mtx);
+            auto it = shard.mapIndex.find(key);
+            if (it != shard.mapIndex.end())
+            {
+                typename CEntryList::iterator mt = it->second;
+                shard.nBytes[mt->nSegment] -= mt->nSize;
+                nTotalBytes -= mt->nSize;
+                mt->value = value;
+                mt->nSize = nSize;
+                shard.nBytes[mt->nSegment] += mt->nSize;
+                nTotalBytes += mt->nSize;
+                if (fPin && mt->nSegment != SEG_PINNED)
+                {
+                    MoveEntry(shard, mt, SEG_PINNED);
+                }
+                Evict(shard, mt);
+            }
+            else
+            {
+                const int nSegment = (fPin ? SEG_PINNED : SEG_PROBATION);
+                shard.listSegment[nSegment].push_front(CEntry(key, value, nSize, nSegment));
+                shard.mapIndex.insert(std::make_pair(key, shard.listSegment[nSegment].begin()));
+                shard.nBytes[nSegment] += nSize;
+                nTotalBytes += nSize;
+                ++nInsert;
+                Evict(shard, shard.listSegment[nSegment].begin());
+            }
+        }
+        if (fPin)
+        {
+            std::vector<K> vUnpin;
+            {
+                // a pinned key holds one slot, pinning it again only makes it the newest pin
+                boost::unique_lock<boost::mutex> lock(mtxPin);
+                auto it = mapPin.find(key);
+                if (it != mapPin.end())
+                {
+                    listPin.erase(it->second);
+                }
+                listPin.push_back(key);
+                mapPin[key] = std::prev(listPin.end());
+                while (listPin.size() > nMaxPinCount)
+                {
+                    vUnpin.push_back(listPin.front());
+                    mapPin.erase(listPin.front());
+                    listPin.pop_front();
+                }
+            }
+            for (const K& keyUnpin : vUnpin)
+            {
+                CShard& shard = GetShard(keyUnpin);
+                boost::unique_lock<boost::mutex> lock(shard.mtx);
+                auto it = shard.mapIndex.find(keyUnpin);
+                if (it != shard.mapIndex.end() && it->second->nSegment == SEG_PINNED)
+                {
+                    // already counted in the budget, so releasing it needs no eviction
+                    MoveEntry(shard, it->second, SEG_PROBATION);
+                }
+            }
+        }
+    }
+    void Remove(const K& key)
+    {
+        {
+            CShard& shard = GetShard(key);
+            boost::unique_lock<boost::mutex> lock(shard.mtx);
+            auto it = shard.mapIndex.find(key);
+            if (it != shard.mapIndex.end())
+            {
+                EraseEntry(shard, it->second);
+            }
+        }
+        boost::unique_lock<boost::mutex> lock(mtxPin);
+        auto it = mapPin.find(key);
+        if (it != mapPin.end())
+        {
+            listPin.erase(it->second);
+            mapPin.erase(it);
+        }
+    }
+    void Clear()
+    {
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(ptr->mtx);
+            for (int i = 0; i < SEG_COUNT; i++)
+            {
+                ptr->listSegment[i].clear();
+                nTotalBytes -= ptr->nBytes[i];
+                ptr->nBytes[i] = 0;
+            }
+            ptr->mapIndex.clear();
+        }
+        boost::unique_lock<boost::mutex> lock(mtxPin);
+        listPin.clear();
+        mapPin.clear();
+    }
+    void GetStat(CStat& stat)
+    {
+        stat = CStat();
+        stat.nHit = nHit;
+        stat.nMiss = nMiss;
+        stat.nInsert = nInsert;
+        stat.nEviction = nEviction;
+        for (std::unique_ptr<CShard>& ptr : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(ptr->mtx);
+            stat.nCount += ptr->mapIndex.size();
+            stat.nBytes += ptr->nBytes[SEG_PROBATION] + ptr->nBytes[SEG_PROTECTED] + ptr->nBytes[SEG_PINNED];
+            stat.nProtectedBytes += ptr->nBytes[SEG_PROTECTED];
+            stat.nPinnedCount += ptr->listSegment[SEG_PINNED].size();
+            stat.nPinnedBytes += ptr->nBytes[SEG_PINNED];
+        }
+    }
+
+protected:
+    CShard& GetShard(const K& key)
+    {
+        return *vShard[ShardOf()(key) % vShard.size()];
+    }
+    void MoveEntry(CShard& shard, typename CEntryList::iterator it, const int nSegment)
+    {
+        shard.nBytes[it->nSegment] -= it->nSize;
+        shard.nBytes[nSegment] += it->nSize;
+        shard.listSegment[nSegment].splice(shard.listSegment[nSegment].begin(), shard.listSegment[it->nSegment], it);
+        it->nSegment = nSegment;
+    }
+    void EraseEntry(CShard& shard, typename CEntryList::iterator it)
+    {
+        shard.nBytes[it->nSegment] -= it->nSize;
+        nTotalBytes -= it->nSize;
+        shard.mapIndex.erase(it->key);
+        shard.listSegment[it->nSegment].erase(it);
+    }
+    // Evicts the oldest unpinned entries of the shard, except itKeep, until the shared budget fits
+    void Evict(CShard& shard, typename CEntryList::iterator itKeep)
+    {
+        while (nTotalBytes > nMaxBytes)
+        {
+            CEntryList& listProbation = shard.listSegment[SEG_PROBATION];
+            CEntryList& listProtected = shard.listSegment[SEG_PROTECTED];
+            if (!listProbation.empty() && std::prev(listProbation.end()) != itKeep)
+            {
+                EraseEntry(shard, std::prev(listProbation.end()));
+            }
+            else if (!listProtected.empty() && std::prev(listProtected.end()) != itKeep)
+            {
+                EraseEntry(shard, std::prev(listProtected.end()));
+            }
+            else
+            {
+                break;
+            }
+            ++nEviction;
+        }
+    }
+
+protected:
+    std::vector<std::unique_ptr<CShard>> vShard;
+    std::size_t nMaxBytes;
+    std::size_t nProtectedMaxBytes;
+    std::size_t nMaxPinCount;
+    std::atomic<std::size_t> nTotalBytes;
+    boost::mutex mtxPin;
+    std::list<K> listPin;
+    std::map<K, typename std::list<K>::iterator> mapPin;
+    std::atomic<uint64> nHit;
+    std::atomic<uint64> nMiss;
+    std::atomic<uint64> nInsert;
+    std::atomic<uint64> nEviction;
+};
+
 } // namespace hnbase
 
 #endif //HNBASE_CACHE_H
@@ -5,8 +5,13 @@
 #ifndef HNBASE_KVDB_H
 #define HNBASE_KVDB_H
 
+#include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/thread.hpp>
+#include <algorithm>
+#include <boost/thread/shared_mutex.hpp>
+#include <memory>
+#include <vector>
 
 #include "stream/stream.h"
 #include "util.h"
@@ -16,11 +21,96 @@ namespace hnbase
 
 typedef boost::function<bool(CBufStream&, CBufStream&)> WalkerFunc;
 
+class CKVDBCursor
+{
+public:
+    virtual ~CKVDBCursor() {}
+
+    virtual bool MoveFirst() = 0;
+    virtual bool MoveTo(CBufStream& ssKey) = 0;
+    virtual bool MoveNext(CBufStream& ssKey, CBufStream& ssValue) = 0;
+};
+
+// Values of a multi-key lookup, kept back to back in one buffer
+class CKVDBMultiValue
+{
+public:
+    void Reset(const std::size_t nCount)
+    {
+        vArena.clear();
+        vSlot.assign(nCount, std::make_pair((std::size_t)-1, (std::size_t)0));
+    }
+    void SetValue(const std::size_t nIndex, const char* pData, const std::size_t nSize)
+    {
+        vSlot[nIndex] = std::make_pair(vArena.size(), nSize);
+        vArena.insert(vArena.end(), pData, pData + nSize);
+    }
+    std::size_t GetCount() const
+    {
+        return vSlot.size();
+    }
+    bool IsFound(const std::size_t nIndex) const
+    {
+        return (nIndex < vSlot.size() && vSlot[nIndex].first != (std::size_t)-1);
+    }
+    bool GetValue(const std::size_t nIndex, CBufStream& ssValue) const
+    {
+        if (!IsFound(nIndex))
+        {
+            return false;
+        }
+        ssValue.Write(vArena.data() + vSlot[nIndex].first, vSlot[nIndex].second);
+        return true;
+    }
+    template <typename T>
+    bool GetValue(const std::size_t nIndex, T& value) const
+    {
+        CBufStream ssValue;
+        if (!GetValue(nIndex, ssValue))
+        {
+            return false;
+        }
+        ssValue >> value;
+        return true;
+    }
+
+protected:
+    std::vector<char> vArena;
+    std::vector<std::pair<std::size_t, std::size_t>> vSlot; // first: offset in arena, second: size
+};
+
 class CKVDBEngine
 {
 public:
     virtual ~CKVDBEngine() {}
 
+    // Get is safe to call concurrently with Get/Put/Remove
+    virtual bool IsConcurrentRead() const
+    {
+        return false;
+    }
+    // Cursor over a consistent snapshot, independent of MoveFirst/MoveTo/MoveNext.
+    // Returns nullptr if the engine does not support snapshots.
+    virtual CKVDBCursor* NewCursor()
+    {
+        return nullptr;
+    }
+    // Look up all keys, mvValue slot i holds the value of vKey[i] if found
+    virtual bool MultiGet(const std::vector<bytes>& vKey, CKVDBMultiValue& mvValue)
+    {
+        mvValue.Reset(vKey.size());
+        for (std::size_t i = 0; i < vKey.size(); i++)
+        {
+            CBufStream ssKey((const char*)vKey[i].data(), vKey[i].size());
+            CBufStream ssValue;
+            if (Get(ssKey, ssValue))
+            {
+                mvValue.SetValue(i, ssValue.GetData(), ssValue.GetSize());
+            }
+        }
+        return true;
+    }
+
     virtual bool Open() = 0;
     virtual void Close() = 0;
     virtual bool TxnBegin() = 0;
@@ -35,15 +125,88 @@ public:
     virtual bool MoveNext(CBufStream& ssKey, CBufStream& ssValue) = 0;
 };
 
+// Cursor over the engine built-in iterator, CKVDB::mtx must be held while it is used
+class CKVDBEngineCursor : public CKVDBCursor
+{
+public:
+    CKVDBEngineCursor(CKVDBEngine* engine)
+      : dbEngine(engine) {}
+
+    bool MoveFirst() override
+    {
+        return dbEngine->MoveFirst();
+    }
+    bool MoveTo(CBufStream& ssKey) override
+    {
+        return dbEngine->MoveTo(ssKey);
+    }
+    bool MoveNext(CBufStream& ssKey, CBufStream& ssValue) override
+    {
+        return dbEngine->MoveNext(ssKey, ssValue);
+    }
+
+protected:
+    CKVDBEngine* dbEngine;
+};
+
+// Lock order: rwEngine (shared for all data access, unique for open/close), then mtx.
+// mtx serializes engine state (write batch, built-in iterator), reads skip it
+// when the engine supports concurrent Get, and walks use a snapshot cursor
+// when the engine provides one.
+// A thread takes the shared rwEngine lock once per db, so walk callbacks may read and write
+// the same db, but must not call Open, Close or RemoveAll on it.
 class CKVDB
 {
+protected:
+    // shared_mutex prefers a queued writer, a second lock_shared on the same thread would wait for it forever
+    class CEngineReadLock
+    {
+    public:
+        CEngineReadLock(CKVDB* pDBIn)
+          : pDB(pDBIn), fOwned(false)
+        {
+            std::vector<const CKVDB*>& vHeld = GetHeldList();
+            if (std::find(vHeld.begin(), vHeld.end(), pDB) == vHeld.end())
+            {
+                pDB->rwEngine.lock_shared();
+                vHeld.push_back(pDB);
+                fOwned = true;
+            }
+        }
+        ~CEngineReadLock()
+        {
+            if (fOwned)
+            {
+                std::vector<const CKVDB*>& vHeld = GetHeldList();
+                vHeld.erase(std::find(vHeld.begin(), vHeld.end(), pDB));
+                pDB->rwEngine.unlock_shared();
+            }
+        }
+        static bool IsHeld(const CKVDB* pDB)
+        {
+            const std::vector<const CKVDB*>& vHeld = GetHeldList();
+            return (std::find(vHeld.begin(), vHeld.end(), pDB) != vHeld.end());
+        }
+
+    protected:
+        static std::vector<const CKVDB*>& GetHeldList()
+        {
+            static thread_local std::vector<const CKVDB*> vHeld;
+            return vHeld;
+        }
+
+    protected:
+        CKVDB* pDB;
+        bool fOwned;
+    };
+
 public:
     CKVDB()
       : dbEngine(nullptr) {}
     CKVDB(CKVDBEngine* engine)
       : dbEngine(engine)
     {
-        boost::recursive_mutex::scoped_lock lock(mtx);
+        boost::unique_lock<boost::shared_mutex> wlock(rwEngine);
         if (dbEngine != nullptr)
         {
             if (!dbEngine->Open())
@@ -56,6 +219,7 @@ public:
 
     virtual ~CKVDB()
     {
+        boost::unique_lock<boost::shared_mutex> wlock(rwEngine);
         boost::recursive_mutex::scoped_lock lock(mtx);
         if (dbEngine != nullptr)
         {
@@ -68,6 +232,7 @@ public:
     {
         if (dbEngine == nullptr && engine != nullptr && engine->Open())
         {
+            boost::unique_lock<boost::shared_mutex> wlock(rwEngine);
             boost::recursive_mutex::scoped_lock lock(mtx);
             dbEngine = engine;
             return true;
@@ -78,17 +243,19 @@ public:
 
     void Close()
     {
-        boost::recursive_mutex::scoped_lock lock(mtx);
-        if (dbEngine != nullptr)
+        if (CEngineReadLock::IsHeld(this))
         {
-            dbEngine->Close();
-            delete dbEngine;
-            dbEngine = nullptr;
+            StdError("CKVDB", "Close: Called from a walk of the same db");
+            return;
         }
+        boost::unique_lock<boost::shared_mutex> wlock(rwEngine);
+        boost::recursive_mutex::scoped_lock lock(mtx);
+        CloseEngine();
     }
 
     bool TxnBegin()
     {
+        CEngineReadLock rlock(this);
         boost::recursive_mutex::scoped_lock lock(mtx);
         if (dbEngine != nullptr)
         {
@@ -99,6 +266,7 @@ public:
 
     bool TxnCommit()
     {
+        CEngineReadLock rlock(this);
         boost::recursive_mutex::scoped_lock lock(mtx);
         if (dbEngine != nullptr)
         {
@@ -109,6 +277,7 @@ public:
 
     void TxnAbort()
     {
+        CEngineReadLock rlock(this);
         boost::recursive_mutex::scoped_lock lock(mtx);
         if (dbEngine != nullptr)
         {
@@ -118,6 +287,12 @@ public:
 
     bool RemoveAll()
     {
+        if (CEngineReadLock::IsHeld(this))
+        {
+            StdError("CKVDB", "RemoveAll: Called from a walk of the same db");
+            return false;
+        }
+        boost::unique_lock<boost::shared_mutex> wlock(rwEngine);
         boost::recursive_mutex::scoped_lock lock(mtx);
         if (dbEngine != nullptr)
         {
@@ -125,7 +300,7 @@ public:
             {
                 return true;
             }
-            Close();
+            CloseEngine();
         }
         return false;
     }
@@ -144,12 +319,12 @@ protected:
     {
         try
         {
-            boost::recursive_mutex::scoped_lock lock(mtx);
+            CEngineReadLock rlock(this);
 
             if (dbEngine == nullptr)
                 return false;
 
-            if (dbEngine->Get(ssKey, ssValue))
+            if (GetNolock(ssKey, ssValue))
             {
                 return true;
             }
@@ -164,10 +339,37 @@ protected:
         }
         return false;
     }
+    bool MultiRead(const std::vector<bytes>& vKey, CKVDBMultiValue& mvValue)
+    {
+        try
+        {
+            CEngineReadLock rlock(this);
+
+            if (dbEngine == nullptr)
+                return false;
+
+            if (dbEngine->IsConcurrentRead())
+            {
+                return dbEngine->MultiGet(vKey, mvValue);
+            }
+            boost::recursive_mutex::scoped_lock lock(mtx);
+            return dbEngine->MultiGet(vKey, mvValue);
+        }
+        catch (const boost::thread_interrupted&)
+        {
+            throw;
+        }
+        catch (std::exception& e)
+        {
+            StdError(__PRETTY_FUNCTION__, e.what());
+        }
+        return false;
+    }
     bool Write(CBufStream& ssKey, CBufStream& ssValue, bool fOverwrite = true)
     {
         try
         {
+            CEngineReadLock rlock(this);
             boost::recursive_mutex::scoped_lock lock(mtx);
 
             if (dbEngine == nullptr)
@@ -188,6 +390,7 @@ protected:
     {
         try
         {
+            CEngineReadLock rlock(this);
             boost::recursive_mutex::scoped_lock lock(mtx);
 
             if (dbEngine == nullptr)
@@ -212,12 +415,12 @@ protected:
 
         try
         {
-            boost::recursive_mutex::scoped_lock lock(mtx);
+            CEngineReadLock rlock(this);
 
             if (dbEngine == nullptr)
                 return false;
 
-            if (dbEngine->Get(ssKey, ssValue))
+            if (GetNolock(ssKey, ssValue))
             {
                 ssValue >> value;
                 return true;
@@ -244,6 +447,7 @@ protected:
 
         try
         {
+            CEngineReadLock rlock(this);
             boost::recursive_mutex::scoped_lock lock(mtx);
 
             if (dbEngine == nullptr)
@@ -270,6 +474,7 @@ protected:
 
         try
         {
+            CEngineReadLock rlock(this);
             boost::recursive_mutex::scoped_lock lock(mtx);
 
             if (dbEngine == nullptr)
@@ -289,133 +494,118 @@ protected:
     }
 
     bool WalkThrough()
+    {
+        CBufStream ssKeyBegin, ssKeyPrefix;
+        return WalkThroughOfPrefix(ssKeyBegin, ssKeyPrefix, boost::bind(&CKVDB::DBWalker, this, _1, _2));
+    }
+
+    bool WalkThrough(WalkerFunc fnWalker)
+    {
+        CBufStream ssKeyBegin, ssKeyPrefix;
+        return WalkThroughOfPrefix(ssKeyBegin, ssKeyPrefix, fnWalker);
+    }
+
+    bool WalkThroughOfPrefix(CBufStream& ssKeyBegin, CBufStream& ssKeyPrefix, WalkerFunc fnWalker)
     {
         try
         {
-            boost::recursive_mutex::scoped_lock lock(mtx);
+            CEngineReadLock rlock(this);
 
             if (dbEngine == nullptr)
+            {
                 return false;
+            }
 
-            if (!dbEngine->MoveFirst())
-                return false;
-
-            for (;;)
+            std::unique_ptr<CKVDBCursor> ptrCursor(dbEngine->NewCursor());
+            if (ptrCursor)
             {
-                CBufStream ssKey, ssValue;
-                if (!dbEngine->MoveNext(ssKey, ssValue))
-                    break;
-
-                if (!DBWalker(ssKey, ssValue))
-                    break;
+                return WalkCursor(*ptrCursor, ssKeyBegin, ssKeyPrefix, fnWalker);
             }
-            return true;
+
+            boost::recursive_mutex::scoped_lock lock(mtx);
+            CKVDBEngineCursor cursor(dbEngine);
+            return WalkCursor(cursor, ssKeyBegin, ssKeyPrefix, fnWalker);
         }
         catch (std::exception& e)
         {
             StdError(__PRETTY_FUNCTION__, e.what());
         }
-
         return false;
     }
 
-    bool WalkThrough(WalkerFunc fnWalker)
+private:
+    bool GetNolock(CBufStream& ssKey, CBufStream& ssValue)
     {
-        try
+        if (dbEngine->IsConcurrentRead())
         {
-            boost::recursive_mutex::scoped_lock lock(mtx);
-
-            if (dbEngine == nullptr)
-                return false;
-
-            if (!dbEngine->MoveFirst())
-                return false;
-
-            for (;;)
-            {
-                CBufStream ssKey, ssValue;
-                if (!dbEngine->MoveNext(ssKey, ssValue))
-                    break;
-
-                if (!fnWalker(ssKey, ssValue))
-                    break;
-            }
-            return true;
+            return dbEngine->Get(ssKey, ssValue);
         }
-        catch (std::exception& e)
+        boost::recursive_mutex::scoped_lock lock(mtx);
+        return dbEngine->Get(ssKey, ssValue);
+    }
+
+    void CloseEngine()
+    {
+        if (dbEngine != nullptr)
         {
-            StdError(__PRETTY_FUNCTION__, e.what());
+            dbEngine->Close();
+            delete dbEngine;
+            dbEngine = nullptr;
         }
-
-        return false;
     }
 
-    bool WalkThroughOfPrefix(CBufStream& ssKeyBegin, CBufStream& ssKeyPrefix, WalkerFunc fnWalker)
+    bool WalkCursor(CKVDBCursor& cursor, CBufStream& ssKeyBegin, CBufStream& ssKeyPrefix, WalkerFunc& fnWalker)
     {
-        try
+        if (ssKeyBegin.GetSize() > 0)
         {
-            boost::recursive_mutex::scoped_lock lock(mtx);
-
-            if (dbEngine == nullptr)
+            if (!cursor.MoveTo(ssKeyBegin))
             {
                 return false;
             }
-
-            if (ssKeyBegin.GetSize() > 0)
+        }
+        else
+        {
+            if (ssKeyPrefix.GetSize() > 0)
             {
-                if (!dbEngine->MoveTo(ssKeyBegin))
+                if (!cursor.MoveTo(ssKeyPrefix))
                 {
                     return false;
                 }
             }
             else
             {
-                if (ssKeyPrefix.GetSize() > 0)
-                {
-                    if (!dbEngine->MoveTo(ssKeyPrefix))
-                    {
-                        return false;
-                    }
-                }
-                else
+                if (!cursor.MoveFirst())
                 {
-                    if (!dbEngine->MoveFirst())
-                    {
-                        return false;
-                    }
+                    return false;
                 }
             }
+        }
 
-            for (;;)
+        for (;;)
+        {
+            CBufStream ssKey, ssValue;
+            if (!cursor.MoveNext(ssKey, ssValue))
             {
-                CBufStream ssKey, ssValue;
-                if (!dbEngine->MoveNext(ssKey, ssValue))
-                {
-                    break;
-                }
+                break;
+            }
 
-                if (ssKeyPrefix.GetSize() > 0
-                    && (ssKey.GetSize() < ssKeyPrefix.GetSize()
-                        || memcmp(ssKey.GetData(), ssKeyPrefix.GetData(), ssKeyPrefix.GetSize()) != 0))
-                {
-                    break;
-                }
+            if (ssKeyPrefix.GetSize() > 0
+                && (ssKey.GetSize() < ssKeyPrefix.GetSize()
+                    || memcmp(ssKey.GetData(), ssKeyPrefix.GetData(), ssKeyPrefix.GetSize()) != 0))
+            {
+                break;
+            }
 
-                if (!fnWalker(ssKey, ssValue))
-                {
-                    break;
-                }
+            if (!fnWalker(ssKey, ssValue))
+            {
+                break;
             }
-            return true;
         }
-        catch (std::exception& e)
-        {
-            StdError(__PRETTY_FUNCTION__, e.what());
-        }
-        return false;
+        return true;
     }
 
 protected:
+    boost::shared_mutex rwEngine;
     boost::recursive_mutex mtx;
     CKVDBEngine* dbEngine;
 };
@@ -36,5 +36,6 @@
 #include <structure/tree.h>
 #include <type.h>
 #include <util.h>
+#include <workerpool.h>
 
 #endif //HNBASE_HNBASE_H
@@ -18,8 +18,8 @@ namespace hnbase
 
 ///////////////////////////////
 // CIOClient
-CIOClient::CIOClient(CIOContainer* pContainerIn)
-  : pContainer(pContainerIn)
+CIOClient::CIOClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice)
+  : pContainer(pContainerIn), strandClient(ioservice)
 {
     nRefCount = 0;
 }
@@ -61,7 +61,7 @@ void CIOClient::Close()
 {
     if (IsSocketOpen())
     {
-        CloseSocket();
+        CloseSocketStage();
         epRemote = tcp::endpoint();
     }
     Release();
@@ -73,7 +73,7 @@ void CIOClient::Release()
     {
         if (IsSocketOpen())
         {
-            CloseSocket();
+            CloseSocketStage();
             epRemote = tcp::endpoint();
         }
         pContainer->ClientClose(this);
@@ -82,7 +82,7 @@ void CIOClient::Release()
 
 void CIOClient::Shutdown()
 {
-    CloseSocket();
+    CloseSocketStage();
     epRemote = tcp::endpoint();
 }
 
@@ -116,12 +116,24 @@ void CIOClient::ReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc
     AsyncReadUntil(ssRecv, delim, fnCompleted);
 }
 
+void CIOClient::ReadSome(CBufStream& ssRecv, size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted)
+{
+    ++nRefCount;
+    AsyncReadSome(ssRecv, nMaxLength, fnStage, fnCompleted);
+}
+
 void CIOClient::Write(CBufStream& ssSend, CallBackFunc fnCompleted)
 {
     ++nRefCount;
     AsyncWrite(ssSend, fnCompleted);
 }
 
+void CIOClient::Write(const vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted)
+{
+    ++nRefCount;
+    AsyncWrite(vSend, fnCompleted);
+}
+
 void CIOClient::HandleCompleted(CallBackFunc fnCompleted,
                                 const boost::system::error_code& err, size_t transferred)
 {
@@ -132,6 +144,34 @@ void CIOClient::HandleCompleted(CallBackFunc fnCompleted,
     }
 }
 
+void CIOClient::HandleReadSomeCompleted(CBufStream& ssRecv, CallBackStage fnStage, CallBackFunc fnCompleted,
+                                        const boost::system::error_code& err, size_t transferred)
+{
+    if (!err)
+    {
+        ssRecv.commit(transferred);
+
+        // the owner may be closing this client on the proc strand, a closed socket means it may be gone
+        boost::lock_guard<boost::mutex> lock(mtxStage);
+        if (IsSocketOpen() && fnStage && !fnStage(transferred))
+        {
+            transferred = 0;
+        }
+    }
+    GetProcStrand().dispatch(boost::bind(&CIOClient::HandleCompleted, this, fnCompleted, err, transferred));
+}
+
+void CIOClient::CloseSocketStage()
+{
+    boost::lock_guard<boost::mutex> lock(mtxStage);
+    CloseSocket();
+}
+
+boost::asio::io_service::strand& CIOClient::GetProcStrand()
+{
+    return pContainer->GetIoStrand();
+}
+
 void CIOClient::HandleConnCompleted(CallBackConn fnCompleted, const boost::system::error_code& err)
 {
     fnCompleted(IsSocketOpen() ? err : boost::asio::error::operation_aborted);
@@ -145,7 +185,7 @@ void CIOClient::HandleConnCompleted(CallBackConn fnCompleted, const boost::syste
 ///////////////////////////////
 // CSocketClient
 CSocketClient::CSocketClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice)
-  : CIOClient(pContainerIn), sockClient(ioservice)
+  : CIOClient(pContainerIn, ioservice), sockClient(ioservice)
 {
 }
 
@@ -156,14 +196,14 @@ CSocketClient::~CSocketClient()
 
 void CSocketClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
-    acceptor.async_accept(sockClient, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                  fnAccepted, boost::asio::placeholders::error));
+    acceptor.async_accept(sockClient, GetProcStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                       fnAccepted, boost::asio::placeholders::error)));
 }
 
 void CSocketClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, GetProcStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                        fnConnected, boost::asio::placeholders::error)));
 }
 
 bool CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -191,8 +231,8 @@ bool CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, cons
             }
         }
     }
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, GetProcStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                        fnConnected, boost::asio::placeholders::error)));
     return true;
 }
 
@@ -201,9 +241,9 @@ void CSocketClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc f
     boost::asio::async_read(sockClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            GetProcStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                             boost::asio::placeholders::error,
+                                                             boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
@@ -211,9 +251,17 @@ void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, Call
     boost::asio::async_read_until(sockClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  GetProcStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                                   boost::asio::placeholders::error,
+                                                                   boost::asio::placeholders::bytes_transferred)));
+}
+
+void CSocketClient::AsyncReadSome(CBufStream& ssRecv, size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted)
+{
+    sockClient.async_read_some(ssRecv.prepare(nMaxLength),
+                               strandClient.wrap(boost::bind(&CSocketClient::HandleReadSomeCompleted, this, boost::ref(ssRecv), fnStage, fnCompleted,
+                                                             boost::asio::placeholders::error,
+                                                             boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
@@ -221,9 +269,18 @@ void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
     boost::asio::async_write(sockClient,
                              (boost::asio::streambuf&)ssSend,
                              boost::asio::transfer_all(),
-                             boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             GetProcStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                              boost::asio::placeholders::error,
+                                                              boost::asio::placeholders::bytes_transferred)));
+}
+
+void CSocketClient::AsyncWrite(const vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted)
+{
+    boost::asio::async_write(sockClient,
+                             vSend,
+                             GetProcStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                              boost::asio::placeholders::error,
+                                                              boost::asio::placeholders::bytes_transferred)));
 }
 
 const tcp::endpoint CSocketClient::SocketGetRemote()
@@ -251,7 +308,7 @@ bool CSocketClient::IsSocketOpen()
 CSSLClient::CSSLClient(CIOContainer* pContainerIn, boost::asio::io_service& ioserivce,
                        boost::asio::ssl::context& context,
                        const string& strVerifyHost)
-  : CIOClient(pContainerIn), sslClient(ioserivce, context)
+  : CIOClient(pContainerIn, ioserivce), sslClient(ioserivce, context)
 {
     /*if (!strVerifyHost.empty())
     {
@@ -271,17 +328,17 @@ CSSLClient::~CSSLClient()
 void CSSLClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
     acceptor.async_accept(sslClient.lowest_layer(),
-                          boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
-                                      boost::asio::ssl::stream_base::server,
-                                      boost::asio::placeholders::error));
+                          GetProcStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
+                                                           boost::asio::ssl::stream_base::server,
+                                                           boost::asio::placeholders::error)));
 }
 
 void CSSLClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           GetProcStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                                            boost::asio::ssl::stream_base::client,
+                                                                            boost::asio::placeholders::error)));
 }
 
 bool CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -310,9 +367,9 @@ bool CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const t
         }
     }
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           GetProcStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                                            boost::asio::ssl::stream_base::client,
+                                                                            boost::asio::placeholders::error)));
     return true;
 }
 
@@ -321,9 +378,9 @@ void CSSLClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCo
     boost::asio::async_read(sslClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            GetProcStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                             boost::asio::placeholders::error,
+                                                             boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
@@ -331,18 +388,36 @@ void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBac
     boost::asio::async_read_until(sslClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  GetProcStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                                   boost::asio::placeholders::error,
+                                                                   boost::asio::placeholders::bytes_transferred)));
+}
+
+void CSSLClient::AsyncReadSome(CBufStream& ssRecv, size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted)
+{
+    // the ssl engine is shared with the writes, so the stage stays on the proc strand
+    sslClient.async_read_some(ssRecv.prepare(nMaxLength),
+                              GetProcStrand().wrap(boost::bind(&CSSLClient::HandleReadSomeCompleted, this, boost::ref(ssRecv), fnStage, fnCompleted,
+                                                               boost::asio::placeholders::error,
+                                                               boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSSLClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
 {
     boost::asio::async_write(sslClient,
                              (boost::asio::streambuf&)ssSend,
-                             boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             GetProcStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                              boost::asio::placeholders::error,
+                                                              boost::asio::placeholders::bytes_transferred)));
+}
+
+void CSSLClient::AsyncWrite(const vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted)
+{
+    boost::asio::async_write(sslClient,
+                             vSend,
+                             GetProcStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                              boost::asio::placeholders::error,
+                                                              boost::asio::placeholders::bytes_transferred)));
 }
 
 const tcp::endpoint CSSLClient::SocketGetRemote()
@@ -371,8 +446,8 @@ void CSSLClient::HandleConnected(CallBackConn fnHandshaked,
 {
     if (!err)
     {
-        sslClient.async_handshake(type, boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
-                                                    boost::asio::placeholders::error));
+        sslClient.async_handshake(type, GetProcStrand().wrap(boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
+                                                                         boost::asio::placeholders::error)));
     }
     else
     {
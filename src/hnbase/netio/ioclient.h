@@ -8,7 +8,9 @@
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
+#include <vector>
 
 #include "stream/stream.h"
 
@@ -22,8 +24,9 @@ class CIOClient
 public:
     typedef boost::function<void(std::size_t)> CallBackFunc;
     typedef boost::function<void(const boost::system::error_code&)> CallBackConn;
+    typedef boost::function<bool(std::size_t)> CallBackStage;
 
-    CIOClient(CIOContainer* pContainerIn);
+    CIOClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice);
     virtual ~CIOClient();
     const boost::asio::ip::tcp::endpoint GetRemote();
     const boost::asio::ip::tcp::endpoint GetLocal();
@@ -35,11 +38,21 @@ public:
     bool ConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected);
     void Read(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted);
     void ReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted);
+    // Appends whatever the socket has ready, up to nMaxLength bytes, in one read.
+    // fnStage runs first on the connection strand, in parallel with other connections, and must only touch
+    // state owned by this read chain; fnCompleted then runs on the io proc strand like every other callback.
+    void ReadSome(CBufStream& ssRecv, std::size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted);
     void Write(CBufStream& ssSend, CallBackFunc fnCompleted);
+    // Gathers the buffers into one write, they must stay valid until fnCompleted
+    void Write(const std::vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted);
 
 protected:
     void HandleCompleted(CallBackFunc fnCompleted,
                          const boost::system::error_code& err, std::size_t transferred);
+    void HandleReadSomeCompleted(CBufStream& ssRecv, CallBackStage fnStage, CallBackFunc fnCompleted,
+                                 const boost::system::error_code& err, std::size_t transferred);
+    void CloseSocketStage();
+    boost::asio::io_service::strand& GetProcStrand();
     void HandleConnCompleted(CallBackConn fnCompleted, const boost::system::error_code& err);
     virtual const boost::asio::ip::tcp::endpoint SocketGetRemote() = 0;
     virtual const boost::asio::ip::tcp::endpoint SocketGetLocal() = 0;
@@ -50,12 +63,16 @@ protected:
     virtual bool AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) = 0;
     virtual void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) = 0;
     virtual void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) = 0;
+    virtual void AsyncReadSome(CBufStream& ssRecv, std::size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted) = 0;
     virtual void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) = 0;
+    virtual void AsyncWrite(const std::vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted) = 0;
 
 protected:
     CIOContainer* pContainer;
     boost::asio::ip::tcp::endpoint epRemote;
     int nRefCount;
+    boost::asio::io_service::strand strandClient;
+    boost::mutex mtxStage;
 };
 
 class CSocketClient : public CIOClient
@@ -70,7 +87,9 @@ protected:
     bool AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
     void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) override;
     void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) override;
+    void AsyncReadSome(CBufStream& ssRecv, std::size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted) override;
     void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) override;
+    void AsyncWrite(const std::vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted) override;
     const boost::asio::ip::tcp::endpoint SocketGetRemote() override;
     const boost::asio::ip::tcp::endpoint SocketGetLocal() override;
     void CloseSocket() override;
@@ -94,7 +113,9 @@ protected:
     bool AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
     void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) override;
     void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) override;
+    void AsyncReadSome(CBufStream& ssRecv, std::size_t nMaxLength, CallBackStage fnStage, CallBackFunc fnCompleted) override;
     void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) override;
+    void AsyncWrite(const std::vector<boost::asio::const_buffer>& vSend, CallBackFunc fnCompleted) override;
     const boost::asio::ip::tcp::endpoint SocketGetRemote() override;
     const boost::asio::ip::tcp::endpoint SocketGetLocal() override;
     void CloseSocket() override;
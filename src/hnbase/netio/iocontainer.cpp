@@ -36,6 +36,11 @@ const tcp::endpoint CIOContainer::GetServiceEndpoint()
     return (tcp::endpoint());
 }
 
+boost::asio::io_service::strand& CIOContainer::GetIoStrand()
+{
+    return pIOProc->GetIoStrand();
+}
+
 ///////////////////////////////
 // CIOCachedContainer
 CIOCachedContainer::CIOCachedContainer(CIOProc* pIOProcIn)
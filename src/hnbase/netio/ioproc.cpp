@@ -4,6 +4,7 @@
 
 #include "ioproc.h"
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 using namespace std;
@@ -23,6 +24,119 @@ CIOTimer::CIOTimer(uint32 nTimerIdIn, uint64 nNonceIn, const std::string& strFun
 {
 }
 
+///////////////////////////////
+// CIOTimerWheel
+
+CIOTimerWheel::CIOTimerWheel()
+  : nNextTimerId(0), nLastPoll(0), vSlot(WHEEL_SLOT_COUNT)
+{
+}
+
+uint32 CIOTimerWheel::AddTimer(uint64 nNonce, const std::string& strFunction, int64 nExpiryAt)
+{
+    while (nNextTimerId == 0 || mapTimer.count(nNextTimerId))
+    {
+        nNextTimerId++;
+    }
+    uint32 nTimerId = nNextTimerId;
+    // an already due timer goes to the next slot to be polled
+    const std::size_t nSlot = std::max(nExpiryAt, nLastPoll + 1) % WHEEL_SLOT_COUNT;
+    mapTimer.insert(make_pair(nTimerId, CEntry(CIOTimer(nTimerId, nNonce, strFunction, nExpiryAt), nSlot)));
+    mapNonceTimer.insert(make_pair(nNonce, nTimerId));
+    vSlot[nSlot].insert(nTimerId);
+    return nTimerId;
+}
+
+void CIOTimerWheel::CancelTimer(uint32 nTimerId)
+{
+    auto it = mapTimer.find(nTimerId);
+    if (it == mapTimer.end())
+    {
+        return;
+    }
+    vSlot[it->second.nSlot].erase(nTimerId);
+    auto range = mapNonceTimer.equal_range(it->second.timer.nNonce);
+    for (auto mt = range.first; mt != range.second; ++mt)
+    {
+        if (mt->second == nTimerId)
+        {
+            mapNonceTimer.erase(mt);
+            break;
+        }
+    }
+    mapTimer.erase(it);
+}
+
+void CIOTimerWheel::CancelNonceTimers(uint64 nNonce)
+{
+    vector<uint32> vTimerId;
+    auto range = mapNonceTimer.equal_range(nNonce);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        vTimerId.push_back(it->second);
+    }
+    for (const uint32 nTimerId : vTimerId)
+    {
+        CancelTimer(nTimerId);
+    }
+}
+
+void CIOTimerWheel::PollExpired(int64 nNow, vector<uint32>& vTimerId)
+{
+    if (nNow <= nLastPoll)
+    {
+        return;
+    }
+    vector<pair<int64, uint32>> vExpired;
+    const int64 nSlotCount = std::min(nNow - nLastPoll, (int64)WHEEL_SLOT_COUNT);
+    for (int64 i = 0; i < nSlotCount; i++)
+    {
+        std::set<uint32>& setSlot = vSlot[(nLastPoll + 1 + i) % WHEEL_SLOT_COUNT];
+        for (auto it = setSlot.begin(); it != setSlot.end();)
+        {
+            const int64 nExpiryAt = mapTimer.at(*it).timer.nExpiryAt;
+            if (nExpiryAt <= nNow)
+            {
+                vExpired.push_back(make_pair(nExpiryAt, *it));
+                it = setSlot.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    nLastPoll = nNow;
+
+    std::sort(vExpired.begin(), vExpired.end());
+    for (const auto& expired : vExpired)
+    {
+        vTimerId.push_back(expired.second);
+    }
+}
+
+bool CIOTimerWheel::TakeTimer(uint32 nTimerId, CIOTimer& timer)
+{
+    auto it = mapTimer.find(nTimerId);
+    if (it == mapTimer.end())
+    {
+        return false;
+    }
+    timer = it->second.timer;
+    CancelTimer(nTimerId);
+    return true;
+}
+
+void CIOTimerWheel::Clear()
+{
+    mapTimer.clear();
+    mapNonceTimer.clear();
+    for (std::set<uint32>& setSlot : vSlot)
+    {
+        setSlot.clear();
+    }
+}
+
 ///////////////////////////////
 // CIOCompletion
 CIOCompletion::CIOCompletion()
@@ -83,6 +197,14 @@ CIOProc::~CIOProc()
 {
 }
 
+void CIOProc::AddIOThread(const uint32 nCount)
+{
+    for (uint32 i = 0; i < nCount; i++)
+    {
+        vIOWorkThread.push_back(CThread(GetOwnKey() + "-io-" + std::to_string(vIOWorkThread.size()), boost::bind(&CIOProc::IOWorkThreadFunc, this)));
+    }
+}
+
 boost::asio::io_service& CIOProc::GetIoService()
 {
     return ioService;
@@ -156,17 +278,7 @@ void CIOProc::HandleHalt()
 
 uint32 CIOProc::SetTimer(uint64 nNonce, int64 nElapse, const std::string& strFunctionIn)
 {
-    static uint32 nTimerId = 0;
-    while (nTimerId == 0 || mapTimerById.count(nTimerId))
-    {
-        nTimerId++;
-    }
-    map<uint32, CIOTimer>::iterator it;
-    it = mapTimerById.insert(make_pair(nTimerId, CIOTimer(nTimerId, nNonce, strFunctionIn, GetTime() + nElapse))).first;
-    CIOTimer* pTimer = &(*it).second;
-    mapTimerByExpiry.insert(make_pair(pTimer->nExpiryAt, nTimerId));
-
-    return nTimerId;
+    return timerWheel.AddTimer(nNonce, strFunctionIn, GetTime() + nElapse);
 }
 
 void CIOProc::CancelTimer(uint32 nTimerId)
@@ -175,44 +287,12 @@ void CIOProc::CancelTimer(uint32 nTimerId)
     {
         return;
     }
-
-    map<uint32, CIOTimer>::iterator it = mapTimerById.find(nTimerId);
-    if (it == mapTimerById.end())
-    {
-        return;
-    }
-
-    CIOTimer* pTimer = &(*it).second;
-
-    multimap<int64, uint32>::iterator li = mapTimerByExpiry.lower_bound(pTimer->nExpiryAt);
-    multimap<int64, uint32>::iterator ui = mapTimerByExpiry.upper_bound(pTimer->nExpiryAt);
-    for (multimap<int64, uint32>::iterator mi = li; mi != ui && mi != mapTimerByExpiry.end(); ++mi)
-    {
-        if ((*mi).second == nTimerId)
-        {
-            mapTimerByExpiry.erase(mi);
-            break;
-        }
-    }
-
-    mapTimerById.erase(it);
+    timerWheel.CancelTimer(nTimerId);
 }
 
 void CIOProc::CancelClientTimers(uint64 nNonce)
 {
-    vector<uint32> vTimerId;
-    for (map<uint32, CIOTimer>::iterator it = mapTimerById.begin(); it != mapTimerById.end(); ++it)
-    {
-        if ((*it).second.nNonce == nNonce)
-        {
-            vTimerId.push_back((*it).first);
-        }
-    }
-
-    for (const uint32 nTimerId : vTimerId)
-    {
-        CancelTimer(nTimerId);
-    }
+    timerWheel.CancelNonceTimers(nNonce);
 }
 
 bool CIOProc::StartService(const tcp::endpoint& epLocal, size_t nMaxConnections, const vector<string>& vAllowMask)
@@ -266,9 +346,9 @@ void CIOProc::ResolveHost(const CNetHost& host)
     ss << host.nPort;
     tcp::resolver::query query(host.strHost, ss.str());
     resolverHost.async_resolve(query,
-                               boost::bind(&CIOProc::IOProcHandleResolved, this, host,
-                                           boost::asio::placeholders::error,
-                                           boost::asio::placeholders::iterator));
+                               ioStrand.wrap(boost::bind(&CIOProc::IOProcHandleResolved, this, host,
+                                                         boost::asio::placeholders::error,
+                                                         boost::asio::placeholders::iterator)));
 }
 
 void CIOProc::EnterLoop()
@@ -318,19 +398,36 @@ void CIOProc::IOThreadFunc()
 {
     ioService.reset();
 
-    timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+    timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
     EnterLoop();
 
+    // started after EnterLoop, so nothing runs beside it
+    for (CThread& thr : vIOWorkThread)
+    {
+        if (!ThreadStart(thr))
+        {
+            Error("Failed to start io work thread");
+        }
+    }
+
     ioService.run();
 
+    for (CThread& thr : vIOWorkThread)
+    {
+        ThreadExit(thr);
+    }
+
     LeaveLoop();
 
     timerHeartbeat.cancel();
 
-    mapTimerById.clear();
+    timerWheel.Clear();
+}
 
-    mapTimerByExpiry.clear();
+void CIOProc::IOWorkThreadFunc()
+{
+    ioService.run();
 }
 
 void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
@@ -339,7 +436,7 @@ void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
     {
         /* restart deadline timer */
         timerHeartbeat.expires_at(timerHeartbeat.expires_at() + IOPROC_HEARTBEAT);
-        timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+        timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
         /* handle io timer */
         IOProcPollTimer();
@@ -351,34 +448,25 @@ void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
 
 void CIOProc::IOProcPollTimer()
 {
-    int64 now = GetTime();
-    multimap<int64, uint32>::iterator ui = mapTimerByExpiry.upper_bound(now + 1);
-    vector<uint32> vecExpires;
-
-    for (multimap<int64, uint32>::iterator it = mapTimerByExpiry.begin(); it != ui; ++it)
-    {
-        vecExpires.push_back((*it).second);
-    }
-
-    mapTimerByExpiry.erase(mapTimerByExpiry.begin(), ui);
+    vector<uint32> vTimerId;
+    timerWheel.PollExpired(GetTime(), vTimerId);
 
-    for (uint32& nTimerId : vecExpires)
+    for (const uint32 nTimerId : vTimerId)
     {
-        map<uint32, CIOTimer>::iterator it = mapTimerById.find(nTimerId);
-        if (it != mapTimerById.end())
+        // a timeout handler may cancel timers later in the list
+        CIOTimer timer(0, 0, "", 0);
+        if (!timerWheel.TakeTimer(nTimerId, timer))
         {
-            uint64 nNonce = (*it).second.nNonce;
-            std::string strFuncTemp = (*it).second.strFunction;
-            mapTimerById.erase(it);
-            if (nNonce == 0)
-            {
-                ioOutBound.Timeout(nTimerId);
-                ioSSLOutBound.Timeout(nTimerId);
-            }
-            else
-            {
-                Timeout(nNonce, nTimerId, strFuncTemp);
-            }
+            continue;
+        }
+        if (timer.nNonce == 0)
+        {
+            ioOutBound.Timeout(timer.nTimerId);
+            ioSSLOutBound.Timeout(timer.nTimerId);
+        }
+        else
+        {
+            Timeout(timer.nNonce, timer.nTimerId, timer.strFunction);
         }
     }
 }
@@ -9,7 +9,10 @@
 #include <boost/asio/ssl.hpp>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "base/base.h"
 #include "netio/ioclient.h"
@@ -32,6 +35,45 @@ public:
     int64 nExpiryAt;
 };
 
+// Timers hashed by expiry second into a ring of slots, polled once per heartbeat.
+// A timer further away than the ring waits in its slot until its second comes around.
+class CIOTimerWheel
+{
+public:
+    enum
+    {
+        WHEEL_SLOT_COUNT = 64
+    };
+
+    CIOTimerWheel();
+    uint32 AddTimer(uint64 nNonce, const std::string& strFunction, int64 nExpiryAt);
+    void CancelTimer(uint32 nTimerId);
+    void CancelNonceTimers(uint64 nNonce);
+    // Lists every timer expired at nNow in expiry order, each one is still cancelable until taken
+    void PollExpired(int64 nNow, std::vector<uint32>& vTimerId);
+    bool TakeTimer(uint32 nTimerId, CIOTimer& timer);
+    void Clear();
+
+protected:
+    class CEntry
+    {
+    public:
+        CEntry(const CIOTimer& timerIn, const std::size_t nSlotIn)
+          : timer(timerIn), nSlot(nSlotIn) {}
+
+    public:
+        CIOTimer timer;
+        std::size_t nSlot;
+    };
+
+protected:
+    uint32 nNextTimerId;
+    int64 nLastPoll;
+    std::unordered_map<uint32, CEntry> mapTimer;
+    std::unordered_multimap<uint64, uint32> mapNonceTimer;
+    std::vector<std::set<uint32>> vSlot;
+};
+
 class CIOCompletion
 {
 public:
@@ -62,6 +104,9 @@ public:
     boost::asio::io_service::strand& GetIoStrand();
     virtual bool DispatchEvent(CEvent* pEvent) override;
     virtual CIOClient* CreateIOClient(CIOContainer* pContainer);
+    // Extra threads running the io service, call before the module is invoked.
+    // Every callback of this proc still runs on ioStrand, the extra threads carry the socket io and connection stages.
+    void AddIOThread(const uint32 nCount);
 
 protected:
     bool HandleInvoke() override;
@@ -96,6 +141,7 @@ protected:
 
 private:
     void IOThreadFunc();
+    void IOWorkThreadFunc();
     void IOProcHeartBeat(const boost::system::error_code& err);
     void IOProcPollTimer();
     void IOProcHandleEvent(CEvent* pEvent, std::shared_ptr<CIOCompletion> spComplt);
@@ -104,6 +150,7 @@ private:
 
 private:
     CThread thrIOProc;
+    std::vector<CThread> vIOWorkThread;
     boost::asio::io_service ioService;
     boost::asio::io_service::strand ioStrand;
     boost::asio::ip::tcp::resolver resolverHost;
@@ -112,8 +159,7 @@ private:
     CIOSSLOutBound ioSSLOutBound;
 
     boost::asio::deadline_timer timerHeartbeat;
-    std::map<uint32, CIOTimer> mapTimerById;
-    std::multimap<int64, uint32> mapTimerByExpiry;
+    CIOTimerWheel timerWheel;
 };
 
 } // namespace hnbase
@@ -17,30 +17,37 @@ namespace hnbase
 ///////////////////////////////
 // CPeerTunnel
 
-bool CPeerTunnel::AddRecvData(CBufStream& ssAdd, CBufStream& ssRecvPacket)
+bool CPeerTunnel::AddRecvData(const char* pData, const std::size_t nSize, const CheckPacketFunc& fnCheckPacket, CBufStream& ssRecvPacket)
 {
-    if (ssAdd.GetSize() > 0)
+    if (nSize > 0)
     {
-        ssTunRecv.Write(ssAdd.GetData(), ssAdd.GetSize());
+        ssTunRecv.Write(pData, nSize);
     }
-    if (nPacketSize == 0)
+    while (true)
     {
-        if (ssTunRecv.GetSize() < sizeof(nPacketSize))
+        if (nPacketSize == 0)
+        {
+            if (ssTunRecv.GetSize() < sizeof(nPacketSize))
+            {
+                return true;
+            }
+            ssTunRecv >> nPacketSize;
+            if (nPacketSize == 0)
+            {
+                return false;
+            }
+        }
+        if (ssTunRecv.GetSize() < nPacketSize)
         {
             return true;
         }
-        ssTunRecv >> nPacketSize;
-        if (nPacketSize == 0)
+        if (fnCheckPacket && !fnCheckPacket(ssTunRecv.GetData(), nPacketSize))
         {
             return false;
         }
-    }
-    if (ssTunRecv.GetSize() >= nPacketSize)
-    {
         ssTunRecv.TransferStream(ssRecvPacket, nPacketSize);
         nPacketSize = 0;
     }
-    return true;
 }
 
 bool CPeerTunnel::WriteStream(CBufStream& ss)
@@ -48,29 +55,159 @@ bool CPeerTunnel::WriteStream(CBufStream& ss)
     uint32 nSize = ss.GetSize();
     if (nSize > 0)
     {
-        ssTunSend << nSize;
-        ssTunSend.Write(ss.GetData(), ss.GetSize());
+        bytes btPacket(sizeof(nSize) + nSize);
+        memcpy(btPacket.data(), &nSize, sizeof(nSize));
+        memcpy(btPacket.data() + sizeof(nSize), ss.GetData(), nSize);
+        queTunSend.push_back(std::move(btPacket));
     }
     return true;
 }
 
-bool CPeerTunnel::GetSendData(bytes& btSend)
+bool CPeerTunnel::GetSendData(const std::size_t nMaxChunk, boost::asio::const_buffer& bufSend, std::vector<bytes>& vSentPacket)
 {
-    std::size_t n = ssTunSend.GetSize();
-    if (n == 0)
+    if (queTunSend.empty())
     {
         return false;
     }
-    if (n > 256)
+    bytes& btPacket = queTunSend.front();
+    std::size_t n = std::min(btPacket.size() - nSendPos, nMaxChunk);
+    bufSend = boost::asio::const_buffer(btPacket.data() + nSendPos, n);
+    nSendPos += n;
+    if (nSendPos == btPacket.size())
     {
-        n = 256;
+        vSentPacket.push_back(std::move(btPacket));
+        queTunSend.pop_front();
+        nSendPos = 0;
     }
-    btSend.resize(n + 2);
-    ssTunSend.Read((char*)(btSend.data() + 2), n);
-    btSend[1] = n - 1;
     return true;
 }
 
+///////////////////////////////
+// CPeerTunnelMux
+
+CPeerTunnelMux::CPeerTunnelMux()
+  : fLargeFrame(false)
+{
+    // header bytes are referenced by pending writes, so the buffer must never grow
+    vSendHeader.reserve(SEND_FRAME_COUNT * 3);
+}
+
+void CPeerTunnelMux::Clear()
+{
+    mapRecvTunnel.clear();
+    mapSendTunnel.clear();
+    fLargeFrame = false;
+    vSendHeader.clear();
+    vSentPacket.clear();
+}
+
+void CPeerTunnelMux::SetCheckPacket(CPeerTunnel::CheckPacketFunc fnCheckPacketIn)
+{
+    fnCheckPacket = fnCheckPacketIn;
+}
+
+void CPeerTunnelMux::SetLargeFrame(const bool fLargeFrameIn)
+{
+    fLargeFrame = fLargeFrameIn;
+}
+
+bool CPeerTunnelMux::IsLargeFrame() const
+{
+    return fLargeFrame;
+}
+
+bool CPeerTunnelMux::WriteStream(const uint32 nTunnelId, CBufStream& ss)
+{
+    if (nTunnelId > TUNNEL_ID_MAX)
+    {
+        return false;
+    }
+    return mapSendTunnel[nTunnelId].WriteStream(ss);
+}
+
+bool CPeerTunnelMux::PrepareSend(std::vector<boost::asio::const_buffer>& vSend)
+{
+    const std::size_t nMaxChunk = (fLargeFrame ? LARGE_FRAME_SIZE : SMALL_FRAME_SIZE);
+    const std::size_t nHeaderSize = (fLargeFrame ? 3 : 2);
+    std::size_t nBatchSize = 0;
+    bool fAdd;
+    do
+    {
+        fAdd = false;
+        for (auto& pk : mapSendTunnel)
+        {
+            if (vSend.size() >= SEND_FRAME_COUNT * 2 || nBatchSize >= SEND_BATCH_SIZE)
+            {
+                return !vSend.empty();
+            }
+            boost::asio::const_buffer bufBody;
+            if (!pk.second.GetSendData(nMaxChunk, bufBody, vSentPacket))
+            {
+                continue;
+            }
+            const std::size_t nBodySize = boost::asio::buffer_size(bufBody);
+            const std::size_t nPos = vSendHeader.size();
+            if (fLargeFrame)
+            {
+                vSendHeader.push_back(pk.first | LARGE_FRAME_FLAG);
+                vSendHeader.push_back((nBodySize - 1) & 0xFF);
+                vSendHeader.push_back(((nBodySize - 1) >> 8) & 0xFF);
+            }
+            else
+            {
+                vSendHeader.push_back(pk.first);
+                vSendHeader.push_back(nBodySize - 1);
+            }
+            vSend.push_back(boost::asio::const_buffer(vSendHeader.data() + nPos, nHeaderSize));
+            vSend.push_back(bufBody);
+            nBatchSize += nHeaderSize + nBodySize;
+            fAdd = true;
+        }
+    } while (fAdd);
+    return !vSend.empty();
+}
+
+void CPeerTunnelMux::CompleteSend()
+{
+    vSendHeader.clear();
+    vSentPacket.clear();
+}
+
+bool CPeerTunnelMux::AddRecvFrame(CBufStream& ssFrame, CBufStream& ssRecvPacket)
+{
+    while (true)
+    {
+        const uint8* p = (const uint8*)(ssFrame.GetData());
+        const std::size_t nSize = ssFrame.GetSize();
+        if (nSize < 2)
+        {
+            return true;
+        }
+        uint8 nTunnelId = p[0];
+        std::size_t nHeaderSize = 2;
+        std::size_t nBodySize = (std::size_t)p[1] + 1;
+        if (nTunnelId & LARGE_FRAME_FLAG)
+        {
+            if (nSize < 3)
+            {
+                return true;
+            }
+            nTunnelId &= TUNNEL_ID_MAX;
+            nHeaderSize = 3;
+            nBodySize = ((std::size_t)p[1] | ((std::size_t)p[2] << 8)) + 1;
+        }
+        if (nSize < nHeaderSize + nBodySize)
+        {
+            return true;
+        }
+        if (!mapRecvTunnel[nTunnelId].AddRecvData((const char*)(p + nHeaderSize), nBodySize, fnCheckPacket, ssRecvPacket))
+        {
+            return false;
+        }
+        ssFrame.consume(nHeaderSize + nBodySize);
+    }
+}
+
 ///////////////////////////////
 // CPeer
 
@@ -91,6 +228,8 @@ void CPeer::Close()
         pClient->Close();
         pClient = nullptr;
     }
+    // queued packets and partial frames die with the connection
+    tunnelMux.Clear();
 }
 
 uint64 CPeer::GetNonce()
@@ -115,7 +254,8 @@ const tcp::endpoint CPeer::GetLocal()
 
 void CPeer::Activate()
 {
-    ssWrite.Clear();
+    vWrite.clear();
+    tunnelMux.CompleteSend();
 
     nTimeActive = GetTime();
     nTimeRecv = 0;
@@ -134,7 +274,7 @@ CBufStream& CPeer::ReadStream()
 
 bool CPeer::WriteStream(const uint32 nTunnelId, CBufStream& ss)
 {
-    if (!mapPeerTunnel[nTunnelId].WriteStream(ss))
+    if (!tunnelMux.WriteStream(nTunnelId, ss))
     {
         return false;
     }
@@ -142,6 +282,11 @@ bool CPeer::WriteStream(const uint32 nTunnelId, CBufStream& ss)
     return true;
 }
 
+void CPeer::SetTunnelLargeFrame(const bool fLargeFrame)
+{
+    tunnelMux.SetLargeFrame(fLargeFrame);
+}
+
 void CPeer::Read(size_t nLength, CompltFunc fnComplt)
 {
     ssRecv.Clear();
@@ -155,93 +300,49 @@ void CPeer::Read(size_t nLength, CompltFunc fnComplt)
     }
     else
     {
-        ssReadTunnel.Clear();
-        pClient->Read(ssReadTunnel, 2, boost::bind(&CPeer::HandleRead, this, _1, nLength, fnComplt, 0, 0));
+        pClient->ReadSome(ssReadFrame, CPeerTunnelMux::RECV_BUFFER_SIZE, boost::bind(&CPeer::HandleReadStage, this, _1),
+                          boost::bind(&CPeer::HandleRead, this, _1, nLength, fnComplt));
     }
 }
 
 void CPeer::Write()
 {
-    if (ssWrite.GetSize() > 0)
+    if (!vWrite.empty())
     {
         return;
     }
-    bool fAdd;
-    do
-    {
-        fAdd = false;
-        for (auto& pk : mapPeerTunnel)
-        {
-            bytes btSendData;
-            if (pk.second.GetSendData(btSendData))
-            {
-                btSendData[0] = pk.first; // tunnel id
-                ssWrite.Write((char*)(btSendData.data()), btSendData.size());
-                fAdd = true;
-            }
-        }
-    } while (ssWrite.GetSize() < 1200 && fAdd);
-    if (ssWrite.GetSize() > 0)
+    if (tunnelMux.PrepareSend(vWrite))
     {
-        pClient->Write(ssWrite, boost::bind(&CPeer::HandleWriten, this, _1));
+        pClient->Write(vWrite, boost::bind(&CPeer::HandleWriten, this, _1));
     }
 }
 
-void CPeer::HandleRead(size_t nTransferred, std::size_t nReadLength, CompltFunc fnComplt, const uint8 nTunnelId, const uint16 nReadSize)
+bool CPeer::HandleReadStage(size_t nTransferred)
 {
-    if (nTransferred != 0)
+    // connection strand: the read chain is the only user of the receive side until HandleRead
+    return tunnelMux.AddRecvFrame(ssReadFrame, ssHisRecv);
+}
+
+void CPeer::HandleRead(size_t nTransferred, std::size_t nReadLength, CompltFunc fnComplt)
+{
+    if (nTransferred == 0)
     {
-        nTimeRecv = GetTime();
-        if (nReadSize == 0)
-        {
-            // read tunnel header
-            if (ssReadTunnel.GetSize() != 2)
-            {
-                pPeerNet->HandlePeerError(this);
-            }
-            else
-            {
-                uint8* p = (uint8*)(ssReadTunnel.GetData());
-                uint8 nTid = *p;
-                uint16 nBodySize = *(p + 1);
-                nBodySize += 1;
-                ssReadTunnel.Clear();
-                pClient->Read(ssReadTunnel, nBodySize, boost::bind(&CPeer::HandleRead, this, _1, nReadLength, fnComplt, nTid, nBodySize));
-            }
-        }
-        else
+        pPeerNet->HandlePeerError(this);
+        return;
+    }
+    nTimeRecv = GetTime();
+    if (ssHisRecv.GetSize() >= nReadLength)
+    {
+        ssHisRecv.TransferStream(ssRecv, nReadLength);
+        if (!fnComplt())
         {
-            // read tunnel body
-            if (ssReadTunnel.GetSize() != nReadSize)
-            {
-                pPeerNet->HandlePeerError(this);
-            }
-            else
-            {
-                if (!mapPeerTunnel[nTunnelId].AddRecvData(ssReadTunnel, ssHisRecv))
-                {
-                    pPeerNet->HandlePeerError(this);
-                    return;
-                }
-                ssReadTunnel.Clear();
-                if (ssHisRecv.GetSize() >= nReadLength)
-                {
-                    ssHisRecv.TransferStream(ssRecv, nReadLength);
-                    if (!fnComplt())
-                    {
-                        pPeerNet->HandlePeerViolate(this);
-                    }
-                }
-                else
-                {
-                    pClient->Read(ssReadTunnel, 2, boost::bind(&CPeer::HandleRead, this, _1, nReadLength, fnComplt, 0, 0));
-                }
-            }
+            pPeerNet->HandlePeerViolate(this);
         }
     }
     else
     {
-        pPeerNet->HandlePeerError(this);
+        pClient->ReadSome(ssReadFrame, CPeerTunnelMux::RECV_BUFFER_SIZE, boost::bind(&CPeer::HandleReadStage, this, _1),
+                          boost::bind(&CPeer::HandleRead, this, _1, nReadLength, fnComplt));
     }
 }
 
@@ -251,7 +352,8 @@ void CPeer::HandleWriten(std::size_t nTransferred)
     {
         nTimeSend = GetTime();
 
-        ssWrite.Clear();
+        vWrite.clear();
+        tunnelMux.CompleteSend();
         Write();
         pPeerNet->HandlePeerWriten(this);
     }
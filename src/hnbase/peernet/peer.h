@@ -7,6 +7,8 @@
 
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
+#include <deque>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -21,18 +23,63 @@ class CPeerNet;
 class CPeerTunnel
 {
 public:
+    typedef boost::function<bool(const char*, std::size_t)> CheckPacketFunc;
+
     CPeerTunnel()
-      : nPacketSize(0) {}
+      : nPacketSize(0), nSendPos(0) {}
 
-    bool AddRecvData(CBufStream& ssAdd, CBufStream& ssRecvPacket);
+    bool AddRecvData(const char* pData, const std::size_t nSize, const CheckPacketFunc& fnCheckPacket, CBufStream& ssRecvPacket);
     bool WriteStream(CBufStream& ss);
-    bool GetSendData(bytes& btSend);
+    // Takes the next chunk of the front packet, a finished packet is moved to vSentPacket so the chunk stays valid
+    bool GetSendData(const std::size_t nMaxChunk, boost::asio::const_buffer& bufSend, std::vector<bytes>& vSentPacket);
 
 protected:
     CBufStream ssTunRecv;
-    CBufStream ssTunSend;
+    std::deque<bytes> queTunSend;
 
     uint32 nPacketSize;
+    std::size_t nSendPos;
+};
+
+// Multiplexes the tunnels of one connection.
+// A small frame is [tunnel id][size - 1] with at most 256 bytes of body,
+// a large frame sets the high bit of the tunnel id and is followed by a 16-bit little endian size - 1.
+class CPeerTunnelMux
+{
+public:
+    enum
+    {
+        TUNNEL_ID_MAX = 0x7F,
+        LARGE_FRAME_FLAG = 0x80,
+        SMALL_FRAME_SIZE = 256,
+        LARGE_FRAME_SIZE = 65536,
+        SEND_FRAME_COUNT = 256,
+        SEND_BATCH_SIZE = 256 * 1024,
+        RECV_BUFFER_SIZE = 64 * 1024
+    };
+
+    CPeerTunnelMux();
+    // Drops every tunnel buffer, only called once the connection is closed and no write is pending
+    void Clear();
+    // Checks every complete packet before it is handed over, while the receive stage still runs off the proc strand
+    void SetCheckPacket(CPeerTunnel::CheckPacketFunc fnCheckPacketIn);
+    void SetLargeFrame(const bool fLargeFrameIn);
+    bool IsLargeFrame() const;
+    bool WriteStream(const uint32 nTunnelId, CBufStream& ss);
+    // Gathers frames of all tunnels round-robin, the buffers stay valid until CompleteSend
+    bool PrepareSend(std::vector<boost::asio::const_buffer>& vSend);
+    void CompleteSend();
+    // Demultiplexes every complete frame of ssFrame, a partial frame is left in ssFrame for the next read
+    bool AddRecvFrame(CBufStream& ssFrame, CBufStream& ssRecvPacket);
+
+protected:
+    // receive and send sides are kept apart, the receive side runs on the connection strand
+    std::map<uint32, CPeerTunnel> mapRecvTunnel;
+    std::map<uint32, CPeerTunnel> mapSendTunnel;
+    CPeerTunnel::CheckPacketFunc fnCheckPacket;
+    bool fLargeFrame;
+    std::vector<uint8> vSendHeader;
+    std::vector<bytes> vSentPacket;
 };
 
 class CPeer
@@ -53,11 +100,14 @@ public:
 protected:
     CBufStream& ReadStream();
     bool WriteStream(const uint32 nTunnelId, CBufStream& ss);
+    // Switches to large tunnel frames once the remote end has announced it can parse them
+    void SetTunnelLargeFrame(const bool fLargeFrame);
 
     void Read(std::size_t nLength, CompltFunc fnComplt);
     void Write();
 
-    void HandleRead(std::size_t nTransferred, std::size_t nReadLength, CompltFunc fnComplt, const uint8 nTunnelId, const uint16 nReadSize);
+    bool HandleReadStage(std::size_t nTransferred);
+    void HandleRead(std::size_t nTransferred, std::size_t nReadLength, CompltFunc fnComplt);
     void HandleWriten(std::size_t nTransferred);
 
 public:
@@ -72,12 +122,12 @@ protected:
     bool fInBound;
 
     CBufStream ssRecv;
-    CBufStream ssWrite;
+    std::vector<boost::asio::const_buffer> vWrite;
 
     CBufStream ssHisRecv;
-    CBufStream ssReadTunnel;
+    CBufStream ssReadFrame;
 
-    std::map<uint32, CPeerTunnel> mapPeerTunnel;
+    CPeerTunnelMux tunnelMux;
 };
 
 } // namespace hnbase
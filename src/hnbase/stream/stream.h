@@ -7,6 +7,7 @@
 
 #include <boost/asio.hpp>
 #include <boost/type_traits.hpp>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -36,7 +37,7 @@ class CStream
 {
 public:
     CStream(std::streambuf* sb)
-      : ios(sb) {}
+      : ios(sb), fFlat(false), pFlatData(nullptr), nFlatSize(0), nFlatPos(0) {}
 
     virtual std::size_t GetSize()
     {
@@ -50,12 +51,35 @@ public:
 
     CStream& Write(const char* s, std::size_t n)
     {
+        if (fFlat)
+        {
+            if (pFlatData != nullptr)
+            {
+                if (n > nFlatSize - nFlatPos)
+                {
+                    throw std::runtime_error((std::string("stream write error. To be writing ") + std::to_string(n) + " but " + std::to_string(nFlatSize - nFlatPos)).c_str());
+                }
+                std::memcpy(pFlatData + nFlatPos, s, n);
+            }
+            nFlatPos += n;
+            return (*this);
+        }
         ios.write(s, n);
         return (*this);
     }
 
     CStream& Read(char* s, std::size_t n)
     {
+        if (fFlat)
+        {
+            if (n > nFlatSize - nFlatPos)
+            {
+                throw std::runtime_error((std::string("stream read error. To be reading ") + std::to_string(n) + " but " + std::to_string(nFlatSize - nFlatPos)).c_str());
+            }
+            std::memcpy(s, pFlatData + nFlatPos, n);
+            nFlatPos += n;
+            return (*this);
+        }
         ios.read(s, n);
         if (ios.gcount() != n)
         {
@@ -190,6 +214,11 @@ protected:
 
 protected:
     std::iostream ios;
+    // flat streams bypass ios and copy straight from/to the span
+    bool fFlat;
+    char* pFlatData;
+    std::size_t nFlatSize;
+    std::size_t nFlatPos;
 };
 
 // Autosize buffer stream
@@ -240,10 +269,8 @@ public:
         std::size_t n = std::min(nSize, size());
         if (n > 0)
         {
-            bytes btData;
-            btData.resize(n);
-            this->Read((char*)(btData.data()), n);
-            ss.Write((char*)(btData.data()), n);
+            ss.Write(gptr(), n);
+            consume(n);
         }
         return n;
     }
@@ -441,6 +468,59 @@ public:
     }
 };
 
+// Flat writer into a preallocated buffer, without a buffer it only counts the bytes
+class CFlatWriteStream : public CStream
+{
+public:
+    CFlatWriteStream()
+      : CStream(nullptr)
+    {
+        fFlat = true;
+    }
+    CFlatWriteStream(char* pData, const std::size_t nSize)
+      : CStream(nullptr)
+    {
+        fFlat = true;
+        pFlatData = pData;
+        nFlatSize = nSize;
+    }
+
+    std::size_t GetSize()
+    {
+        return nFlatPos;
+    }
+
+    std::size_t GetWritePos() const
+    {
+        return nFlatPos;
+    }
+};
+
+// Bounds-checked flat reader over a byte span
+class CFlatReadStream : public CStream
+{
+public:
+    CFlatReadStream(const uint8* pData, const std::size_t nSize)
+      : CStream(nullptr)
+    {
+        fFlat = true;
+        pFlatData = (char*)pData;
+        nFlatSize = nSize;
+    }
+    CFlatReadStream(const bytes& btData)
+      : CFlatReadStream(btData.data(), btData.size()) {}
+
+    std::size_t GetSize()
+    {
+        return nFlatSize - nFlatPos;
+    }
+
+    std::size_t GetReadPos() const
+    {
+        return nFlatPos;
+    }
+};
+
 class CVarInt
 {
     friend class CStream;
@@ -993,10 +1073,37 @@ inline CStream& CStream::Serialize(std::pair<P1, P2>& t, ObjectType&, O& o)
 template <typename T>
 std::size_t GetSerializeSize(const T& obj)
 {
-    CBufStream ss;
+    CFlatWriteStream ss;
     return ss.GetSerializeSize(obj);
 }
 
+// Serialize into an exactly sized buffer through the flat stream
+template <typename T>
+void FlatSerialize(const T& obj, bytes& btData)
+{
+    CFlatWriteStream ssSize;
+    ssSize << obj;
+    btData.resize(ssSize.GetWritePos());
+    CFlatWriteStream ss((char*)btData.data(), btData.size());
+    ss << obj;
+}
+
+// Deserialize a whole span, fails if the data is short or has bytes left over
+template <typename T>
+bool FlatDeserialize(const uint8* pData, const std::size_t nSize, T& obj)
+{
+    try
+    {
+        CFlatReadStream ss(pData, nSize);
+        ss >> obj;
+        return (ss.GetSize() == 0);
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+}
+
 } // namespace hnbase
 
 #endif //HNBASE_STREAM_H
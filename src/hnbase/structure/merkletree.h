@@ -5,7 +5,10 @@
 #ifndef HNBASE_STRUCTURE_MERKLETREE_H
 #define HNBASE_STRUCTURE_MERKLETREE_H
 
+#include <algorithm>
+
 #include "crypto.h"
+#include "workerpool.h"
 
 using namespace hashahead::crypto;
 
@@ -25,16 +28,29 @@ public:
         PD_RIGHT = 1
     };
 
+    enum
+    {
+        PARALLEL_MIN_PAIR_COUNT = 4096
+    };
+
+    static std::size_t GetMerkleTreeSize(const std::size_t nLeafCount)
+    {
+        std::size_t nTreeSize = nLeafCount;
+        for (std::size_t nSize = nLeafCount; nSize > 1; nSize = (nSize + 1) / 2)
+        {
+            nTreeSize += (nSize + 1) / 2;
+        }
+        return nTreeSize;
+    }
+    // vMerkleTree holds the leaves on entry, the layers are appended in place and the last node is the root
     static uint256 BuildMerkleTree(std::vector<uint256>& vMerkleTree)
     {
+        const std::size_t nLeafCount = vMerkleTree.size();
+        vMerkleTree.resize(GetMerkleTreeSize(nLeafCount));
         std::size_t nLayerHeadIndex = 0;
-        for (std::size_t nSize = vMerkleTree.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        for (std::size_t nSize = nLeafCount; nSize > 1; nSize = (nSize + 1) / 2)
         {
-            for (std::size_t i = 0; i < nSize; i += 2)
-            {
-                std::size_t i2 = std::min(i + 1, nSize - 1);
-                vMerkleTree.push_back(CryptoHash(vMerkleTree[nLayerHeadIndex + i], vMerkleTree[nLayerHeadIndex + i2]));
-            }
+            BuildMerkleLayer(&vMerkleTree[nLayerHeadIndex], nSize, &vMerkleTree[nLayerHeadIndex + nSize]);
             nLayerHeadIndex += nSize;
         }
         return (vMerkleTree.empty() ? uint64(0) : vMerkleTree.back());
@@ -119,6 +135,32 @@ public:
     {
         return (hashMerkleRoot == GetMerkleRootByProve(vMerkleProve, hashVerify));
     }
+
+protected:
+    // Hashes the full pairs of one layer in batches, a trailing odd node is paired with itself.
+    // Large layers are split into chunks for the shared worker pool.
+    static void BuildMerkleLayer(const uint256* pLayer, const std::size_t nSize, uint256* pParent)
+    {
+        const std::size_t nPairCount = nSize / 2;
+        CWorkerPool& pool = CWorkerPool::GetShared();
+        const std::size_t nChunkCount = std::min<std::size_t>(pool.GetConcurrency(), nPairCount / PARALLEL_MIN_PAIR_COUNT);
+        if (nChunkCount > 1)
+        {
+            const std::size_t nChunk = (nPairCount + nChunkCount - 1) / nChunkCount;
+            pool.ParallelFor((nPairCount + nChunk - 1) / nChunk, [pLayer, pParent, nPairCount, nChunk](const std::size_t nIndex) {
+                const std::size_t nBegin = nIndex * nChunk;
+                CryptoHashPairs(pLayer + nBegin * 2, std::min(nChunk, nPairCount - nBegin), pParent + nBegin);
+            });
+        }
+        else
+        {
+            CryptoHashPairs(pLayer, nPairCount, pParent);
+        }
+        if (nSize % 2 != 0)
+        {
+            pParent[nPairCount] = CryptoHash(pLayer[nSize - 1], pLayer[nSize - 1]);
+        }
+    }
 };
 
 } // namespace hnbase
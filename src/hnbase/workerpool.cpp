@@ -0,0 +1,146 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+namespace hnbase
+{
+
+///////////////////////////////
+// CWorkerPool
+
+CWorkerPool::CWorkerPool(const std::size_t nWorkerCountIn)
+  : nWorkerCount(nWorkerCountIn), fExit(false)
+{
+    for (std::size_t i = 0; i < nWorkerCount; i++)
+    {
+        grpWorker.create_thread(boost::bind(&CWorkerPool::WorkerFunc, this));
+    }
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        fExit = true;
+    }
+    condWork.notify_all();
+    grpWorker.join_all();
+}
+
+CWorkerPool& CWorkerPool::GetShared()
+{
+    static CWorkerPool poolShared(std::max(boost::thread::hardware_concurrency(), 1U) - 1);
+    return poolShared;
+}
+
+std::size_t CWorkerPool::GetConcurrency() const
+{
+    return nWorkerCount + 1;
+}
+
+void CWorkerPool::ParallelFor(const std::size_t nTaskCount, const TaskFunc& fnTask)
+{
+    if (nTaskCount == 0)
+    {
+        return;
+    }
+    if (nTaskCount == 1 || nWorkerCount == 0)
+    {
+        for (std::size_t i = 0; i < nTaskCount; i++)
+        {
+            fnTask(i);
+        }
+        return;
+    }
+
+    std::shared_ptr<CJob> spJob = std::make_shared<CJob>(nTaskCount, fnTask);
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        queJob.push_back(spJob);
+    }
+    condWork.notify_all();
+
+    while (RunOne(*spJob))
+    {
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        while (spJob->nDone < nTaskCount)
+        {
+            condDone.wait(lock);
+        }
+        auto it = std::find(queJob.begin(), queJob.end(), spJob);
+        if (it != queJob.end())
+        {
+            queJob.erase(it);
+        }
+    }
+    if (spJob->ptrError)
+    {
+        std::rethrow_exception(spJob->ptrError);
+    }
+}
+
+bool CWorkerPool::RunOne(CJob& job)
+{
+    const std::size_t nIndex = job.nNext++;
+    if (nIndex >= job.nTaskCount)
+    {
+        return false;
+    }
+    try
+    {
+        job.fnTask(nIndex);
+    }
+    catch (...)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        if (!job.ptrError)
+        {
+            job.ptrError = std::current_exception();
+        }
+    }
+    if (++job.nDone == job.nTaskCount)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        condDone.notify_all();
+    }
+    return true;
+}
+
+void CWorkerPool::WorkerFunc()
+{
+    while (true)
+    {
+        std::shared_ptr<CJob> spJob;
+        {
+            boost::unique_lock<boost::mutex> lock(mtxPool);
+            while (!fExit && queJob.empty())
+            {
+                condWork.wait(lock);
+            }
+            if (fExit)
+            {
+                return;
+            }
+            spJob = queJob.front();
+        }
+        if (!RunOne(*spJob))
+        {
+            // every index is taken, the owner waits for the running ones and no worker needs the job any more
+            boost::unique_lock<boost::mutex> lock(mtxPool);
+            if (!queJob.empty() && queJob.front() == spJob)
+            {
+                queJob.pop_front();
+            }
+        }
+    }
+}
+
+} // namespace hnbase
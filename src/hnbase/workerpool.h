@@ -0,0 +1,67 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HNBASE_WORKERPOOL_H
+#define HNBASE_WORKERPOOL_H
+
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace hnbase
+{
+
+// Fixed worker threads shared by the short parallel steps of block and trie processing.
+// The calling thread works on its own job too, so a nested ParallelFor always makes progress.
+class CWorkerPool : public boost::noncopyable
+{
+public:
+    typedef std::function<void(std::size_t)> TaskFunc;
+
+    CWorkerPool(const std::size_t nWorkerCount);
+    ~CWorkerPool();
+
+    // One pool per process, hardware threads minus the caller
+    static CWorkerPool& GetShared();
+    // Threads a ParallelFor can use, the workers plus the caller
+    std::size_t GetConcurrency() const;
+    // Runs fnTask(i) for every i in [0, nTaskCount) and returns when all are done.
+    // The first exception thrown by a task is rethrown here after the others finished.
+    void ParallelFor(const std::size_t nTaskCount, const TaskFunc& fnTask);
+
+protected:
+    class CJob
+    {
+    public:
+        CJob(const std::size_t nTaskCountIn, const TaskFunc& fnTaskIn)
+          : nTaskCount(nTaskCountIn), fnTask(fnTaskIn), nNext(0), nDone(0) {}
+
+    public:
+        const std::size_t nTaskCount;
+        const TaskFunc& fnTask;
+        std::atomic<std::size_t> nNext;
+        std::atomic<std::size_t> nDone;
+        std::exception_ptr ptrError;
+    };
+
+    bool RunOne(CJob& job);
+    void WorkerFunc();
+
+protected:
+    boost::thread_group grpWorker;
+    std::size_t nWorkerCount;
+    boost::mutex mtxPool;
+    boost::condition_variable condWork;
+    boost::condition_variable condDone;
+    std::deque<std::shared_ptr<CJob>> queJob;
+    bool fExit;
+};
+
+} // namespace hnbase
+
+#endif //HNBASE_WORKERPOOL_H
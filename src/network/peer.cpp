@@ -22,6 +22,8 @@ CBbPeer::CBbPeer(CPeerNet* pPeerNetIn, CIOClient* pClientIn, uint64 nNonceIn,
                  bool fInBoundIn, uint32 nMsgMagicIn, uint32 nHsTimerIdIn)
   : CPeer(pPeerNetIn, pClientIn, nNonceIn, fInBoundIn), nMsgMagic(nMsgMagicIn), nHsTimerId(nHsTimerIdIn), nPingTimerId(0), nPingMillisTime(0), nPingSeq(0)
 {
+    // every tunnel packet is one whole message, its payload checksum is verified before the proc strand sees it
+    tunnelMux.SetCheckPacket(boost::bind(&CBbPeer::CheckRecvPacket, nMsgMagic, _1, _2));
 }
 
 CBbPeer::~CBbPeer()
@@ -160,6 +162,28 @@ void CBbPeer::SendPing()
     nPingMillisTime = GetTimeMillis();
 }
 
+bool CBbPeer::CheckRecvPacket(const uint32 nMsgMagic, const char* pData, const std::size_t nSize)
+{
+    if (nSize < MESSAGE_HEADER_SIZE)
+    {
+        return false;
+    }
+    try
+    {
+        CPeerMessageHeader hdr;
+        CBufStream ss(pData, MESSAGE_HEADER_SIZE);
+        ss >> hdr;
+        return (hdr.nMagic == nMsgMagic && hdr.Verify()
+                && hdr.nPayloadSize == nSize - MESSAGE_HEADER_SIZE
+                && hdr.nPayloadChecksum == hashahead::crypto::CryptoHash(pData + MESSAGE_HEADER_SIZE, hdr.nPayloadSize).Get32());
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return false;
+}
+
 bool CBbPeer::ParseMessageHeader()
 {
     try
@@ -207,8 +231,8 @@ bool CBbPeer::HandleReadHeader()
 bool CBbPeer::HandshakeReadCompleted()
 {
     CBufStream& ss = ReadStream();
-    uint256 hash = hashahead::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-    if (hdrRecv.nPayloadChecksum == hash.Get32() && hdrRecv.GetChannel() == PROTO_CHN_NETWORK)
+    // the payload checksum was verified by CheckRecvPacket
+    if (hdrRecv.GetChannel() == PROTO_CHN_NETWORK)
     {
         int64 nTimeRecv = GetTime();
         int nCmd = hdrRecv.GetCommand();
@@ -223,6 +247,7 @@ bool CBbPeer::HandshakeReadCompleted()
                 int64 nTime;
                 ss >> nVersion >> nService >> nTime >> nNonceFrom >> strSubVer >> nStartingHeight >> hashGenesis;
                 nTimeDelta = nTime - nTimeRecv;
+                SetTunnelLargeFrame((nService & NODE_LARGE_FRAME) != 0);
                 if (!fInBound)
                 {
                     nTimeDelta += (nTimeRecv - nTimeHello) / 2;
@@ -264,23 +289,20 @@ bool CBbPeer::HandshakeCompleted()
 
 bool CBbPeer::HandleReadCompleted()
 {
+    // the payload checksum was verified by CheckRecvPacket
     CBufStream& ss = ReadStream();
-    uint256 hash = hashahead::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-    if (hdrRecv.nPayloadChecksum == hash.Get32())
+    try
     {
-        try
+        if ((dynamic_cast<CBbPeerNet*>(pPeerNet))->HandlePeerRecvMessage(this, hdrRecv.GetChannel(), hdrRecv.GetCommand(), ss))
         {
-            if ((dynamic_cast<CBbPeerNet*>(pPeerNet))->HandlePeerRecvMessage(this, hdrRecv.GetChannel(), hdrRecv.GetCommand(), ss))
-            {
-                Read(MESSAGE_HEADER_SIZE, boost::bind(&CBbPeer::HandleReadHeader, this));
-                return true;
-            }
-        }
-        catch (exception& e)
-        {
-            StdError(__PRETTY_FUNCTION__, e.what());
+            Read(MESSAGE_HEADER_SIZE, boost::bind(&CBbPeer::HandleReadHeader, this));
+            return true;
         }
     }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
     return false;
 }
 
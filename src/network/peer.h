@@ -37,6 +37,8 @@ public:
     bool PingTimer(uint32 nTimerId) override;
 
 protected:
+    // Runs on the connection strand, so it only looks at the packet
+    static bool CheckRecvPacket(const uint32 nMsgMagic, const char* pData, const std::size_t nSize);
     void SendHello();
     void SendHelloAck();
     void SendPing();
@@ -81,6 +83,36 @@ public:
     int nPingPongTimeDelta;
 };
 
+class CNetSyncPeerStatus
+{
+public:
+    CNetSyncPeerStatus()
+      : nNonce(0), nBlockWindow(0), nAssignedBlock(0), nRecvBlockCount(0), dBlockRate(0.0), dBytesRate(0.0) {}
+
+public:
+    uint64 nNonce;
+    std::string strAddress;
+    std::size_t nBlockWindow;
+    std::size_t nAssignedBlock;
+    uint64 nRecvBlockCount;
+    double dBlockRate;
+    double dBytesRate;
+};
+
+class CNetSyncStatus
+{
+public:
+    CNetSyncStatus()
+      : nSyncHeight(0), nSyncBlockCount(0), dBlockRate(0.0), nReorderBlock(0) {}
+
+public:
+    int nSyncHeight;
+    uint64 nSyncBlockCount;
+    double dBlockRate;
+    std::size_t nReorderBlock;
+    std::vector<CNetSyncPeerStatus> vPeer;
+};
+
 } // namespace network
 } // namespace hashahead
 
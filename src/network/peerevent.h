@@ -41,6 +41,9 @@ enum
     EVENT_PEER_BLOCK_PREV_BLOCKS,
     EVENT_PEER_BLOCK_GET_BLOCK_REQ,
     EVENT_PEER_BLOCK_GET_BLOCK_RSP,
+    EVENT_PEER_BLOCK_CMPCT,
+    EVENT_PEER_BLOCK_GET_BLOCK_TXS,
+    EVENT_PEER_BLOCK_BLOCK_TXS,
 
     EVENT_PEER_CERTTX_SUBSCRIBE,
     EVENT_PEER_CERTTX_UNSUBSCRIBE,
@@ -49,6 +52,8 @@ enum
     EVENT_PEER_USERTX_SUBSCRIBE,
     EVENT_PEER_USERTX_UNSUBSCRIBE,
     EVENT_PEER_USERTX_TXS,
+    EVENT_PEER_USERTX_INV,
+    EVENT_PEER_USERTX_GETTXS,
 
     EVENT_PEER_BLOCKVOTE_PROTO_DATA,
 
@@ -62,6 +67,7 @@ enum
     EVENT_LOCAL_CERTTX_BROADCAST_TXS,
     EVENT_LOCAL_USERTX_SUBSCRIBE_FORK,
     EVENT_LOCAL_USERTX_BROADCAST_TXS,
+    EVENT_LOCAL_USERTX_RELAY_TIMER,
 
     EVENT_LOCAL_BLOCKVOTE_TIMER,
     EVENT_LOCAL_BLOCKVOTE_SUBSCRIBE_FORK,
@@ -305,6 +311,79 @@ public:
     bytes btBlockData;
 };
 
+class CPeerCmpctBlockData
+{
+    friend class hnbase::CStream;
+
+public:
+    CPeerCmpctBlockData()
+      : nSalt(0) {}
+
+protected:
+    template <typename O>
+    void Serialize(hnbase::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(hashPrev, opt);
+        s.Serialize(nSalt, opt);
+        s.Serialize(btBlockData, opt);
+        s.Serialize(vPrefilledIndex, opt);
+        s.Serialize(vShortId, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    uint256 hashPrev;
+    uint64 nSalt;
+    bytes btBlockData;                   // the block with only the prefilled txs in vtx
+    std::vector<uint32> vPrefilledIndex; // index of each prefilled tx in the full vtx
+    std::vector<uint64> vShortId;        // short ids of the other txs, in vtx order
+};
+
+class CPeerBlockTxsReq
+{
+    friend class hnbase::CStream;
+
+public:
+    CPeerBlockTxsReq() {}
+    CPeerBlockTxsReq(const uint256& h, const std::vector<uint32>& v)
+      : hashBlock(h), vTxIndex(v) {}
+
+protected:
+    template <typename O>
+    void Serialize(hnbase::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vTxIndex, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    std::vector<uint32> vTxIndex;
+};
+
+class CPeerBlockTxsData
+{
+    friend class hnbase::CStream;
+
+public:
+    CPeerBlockTxsData() {}
+    CPeerBlockTxsData(const uint256& h, const bytes& b)
+      : hashBlock(h), btTxData(b) {}
+
+protected:
+    template <typename O>
+    void Serialize(hnbase::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(btTxData, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    bytes btTxData;
+};
+
 class CBroadBlockData
 {
     friend class hnbase::CStream;
@@ -412,6 +491,9 @@ typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_NEXT_PREVBLOCK, uint256) CEventPeerB
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_PREV_BLOCKS, std::vector<uint256>) CEventPeerBlockPrevBlocks;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_GET_BLOCK_REQ, uint256) CEventPeerBlockGetBlockReq;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_GET_BLOCK_RSP, bytes) CEventPeerBlockGetBlockRsp;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_CMPCT, CPeerCmpctBlockData) CEventPeerBlockCmpct;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_GET_BLOCK_TXS, CPeerBlockTxsReq) CEventPeerBlockGetBlockTxs;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK_BLOCK_TXS, CPeerBlockTxsData) CEventPeerBlockBlockTxs;
 
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_CERTTX_SUBSCRIBE, std::vector<uint256>) CEventPeerCerttxSubscribe;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_CERTTX_UNSUBSCRIBE, std::vector<uint256>) CEventPeerCerttxUnsubscribe;
@@ -420,6 +502,8 @@ typedef TYPE_PEERDATAEVENT(EVENT_PEER_CERTTX_TXS, bytes) CEventPeerCerttxTxs;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_USERTX_SUBSCRIBE, std::vector<uint256>) CEventPeerUsertxSubscribe;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_USERTX_UNSUBSCRIBE, std::vector<uint256>) CEventPeerUsertxUnsubscribe;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_USERTX_TXS, bytes) CEventPeerUsertxTxs;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_USERTX_INV, std::vector<uint64>) CEventPeerUsertxInv;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_USERTX_GETTXS, std::vector<uint64>) CEventPeerUsertxGetTxs;
 
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCKVOTE_PROTO_DATA, bytes) CEventPeerBlockVoteProtoData;
 
@@ -433,6 +517,7 @@ typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_BLOCK_BROADCAST_BKS, CBroadBlockData) CEv
 typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_CERTTX_BROADCAST_TXS, std::vector<CTransaction>) CEventLocalCerttxBroadcastTxs;
 typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_USERTX_SUBSCRIBE_FORK, std::vector<uint256>) CEventLocalUsertxSubscribeFork;
 typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_USERTX_BROADCAST_TXS, std::vector<CTransaction>) CEventLocalUsertxBroadcastTxs;
+typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_USERTX_RELAY_TIMER, uint32) CEventLocalUsertxRelayTimer;
 
 typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_BLOCKVOTE_TIMER, uint32) CEventLocalBlockvoteTimer;
 typedef TYPE_PEERDATAEVENT(EVENT_LOCAL_BLOCKVOTE_SUBSCRIBE_FORK, std::vector<uint256>) CEventLocalBlockvoteSubscribeFork;
@@ -472,6 +557,9 @@ public:
     DECLARE_EVENTHANDLER(CEventPeerBlockPrevBlocks);
     DECLARE_EVENTHANDLER(CEventPeerBlockGetBlockReq);
     DECLARE_EVENTHANDLER(CEventPeerBlockGetBlockRsp);
+    DECLARE_EVENTHANDLER(CEventPeerBlockCmpct);
+    DECLARE_EVENTHANDLER(CEventPeerBlockGetBlockTxs);
+    DECLARE_EVENTHANDLER(CEventPeerBlockBlockTxs);
 
     DECLARE_EVENTHANDLER(CEventPeerCerttxSubscribe);
     DECLARE_EVENTHANDLER(CEventPeerCerttxUnsubscribe);
@@ -480,6 +568,8 @@ public:
     DECLARE_EVENTHANDLER(CEventPeerUsertxSubscribe);
     DECLARE_EVENTHANDLER(CEventPeerUsertxUnsubscribe);
     DECLARE_EVENTHANDLER(CEventPeerUsertxTxs);
+    DECLARE_EVENTHANDLER(CEventPeerUsertxInv);
+    DECLARE_EVENTHANDLER(CEventPeerUsertxGetTxs);
 
     DECLARE_EVENTHANDLER(CEventPeerBlockVoteProtoData);
 
@@ -493,6 +583,7 @@ public:
     DECLARE_EVENTHANDLER(CEventLocalCerttxBroadcastTxs);
     DECLARE_EVENTHANDLER(CEventLocalUsertxSubscribeFork);
     DECLARE_EVENTHANDLER(CEventLocalUsertxBroadcastTxs);
+    DECLARE_EVENTHANDLER(CEventLocalUsertxRelayTimer);
 
     DECLARE_EVENTHANDLER(CEventLocalBlockvoteTimer);
     DECLARE_EVENTHANDLER(CEventLocalBlockvoteSubscribeFork);
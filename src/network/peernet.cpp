@@ -240,6 +240,27 @@ bool CBbPeerNet::HandleEvent(CEventPeerBlockGetBlockRsp& eventData)
     return SendChannelMessage(PROTO_CHN_BLOCK, eventData.nNonce, PROTO_CMD_BLOCK_GET_BLOCK_RSP, ssPayload);
 }
 
+bool CBbPeerNet::HandleEvent(CEventPeerBlockCmpct& eventCmpct)
+{
+    CBufStream ssPayload;
+    ssPayload << eventCmpct;
+    return SendChannelMessage(PROTO_CHN_BLOCK, eventCmpct.nNonce, PROTO_CMD_BLOCK_CMPCT, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerBlockGetBlockTxs& eventData)
+{
+    CBufStream ssPayload;
+    ssPayload << eventData;
+    return SendChannelMessage(PROTO_CHN_BLOCK, eventData.nNonce, PROTO_CMD_BLOCK_GET_BLOCK_TXS, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerBlockBlockTxs& eventData)
+{
+    CBufStream ssPayload;
+    ssPayload << eventData;
+    return SendChannelMessage(PROTO_CHN_BLOCK, eventData.nNonce, PROTO_CMD_BLOCK_BLOCK_TXS, ssPayload);
+}
+
 //-----------------------------------------------------------------------
 bool CBbPeerNet::HandleEvent(CEventPeerCerttxSubscribe& eventSubscribe)
 {
@@ -284,6 +305,20 @@ bool CBbPeerNet::HandleEvent(CEventPeerUsertxTxs& eventTxs)
     return SendChannelMessage(PROTO_CHN_USER_TX, eventTxs.nNonce, PROTO_CMD_USERTX_TXS, ssPayload);
 }
 
+bool CBbPeerNet::HandleEvent(CEventPeerUsertxInv& eventInv)
+{
+    CBufStream ssPayload;
+    ssPayload << eventInv;
+    return SendChannelMessage(PROTO_CHN_USER_TX, eventInv.nNonce, PROTO_CMD_USERTX_INV, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerUsertxGetTxs& eventGetTxs)
+{
+    CBufStream ssPayload;
+    ssPayload << eventGetTxs;
+    return SendChannelMessage(PROTO_CHN_USER_TX, eventGetTxs.nNonce, PROTO_CMD_USERTX_GETTXS, ssPayload);
+}
+
 //-----------------------------------------------------------------------
 bool CBbPeerNet::HandleEvent(CEventPeerBlockVoteProtoData& eventBvp)
 {
@@ -908,6 +943,39 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
             }
         }
         break;
+        case PROTO_CMD_BLOCK_CMPCT:
+        {
+            CEventPeerBlockCmpct* pEvent = new CEventPeerBlockCmpct(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pBlockChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_BLOCK_GET_BLOCK_TXS:
+        {
+            CEventPeerBlockGetBlockTxs* pEvent = new CEventPeerBlockGetBlockTxs(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pBlockChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_BLOCK_BLOCK_TXS:
+        {
+            CEventPeerBlockBlockTxs* pEvent = new CEventPeerBlockBlockTxs(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pBlockChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
         }
     }
     else if (nChannel == PROTO_CHN_CERT_TX)
@@ -990,6 +1058,28 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
             }
         }
         break;
+        case PROTO_CMD_USERTX_INV:
+        {
+            CEventPeerUsertxInv* pEvent = new CEventPeerUsertxInv(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pUserTxChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_USERTX_GETTXS:
+        {
+            CEventPeerUsertxGetTxs* pEvent = new CEventPeerUsertxGetTxs(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pUserTxChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
         }
     }
     else if (nChannel == PROTO_CHN_DELEGATE)
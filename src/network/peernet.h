@@ -6,6 +6,7 @@
 #define NETWORK_PEERNET_H
 
 #include "hnbase.h"
+#include "peer.h"
 #include "peerevent.h"
 #include "proto.h"
 
@@ -28,6 +29,7 @@ public:
     virtual bool SubmitCachePoaBlock(const CConsensusParam& consParam) = 0;
     virtual bool IsLocalCachePoaBlock(int nHeight, bool& fIsPos) = 0;
     virtual bool AddCacheLocalPoaBlock(const CBlock& block) = 0;
+    virtual bool GetSyncStatus(const uint256& hashFork, CNetSyncStatus& status) = 0;
 };
 
 class IBlockChannel : public hnbase::IIOModule, virtual public CBbPeerEventListener
@@ -124,6 +126,9 @@ protected:
     bool HandleEvent(CEventPeerBlockUnsubscribe& eventUnsubscribe) override;
     bool HandleEvent(CEventPeerBlockBks& eventBks) override;
     bool HandleEvent(CEventPeerBlockNextPrevBlock& eventData) override;
+    bool HandleEvent(CEventPeerBlockCmpct& eventCmpct) override;
+    bool HandleEvent(CEventPeerBlockGetBlockTxs& eventData) override;
+    bool HandleEvent(CEventPeerBlockBlockTxs& eventData) override;
 
     bool HandleEvent(CEventPeerCerttxSubscribe& eventSubscribe) override;
     bool HandleEvent(CEventPeerCerttxUnsubscribe& eventUnsubscribe) override;
@@ -132,6 +137,8 @@ protected:
     bool HandleEvent(CEventPeerUsertxSubscribe& eventSubscribe) override;
     bool HandleEvent(CEventPeerUsertxUnsubscribe& eventUnsubscribe) override;
     bool HandleEvent(CEventPeerUsertxTxs& eventTxs) override;
+    bool HandleEvent(CEventPeerUsertxInv& eventInv) override;
+    bool HandleEvent(CEventPeerUsertxGetTxs& eventGetTxs) override;
 
     bool HandleEvent(CEventPeerBulletin& eventBulletin) override;
     bool HandleEvent(CEventPeerGetDelegated& eventGetDelegated) override;
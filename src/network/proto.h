@@ -19,6 +19,9 @@ enum
 {
     NODE_NETWORK = (1 << 0),
     NODE_DELEGATED = (1 << 1),
+    NODE_LARGE_FRAME = (1 << 2),
+    NODE_TX_INV = (1 << 3),
+    NODE_CMPCT_BLOCK = (1 << 4),
 };
 
 enum
@@ -62,6 +65,9 @@ enum
     PROTO_CMD_BLOCK_SUBSCRIBE = 1,
     PROTO_CMD_BLOCK_UNSUBSCRIBE = 2,
     PROTO_CMD_BLOCK_BKS = 3,
+    PROTO_CMD_BLOCK_CMPCT = 8,
+    PROTO_CMD_BLOCK_GET_BLOCK_TXS = 9,
+    PROTO_CMD_BLOCK_BLOCK_TXS = 10,
 };
 
 enum
@@ -76,6 +82,8 @@ enum
     PROTO_CMD_USERTX_SUBSCRIBE = 1,
     PROTO_CMD_USERTX_UNSUBSCRIBE = 2,
     PROTO_CMD_USERTX_TXS = 3,
+    PROTO_CMD_USERTX_INV = 4,
+    PROTO_CMD_USERTX_GETTXS = 5,
 };
 
 enum
@@ -290,6 +290,27 @@ bool CCacheAddressData::GetBlockContractAddress(const uint256& hashBlock, std::m
     return false;
 }
 
+bool CCacheAddressData::GetBlockContractAddress(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+{
+    CReadLock rlock(rwAccess);
+
+    auto it = mapBlockContractAddress.find(hashBlock);
+    if (it != mapBlockContractAddress.end())
+    {
+        const auto& mapBlock = it->second;
+        for (auto mt = (destBegin.IsNull() ? mapBlock.begin() : mapBlock.upper_bound(destBegin)); mt != mapBlock.end(); ++mt)
+        {
+            if (nCount > 0 && mapContractAddress.size() >= nCount)
+            {
+                break;
+            }
+            mapContractAddress.insert(*mt);
+        }
+        return true;
+    }
+    return false;
+}
+
 bool CCacheAddressData::GetBlockTokenContractAddress(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
 {
     CReadLock rlock(rwAccess);
@@ -540,6 +561,48 @@ bool CForkAddressDB::RetrieveAddressContext(const uint256& hashBlock, const CDes
     return true;
 }
 
+bool CForkAddressDB::RetrieveAddressContexts(const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress)
+{
+    uint256 hashRoot;
+    if (!ReadTrieRoot(DB_ADDRESS_KEY_TYPE_ROOT_TYPE_ADDRESS, hashBlock, hashRoot))
+    {
+        StdLog("CForkAddressDB", "Retrieve address contexts: Read trie root fail, block: %s", hashBlock.GetHex().c_str());
+        return false;
+    }
+    std::vector<bytes> vKey;
+    vKey.reserve(setDest.size());
+    for (const CDestination& dest : setDest)
+    {
+        hnbase::CBufStream ssKey;
+        ssKey << DB_ADDRESS_KEY_TYPE_ADDRESS << dest;
+        vKey.push_back(ssKey.GetBytes());
+    }
+    bytesmap mapValue;
+    if (!dbTrie.RetrieveBatch(hashRoot, vKey, mapValue))
+    {
+        return false;
+    }
+    try
+    {
+        for (const auto& kv : mapValue)
+        {
+            hnbase::CBufStream ssKey(kv.first), ssValue(kv.second);
+            uint8 nKeyType;
+            CDestination dest;
+            CAddressContext ctxAddress;
+            ssKey >> nKeyType >> dest;
+            ssValue >> ctxAddress;
+            mapAddress[dest] = ctxAddress;
+        }
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
 bool CForkAddressDB::RetrieveTokenContractAddressContext(const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress)
 {
     uint256 hashRoot;
@@ -578,13 +641,13 @@ bool CForkAddressDB::ListAddress(const uint256& hashBlock, std::map<CDestination
     return ListAddressDb(hashBlock, mapAddress);
 }
 
-bool CForkAddressDB::ListContractAddress(const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CForkAddressDB::ListContractAddress(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
 {
-    if (cacheAddressData.GetBlockContractAddress(hashBlock, mapContractAddress))
+    if (cacheAddressData.GetBlockContractAddress(hashBlock, destBegin, nCount, mapContractAddress))
     {
         return true;
     }
-    return ListContractAddressDb(hashBlock, mapContractAddress);
+    return ListContractAddressDb(hashBlock, destBegin, nCount, mapContractAddress);
 }
 
 bool CForkAddressDB::ListTokenContractAddress(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
@@ -1422,6 +1485,65 @@ bool CForkAddressDB::ListContractAddressDb(const uint256& hashBlock, std::map<CD
     return true;
 }
 
+bool CForkAddressDB::ListContractAddressDb(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+{
+    uint256 hashRoot;
+    if (!ReadTrieRoot(DB_ADDRESS_KEY_TYPE_ROOT_TYPE_ADDRESS, hashBlock, hashRoot))
+    {
+        StdLog("CForkAddressDB", "List contract address: Read trie root fail, block: %s", hashBlock.GetHex().c_str());
+        return false;
+    }
+
+    hnbase::CBufStream ssKeyPrefix, ssKeyBegin;
+    bytes btKeyPrefix, btKeyBegin;
+    ssKeyPrefix << DB_ADDRESS_KEY_TYPE_ADDRESS;
+    ssKeyPrefix.GetData(btKeyPrefix);
+    if (!destBegin.IsNull())
+    {
+        ssKeyBegin << DB_ADDRESS_KEY_TYPE_ADDRESS << destBegin;
+        ssKeyBegin.GetData(btKeyBegin);
+    }
+
+    CTrieIterator it(dbTrie, hashRoot, btKeyPrefix);
+    if (!it.Seek(btKeyBegin))
+    {
+        StdLog("CForkAddressDB", "List contract address: Seek fail, block: %s", hashBlock.GetHex().c_str());
+        return false;
+    }
+    for (; it.IsValid() && (nCount == 0 || mapContractAddress.size() < nCount); it.Next())
+    {
+        if (it.GetKey() == btKeyBegin)
+        {
+            continue;
+        }
+        try
+        {
+            hnbase::CBufStream ssKey(it.GetKey()), ssValue(it.GetValue());
+            uint8 nKeyType;
+            CDestination dest;
+            CAddressContext ctxAddress;
+            ssKey >> nKeyType >> dest;
+            ssValue >> ctxAddress;
+            if (ctxAddress.IsContract())
+            {
+                CContractAddressContext ctxContract;
+                if (!ctxAddress.GetContractAddressContext(ctxContract))
+                {
+                    StdLog("CForkAddressDB", "List contract address: Get contract address context fail, dest: %s", dest.ToString().c_str());
+                    return false;
+                }
+                mapContractAddress.insert(std::make_pair(dest, ctxContract));
+            }
+        }
+        catch (std::exception& e)
+        {
+            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CForkAddressDB::ListTokenContractAddressDb(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
 {
     uint256 hashRoot;
@@ -1746,6 +1868,18 @@ bool CAddressDB::RetrieveAddressContext(const uint256& hashFork, const uint256&
     return false;
 }
 
+bool CAddressDB::RetrieveAddressContexts(const uint256& hashFork, const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress)
+{
+    CReadLock rlock(rwAccess);
+
+    auto it = mapAddressDB.find(hashFork);
+    if (it != mapAddressDB.end())
+    {
+        return it->second->RetrieveAddressContexts(hashBlock, setDest, mapAddress);
+    }
+    return false;
+}
+
 bool CAddressDB::RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress)
 {
     CReadLock rlock(rwAccess);
@@ -1770,14 +1904,14 @@ bool CAddressDB::ListAddress(const uint256& hashFork, const uint256& hashBlock,
     return false;
 }
 
-bool CAddressDB::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CAddressDB::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
 {
     CReadLock rlock(rwAccess);
 
     auto it = mapAddressDB.find(hashFork);
     if (it != mapAddressDB.end())
     {
-        return it->second->ListContractAddress(hashBlock, mapContractAddress);
+        return it->second->ListContractAddress(hashBlock, destBegin, nCount, mapContractAddress);
     }
     return false;
 }
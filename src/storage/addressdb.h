@@ -92,6 +92,7 @@ public:
 
     bool GetBlockAddress(const uint256& hashBlock, std::map<CDestination, CAddressContext>& mapAddress);
     bool GetBlockContractAddress(const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress);
+    bool GetBlockContractAddress(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress);
     bool GetBlockTokenContractAddress(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress);
 
 protected:
@@ -116,9 +117,10 @@ public:
                            const std::map<CDestination, uint384>& mapBlsPubkeyContext, uint256& hashNewRoot);
     bool AddTokenContractAddressContext(const uint256& hashPrevBlock, const uint256& hashBlock, const std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddressContext, const bool fAll);
     bool RetrieveAddressContext(const uint256& hashBlock, const CDestination& dest, CAddressContext& ctxAddress);
+    bool RetrieveAddressContexts(const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress);
     bool RetrieveTokenContractAddressContext(const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress);
     bool ListAddress(const uint256& hashBlock, std::map<CDestination, CAddressContext>& mapAddress);
-    bool ListContractAddress(const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress);
+    bool ListContractAddress(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress);
     bool ListTokenContractAddress(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress);
     bool GetAddressCount(const uint256& hashBlock, uint64& nAddressCount, uint64& nNewAddressCount);
     bool ListFunctionAddress(const uint256& hashBlock, std::map<uint32, CFunctionAddressContext>& mapFunctionAddress);
@@ -157,6 +159,7 @@ protected:
     bool AddDelegateAddressLinkTemplate(const uint256& hashBlock, const CDestination& destTemplate, const CAddressContext& ctxAddress, std::map<CDestination, std::map<CDestination, uint8>>& mapDelegateLinkTemplate, bytesmap& mapKv);
     bool ListAddressDb(const uint256& hashBlock, std::map<CDestination, CAddressContext>& mapAddress);
     bool ListContractAddressDb(const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress);
+    bool ListContractAddressDb(const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress);
     bool ListTokenContractAddressDb(const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress);
     bool AddCacheAddressData(const uint256& hashPrevBlock, const uint256& hashBlock, const std::map<CDestination, CAddressContext>& mapIncAddress);
     bool AddCacheTokenContractAddressData(const uint256& hashPrevBlock, const uint256& hashBlock, const std::map<CDestination, CTokenContractAddressContext>& mapIncTokenAddress, const bool fAll);
@@ -191,9 +194,10 @@ public:
                            const std::map<CDestination, uint384>& mapBlsPubkeyContext, uint256& hashNewRoot);
     bool AddTokenContractAddressContext(const uint256& hashFork, const uint256& hashPrevBlock, const uint256& hashBlock, const std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddressContext, const bool fAll);
     bool RetrieveAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CAddressContext& ctxAddress);
+    bool RetrieveAddressContexts(const uint256& hashFork, const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress);
     bool RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress);
     bool ListAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CAddressContext>& mapAddress);
-    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress);
+    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress);
     bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress);
     bool GetAddressCount(const uint256& hashFork, const uint256& hashBlock, uint64& nAddressCount, uint64& nNewAddressCount);
     bool ListFunctionAddress(const uint256& hashFork, const uint256& hashBlock, std::map<uint32, CFunctionAddressContext>& mapFunctionAddress);
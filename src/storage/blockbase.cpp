@@ -4,8 +4,12 @@
 
 #include "blockbase.h"
 
+#include <atomic>
+#include <boost/bind.hpp>
 #include <boost/timer/timer.hpp>
 #include <cstdio>
+#include <future>
+#include <thread>
 
 #include "bloomfilter/bloomfilter.h"
 #include "dbstruct.h"
@@ -244,12 +248,98 @@ bool CCacheBlockReceipt::GetBlockReceiptCache(const uint256& hashBlock, std::vec
     return true;
 }
 
+//////////////////////////////
+// CBlockVerifyPool
+
+CBlockVerifyPool::CBlockVerifyPool(const std::size_t nThreadCount, VerifyFunc fnVerifyIn)
+  : fnVerify(fnVerifyIn), pvTask(nullptr), nNextTask(0), nBatch(0), nActiveWorker(0), fExit(false)
+{
+    // the calling thread takes part in every window, so one thread fewer is started
+    for (std::size_t i = 1; i < nThreadCount; i++)
+    {
+        grpWorker.create_thread(boost::bind(&CBlockVerifyPool::WorkerFunc, this));
+    }
+}
+
+CBlockVerifyPool::~CBlockVerifyPool()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        fExit = true;
+    }
+    condWork.notify_all();
+    grpWorker.join_all();
+}
+
+void CBlockVerifyPool::Run(std::vector<CBlockVerifyTask>& vTask)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        pvTask = &vTask;
+        nNextTask = 0;
+        ++nBatch;
+    }
+    condWork.notify_all();
+
+    Work();
+
+    boost::unique_lock<boost::mutex> lock(mtxPool);
+    while (nActiveWorker > 0)
+    {
+        condDone.wait(lock);
+    }
+    // workers waking after this point find no window and wait for the next batch
+    pvTask = nullptr;
+}
+
+void CBlockVerifyPool::WorkerFunc()
+{
+    uint64 nLastBatch = 0;
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mtxPool);
+            while (!fExit && (nBatch == nLastBatch || pvTask == nullptr))
+            {
+                condWork.wait(lock);
+            }
+            if (fExit)
+            {
+                return;
+            }
+            nLastBatch = nBatch;
+            ++nActiveWorker;
+        }
+
+        Work();
+
+        {
+            boost::unique_lock<boost::mutex> lock(mtxPool);
+            if (--nActiveWorker == 0)
+            {
+                condDone.notify_all();
+            }
+        }
+    }
+}
+
+void CBlockVerifyPool::Work()
+{
+    std::vector<CBlockVerifyTask>& vTask = *pvTask;
+    for (std::size_t n = nNextTask++; n < vTask.size(); n = nNextTask++)
+    {
+        CBlockVerifyTask& task = vTask[n];
+        task.fResult = fnVerify(task);
+    }
+}
+
 //////////////////////////////
 // CBlockBase
 
 CBlockBase::CBlockBase()
-  : fCfgFullDb(false), fCfgTraceDb(false), fCfgCacheTrace(false), fCfgRewardCheck(false), fCfgPrune(false)
+  : fCfgFullDb(false), fCfgTraceDb(false), fCfgCacheTrace(false), fCfgRewardCheck(false), fCfgPrune(false), fCfgFullVerifyDb(false)
 {
+    arenaBlockIndex.SetLoader([this](const uint256& hashBlock, CBlockIndex& index) { return dbBlock.RetrieveBlockIndex(hashBlock, index); });
 }
 
 CBlockBase::~CBlockBase()
@@ -259,7 +349,9 @@ CBlockBase::~CBlockBase()
 }
 
 bool CBlockBase::BsInitialize(const fs::path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fFullDbIn, const bool fTraceDbIn,
-                              const bool fCacheTrace, const bool fRewardCheckIn, const bool fRenewDB, const bool fPruneDb)
+                              const bool fCacheTrace, const bool fRewardCheckIn, const bool fRenewDB, const bool fPruneDb,
+                              const CTimeSeriesSyncPolicy& syncPolicy, const std::size_t nBlockCacheSize, const std::size_t nBlockCachePinCount,
+                              const bool fFullVerifyDbIn)
 {
     hashGenesisBlock = hashGenesisBlockIn;
     fCfgFullDb = fFullDbIn;
@@ -267,6 +359,8 @@ bool CBlockBase::BsInitialize(const fs::path& pathDataLocation, const uint256& h
     fCfgCacheTrace = fCacheTrace;
     fCfgRewardCheck = fRewardCheckIn;
     fCfgPrune = fPruneDb;
+    fCfgFullVerifyDb = fFullVerifyDbIn;
+    pathIndexCheckpoint = pathDataLocation / "indexcheckpoint.dat";
 
     StdLog("BlockBase", "Initializing... (Path : %s)", pathDataLocation.string().c_str());
 
@@ -295,10 +389,13 @@ bool CBlockBase::BsInitialize(const fs::path& pathDataLocation, const uint256& h
         StdError("BlockBase", "Failed to initialize block tsfile");
         return false;
     }
+    tsBlock.SetSyncPolicy(syncPolicy);
+    tsBlock.SetCacheParam(nBlockCacheSize, nBlockCachePinCount);
 
     if (fRenewDB)
     {
         Clear();
+        boost::filesystem::remove(pathIndexCheckpoint);
     }
     else if (!LoadDB())
     {
@@ -321,6 +418,27 @@ bool CBlockBase::BsInitialize(const fs::path& pathDataLocation, const uint256& h
 
 void CBlockBase::BsDeinitialize()
 {
+    CBlockCacheStat stat;
+    tsBlock.GetCacheStat(stat);
+    StdLog("BlockBase", "Block cache: hit: %lu, miss: %lu, insert: %lu, eviction: %lu, count: %lu, bytes: %lu, pinned: %lu",
+           stat.nHit, stat.nMiss, stat.nInsert, stat.nEviction, stat.nCount, stat.nBytes, stat.nPinnedCount);
+
+    CBlockIndexArena::CStat statIndex;
+    arenaBlockIndex.GetStat(statIndex);
+    if (statIndex.nCount > 0)
+    {
+        StdLog("BlockBase", "Block index: count: %lu, arena: %lu, table: %lu, cold cached: %lu, resident bytes per block: %lu",
+               statIndex.nCount, statIndex.nArenaBytes, statIndex.nTableBytes, statIndex.nColdCount,
+               (statIndex.nArenaBytes + statIndex.nTableBytes) / statIndex.nCount);
+    }
+
+    {
+        CWriteLock wlock(rwAccess);
+
+        SaveIndexCheckpoint();
+    }
+    WaitIndexCheckpoint();
+
     dbBlock.BdDeinitialize();
     tsBlock.Deinitialize();
     {
@@ -730,16 +848,17 @@ bool CBlockBase::GetPrevBlockHashList(const uint256& hashBlock, const uint32 nGe
 
 BlockIndexPtr CBlockBase::LoadBlockIndex(const CBlockIndex& outline)
 {
-    BlockIndexPtr pIndex = MAKE_SHARED_BLOCK_INDEX(outline);
+    BlockIndexPtr pIndex = GetCacheBlockIndex(outline.GetBlockHash());
     if (pIndex)
     {
-        if (!GetCacheBlockIndex(outline.GetBlockHash()))
-        {
-            AddCacheBlockIndex(pIndex);
-        }
         return pIndex;
     }
-    return nullptr;
+    pIndex = MAKE_SHARED_BLOCK_INDEX(outline);
+    if (pIndex)
+    {
+        AddCacheBlockIndex(pIndex);
+    }
+    return pIndex;
 }
 
 bool CBlockBase::LoadTx(const uint32 nTxFile, const uint32 nTxOffset, CTransaction& tx)
@@ -1995,6 +2114,11 @@ bool CBlockBase::RetrieveAddressContext(const uint256& hashFork, const uint256&
     return dbBlock.RetrieveAddressContext(hashFork, hashBlock, dest, ctxAddress);
 }
 
+bool CBlockBase::RetrieveAddressContexts(const uint256& hashFork, const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress)
+{
+    return dbBlock.RetrieveAddressContexts(hashFork, hashBlock, setDest, mapAddress);
+}
+
 bool CBlockBase::RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress)
 {
     uint256 hashLastBlock = hashBlock;
@@ -2008,9 +2132,9 @@ bool CBlockBase::RetrieveTokenContractAddressContext(const uint256& hashFork, co
     return dbBlock.RetrieveTokenContractAddressContext(hashFork, hashLastBlock, dest, ctxAddress);
 }
 
-bool CBlockBase::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CBlockBase::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
 {
-    return dbBlock.ListContractAddress(hashFork, hashBlock, mapContractAddress);
+    return dbBlock.ListContractAddress(hashFork, hashBlock, destBegin, nCount, mapContractAddress);
 }
 
 bool CBlockBase::ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress)
@@ -2469,25 +2593,17 @@ BlockIndexPtr CBlockBase::GetIndex(const uint256& hash)
 
 void CBlockBase::AddCacheBlockIndex(const BlockIndexPtr pIndex)
 {
-    CWriteLock wlock(rwCacheBlockIndexAccess);
-    mapCacheBlockIndex.insert(std::make_pair(pIndex->GetBlockHash(), pIndex));
+    arenaBlockIndex.AddNew(pIndex);
 }
 
 void CBlockBase::RemoveCacheBlockIndex(const uint256& hashBlock)
 {
-    CWriteLock wlock(rwCacheBlockIndexAccess);
-    mapCacheBlockIndex.erase(hashBlock);
+    arenaBlockIndex.Remove(hashBlock);
 }
 
 BlockIndexPtr CBlockBase::GetCacheBlockIndex(const uint256& hashBlock)
 {
-    CReadLock rlock(rwCacheBlockIndexAccess);
-    auto it = mapCacheBlockIndex.find(hashBlock);
-    if (it != mapCacheBlockIndex.end())
-    {
-        return it->second;
-    }
-    return nullptr;
+    return arenaBlockIndex.Retrieve(hashBlock);
 }
 
 BlockIndexPtr CBlockBase::GetForkLastIndex(const uint256& hashFork)
@@ -2568,24 +2684,29 @@ bool CBlockBase::UpdateBlockLongChain(const uint256& hashFork, const std::vector
         vRemoveNumberBlock.push_back(std::make_pair(blockex.GetBlockNumber(), hashBlock));
     }
 
-    if (!dbBlock.UpdateBlockNumberBlockLongChain(hashFork, vRemoveNumberBlock, vNewNumberBlock))
-    {
-        StdLog("CBlockBase", "Update block long chain: Update block number long chain fail, fork: %s", hashFork.GetBhString().c_str());
-        return false;
-    }
-    if (!dbBlock.UpdateTxIndexBlockLongChain(hashFork, vRemoveTx, mapNewTx))
+    // block number, tx index and address tx index live in separate leveldb instances,
+    // the fork last block is only moved by the caller after all of them are joined
+    CDbCommitTasks tasks;
+    tasks.AddTask("block number", [&]() { return dbBlock.UpdateBlockNumberBlockLongChain(hashFork, vRemoveNumberBlock, vNewNumberBlock); });
+    tasks.AddTask("tx index", [&]() { return dbBlock.UpdateTxIndexBlockLongChain(hashFork, vRemoveTx, mapNewTx); });
+    if (fCfgFullDb)
     {
-        StdLog("CBlockBase", "Update block long chain: Update tx index long chain fail, fork: %s", hashFork.GetBhString().c_str());
-        return false;
+        tasks.AddTask("address tx", [&]() { return dbBlock.UpdateAddressTxInfoBlockLongChain(hashFork, vRemoveBlock, vNewBlock); });
     }
-    if (fCfgFullDb)
+
+    const bool fParallel = (mapNewTx.size() + vRemoveTx.size() >= COMMIT_PARALLEL_MIN_TX_COUNT);
+    std::vector<std::string> vFailTask;
+    if (!tasks.Run(fParallel, vFailTask))
     {
-        if (!dbBlock.UpdateAddressTxInfoBlockLongChain(hashFork, vRemoveBlock, vNewBlock))
+        for (const std::string& strTask : vFailTask)
         {
-            StdLog("CBlockBase", "Update block long chain: Update address tx long chain fail, fork: %s", hashFork.GetBhString().c_str());
-            return false;
+            StdLog("CBlockBase", "Update block long chain: Update %s long chain fail, fork: %s", strTask.c_str(), hashFork.GetBhString().c_str());
         }
+        return false;
     }
+
+    StdTrace("CBlockBase", "Update block long chain: parallel: %s, tx count: %lu, wall: %ld us, fork: %s",
+             (fParallel ? "true" : "false"), mapNewTx.size() + vRemoveTx.size(), tasks.GetWallTimeUs(), hashFork.GetBhString().c_str());
     return true;
 }
 
@@ -2699,6 +2820,23 @@ bool CBlockBase::UpdateDelegate(const uint256& hashFork, const uint256& hashBloc
         return true;
     };
 
+    std::map<CDestination, CAddressContext> mapPrevAddressContext;
+    {
+        std::set<CDestination> setFetchDest;
+        for (auto& kv : mapAccStateIn)
+        {
+            if (mapAddressContext.count(kv.first) == 0)
+            {
+                setFetchDest.insert(kv.first);
+            }
+        }
+        if (!setFetchDest.empty() && !RetrieveAddressContexts(hashFork, block.hashPrev, setFetchDest, mapPrevAddressContext))
+        {
+            StdError("BlockBase", "Update delegate: Retrieve address contexts fail, prev block: %s", block.hashPrev.ToString().c_str());
+            return false;
+        }
+    }
+
     for (auto& kv : mapAccStateIn)
     {
         const CDestination& dest = kv.first;
@@ -2708,7 +2846,12 @@ bool CBlockBase::UpdateDelegate(const uint256& hashFork, const uint256& hashBloc
         auto it = mapAddressContext.find(dest);
         if (it == mapAddressContext.end())
         {
-            if (!RetrieveAddressContext(hashFork, block.hashPrev, dest, ctxAddress))
+            auto mt = mapPrevAddressContext.find(dest);
+            if (mt != mapPrevAddressContext.end())
+            {
+                ctxAddress = mt->second;
+            }
+            else if (!RetrieveAddressContext(hashFork, block.hashPrev, dest, ctxAddress))
             {
                 StdError("BlockBase", "Update delegate: Find address context fail, dest: %s", dest.ToString().c_str());
                 return false;
@@ -2906,6 +3049,22 @@ bool CBlockBase::UpdateVote(const uint256& hashFork, const uint256& hashBlock, c
         }
         return false;
     };
+    std::map<CDestination, CAddressContext> mapPrevAddressContext;
+    {
+        std::set<CDestination> setFetchDest;
+        for (auto& kv : mapAccStateIn)
+        {
+            if (mapAddressContext.count(kv.first) == 0)
+            {
+                setFetchDest.insert(kv.first);
+            }
+        }
+        if (!setFetchDest.empty() && !RetrieveAddressContexts(hashFork, block.hashPrev, setFetchDest, mapPrevAddressContext))
+        {
+            StdError("BlockBase", "Update vote: Retrieve address contexts fail, prev block: %s", block.hashPrev.ToString().c_str());
+            return false;
+        }
+    }
     auto funcGetAddressContext = [&](const CDestination& dest, CAddressContext& ctxAddress) -> bool {
         auto it = mapAddressContext.find(dest);
         if (it != mapAddressContext.end())
@@ -2914,7 +3073,12 @@ bool CBlockBase::UpdateVote(const uint256& hashFork, const uint256& hashBlock, c
         }
         else
         {
-            if (!RetrieveAddressContext(hashFork, block.hashPrev, dest, ctxAddress))
+            auto mt = mapPrevAddressContext.find(dest);
+            if (mt != mapPrevAddressContext.end())
+            {
+                ctxAddress = mt->second;
+            }
+            else if (!RetrieveAddressContext(hashFork, block.hashPrev, dest, ctxAddress))
             {
                 return false;
             }
@@ -4209,8 +4373,19 @@ bool CBlockBase::GetTransactionReceipt(const uint256& hashFork, const uint256& t
     return true;
 }
 
-bool CBlockBase::GetBlockReceiptsByBlock(const uint256& hashFork, const uint256& hashFromBlock, const uint256& hashToBlock, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts)
+bool CBlockBase::GetBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts)
 {
+    auto funcWalker = [&](const uint256& hashBlock, const std::vector<CTransactionReceipt>& vTxReceipt) -> bool {
+        mapBlockReceipts.insert(std::make_pair(hashBlock, vTxReceipt));
+        return true;
+    };
+    return WalkThroughBlockReceiptsByLogsFilter(hashFork, logsFilter, 0, funcWalker);
+}
+
+bool CBlockBase::WalkThroughBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerBlockReceiptsFunc fnWalker)
+{
+    const uint256& hashFromBlock = logsFilter.hashFromBlock;
+    const uint256& hashToBlock = logsFilter.hashToBlock;
     BlockIndexPtr pIndexFrom;
     BlockIndexPtr pIndexTo;
     if (hashFromBlock == 0)
@@ -4226,7 +4401,7 @@ bool CBlockBase::GetBlockReceiptsByBlock(const uint256& hashFork, const uint256&
         pIndexTo = RetrieveFork(hashFork);
         if (!pIndexTo)
         {
-            StdLog("CBlockBase", "Get block receipts by logs filter: from or to block error, fork: %s", hashFork.ToString().c_str());
+            StdLog("CBlockBase", "Walk through block receipts by logs filter: from or to block error, fork: %s", hashFork.ToString().c_str());
             return false;
         }
     }
@@ -4236,18 +4411,35 @@ bool CBlockBase::GetBlockReceiptsByBlock(const uint256& hashFork, const uint256&
     }
     if (!pIndexFrom || !pIndexTo)
     {
-        StdLog("CBlockBase", "Get block receipts by logs filter: from or to block error, from: %s, to: %s",
+        StdLog("CBlockBase", "Walk through block receipts by logs filter: from or to block error, from: %s, to: %s",
                hashFromBlock.ToString().c_str(), hashToBlock.ToString().c_str());
         return false;
     }
+    if (nMaxBlockCount > 0 && pIndexTo->GetBlockNumber() >= pIndexFrom->GetBlockNumber()
+        && pIndexTo->GetBlockNumber() - pIndexFrom->GetBlockNumber() >= nMaxBlockCount)
+    {
+        StdLog("CBlockBase", "Walk through block receipts by logs filter: block range exceeds %lu, from: %lu, to: %lu",
+               nMaxBlockCount, pIndexFrom->GetBlockNumber(), pIndexTo->GetBlockNumber());
+        return false;
+    }
 
-    std::vector<uint256> vBlockHash;
+    std::vector<std::pair<uint64, uint256>> vBlock;
     while (pIndexTo && pIndexTo->GetBlockNumber() >= pIndexFrom->GetBlockNumber())
     {
-        vBlockHash.push_back(pIndexTo->GetBlockHash());
+        vBlock.push_back(std::make_pair(pIndexTo->GetBlockNumber(), pIndexTo->GetBlockHash()));
         pIndexTo = GetPrevBlockIndex(pIndexTo);
     }
+    std::reverse(vBlock.begin(), vBlock.end());
+
+    // skip the blocks whose logs bloom rules out the filter
+    std::vector<uint256> vBlockHash;
+    if (!dbBlock.FilterLogsBloomBlock(hashFork, logsFilter, vBlock, vBlockHash))
+    {
+        StdLog("CBlockBase", "Walk through block receipts by logs filter: Filter logs bloom failed, fork: %s", hashFork.ToString().c_str());
+        return false;
+    }
 
+    // receipts are loaded one block at a time and handed to the walker
     for (auto& hashBlock : vBlockHash)
     {
         std::vector<CTransactionReceipt> vTxReceipt;
@@ -4256,27 +4448,27 @@ bool CBlockBase::GetBlockReceiptsByBlock(const uint256& hashFork, const uint256&
             CBlockEx block;
             if (!Retrieve(hashBlock, block))
             {
-                StdLog("CBlockBase", "Get block receipts by logs filter: Retrieve block failed, block: %s", hashBlock.ToString().c_str());
+                StdLog("CBlockBase", "Walk through block receipts by logs filter: Retrieve block failed, block: %s", hashBlock.ToString().c_str());
                 return false;
             }
+            std::vector<uint256> vTxid;
+            vTxid.reserve(block.vtx.size() + 1);
+            vTxid.push_back(block.txMint.GetHash());
+            for (auto& tx : block.vtx)
             {
-                CTransactionReceipt receipt;
-                if (dbBlock.RetrieveTxReceipt(hashFork, block.txMint.GetHash(), receipt))
-                {
-                    vTxReceipt.push_back(receipt);
-                }
+                vTxid.push_back(tx.GetHash());
             }
-            for (auto& tx : block.vtx)
+            if (!dbBlock.RetrieveBlockTxReceipts(hashFork, hashBlock, vTxid, vTxReceipt))
             {
-                CTransactionReceipt receipt;
-                if (dbBlock.RetrieveTxReceipt(hashFork, tx.GetHash(), receipt))
-                {
-                    vTxReceipt.push_back(receipt);
-                }
+                StdLog("CBlockBase", "Walk through block receipts by logs filter: Retrieve receipts failed, block: %s", hashBlock.ToString().c_str());
+                return false;
             }
             blockReceiptCache.AddBlockReceiptCache(hashBlock, vTxReceipt);
         }
-        mapBlockReceipts.insert(std::make_pair(hashBlock, vTxReceipt));
+        if (!fnWalker(hashBlock, vTxReceipt))
+        {
+            break;
+        }
     }
     return true;
 }
@@ -4377,13 +4569,6 @@ bool CBlockBase::ListBlockContractPrevState(const uint256& hashFork, const uint2
 
 bool CBlockBase::GetContractKvList(const uint256& hashFork, const uint256& hashBlock, const uint32 nTxIndex, const CDestination& destContract, const uint256& keyStart, const uint32 nLimit, std::vector<std::pair<uint256, bytes>>& vContractKv, uint256& keyNext)
 {
-    std::vector<std::pair<uint256, uint256>> vContractKvPair;
-    if (!dbBlock.GetContractKvPairList(hashFork, hashBlock, destContract, keyStart, nLimit, vContractKvPair, keyNext))
-    {
-        StdLog("CBlockBase", "Get contract kv list: Get contract kv pair list fail, contract address: %s, block: %s", destContract.ToString().c_str(), hashBlock.ToString().c_str());
-        return false;
-    }
-
     uint256 hashStateRoot;
     {
         CReadLock rlock(rwAccess);
@@ -4404,16 +4589,11 @@ bool CBlockBase::GetContractKvList(const uint256& hashFork, const uint256& hashB
     }
     const uint256 hashStorageRoot = stateDest.GetStorageRoot();
 
-    for (auto& kv : vContractKvPair)
+    if (!dbBlock.ListContractKvValue(hashFork, hashStorageRoot, keyStart, nLimit, vContractKv, keyNext))
     {
-        bytes btValue;
-        if (!dbBlock.RetrieveContractKvValue(hashFork, hashStorageRoot, kv.second, btValue))
-        {
-            StdLog("CBlockBase", "Get contract kv list: Get contract kv value fail, state root: %s, contract address: %s, key: %s, block: %s",
-                   hashStateRoot.GetHex().c_str(), destContract.ToString().c_str(), kv.second.ToString().c_str(), hashBlock.ToString().c_str());
-            return false;
-        }
-        vContractKv.push_back(std::make_pair(kv.second, btValue));
+        StdLog("CBlockBase", "Get contract kv list: List contract kv value fail, storage root: %s, contract address: %s, block: %s",
+               hashStorageRoot.GetHex().c_str(), destContract.ToString().c_str(), hashBlock.ToString().c_str());
+        return false;
     }
     return true;
 }
@@ -4620,6 +4800,24 @@ uint256 CBlockBase::GetForkMintMinGasPrice(const uint256& hashFork)
     return nMinGasPrice;
 }
 
+bool CBlockBase::PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, const uint64 nMaxPruneNodeCount, uint64& nPruneNodeCount, uint64& nPruneBytes)
+{
+    CTriePruneStat statPrune;
+    if (!dbBlock.ClearStateUnavailableNode(hashFork, nPruneReserveLastHeight, nMaxPruneNodeCount, statPrune))
+    {
+        StdLog("BlockBase", "Prune fork state data: Clear state unavailable node failed, prune height: %d, fork: %s", nPruneReserveLastHeight, hashFork.GetHex().c_str());
+        return false;
+    }
+    nPruneNodeCount = statPrune.nNodeCount;
+    nPruneBytes = statPrune.nByteCount;
+    if (statPrune.nNodeCount > 0)
+    {
+        StdDebug("BlockBase", "Prune fork state data: Prune height count: %d, root count: %lu, node count: %lu, bytes: %lu, fork: %s",
+                 statPrune.nHeightCount, statPrune.nRootCount, statPrune.nNodeCount, statPrune.nByteCount, hashFork.GetHex().c_str());
+    }
+    return true;
+}
+
 //----------------------------------------------------------------------------
 bool CBlockBase::GetTxIndex(const uint256& hashFork, const uint256& txid, uint256& hashAtFork, CTxIndex& txIndex)
 {
@@ -4653,12 +4851,7 @@ bool CBlockBase::GetTxIndex(const uint256& hashFork, const uint256& txid, uint25
 
 void CBlockBase::ClearCache()
 {
-    map<uint256, CBlockIndex*>::iterator mi;
-    for (mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
-    {
-        delete (*mi).second;
-    }
-    mapIndex.clear();
+    arenaBlockIndex.Clear();
     mapForkHeightIndex.clear();
 }
 
@@ -4676,12 +4869,14 @@ bool CBlockBase::LoadDB()
         return false;
     }*/
     StdLog("BlockBase", "Start verify db.");
+    int64 nBeginTime = GetTimeMillis();
     if (!VerifyDB())
     {
         StdError("BlockBase", "Load DB: Verify DB fail.");
         return false;
     }
-    StdLog("BlockBase", "Verify db success!");
+    StdLog("BlockBase", "Verify db success, startup load time: %ld ms, block index count: %lu",
+           GetTimeMillis() - nBeginTime, arenaBlockIndex.GetCount());
     return true;
 }
 
@@ -4691,57 +4886,119 @@ bool CBlockBase::VerifyDB()
     bool fAllVerify = false;
     std::map<uint256, uint256> mapForkLast;
     std::size_t nVerifyCount = dbBlock.GetBlockVerifyCount();
-    if (nVerifyCount > nNeedVerifyCount)
-    {
-        for (std::size_t i = nVerifyCount - nNeedVerifyCount; i < nVerifyCount; i++)
+
+    // workers live for the whole run, windows are handed to them instead of spawning threads per window
+    CBlockVerifyPool poolVerify(GetVerifyThreadCount(), [this](CBlockVerifyTask& task) -> bool {
+        return VerifyBlockDB(task.verifyBlock, task.outline, task.blockRoot, task.fVerify);
+    });
+
+    auto funcNeedVerify = [&](const std::size_t nPos) -> bool {
+        return (fAllVerify || nPos <= nNeedVerifyCount / 2 || nVerifyCount <= nNeedVerifyCount || nPos > (nVerifyCount - nNeedVerifyCount));
+    };
+    auto funcPrepareWindow = [&](const std::size_t nBeginPos, const std::size_t nEndPos, std::vector<CBlockVerifyTask>& vTask) -> bool {
+        vTask.clear();
+        vTask.resize(nEndPos - nBeginPos);
+        for (std::size_t i = nBeginPos; i < nEndPos; i++)
         {
-            CBlockVerify verifyBlock;
-            if (!dbBlock.GetBlockVerify(i, verifyBlock))
+            CBlockVerifyTask& task = vTask[i - nBeginPos];
+            if (!dbBlock.GetBlockVerify(i, task.verifyBlock))
             {
                 StdError("BlockBase", "Verify DB: Get block verify fail, pos: %ld.", i);
                 return false;
             }
-            CBlockOutline outline;
-            CBlockRoot blockRoot;
-            if (!VerifyBlockDB(verifyBlock, outline, blockRoot, true))
+            task.fVerify = funcNeedVerify(i);
+        }
+        poolVerify.Run(vTask);
+        return true;
+    };
+
+    int64 nBeginTime = GetTimeMillis();
+    std::vector<CBlockVerifyTask> vTask;
+    if (nVerifyCount > nNeedVerifyCount)
+    {
+        if (!funcPrepareWindow(nVerifyCount - nNeedVerifyCount, nVerifyCount, vTask))
+        {
+            return false;
+        }
+        for (const CBlockVerifyTask& task : vTask)
+        {
+            if (!task.fResult)
             {
                 fAllVerify = true;
                 break;
             }
         }
     }
-    for (std::size_t i = 0; i < nVerifyCount; i++)
+
+    // resume after the checkpoint, only the verify records written after it are replayed.
+    // A damaged tail means every record is verified again, so the full load runs instead.
+    std::size_t nStartPos = 0;
+    if (!fCfgFullVerifyDb && !fAllVerify)
     {
-        CBlockVerify verifyBlock;
-        if (!dbBlock.GetBlockVerify(i, verifyBlock))
+        CBlockIndexCheckpoint checkpoint;
+        if (checkpoint.Load(pathIndexCheckpoint, arenaBlockIndex))
         {
-            StdError("BlockBase", "Verify DB: Get block verify fail, pos: %ld.", i);
-            return false;
+            CBlockVerify verifyLast;
+            if (checkpoint.nVerifyCount > 0 && checkpoint.nVerifyCount <= nVerifyCount
+                && dbBlock.GetBlockVerify(checkpoint.nVerifyCount - 1, verifyLast) && verifyLast.GetCrc() == checkpoint.nVerifyCrc)
+            {
+                nStartPos = checkpoint.nVerifyCount;
+                mapForkLast = checkpoint.mapForkLast;
+                StdLog("BlockBase", "Verify DB: Load index checkpoint success, verify count: %lu, replay count: %lu, index count: %lu.",
+                       nStartPos, nVerifyCount - nStartPos, arenaBlockIndex.GetCount());
+            }
+            else
+            {
+                StdLog("BlockBase", "Verify DB: Index checkpoint does not match verify db, checkpoint verify count: %lu, verify count: %lu.",
+                       checkpoint.nVerifyCount, nVerifyCount);
+                ClearCache();
+            }
         }
+    }
 
-        bool fVerify = false;
-        if (fAllVerify)
-        {
-            fVerify = true;
-        }
-        else
+    // root checks run a window ahead on worker threads, index linkage below stays in record order
+    std::size_t nWindowBegin = nStartPos;
+    bool fWindowRepaired = false;
+    vTask.clear();
+    for (std::size_t i = nStartPos; i < nVerifyCount; i++)
+    {
+        if (i == nWindowBegin + vTask.size())
         {
-            if (i <= nNeedVerifyCount / 2
-                || nVerifyCount <= nNeedVerifyCount
-                || i > (nVerifyCount - nNeedVerifyCount))
+            nWindowBegin = i;
+            fWindowRepaired = false;
+            if (!funcPrepareWindow(i, std::min(i + (std::size_t)VERIFY_WINDOW_SIZE, nVerifyCount), vTask))
             {
-                fVerify = true;
+                return false;
             }
         }
+        CBlockVerifyTask& task = vTask[i - nWindowBegin];
+        const CBlockVerify& verifyBlock = task.verifyBlock;
+
+        // redo the check in place when an earlier failure raised the verify level or a repair may have changed the result
+        const bool fVerify = funcNeedVerify(i);
+        CBlockOutline& outline = task.outline;
+        CBlockRoot& blockRoot = task.blockRoot;
+        if (fWindowRepaired || (fVerify && !task.fVerify))
+        {
+            task.fResult = VerifyBlockDB(verifyBlock, outline, blockRoot, fVerify);
+        }
 
-        CBlockOutline outline;
-        CBlockRoot blockRoot;
-        CBlockIndex* pIndexNew = nullptr;
+        BlockIndexPtr pIndexNew;
         CBlockEx blockex;
         bool fRepairBlock = false;
-        if (VerifyBlockDB(verifyBlock, outline, blockRoot, fVerify))
+        if (task.fResult && nStartPos > 0 && arenaBlockIndex.Exists(verifyBlock.hashBlock))
         {
-            if (!LoadBlockIndex(outline, &pIndexNew))
+            // indexes added after the covered verify records can already be in the checkpoint,
+            // which restores resident records only, so the full index is read from the db
+            if (!(pIndexNew = GetIndex(verifyBlock.hashBlock)))
+            {
+                StdError("BlockBase", "Verify DB: Get checkpoint index fail, pos: %ld, block: [%d] %s.", i, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
+                return false;
+            }
+        }
+        else if (task.fResult)
+        {
+            if (!LoadBlockIndex(outline, pIndexNew))
             {
                 StdError("BlockBase", "Verify DB: Load block index fail, pos: %ld, block: [%d] %s.", i, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
                 return false;
@@ -4754,15 +5011,16 @@ bool CBlockBase::VerifyDB()
                 fAllVerify = true;
             }
             StdDebug("BlockBase", "Verify DB: Verify block db fail, pos: %ld, block: [%d] %s.", i, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
-            if (!RepairBlockDB(verifyBlock, blockRoot, blockex, &pIndexNew))
+            if (!RepairBlockDB(verifyBlock, blockRoot, blockex, pIndexNew))
             {
                 StdError("BlockBase", "Verify DB: Repair block db fail, pos: %ld, block: [%d] %s.", i, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
                 return false;
             }
             fRepairBlock = true;
+            fWindowRepaired = true;
         }
 
-        auto funcUpdateLongChain = [&](const uint256& hashForkIn, const uint256& hashForkLastBlockIn, const uint256& hashBlockIn, const CBlockEx& blockIn, const CBlockIndex* pIndexIn) -> bool {
+        auto funcUpdateLongChain = [&](const uint256& hashForkIn, const uint256& hashForkLastBlockIn, const uint256& hashBlockIn, const CBlockEx& blockIn, const BlockIndexPtr pIndexIn) -> bool {
             CBlockChainUpdate update = CBlockChainUpdate(pIndexIn);
             if (blockIn.IsOrigin())
             {
@@ -4805,7 +5063,7 @@ bool CBlockBase::VerifyDB()
                          pIndexNew->GetOriginHash().GetHex().c_str(), CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
                 return false;
             }
-            CBlockIndex* pIndexFork = GetIndex(it->second);
+            BlockIndexPtr pIndexFork = GetIndex(it->second);
             if (pIndexFork == nullptr)
             {
                 StdError("BlockBase", "Verify DB: Get last index fail, fork: %s, block: [%d] %s.",
@@ -4831,10 +5089,18 @@ bool CBlockBase::VerifyDB()
 
         if (i % 100000 == 0)
         {
-            StdLog("BlockBase", "Verify DB: Verify block count: %ld, block: [%d] %s.",
-                   i + 1, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str());
+            int64 nUseTime = std::max(GetTimeMillis() - nBeginTime, (int64)1);
+            StdLog("BlockBase", "Verify DB: Verify block count: %ld, block: [%d] %s, blocks/s: %ld.",
+                   i + 1, CBlock::GetBlockHeightByHash(verifyBlock.hashBlock), verifyBlock.hashBlock.GetHex().c_str(),
+                   (int64)((i + 1 - nStartPos) * 1000 / nUseTime));
         }
     }
+    if (nVerifyCount > nStartPos)
+    {
+        int64 nUseTime = std::max(GetTimeMillis() - nBeginTime, (int64)1);
+        StdLog("BlockBase", "Verify DB: Verify block finish, count: %lu, time: %ld ms, blocks/s: %ld, threads: %u.",
+               nVerifyCount - nStartPos, nUseTime, (int64)((nVerifyCount - nStartPos) * 1000 / nUseTime), GetVerifyThreadCount());
+    }
 
     for (const auto& kv : mapForkLast)
     {
@@ -4851,9 +5117,88 @@ bool CBlockBase::VerifyDB()
             }
         }
     }
+
+    if (nVerifyCount > nStartPos && !SaveIndexCheckpoint())
+    {
+        StdLog("BlockBase", "Verify DB: Save index checkpoint fail.");
+    }
     return true;
 }
 
+uint32 CBlockBase::GetVerifyThreadCount() const
+{
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+bool CBlockBase::SaveIndexCheckpoint()
+{
+    if (futIndexCheckpoint.valid())
+    {
+        if (futIndexCheckpoint.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            // previous checkpoint is still being written, the next save covers the newer records
+            return true;
+        }
+        futIndexCheckpoint.get();
+    }
+
+    auto spCheckpoint = std::make_shared<CBlockIndexCheckpoint>();
+    CBlockIndexCheckpoint& checkpoint = *spCheckpoint;
+    checkpoint.nVerifyCount = dbBlock.GetBlockVerifyCount();
+    if (checkpoint.nVerifyCount == 0)
+    {
+        return true;
+    }
+    CBlockVerify verifyLast;
+    if (!dbBlock.GetBlockVerify(checkpoint.nVerifyCount - 1, verifyLast))
+    {
+        StdError("BlockBase", "Save index checkpoint: Get block verify fail, pos: %lu.", checkpoint.nVerifyCount - 1);
+        return false;
+    }
+    checkpoint.nVerifyCrc = verifyLast.GetCrc();
+
+    std::map<uint256, CForkContext> mapForkCtxt;
+    if (!dbBlock.ListForkContext(mapForkCtxt))
+    {
+        StdError("BlockBase", "Save index checkpoint: List fork context fail.");
+        return false;
+    }
+    for (const auto& kv : mapForkCtxt)
+    {
+        uint256 hashLastBlock;
+        if (dbBlock.RetrieveForkLast(kv.first, hashLastBlock))
+        {
+            checkpoint.mapForkLast.insert(make_pair(kv.first, hashLastBlock));
+        }
+    }
+
+    // only the resident records are copied under the caller's lock, serialization and file io run on a worker
+    checkpoint.Collect(arenaBlockIndex);
+
+    const fs::path pathFile = pathIndexCheckpoint;
+    futIndexCheckpoint = std::async(std::launch::async, [spCheckpoint, pathFile]() -> bool {
+        int64 nBeginTime = GetTimeMillis();
+        if (!spCheckpoint->Save(pathFile))
+        {
+            StdError("BlockBase", "Save index checkpoint: Save fail, verify count: %lu.", spCheckpoint->nVerifyCount);
+            return false;
+        }
+        StdLog("BlockBase", "Save index checkpoint: verify count: %lu, index count: %lu, time: %ld ms.",
+               spCheckpoint->nVerifyCount, spCheckpoint->vHot.size(), GetTimeMillis() - nBeginTime);
+        return true;
+    });
+    return true;
+}
+
+bool CBlockBase::WaitIndexCheckpoint()
+{
+    if (!futIndexCheckpoint.valid())
+    {
+        return true;
+    }
+    return futIndexCheckpoint.get();
+}
+
 bool CBlockBase::VerifyBlockDB(const CBlockVerify& verifyBlock, CBlockOutline& outline, CBlockRoot& blockRoot, const bool fVerify)
 {
     if (!dbBlock.RetrieveBlockIndex(verifyBlock.hashBlock, outline))
@@ -4886,7 +5231,7 @@ bool CBlockBase::VerifyBlockDB(const CBlockVerify& verifyBlock, CBlockOutline& o
     return true;
 }
 
-bool CBlockBase::RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& blockRoot, CBlockEx& block, CBlockIndex** ppIndexNew)
+bool CBlockBase::RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& blockRoot, CBlockEx& block, BlockIndexPtr& pIndexNew)
 {
     //CBlockEx block;
     if (!tsBlock.Read(block, verifyBlock.nFile, verifyBlock.nOffset, true, true))
@@ -4911,7 +5256,7 @@ bool CBlockBase::RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& bloc
     }
     else
     {
-        CBlockIndex* pPrevIndex = GetIndex(block.hashPrev);
+        BlockIndexPtr pPrevIndex = GetIndex(block.hashPrev);
         if (!pPrevIndex)
         {
             StdError("BlockBase", "Repair block DB: Get prev index fail, block: [%d] %s, prev block: [%d] %s.",
@@ -4922,7 +5267,7 @@ bool CBlockBase::RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& bloc
         hashFork = pPrevIndex->GetOriginHash();
     }
 
-    if (!SaveBlock(hashFork, hashBlock, block, ppIndexNew, blockRoot, true))
+    if (!SaveBlock(hashFork, hashBlock, block, pIndexNew, blockRoot, true))
     {
         StdError("BlockBase", "Repair block DB: Save block failed, block: [%d] %s", CBlock::GetBlockHeightByHash(hashBlock), hashBlock.ToString().c_str());
         return false;
@@ -4930,62 +5275,33 @@ bool CBlockBase::RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& bloc
     return true;
 }
 
-bool CBlockBase::LoadBlockIndex(CBlockOutline& outline, CBlockIndex** ppIndexNew)
+bool CBlockBase::LoadBlockIndex(const CBlockOutline& outline, BlockIndexPtr& pIndexNew)
 {
-    uint256 hashBlock = outline.GetBlockHash();
+    const CBlockIndex& index = static_cast<const CBlockIndex&>(outline);
+    const uint256 hashBlock = index.GetBlockHash();
 
-    if (mapIndex.find(hashBlock) != mapIndex.end())
+    if (arenaBlockIndex.Exists(hashBlock))
     {
         StdError("BlockBase", "Load block index: Block index exist, block: %s", hashBlock.ToString().c_str());
         return false;
     }
-
-    CBlockIndex* pIndexNew = new CBlockIndex(static_cast<CBlockIndex&>(outline));
-    if (pIndexNew == nullptr)
+    if (index.hashPrev != 0 && !GetIndex(index.hashPrev))
     {
-        StdError("BlockBase", "Load block index: New block index fail, block: %s", hashBlock.ToString().c_str());
+        StdError("BlockBase", "Load block index: Get prev index fail, block: %s, prev block: %s",
+                 hashBlock.ToString().c_str(), index.hashPrev.GetHex().c_str());
         return false;
     }
-    auto mi = mapIndex.insert(make_pair(hashBlock, pIndexNew)).first;
-    if (mi == mapIndex.end())
+    if (!index.IsOrigin() && !GetIndex(index.hashOrigin))
     {
-        StdError("BlockBase", "Load block index: Block index insert fail, block: %s", hashBlock.ToString().c_str());
+        StdError("BlockBase", "Load block index: Get origin index fail, block: %s, origin block: %s",
+                 hashBlock.ToString().c_str(), index.hashOrigin.GetHex().c_str());
         return false;
     }
 
-    pIndexNew->phashBlock = &(mi->first);
-    pIndexNew->pPrev = nullptr;
-    pIndexNew->pOrigin = nullptr;
-
-    if (outline.hashPrev != 0)
-    {
-        pIndexNew->pPrev = GetIndex(outline.hashPrev);
-        if (pIndexNew->pPrev == nullptr)
-        {
-            StdError("BlockBase", "Load block index: Get prev index fail, block: %s, prev block: %s",
-                     hashBlock.ToString().c_str(), outline.hashPrev.GetHex().c_str());
-            return false;
-        }
-    }
-
-    if (pIndexNew->IsOrigin())
-    {
-        pIndexNew->pOrigin = pIndexNew;
-    }
-    else
-    {
-        pIndexNew->pOrigin = GetIndex(outline.hashOrigin);
-        if (pIndexNew->pOrigin == nullptr)
-        {
-            StdError("BlockBase", "Load block index: Get origin index fail, block: %s, origin block: %s",
-                     hashBlock.ToString().c_str(), outline.hashOrigin.GetHex().c_str());
-            return false;
-        }
-    }
+    pIndexNew = MAKE_SHARED_BLOCK_INDEX(index);
+    AddCacheBlockIndex(pIndexNew);
 
     UpdateBlockHeightIndex(pIndexNew->GetOriginHash(), hashBlock, pIndexNew->nTimeStamp, CDestination(), pIndexNew->GetRefBlock());
-
-    *ppIndexNew = pIndexNew;
     return true;
 }
 
@@ -7,7 +7,10 @@
 
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <atomic>
 #include <boost/thread/thread.hpp>
+#include <functional>
+#include <future>
 #include <list>
 #include <map>
 #include <numeric>
@@ -15,8 +18,10 @@
 #include "../hvm/vface/vmhostface.h"
 #include "block.h"
 #include "blockdb.h"
+#include "blockindexarena.h"
 #include "blockstate.h"
 #include "cmstruct.h"
+#include "committask.h"
 #include "dbstruct.h"
 #include "forkcontext.h"
 #include "hnbase.h"
@@ -115,6 +120,54 @@ protected:
     std::map<CChainId, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>> mapBlockReceiptCache; // key: chainid, value: key: block hash, value: receipt
 };
 
+//////////////////////////////////////////
+// CBlockVerifyTask
+
+class CBlockVerifyTask
+{
+public:
+    CBlockVerifyTask()
+      : fVerify(false), fResult(false) {}
+
+public:
+    CBlockVerify verifyBlock;
+    bool fVerify;
+    bool fResult;
+    CBlockOutline outline;
+    CBlockRoot blockRoot;
+};
+
+//////////////////////////////////////////
+// CBlockVerifyPool
+
+// Fixed worker threads kept for a whole verify run, each Run() call spreads one window over them
+class CBlockVerifyPool
+{
+public:
+    typedef std::function<bool(CBlockVerifyTask&)> VerifyFunc;
+
+    CBlockVerifyPool(const std::size_t nThreadCount, VerifyFunc fnVerifyIn);
+    ~CBlockVerifyPool();
+
+    void Run(std::vector<CBlockVerifyTask>& vTask);
+
+protected:
+    void WorkerFunc();
+    void Work();
+
+protected:
+    VerifyFunc fnVerify;
+    boost::thread_group grpWorker;
+    boost::mutex mtxPool;
+    boost::condition_variable condWork;
+    boost::condition_variable condDone;
+    std::vector<CBlockVerifyTask>* pvTask;
+    std::atomic<std::size_t> nNextTask;
+    uint64 nBatch;
+    std::size_t nActiveWorker;
+    bool fExit;
+};
+
 //////////////////////////////////////////
 // CBlockBase
 
@@ -124,7 +177,9 @@ public:
     CBlockBase();
     ~CBlockBase();
     bool BsInitialize(const fs::path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fFullDbIn, const bool fTraceDbIn,
-                      const bool fCacheTrace, const bool fRewardCheckIn, const bool fRenewDB, const bool fPruneDb);
+                      const bool fCacheTrace, const bool fRewardCheckIn, const bool fRenewDB, const bool fPruneDb,
+                      const CTimeSeriesSyncPolicy& syncPolicy = CTimeSeriesSyncPolicy(), const std::size_t nBlockCacheSize = CTimeSeriesCached::DEFAULT_CACHE_SIZE,
+                      const std::size_t nBlockCachePinCount = CTimeSeriesCached::DEFAULT_CACHE_PIN_COUNT, const bool fFullVerifyDbIn = false);
     void BsDeinitialize();
     void Clear();
     bool IsEmpty();
@@ -222,8 +277,9 @@ public:
     bool RetrieveContractKvValue(const uint256& hashFork, const uint256& hashContractRoot, const uint256& key, bytes& value);
     bool CreateCacheContractKvTrie(const uint256& hashFork, const uint256& hashPrevRoot, const std::map<uint256, bytes>& mapContractState, uint256& hashNewRoot);
     bool RetrieveAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CAddressContext& ctxAddress);
+    bool RetrieveAddressContexts(const uint256& hashFork, const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress);
     bool RetrieveTokenContractAddressContext(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTokenContractAddressContext& ctxAddress);
-    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress);
+    bool ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress);
     bool ListTokenContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CTokenContractAddressContext>& mapTokenContractAddress);
     bool GetAddressCount(const uint256& hashFork, const uint256& hashBlock, uint64& nAddressCount, uint64& nNewAddressCount);
     bool ListFunctionAddress(const uint256& hashBlock, std::map<uint32, CFunctionAddressContext>& mapFunctionAddress);
@@ -254,7 +310,8 @@ public:
     bool GetVoteRewardLockedAmount(const uint256& hashFork, const uint256& hashPrevBlock, const CDestination& dest, uint256& nLockedAmount);
     bool GetBlockAddress(const uint256& hashFork, const uint256& hashBlock, const CBlock& block, std::map<CDestination, CAddressContext>& mapBlockAddress);
     bool GetTransactionReceipt(const uint256& hashFork, const uint256& txid, CTransactionReceiptEx& txReceiptex);
-    bool GetBlockReceiptsByBlock(const uint256& hashFork, const uint256& hashFromBlock, const uint256& hashToBlock, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts);
+    bool GetBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, std::map<uint256, std::vector<CTransactionReceipt>, CustomBlockHashCompare>& mapBlockReceipts);
+    bool WalkThroughBlockReceiptsByLogsFilter(const uint256& hashFork, const CLogsFilter& logsFilter, const uint64 nMaxBlockCount, WalkerBlockReceiptsFunc fnWalker);
     bool RetrieveTxContractReceipt(const uint256& hashFork, const uint256& txid, TxContractReceipts& tcrReceipt);
     bool ListBlockContractReceipt(const uint256& hashFork, const uint256& hashBlock, BlockContractReceipts& vContractReceipts);
     bool RetrieveTxContractPrevState(const uint256& hashFork, const uint256& txid, MapContractPrevState& mapContractPrevState);
@@ -276,6 +333,8 @@ public:
     bool UpdateForkMintMinGasPrice(const uint256& hashFork, const uint256& nMinGasPrice);
     uint256 GetForkMintMinGasPrice(const uint256& hashFork);
 
+    bool PruneForkStateData(const uint256& hashFork, const uint32 nPruneReserveLastHeight, const uint64 nMaxPruneNodeCount, uint64& nPruneNodeCount, uint64& nPruneBytes);
+
 protected:
     CBlockIndex* GetIndex(const uint256& hash) const;
     CBlockIndex* GetForkLastIndex(const uint256& hashFork);
@@ -286,7 +345,7 @@ protected:
     void RemoveBlockIndex(const uint256& hashFork, const uint256& hashBlock);
     void UpdateBlockRef(const uint256& hashFork, const uint256& hashBlock, const uint256& hashRefBlock);
     bool UpdateBlockLongChain(const uint256& hashFork, const std::vector<CBlockEx>& vBlockRemove, const std::vector<CBlockEx>& vBlockAddNew);
-    void UpdateBlockNext(CBlockIndex* pIndexLast);
+    void UpdateBlockNext(BlockIndexPtr pIndexLast);
     CBlockIndex* AddNewIndex(const uint256& hash, const CBlock& block, const uint32 nFile, const uint32 nOffset, const uint32 nCrc, const uint256& nChainTrust, const uint256& hashNewStateRoot);
     bool LoadForkProfile(const CBlockIndex* pIndexOrigin, CProfile& profile);
     bool UpdateDelegate(const uint256& hashFork, const uint256& hashBlock, const CBlockEx& block, const uint32 nFile, const uint32 nOffset,
@@ -304,22 +363,30 @@ protected:
     bool LoadDB();
     bool VerifyDB();
     bool VerifyBlockDB(const CBlockVerify& verifyBlock, CBlockOutline& outline, CBlockRoot& blockRoot, const bool fVerify);
-    bool RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& blockRoot, CBlockEx& block, CBlockIndex** ppIndexNew);
-    bool LoadBlockIndex(CBlockOutline& outline, CBlockIndex** ppIndexNew);
+    bool RepairBlockDB(const CBlockVerify& verifyBlock, CBlockRoot& blockRoot, CBlockEx& block, BlockIndexPtr& pIndexNew);
+    bool LoadBlockIndex(const CBlockOutline& outline, BlockIndexPtr& pIndexNew);
+    bool SaveIndexCheckpoint();
+    bool WaitIndexCheckpoint();
+    uint32 GetVerifyThreadCount() const;
 
 protected:
     enum
     {
-        MAX_CACHE_BLOCK_STATE = 64
+        MAX_CACHE_BLOCK_STATE = 64,
+        VERIFY_WINDOW_SIZE = 1024,
+        COMMIT_PARALLEL_MIN_TX_COUNT = 64
     };
 
     mutable hnbase::CRWAccess rwAccess;
     bool fCfgFullDb;
     bool fCfgRewardCheck;
+    bool fCfgFullVerifyDb;
+    fs::path pathIndexCheckpoint;
+    std::future<bool> futIndexCheckpoint;
     uint256 hashGenesisBlock;
     CBlockDB dbBlock;
     CTimeSeriesCached tsBlock;
-    std::map<uint256, CBlockIndex*> mapIndex;
+    CBlockIndexArena arenaBlockIndex;
     std::map<uint256, CForkHeightIndex> mapForkHeightIndex;
     CBlockFilter blockFilter;
 };
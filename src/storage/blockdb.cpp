@@ -52,6 +52,11 @@ bool CBlockDB::BdInitialize(const boost::filesystem::path& pathData, const uint2
         StdLog("CBlockDB", "Initialize: dbTxIndex initialize fail");
         return false;
     }
+    if (!dbLogBloom.Initialize(pathData))
+    {
+        StdLog("CBlockDB", "Initialize: dbLogBloom initialize fail");
+        return false;
+    }
     if (!dbVote.Initialize(pathData, fPruneIn))
     {
         StdLog("CBlockDB", "Initialize: dbVote initialize fail");
@@ -119,6 +124,7 @@ void CBlockDB::BdDeinitialize()
     dbVote.Deinitialize();
     dbHdex.Deinitialize();
     dbTxIndex.Deinitialize();
+    dbLogBloom.Deinitialize();
     dbBlockIndex.Deinitialize();
     dbFork.Deinitialize();
     dbVerify.Deinitialize();
@@ -143,6 +149,7 @@ void CBlockDB::RemoveAll()
     dbVote.Clear();
     dbHdex.Clear();
     dbTxIndex.Clear();
+    dbLogBloom.Clear();
     dbBlockIndex.Clear();
     dbFork.Clear();
     dbVerify.Clear();
@@ -266,6 +273,11 @@ bool CBlockDB::AddNewFork(const uint256& hashFork)
         RemoveFork(hashFork);
         return false;
     }
+    if (!dbLogBloom.AddNewFork(hashFork))
+    {
+        RemoveFork(hashFork);
+        return false;
+    }
     if (!dbState.AddNewFork(hashFork))
     {
         RemoveFork(hashFork);
@@ -306,6 +318,10 @@ bool CBlockDB::LoadFork(const uint256& hashFork)
     {
         return false;
     }
+    if (!dbLogBloom.LoadFork(hashFork))
+    {
+        return false;
+    }
     if (!dbState.LoadFork(hashFork))
     {
         return false;
@@ -338,6 +354,7 @@ bool CBlockDB::LoadFork(const uint256& hashFork)
 bool CBlockDB::RemoveFork(const uint256& hashFork)
 {
     dbTxIndex.RemoveFork(hashFork);
+    dbLogBloom.RemoveFork(hashFork);
     dbState.RemoveFork(hashFork);
     dbAddress.RemoveFork(hashFork);
     dbContract.RemoveFork(hashFork);
@@ -493,6 +510,16 @@ bool CBlockDB::RetrieveTxReceipt(const uint256& hashFork, const uint256& txid, C
     return dbTxIndex.RetrieveTxReceipt(hashFork, txid, txReceipt);
 }
 
+bool CBlockDB::RetrieveBlockTxReceipts(const uint256& hashFork, const uint256& hashBlock, const std::vector<uint256>& vTxid, std::vector<CTransactionReceipt>& vTxReceipt)
+{
+    return dbTxIndex.RetrieveBlockTxReceipts(hashFork, hashBlock, vTxid, vTxReceipt);
+}
+
+bool CBlockDB::FilterLogsBloomBlock(const uint256& hashFork, const CLogsFilter& logsFilter, const std::vector<std::pair<uint64, uint256>>& vBlock, std::vector<uint256>& vMatchBlock)
+{
+    return dbLogBloom.FilterBlocks(hashFork, logsFilter, vBlock, vMatchBlock);
+}
+
 bool CBlockDB::RetrieveDelegate(const uint256& hash, map<CDestination, uint256>& mapDelegate)
 {
     return dbVote.RetrieveDelegatedVote(hash, mapDelegate);
@@ -529,9 +556,9 @@ bool CBlockDB::WalkThroughDayVote(const uint256& hashBeginBlock, const uint256&
     return dbVote.WalkThroughDayVote(hashBeginBlock, hashTailBlock, walker);
 }
 
-bool CBlockDB::AddBlockState(const uint256& hashFork, const uint256& hashPrevRoot, const CBlockRootStatus& statusBlockRoot, const std::map<CDestination, CDestState>& mapBlockState, uint256& hashBlockRoot)
+bool CBlockDB::AddBlockState(const uint256& hashFork, const uint32 nBlockHeight, const uint256& hashPrevRoot, const CBlockRootStatus& statusBlockRoot, const std::map<CDestination, CDestState>& mapBlockState, uint256& hashBlockRoot)
 {
-    return dbState.AddBlockState(hashFork, hashPrevRoot, statusBlockRoot, mapBlockState, hashBlockRoot);
+    return dbState.AddBlockState(hashFork, nBlockHeight, hashPrevRoot, statusBlockRoot, mapBlockState, hashBlockRoot);
 }
 
 bool CBlockDB::CreateCacheStateTrie(const uint256& hashFork, const uint256& hashPrevRoot, const CBlockRootStatus& statusBlockRoot, const std::map<CDestination, CDestState>& mapBlockState, uint256& hashBlockRoot)
@@ -549,14 +576,48 @@ bool CBlockDB::ListDestState(const uint256& hashFork, const uint256& hashBlockRo
     return dbState.ListDestState(hashFork, hashBlockRoot, mapBlockState);
 }
 
+bool CBlockDB::ClearStateUnavailableNode(const uint256& hashFork, const uint32 nClearRefHeight, const uint64 nMaxNodeCount, CTriePruneStat& statPrune)
+{
+    return dbState.ClearStateUnavailableNode(hashFork, nClearRefHeight, nMaxNodeCount, statPrune);
+}
+
 bool CBlockDB::AddBlockTxIndexReceipt(const uint256& hashFork, const uint256& hashBlock, const std::map<uint256, CTxIndex>& mapBlockTxIndex, const std::map<uint256, CTransactionReceipt>& mapBlockTxReceipts)
 {
-    return dbTxIndex.AddBlockTxIndexReceipt(hashFork, hashBlock, mapBlockTxIndex, mapBlockTxReceipts);
+    std::vector<CTransactionReceipt> vTxReceipts;
+    vTxReceipts.reserve(mapBlockTxReceipts.size());
+    uint2048 nBlockLogsBloom;
+    for (const auto& kv : mapBlockTxReceipts)
+    {
+        vTxReceipts.push_back(kv.second);
+        // nLogsBloom of a receipt is not always filled in, so the block bloom is built from the logs
+        for (const auto& logs : kv.second.vLogs)
+        {
+            nBlockLogsBloom |= logs.GetLogsBloom();
+        }
+    }
+    // packed in block order
+    std::stable_sort(vTxReceipts.begin(), vTxReceipts.end(), [](const CTransactionReceipt& a, const CTransactionReceipt& b) { return a.nTxIndex < b.nTxIndex; });
+
+    if (!dbTxIndex.AddBlockTxIndexReceipt(hashFork, hashBlock, mapBlockTxIndex, vTxReceipts))
+    {
+        return false;
+    }
+    if (!dbLogBloom.AddBlockBloom(hashFork, hashBlock, nBlockLogsBloom))
+    {
+        StdLog("CBlockDB", "Add block tx index receipt: Add block logs bloom fail, block: %s", hashBlock.ToString().c_str());
+        return false;
+    }
+    return true;
 }
 
-bool CBlockDB::UpdateBlockLongChain(const uint256& hashFork, const std::vector<uint256>& vRemoveTx, const std::map<uint256, uint256>& mapNewTx)
+bool CBlockDB::UpdateTxIndexBlockLongChain(const uint256& hashFork, const std::vector<uint256>& vRemoveTx, const std::map<uint256, uint256>& mapNewTx)
 {
-    return dbTxIndex.UpdateBlockLongChain(hashFork, vRemoveTx, mapNewTx);
+    return dbTxIndex.UpdateTxIndexBlockLongChain(hashFork, vRemoveTx, mapNewTx);
+}
+
+bool CBlockDB::UpdateAddressTxInfoBlockLongChain(const uint256& hashFork, const std::vector<uint256>& vRemoveBlock, const std::vector<uint256>& vAddBlock)
+{
+    return dbAddressTxInfo.UpdateAddressTxInfoBlockLongChain(hashFork, vRemoveBlock, vAddBlock);
 }
 
 bool CBlockDB::AddBlockContractKvValue(const uint256& hashFork, const uint256& hashPrevRoot, uint256& hashContractRoot, const std::map<uint256, bytes>& mapContractState)
@@ -569,6 +630,11 @@ bool CBlockDB::RetrieveContractKvValue(const uint256& hashFork, const uint256& h
     return dbContract.RetrieveContractKvValue(hashFork, hashContractRoot, key, value);
 }
 
+bool CBlockDB::ListContractKvValue(const uint256& hashFork, const uint256& hashContractRoot, const uint256& keyStart, const uint32 nLimit, std::vector<std::pair<uint256, bytes>>& vContractKv, uint256& keyNext)
+{
+    return dbContract.ListContractKvValue(hashFork, hashContractRoot, keyStart, nLimit, vContractKv, keyNext);
+}
+
 bool CBlockDB::AddAddressContext(const uint256& hashFork, const uint256& hashPrevBlock, const uint256& hashBlock, const std::map<CDestination, CAddressContext>& mapAddress, const uint64 nNewAddressCount,
                                  const std::map<CDestination, CTimeVault>& mapTimeVault, const std::map<uint32, CFunctionAddressContext>& mapFunctionAddress, uint256& hashNewRoot)
 {
@@ -593,9 +659,27 @@ bool CBlockDB::RetrieveAddressContext(const uint256& hashFork, const uint256& ha
     return dbAddress.RetrieveAddressContext(hashFork, hashRefBlock, dest, ctxAddress);
 }
 
-bool CBlockDB::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+bool CBlockDB::RetrieveAddressContexts(const uint256& hashFork, const uint256& hashBlock, const std::set<CDestination>& setDest, std::map<CDestination, CAddressContext>& mapAddress)
 {
-    return dbAddress.ListContractAddress(hashFork, hashBlock, mapContractAddress);
+    uint256 hashRefBlock;
+    if (hashBlock == 0)
+    {
+        if (!dbFork.RetrieveForkLast(hashFork, hashRefBlock))
+        {
+            StdLog("CBlockDB", "Retrieve address contexts: Retrieve fork last fail, fork: %s", hashFork.ToString().c_str());
+            return false;
+        }
+    }
+    else
+    {
+        hashRefBlock = hashBlock;
+    }
+    return dbAddress.RetrieveAddressContexts(hashFork, hashRefBlock, setDest, mapAddress);
+}
+
+bool CBlockDB::ListContractAddress(const uint256& hashFork, const uint256& hashBlock, const CDestination& destBegin, const uint32 nCount, std::map<CDestination, CContractAddressContext>& mapContractAddress)
+{
+    return dbAddress.ListContractAddress(hashFork, hashBlock, destBegin, nCount, mapContractAddress);
 }
 
 bool CBlockDB::RetrieveTimeVault(const uint256& hashFork, const uint256& hashBlock, const CDestination& dest, CTimeVault& tv)
@@ -805,6 +889,11 @@ bool CBlockDB::LoadAllFork()
             StdLog("CBlockDB", "Load all fork: dbTxIndex LoadFork fail");
             return false;
         }
+        if (!dbLogBloom.LoadFork(kv.first))
+        {
+            StdLog("CBlockDB", "Load all fork: dbLogBloom LoadFork fail");
+            return false;
+        }
         if (!dbState.LoadFork(kv.first))
         {
             StdLog("CBlockDB", "Load all fork: dbState LoadFork fail");
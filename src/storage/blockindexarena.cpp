@@ -0,0 +1,447 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockindexarena.h"
+
+#include "crypto.h"
+#include "timeseries.h"
+
+using namespace std;
+using namespace hnbase;
+
+namespace hashahead
+{
+namespace storage
+{
+
+//////////////////////////////
+// CBlockIndexArena
+
+CBlockIndexArena::CBlockIndexArena(const size_t nMaxColdCountIn)
+  : nNextId(0), nCount(0), nUsedSlot(0), cacheCold(nMaxColdCountIn)
+{
+}
+
+void CBlockIndexArena::SetLoader(const LoadFunc& fnLoadIn)
+{
+    fnLoad = fnLoadIn;
+}
+
+bool CBlockIndexArena::Exists(const uint256& hashBlock) const
+{
+    CReadLock rlock(rwAccess);
+    return (FindRecord(hashBlock) != SLOT_EMPTY);
+}
+
+BlockIndexPtr CBlockIndexArena::Retrieve(const uint256& hashBlock) const
+{
+    BlockIndexPtr pIndex = MAKE_SHARED_BLOCK_INDEX();
+    if (!Retrieve(hashBlock, *pIndex))
+    {
+        return nullptr;
+    }
+    return pIndex;
+}
+
+bool CBlockIndexArena::Retrieve(const uint256& hashBlock, CBlockIndex& index) const
+{
+    {
+        CReadLock rlock(rwAccess);
+        const uint32 nId = FindRecord(hashBlock);
+        if (nId == SLOT_EMPTY)
+        {
+            return false;
+        }
+        const CBlockIndexHot& hot = GetRecord(nId);
+        index.hashBlock = hot.hashBlock;
+        index.hashPrev = hot.hashPrev;
+        index.hashOrigin = hot.hashOrigin;
+        index.txidMint = hot.txidMint;
+        index.nMintType = hot.nMintType;
+        index.destMint = hot.destMint;
+        index.nVersion = hot.nVersion;
+        index.nType = hot.nType;
+        index.nTimeStamp = hot.nTimeStamp;
+        index.nNumber = hot.nNumber;
+        index.nTxCount = hot.nTxCount;
+        index.nRewardTxCount = hot.nRewardTxCount;
+        index.nUserTxCount = hot.nUserTxCount;
+        index.nAgreement = hot.nAgreement;
+        index.hashRefBlock = hot.hashRefBlock;
+        index.hashStateRoot = hot.hashStateRoot;
+        index.nChainTrust = hot.nChainTrust;
+        index.nFile = hot.nFile;
+        index.nOffset = hot.nOffset;
+        index.nBlockCrc = hot.nBlockCrc;
+    }
+
+    CBlockIndexCold cold;
+    if (!cacheCold.Retrieve(hashBlock, cold))
+    {
+        // evicted, or restored from a checkpoint without them
+        CBlockIndex indexLoad;
+        if (!fnLoad || !fnLoad(hashBlock, indexLoad))
+        {
+            return false;
+        }
+        cold.nGasLimit = indexLoad.nGasLimit;
+        cold.nGasUsed = indexLoad.nGasUsed;
+        cold.nBlockReward = indexLoad.nBlockReward;
+        cold.nMoneySupply = indexLoad.nMoneySupply;
+        cold.nMoneyDestroy = indexLoad.nMoneyDestroy;
+        cacheCold.AddNew(hashBlock, cold);
+    }
+    index.nGasLimit = cold.nGasLimit;
+    index.nGasUsed = cold.nGasUsed;
+    index.nBlockReward = cold.nBlockReward;
+    index.nMoneySupply = cold.nMoneySupply;
+    index.nMoneyDestroy = cold.nMoneyDestroy;
+    return true;
+}
+
+void CBlockIndexArena::AddNew(const BlockIndexPtr& pIndex)
+{
+    AddNew(*pIndex);
+}
+
+void CBlockIndexArena::AddNew(const CBlockIndex& index)
+{
+    {
+        CWriteLock wlock(rwAccess);
+
+        CBlockIndexHot& hot = InsertRecord(index.hashBlock);
+        hot.hashBlock = index.hashBlock;
+        hot.hashPrev = index.hashPrev;
+        hot.hashOrigin = index.hashOrigin;
+        hot.txidMint = index.txidMint;
+        hot.nMintType = index.nMintType;
+        hot.destMint = index.destMint;
+        hot.nVersion = index.nVersion;
+        hot.nType = index.nType;
+        hot.nTimeStamp = index.nTimeStamp;
+        hot.nNumber = index.nNumber;
+        hot.nTxCount = index.nTxCount;
+        hot.nRewardTxCount = index.nRewardTxCount;
+        hot.nUserTxCount = index.nUserTxCount;
+        hot.nAgreement = index.nAgreement;
+        hot.hashRefBlock = index.hashRefBlock;
+        hot.hashStateRoot = index.hashStateRoot;
+        hot.nChainTrust = index.nChainTrust;
+        hot.nFile = index.nFile;
+        hot.nOffset = index.nOffset;
+        hot.nBlockCrc = index.nBlockCrc;
+    }
+
+    CBlockIndexCold cold;
+    cold.nGasLimit = index.nGasLimit;
+    cold.nGasUsed = index.nGasUsed;
+    cold.nBlockReward = index.nBlockReward;
+    cold.nMoneySupply = index.nMoneySupply;
+    cold.nMoneyDestroy = index.nMoneyDestroy;
+    cacheCold.AddNew(index.hashBlock, cold);
+}
+
+void CBlockIndexArena::AddNewHot(const CBlockIndexHot& hot)
+{
+    cacheCold.Remove(hot.hashBlock);
+
+    CWriteLock wlock(rwAccess);
+    InsertRecord(hot.hashBlock) = hot;
+}
+
+void CBlockIndexArena::Remove(const uint256& hashBlock)
+{
+    cacheCold.Remove(hashBlock);
+
+    CWriteLock wlock(rwAccess);
+    if (vTable.empty())
+    {
+        return;
+    }
+    size_t nPos = GetSlotPos(hashBlock);
+    while (vTable[nPos] != SLOT_EMPTY)
+    {
+        if (vTable[nPos] != SLOT_DELETED && GetRecord(vTable[nPos]).hashBlock == hashBlock)
+        {
+            GetRecord(vTable[nPos]).hashBlock = 0;
+            vFreeId.push_back(vTable[nPos]);
+            vTable[nPos] = SLOT_DELETED;
+            nCount--;
+            return;
+        }
+        nPos = (nPos + 1) & (vTable.size() - 1);
+    }
+}
+
+void CBlockIndexArena::Clear()
+{
+    cacheCold.Clear();
+
+    CWriteLock wlock(rwAccess);
+    vChunk.clear();
+    vFreeId.clear();
+    vTable.clear();
+    nNextId = 0;
+    nCount = 0;
+    nUsedSlot = 0;
+}
+
+size_t CBlockIndexArena::GetCount() const
+{
+    CReadLock rlock(rwAccess);
+    return nCount;
+}
+
+void CBlockIndexArena::GetStat(CStat& stat) const
+{
+    stat.nColdCount = cacheCold.GetCount();
+
+    CReadLock rlock(rwAccess);
+    stat.nCount = nCount;
+    stat.nArenaBytes = vChunk.size() * CHUNK_RECORD_COUNT * sizeof(CBlockIndexHot) + vChunk.capacity() * sizeof(unique_ptr<CBlockIndexHot[]>)
+                       + vFreeId.capacity() * sizeof(uint32);
+    stat.nTableBytes = vTable.capacity() * sizeof(uint32);
+}
+
+bool CBlockIndexArena::WalkThrough(CBlockIndexArenaWalker& walker) const
+{
+    CReadLock rlock(rwAccess);
+    for (const uint32 nId : vTable)
+    {
+        if (nId != SLOT_EMPTY && nId != SLOT_DELETED && !walker.Walk(GetRecord(nId)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CBlockIndexArena::GetSlotPos(const uint256& hashBlock) const
+{
+    // block hashes carry chain id and height in the top word, so fold all words
+    return (size_t)(hashBlock.GetInt64Index() * 0x9E3779B97F4A7C15ULL) & (vTable.size() - 1);
+}
+
+uint32 CBlockIndexArena::FindRecord(const uint256& hashBlock) const
+{
+    if (vTable.empty())
+    {
+        return SLOT_EMPTY;
+    }
+    size_t nPos = GetSlotPos(hashBlock);
+    while (vTable[nPos] != SLOT_EMPTY)
+    {
+        if (vTable[nPos] != SLOT_DELETED && GetRecord(vTable[nPos]).hashBlock == hashBlock)
+        {
+            return vTable[nPos];
+        }
+        nPos = (nPos + 1) & (vTable.size() - 1);
+    }
+    return SLOT_EMPTY;
+}
+
+CBlockIndexHot& CBlockIndexArena::GetRecord(const uint32 nId) const
+{
+    return vChunk[nId / CHUNK_RECORD_COUNT][nId % CHUNK_RECORD_COUNT];
+}
+
+uint32 CBlockIndexArena::NewRecord()
+{
+    if (!vFreeId.empty())
+    {
+        uint32 nId = vFreeId.back();
+        vFreeId.pop_back();
+        return nId;
+    }
+    if (nNextId / CHUNK_RECORD_COUNT >= vChunk.size())
+    {
+        vChunk.emplace_back(new CBlockIndexHot[CHUNK_RECORD_COUNT]);
+    }
+    return nNextId++;
+}
+
+CBlockIndexHot& CBlockIndexArena::InsertRecord(const uint256& hashBlock)
+{
+    uint32 nId = FindRecord(hashBlock);
+    if (nId == SLOT_EMPTY)
+    {
+        if ((nUsedSlot + 1) * 10 > vTable.size() * 7)
+        {
+            // grow only when live records fill the table, otherwise just sweep the tombstones
+            Rehash((nCount + 1) * 10 > vTable.size() * 5 ? max(vTable.size() * 2, (size_t)1024) : vTable.size());
+        }
+        nId = NewRecord();
+        size_t nPos = GetSlotPos(hashBlock);
+        while (vTable[nPos] != SLOT_EMPTY && vTable[nPos] != SLOT_DELETED)
+        {
+            nPos = (nPos + 1) & (vTable.size() - 1);
+        }
+        if (vTable[nPos] == SLOT_EMPTY)
+        {
+            nUsedSlot++;
+        }
+        vTable[nPos] = nId;
+        nCount++;
+        GetRecord(nId).hashBlock = hashBlock;
+    }
+    return GetRecord(nId);
+}
+
+void CBlockIndexArena::Rehash(const size_t nTableSize)
+{
+    vector<uint32> vOldTable(nTableSize, SLOT_EMPTY);
+    vTable.swap(vOldTable);
+    nUsedSlot = 0;
+    for (const uint32 nId : vOldTable)
+    {
+        if (nId == SLOT_EMPTY || nId == SLOT_DELETED)
+        {
+            continue;
+        }
+        size_t nPos = GetSlotPos(GetRecord(nId).hashBlock);
+        while (vTable[nPos] != SLOT_EMPTY)
+        {
+            nPos = (nPos + 1) & (vTable.size() - 1);
+        }
+        vTable[nPos] = nId;
+        nUsedSlot++;
+    }
+}
+
+//////////////////////////////
+// CBlockIndexCheckpoint
+
+void CBlockIndexCheckpoint::Collect(const CBlockIndexArena& arena)
+{
+    class CCollectWalker : public CBlockIndexArenaWalker
+    {
+    public:
+        CCollectWalker(vector<CBlockIndexHot>& vHotIn)
+          : vHot(vHotIn) {}
+        bool Walk(const CBlockIndexHot& hot) override
+        {
+            vHot.push_back(hot);
+            return true;
+        }
+
+    public:
+        vector<CBlockIndexHot>& vHot;
+    };
+
+    vHot.clear();
+    vHot.reserve(arena.GetCount());
+    CCollectWalker walker(vHot);
+    arena.WalkThrough(walker);
+}
+
+bool CBlockIndexCheckpoint::Save(const boost::filesystem::path& pathFile, const CBlockIndexArena& arena)
+{
+    Collect(arena);
+    return Save(pathFile);
+}
+
+bool CBlockIndexCheckpoint::Save(const boost::filesystem::path& pathFile) const
+{
+    bytes btData;
+    try
+    {
+        CFlatWriteStream ssSize;
+        ssSize << (uint32)CHECKPOINT_MAGIC << (uint32)CHECKPOINT_VERSION << nVerifyCount << nVerifyCrc << mapForkLast << vHot;
+        btData.resize(ssSize.GetWritePos() + sizeof(uint256));
+
+        CFlatWriteStream ss((char*)btData.data(), btData.size());
+        ss << (uint32)CHECKPOINT_MAGIC << (uint32)CHECKPOINT_VERSION << nVerifyCount << nVerifyCrc << mapForkLast << vHot;
+        const uint256 hashCheck = crypto::CryptoHash(btData.data(), ss.GetWritePos());
+        ss.Write((const char*)hashCheck.begin(), sizeof(uint256));
+    }
+    catch (exception& e)
+    {
+        StdError("CBlockIndexCheckpoint", "Save: Serialize fail, %s", e.what());
+        return false;
+    }
+
+    // write aside and rename, a crash never leaves a torn checkpoint behind
+    const boost::filesystem::path pathTemp = pathFile.string() + ".tmp";
+    FILE* f = fopen(pathTemp.string().c_str(), "wb");
+    if (f == nullptr)
+    {
+        StdError("CBlockIndexCheckpoint", "Save: Open file fail, path: %s", pathTemp.string().c_str());
+        return false;
+    }
+    bool fWrite = (fwrite(btData.data(), 1, btData.size(), f) == btData.size() && fflush(f) == 0);
+    fclose(f);
+    if (!fWrite)
+    {
+        StdError("CBlockIndexCheckpoint", "Save: Write file fail, path: %s", pathTemp.string().c_str());
+        boost::filesystem::remove(pathTemp);
+        return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(pathTemp, pathFile, ec);
+    if (ec)
+    {
+        StdError("CBlockIndexCheckpoint", "Save: Rename file fail, path: %s, %s", pathFile.string().c_str(), ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CBlockIndexCheckpoint::Load(const boost::filesystem::path& pathFile, CBlockIndexArena& arena)
+{
+    if (!boost::filesystem::exists(pathFile))
+    {
+        return false;
+    }
+    CTimeSeriesMappedFile mappedFile;
+    if (!mappedFile.Open(pathFile.string()) || mappedFile.GetSize() <= sizeof(uint256))
+    {
+        StdError("CBlockIndexCheckpoint", "Load: Map file fail, path: %s", pathFile.string().c_str());
+        return false;
+    }
+
+    const uint8* pData = (const uint8*)mappedFile.GetData();
+    const size_t nDataSize = mappedFile.GetSize() - sizeof(uint256);
+    uint256 hashCheck;
+    memcpy(hashCheck.begin(), pData + nDataSize, sizeof(uint256));
+    if (crypto::CryptoHash(pData, nDataSize) != hashCheck)
+    {
+        StdError("CBlockIndexCheckpoint", "Load: Checksum error, path: %s", pathFile.string().c_str());
+        return false;
+    }
+
+    try
+    {
+        CFlatReadStream ss(pData, nDataSize);
+        uint32 nMagic = 0;
+        uint32 nVersion = 0;
+        ss >> nMagic >> nVersion;
+        if (nMagic != CHECKPOINT_MAGIC || nVersion != CHECKPOINT_VERSION)
+        {
+            StdError("CBlockIndexCheckpoint", "Load: Format error, magic: 0x%8.8x, version: %d", nMagic, nVersion);
+            return false;
+        }
+        ss >> nVerifyCount >> nVerifyCrc >> mapForkLast;
+
+        // records are applied straight from the mapping instead of building a vector first
+        CVarInt varCount;
+        ss >> varCount;
+        for (uint64 i = 0; i < varCount.GetValue(); i++)
+        {
+            CBlockIndexHot hot;
+            ss >> hot;
+            arena.AddNewHot(hot);
+        }
+    }
+    catch (exception& e)
+    {
+        StdError("CBlockIndexCheckpoint", "Load: Deserialize fail, %s", e.what());
+        arena.Clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace storage
+} // namespace hashahead
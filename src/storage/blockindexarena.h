@@ -0,0 +1,193 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef STORAGE_BLOCKINDEXARENA_H
+#define STORAGE_BLOCKINDEXARENA_H
+
+#include <boost/filesystem.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "block.h"
+#include "hnbase.h"
+#include "uint256.h"
+
+namespace hashahead
+{
+namespace storage
+{
+
+// Fields read on every chain walk, kept resident for each known block
+class CBlockIndexHot
+{
+    friend class hnbase::CStream;
+
+public:
+    uint256 hashBlock;
+    uint256 hashPrev;
+    uint256 hashOrigin;
+    uint256 txidMint;
+    uint256 nAgreement;
+    uint256 hashRefBlock;
+    uint256 hashStateRoot;
+    uint256 nChainTrust;
+    CDestination destMint;
+    uint64 nTimeStamp;
+    uint64 nNumber;
+    uint64 nTxCount;
+    uint64 nRewardTxCount;
+    uint64 nUserTxCount;
+    uint32 nFile;
+    uint32 nOffset;
+    uint32 nBlockCrc;
+    uint16 nMintType;
+    uint16 nVersion;
+    uint16 nType;
+
+protected:
+    template <typename O>
+    void Serialize(hnbase::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(hashPrev, opt);
+        s.Serialize(hashOrigin, opt);
+        s.Serialize(txidMint, opt);
+        s.Serialize(nAgreement, opt);
+        s.Serialize(hashRefBlock, opt);
+        s.Serialize(hashStateRoot, opt);
+        s.Serialize(nChainTrust, opt);
+        s.Serialize(destMint, opt);
+        s.Serialize(nTimeStamp, opt);
+        s.Serialize(nNumber, opt);
+        s.Serialize(nTxCount, opt);
+        s.Serialize(nRewardTxCount, opt);
+        s.Serialize(nUserTxCount, opt);
+        s.Serialize(nFile, opt);
+        s.Serialize(nOffset, opt);
+        s.Serialize(nBlockCrc, opt);
+        s.Serialize(nMintType, opt);
+        s.Serialize(nVersion, opt);
+        s.Serialize(nType, opt);
+    }
+};
+
+// Supply and gas accounting fields, cached for recent blocks and read from the index db otherwise
+class CBlockIndexCold
+{
+public:
+    uint256 nGasLimit;
+    uint256 nGasUsed;
+    uint256 nBlockReward;
+    uint256 nMoneySupply;
+    uint256 nMoneyDestroy;
+};
+
+class CBlockIndexArenaWalker
+{
+public:
+    virtual bool Walk(const CBlockIndexHot& hot) = 0;
+};
+
+// Block index records in chunked arena storage, located through an open-addressing hash table
+class CBlockIndexArena
+{
+public:
+    class CStat
+    {
+    public:
+        CStat()
+          : nCount(0), nColdCount(0), nArenaBytes(0), nTableBytes(0) {}
+
+    public:
+        std::size_t nCount;
+        std::size_t nColdCount;
+        std::size_t nArenaBytes; // allocated record chunks and free list
+        std::size_t nTableBytes; // allocated hash table
+    };
+    typedef std::function<bool(const uint256&, CBlockIndex&)> LoadFunc;
+
+    enum
+    {
+        DEFAULT_COLD_COUNT = 65536,
+        CHUNK_RECORD_COUNT = 4096
+    };
+
+public:
+    CBlockIndexArena(const std::size_t nMaxColdCountIn = DEFAULT_COLD_COUNT);
+
+    // Reads a full index from the index db when the cold fields of a known block are not cached
+    void SetLoader(const LoadFunc& fnLoadIn);
+    bool Exists(const uint256& hashBlock) const;
+    // A full index built from the resident record, null if the block is unknown or its cold fields cannot be loaded
+    BlockIndexPtr Retrieve(const uint256& hashBlock) const;
+    bool Retrieve(const uint256& hashBlock, CBlockIndex& index) const;
+    void AddNew(const BlockIndexPtr& pIndex);
+    void AddNew(const CBlockIndex& index);
+    // Restores a resident record only, the cold fields are loaded on first use
+    void AddNewHot(const CBlockIndexHot& hot);
+    void Remove(const uint256& hashBlock);
+    void Clear();
+    std::size_t GetCount() const;
+    void GetStat(CStat& stat) const;
+    bool WalkThrough(CBlockIndexArenaWalker& walker) const;
+
+protected:
+    enum : uint32
+    {
+        SLOT_EMPTY = 0xFFFFFFFF,
+        SLOT_DELETED = 0xFFFFFFFE
+    };
+
+    std::size_t GetSlotPos(const uint256& hashBlock) const;
+    uint32 FindRecord(const uint256& hashBlock) const;
+    CBlockIndexHot& GetRecord(const uint32 nId) const;
+    uint32 NewRecord();
+    CBlockIndexHot& InsertRecord(const uint256& hashBlock);
+    void Rehash(const std::size_t nTableSize);
+
+protected:
+    LoadFunc fnLoad;
+    mutable hnbase::CRWAccess rwAccess;
+    std::vector<std::unique_ptr<CBlockIndexHot[]>> vChunk;
+    std::vector<uint32> vFreeId;
+    uint32 nNextId;
+    std::vector<uint32> vTable;
+    std::size_t nCount;
+    std::size_t nUsedSlot;
+    mutable hnbase::CCache<uint256, CBlockIndexCold> cacheCold;
+};
+
+// Checksummed snapshot of the block index and fork last blocks, covering the first nVerifyCount verify records
+class CBlockIndexCheckpoint
+{
+public:
+    enum
+    {
+        CHECKPOINT_MAGIC = 0x48434B50,
+        CHECKPOINT_VERSION = 1
+    };
+
+public:
+    CBlockIndexCheckpoint()
+      : nVerifyCount(0), nVerifyCrc(0) {}
+
+    // Copies the resident records, so the caller can release its lock before Save(pathFile)
+    void Collect(const CBlockIndexArena& arena);
+    bool Save(const boost::filesystem::path& pathFile) const;
+    bool Save(const boost::filesystem::path& pathFile, const CBlockIndexArena& arena);
+    bool Load(const boost::filesystem::path& pathFile, CBlockIndexArena& arena);
+
+public:
+    uint64 nVerifyCount;
+    uint32 nVerifyCrc; // crc of the last covered verify record
+    std::map<uint256, uint256> mapForkLast;
+    std::vector<CBlockIndexHot> vHot;
+};
+
+} // namespace storage
+} // namespace hashahead
+
+#endif //STORAGE_BLOCKINDEXARENA_H
@@ -0,0 +1,85 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "committask.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hnbase;
+
+namespace hashahead
+{
+namespace storage
+{
+
+static int64 GetSteadyTimeUs()
+{
+    return (int64)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//////////////////////////////
+// CDbCommitTasks
+
+CDbCommitTasks::CDbCommitTasks()
+  : nWallTimeUs(0)
+{
+}
+
+void CDbCommitTasks::AddTask(const std::string& strName, CommitFunc fnCommit)
+{
+    vTask.push_back(CTask(strName, fnCommit));
+}
+
+bool CDbCommitTasks::Run(const bool fParallel, std::vector<std::string>& vFailTask)
+{
+    const int64 nBeginTime = GetSteadyTimeUs();
+    if (fParallel && vTask.size() > 1)
+    {
+        CWorkerPool::GetShared().ParallelFor(vTask.size(), [this](const std::size_t nIndex) { RunTask(vTask[nIndex]); });
+    }
+    else
+    {
+        for (CTask& task : vTask)
+        {
+            RunTask(task);
+        }
+    }
+    nWallTimeUs = GetSteadyTimeUs() - nBeginTime;
+
+    for (const CTask& task : vTask)
+    {
+        if (!task.fResult)
+        {
+            vFailTask.push_back(task.strName);
+        }
+    }
+    return vFailTask.empty();
+}
+
+std::size_t CDbCommitTasks::GetTaskCount() const
+{
+    return vTask.size();
+}
+
+int64 CDbCommitTasks::GetWallTimeUs() const
+{
+    return nWallTimeUs;
+}
+
+void CDbCommitTasks::RunTask(CTask& task)
+{
+    try
+    {
+        task.fResult = task.fnCommit();
+    }
+    catch (exception& e)
+    {
+        StdError("CDbCommitTasks", "Run task: %s throw: %s", task.strName.c_str(), e.what());
+        task.fResult = false;
+    }
+}
+
+} // namespace storage
+} // namespace hashahead
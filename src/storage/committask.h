@@ -0,0 +1,57 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef STORAGE_COMMITTASK_H
+#define STORAGE_COMMITTASK_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "hnbase.h"
+
+namespace hashahead
+{
+namespace storage
+{
+
+// Independent database writes of one commit step, fanned out to the shared worker pool and joined before the step returns
+class CDbCommitTasks
+{
+public:
+    typedef std::function<bool()> CommitFunc;
+
+public:
+    CDbCommitTasks();
+
+    void AddTask(const std::string& strName, CommitFunc fnCommit);
+    // Every task runs to the end even if another one fails, the failed task names are returned
+    bool Run(const bool fParallel, std::vector<std::string>& vFailTask);
+    std::size_t GetTaskCount() const;
+    int64 GetWallTimeUs() const;
+
+protected:
+    class CTask
+    {
+    public:
+        CTask(const std::string& strNameIn, CommitFunc fnCommitIn)
+          : strName(strNameIn), fnCommit(fnCommitIn), fResult(false) {}
+
+    public:
+        std::string strName;
+        CommitFunc fnCommit;
+        bool fResult;
+    };
+
+    static void RunTask(CTask& task);
+
+protected:
+    std::vector<CTask> vTask;
+    int64 nWallTimeUs;
+};
+
+} // namespace storage
+} // namespace hashahead
+
+#endif //STORAGE_COMMITTASK_H
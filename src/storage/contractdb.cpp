@@ -135,6 +135,48 @@ bool CForkContractDB::RetrieveContractKvValue(const uint256& hashContractRoot, c
     return true;
 }
 
+bool CForkContractDB::ListContractKvValue(const uint256& hashContractRoot, const uint256& keyStart, const uint32 nLimit, std::vector<std::pair<uint256, bytes>>& vContractKv, uint256& keyNext)
+{
+    hnbase::CBufStream ssKeyPrefix, ssKeyStart;
+    bytes btKeyPrefix, btKeyStart;
+    ssKeyPrefix << DB_CONTRACT_KEY_TYPE_CONTRACTKV;
+    ssKeyPrefix.GetData(btKeyPrefix);
+    ssKeyStart << DB_CONTRACT_KEY_TYPE_CONTRACTKV << keyStart;
+    ssKeyStart.GetData(btKeyStart);
+
+    keyNext = 0;
+    CTrieIterator it(dbTrie, hashContractRoot, btKeyPrefix);
+    if (!it.Seek(btKeyStart))
+    {
+        StdLog("CForkContractDB", "List contract kv value: Seek failed, root: %s", hashContractRoot.ToString().c_str());
+        return false;
+    }
+    for (; it.IsValid(); it.Next())
+    {
+        try
+        {
+            hnbase::CBufStream ssKey(it.GetKey()), ssValue(it.GetValue());
+            uint8 nKeyType;
+            uint256 key;
+            ssKey >> nKeyType >> key;
+            if (nLimit > 0 && vContractKv.size() >= nLimit)
+            {
+                keyNext = key;
+                break;
+            }
+            bytes value;
+            ssValue >> value;
+            vContractKv.push_back(std::make_pair(key, value));
+        }
+        catch (std::exception& e)
+        {
+            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CForkContractDB::ClearContractKvRootUnavailableNode(const uint32 nRemoveLastHeight, bool& fExit)
 {
     if (!fPruneData)
@@ -479,6 +521,18 @@ bool CContractDB::RetrieveContractKvValue(const uint256& hashFork, const uint256
     return false;
 }
 
+bool CContractDB::ListContractKvValue(const uint256& hashFork, const uint256& hashContractRoot, const uint256& keyStart, const uint32 nLimit, std::vector<std::pair<uint256, bytes>>& vContractKv, uint256& keyNext)
+{
+    CReadLock rlock(rwAccess);
+
+    auto it = mapContractDB.find(hashFork);
+    if (it != mapContractDB.end())
+    {
+        return it->second->ListContractKvValue(hashContractRoot, keyStart, nLimit, vContractKv, keyNext);
+    }
+    return false;
+}
+
 bool CContractDB::ClearContractKvRootUnavailableNode(const uint256& hashFork, const uint32 nRemoveLastHeight, bool& fExit)
 {
     CReadLock rlock(rwAccess);
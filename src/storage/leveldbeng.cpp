@@ -4,6 +4,7 @@
 
 #include "leveldbeng.h"
 
+#include <algorithm>
 #include <boost/filesystem/path.hpp>
 
 #include "leveldb/cache.h"
@@ -27,6 +28,65 @@ CLevelDBArguments::~CLevelDBArguments()
 {
 }
 
+//////////////////////////////
+// CLevelDBCursor
+
+CLevelDBCursor::CLevelDBCursor(leveldb::DB* pdbIn, const leveldb::ReadOptions& readoptionsIn)
+  : pdb(pdbIn), psnapshot(pdbIn->GetSnapshot())
+{
+    leveldb::ReadOptions options = readoptionsIn;
+    options.snapshot = psnapshot;
+    // range scans should not evict the point lookup working set from block cache
+    options.fill_cache = false;
+    piter = pdb->NewIterator(options);
+}
+
+CLevelDBCursor::~CLevelDBCursor()
+{
+    delete piter;
+    piter = nullptr;
+    pdb->ReleaseSnapshot(psnapshot);
+}
+
+bool CLevelDBCursor::MoveFirst()
+{
+    if (piter == nullptr)
+    {
+        return false;
+    }
+    piter->SeekToFirst();
+    return true;
+}
+
+bool CLevelDBCursor::MoveTo(CBufStream& ssKey)
+{
+    if (piter == nullptr)
+    {
+        return false;
+    }
+    piter->Seek(leveldb::Slice(ssKey.GetData(), ssKey.GetSize()));
+    return true;
+}
+
+bool CLevelDBCursor::MoveNext(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (piter == nullptr || !piter->Valid())
+        return false;
+
+    leveldb::Slice slKey = piter->key();
+    leveldb::Slice slValue = piter->value();
+
+    ssKey.Write(slKey.data(), slKey.size());
+    ssValue.Write(slValue.data(), slValue.size());
+
+    piter->Next();
+
+    return true;
+}
+
+//////////////////////////////
+// CLevelDBEngine
+
 CLevelDBEngine::CLevelDBEngine(CLevelDBArguments& arguments)
   : path(arguments.path)
 {
@@ -221,5 +281,80 @@ bool CLevelDBEngine::MoveNext(CBufStream& ssKey, CBufStream& ssValue)
     return true;
 }
 
+bool CLevelDBEngine::IsConcurrentRead() const
+{
+    return true;
+}
+
+CKVDBCursor* CLevelDBEngine::NewCursor()
+{
+    if (pdb == nullptr)
+    {
+        return nullptr;
+    }
+    return new CLevelDBCursor(pdb, readoptions);
+}
+
+bool CLevelDBEngine::MultiGet(const std::vector<bytes>& vKey, CKVDBMultiValue& mvValue)
+{
+    // Keys are visited in sorted order through one snapshot iterator, so keys
+    // sharing a prefix (receipts of one block, trie nodes of one level) are read
+    // from the same data blocks with Next() instead of independent seeks.
+    const int MAX_SCAN_NEXT = 8;
+
+    mvValue.Reset(vKey.size());
+    if (vKey.empty())
+    {
+        return true;
+    }
+
+    std::vector<std::size_t> vOrder(vKey.size());
+    for (std::size_t i = 0; i < vOrder.size(); i++)
+    {
+        vOrder[i] = i;
+    }
+    std::sort(vOrder.begin(), vOrder.end(), [&](const std::size_t a, const std::size_t b) { return vKey[a] < vKey[b]; });
+
+    const leveldb::Snapshot* psnapshot = pdb->GetSnapshot();
+    leveldb::ReadOptions options = readoptions;
+    options.snapshot = psnapshot;
+    leveldb::Iterator* pit = pdb->NewIterator(options);
+
+    bool fSeek = true;
+    for (const std::size_t nIndex : vOrder)
+    {
+        const leveldb::Slice slKey((const char*)vKey[nIndex].data(), vKey[nIndex].size());
+        if (!fSeek)
+        {
+            int n = 0;
+            while (pit->Valid() && pit->key().compare(slKey) < 0 && n++ < MAX_SCAN_NEXT)
+            {
+                pit->Next();
+            }
+            fSeek = (pit->Valid() && pit->key().compare(slKey) < 0);
+        }
+        if (fSeek)
+        {
+            pit->Seek(slKey);
+        }
+        if (!pit->Valid())
+        {
+            // no key at or after this one, later keys in the order are missing too
+            break;
+        }
+        if (pit->key().compare(slKey) == 0)
+        {
+            const leveldb::Slice slValue = pit->value();
+            mvValue.SetValue(nIndex, slValue.data(), slValue.size());
+        }
+        fSeek = false;
+    }
+
+    bool fRet = pit->status().ok();
+    delete pit;
+    pdb->ReleaseSnapshot(psnapshot);
+    return fRet;
+}
+
 } // namespace storage
 } // namespace hashahead
@@ -28,6 +28,22 @@ public:
     int files;
 };
 
+class CLevelDBCursor : public hnbase::CKVDBCursor
+{
+public:
+    CLevelDBCursor(leveldb::DB* pdbIn, const leveldb::ReadOptions& readoptionsIn);
+    ~CLevelDBCursor();
+
+    bool MoveFirst() override;
+    bool MoveTo(hnbase::CBufStream& ssKey) override;
+    bool MoveNext(hnbase::CBufStream& ssKey, hnbase::CBufStream& ssValue) override;
+
+protected:
+    leveldb::DB* pdb;
+    const leveldb::Snapshot* psnapshot;
+    leveldb::Iterator* piter;
+};
+
 class CLevelDBEngine : public hnbase::CKVDBEngine
 {
 public:
@@ -46,6 +62,9 @@ public:
     bool MoveFirst() override;
     bool MoveTo(hnbase::CBufStream& ssKey) override;
     bool MoveNext(hnbase::CBufStream& ssKey, hnbase::CBufStream& ssValue) override;
+    bool IsConcurrentRead() const override;
+    hnbase::CKVDBCursor* NewCursor() override;
+    bool MultiGet(const std::vector<bytes>& vKey, hnbase::CKVDBMultiValue& mvValue) override;
 
 protected:
     std::string path;
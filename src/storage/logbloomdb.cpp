@@ -0,0 +1,602 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "logbloomdb.h"
+
+#include "bloomfilter/bloomfilter.h"
+#include "leveldbeng.h"
+
+using namespace std;
+using namespace hnbase;
+
+namespace hashahead
+{
+namespace storage
+{
+
+const uint8 DB_LOGBLOOM_KEY_NAME_BLOCK = 0x01;
+const uint8 DB_LOGBLOOM_KEY_NAME_SECTION = 0x02;
+const uint8 DB_LOGBLOOM_KEY_NAME_ROW = 0x03;
+
+//////////////////////////////
+// CLogBloomMatcher
+
+CLogBloomMatcher::CLogBloomMatcher(const CLogsFilter& logsFilter)
+{
+    if (!logsFilter.setAddress.empty())
+    {
+        std::vector<std::vector<uint16>> vAlternative;
+        for (const CDestination& dest : logsFilter.setAddress)
+        {
+            std::vector<uint16> vBit;
+            GetElementBits(dest.begin(), dest.size(), vBit);
+            vAlternative.push_back(vBit);
+        }
+        vGroup.push_back(vAlternative);
+    }
+    for (const std::set<uint256>& setTopics : logsFilter.arrayTopics)
+    {
+        // a zero topic is a wildcard, same as CLogsFilter::matchesLogs
+        if (setTopics.empty() || *setTopics.begin() == 0)
+        {
+            continue;
+        }
+        std::vector<std::vector<uint16>> vAlternative;
+        for (const uint256& topic : setTopics)
+        {
+            std::vector<uint16> vBit;
+            GetElementBits(topic.begin(), topic.size(), vBit);
+            vAlternative.push_back(vBit);
+        }
+        vGroup.push_back(vAlternative);
+    }
+}
+
+bool CLogBloomMatcher::IsMatchAll() const
+{
+    return vGroup.empty();
+}
+
+bool CLogBloomMatcher::Match(const uint2048& nLogsBloom) const
+{
+    const unsigned char* pBloom = nLogsBloom.begin();
+    for (const auto& vAlternative : vGroup)
+    {
+        bool fGroupMatch = false;
+        for (const auto& vBit : vAlternative)
+        {
+            bool fMatch = true;
+            for (const uint16 nBit : vBit)
+            {
+                if ((pBloom[nBit / 8] & (0x01 << (nBit % 8))) == 0)
+                {
+                    fMatch = false;
+                    break;
+                }
+            }
+            if (fMatch)
+            {
+                fGroupMatch = true;
+                break;
+            }
+        }
+        if (!fGroupMatch)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CLogBloomMatcher::GetBitIndexes(std::set<uint16>& setBit) const
+{
+    for (const auto& vAlternative : vGroup)
+    {
+        for (const auto& vBit : vAlternative)
+        {
+            setBit.insert(vBit.begin(), vBit.end());
+        }
+    }
+}
+
+void CLogBloomMatcher::MatchSection(const std::map<uint16, bytes>& mapRow, bytes& btMatch) const
+{
+    btMatch.assign(LOG_BLOOM_SECTION_ROW_BYTES, 0xFF);
+    bytes btGroup;
+    bytes btAlternative;
+    for (const auto& vAlternative : vGroup)
+    {
+        btGroup.assign(LOG_BLOOM_SECTION_ROW_BYTES, 0);
+        for (const auto& vBit : vAlternative)
+        {
+            btAlternative.assign(LOG_BLOOM_SECTION_ROW_BYTES, 0xFF);
+            for (const uint16 nBit : vBit)
+            {
+                auto it = mapRow.find(nBit);
+                if (it == mapRow.end() || it->second.size() != LOG_BLOOM_SECTION_ROW_BYTES)
+                {
+                    btAlternative.assign(LOG_BLOOM_SECTION_ROW_BYTES, 0);
+                    break;
+                }
+                for (std::size_t i = 0; i < LOG_BLOOM_SECTION_ROW_BYTES; i++)
+                {
+                    btAlternative[i] &= it->second[i];
+                }
+            }
+            for (std::size_t i = 0; i < LOG_BLOOM_SECTION_ROW_BYTES; i++)
+            {
+                btGroup[i] |= btAlternative[i];
+            }
+        }
+        for (std::size_t i = 0; i < LOG_BLOOM_SECTION_ROW_BYTES; i++)
+        {
+            btMatch[i] &= btGroup[i];
+        }
+    }
+}
+
+void CLogBloomMatcher::GetElementBits(const unsigned char* pData, const std::size_t nSize, std::vector<uint16>& vBit)
+{
+    // same hashing as CTransactionLogs::GetLogsBloom
+    CNhBloomFilter bf(LOG_BLOOM_BITS);
+    bf.Add(pData, nSize);
+    const bytes btBloom = bf.GetData();
+    for (std::size_t i = 0; i < btBloom.size(); i++)
+    {
+        for (std::size_t j = 0; j < 8; j++)
+        {
+            if (btBloom[i] & (0x01 << j))
+            {
+                vBit.push_back((uint16)(i * 8 + j));
+            }
+        }
+    }
+}
+
+//////////////////////////////
+// CLogBloomSectionBuilder
+
+CLogBloomSectionBuilder::CLogBloomSectionBuilder()
+  : vRow(LOG_BLOOM_BITS, bytes(LOG_BLOOM_SECTION_ROW_BYTES, 0))
+{
+}
+
+void CLogBloomSectionBuilder::AddBloom(const uint32 nOffset, const uint2048& nLogsBloom)
+{
+    if (nOffset >= LOG_BLOOM_SECTION_SIZE)
+    {
+        return;
+    }
+    const unsigned char* pBloom = nLogsBloom.begin();
+    for (std::size_t i = 0; i < LOG_BLOOM_BITS / 8; i++)
+    {
+        if (pBloom[i] == 0)
+        {
+            continue;
+        }
+        for (std::size_t j = 0; j < 8; j++)
+        {
+            if (pBloom[i] & (0x01 << j))
+            {
+                vRow[i * 8 + j][nOffset / 8] |= (0x01 << (nOffset % 8));
+            }
+        }
+    }
+}
+
+void CLogBloomSectionBuilder::GetRows(std::map<uint16, bytes>& mapRow) const
+{
+    for (std::size_t i = 0; i < vRow.size(); i++)
+    {
+        const bytes& btRow = vRow[i];
+        if (std::any_of(btRow.begin(), btRow.end(), [](const unsigned char c) { return c != 0; }))
+        {
+            mapRow[(uint16)i] = btRow;
+        }
+    }
+}
+
+//////////////////////////////
+// CForkLogBloomDB
+
+CForkLogBloomDB::CForkLogBloomDB()
+{
+}
+
+CForkLogBloomDB::~CForkLogBloomDB()
+{
+}
+
+bool CForkLogBloomDB::Initialize(const uint256& hashForkIn, const boost::filesystem::path& pathData)
+{
+    CLevelDBArguments args;
+    args.path = pathData.string();
+    args.syncwrite = false;
+    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    if (!Open(engine))
+    {
+        StdLog("CForkLogBloomDB", "Open db fail");
+        delete engine;
+        return false;
+    }
+    hashFork = hashForkIn;
+    return true;
+}
+
+void CForkLogBloomDB::Deinitialize()
+{
+    Close();
+}
+
+bool CForkLogBloomDB::AddBlockBloom(const uint256& hashBlock, const uint2048& nLogsBloom)
+{
+    CWriteLock wlock(rwAccess);
+
+    hnbase::CBufStream ssKey, ssValue;
+    ssKey << DB_LOGBLOOM_KEY_NAME_BLOCK << hashBlock;
+    ssValue << bytes(nLogsBloom.begin(), nLogsBloom.end());
+    return Write(ssKey, ssValue);
+}
+
+bool CForkLogBloomDB::RetrieveBlockBlooms(const std::vector<uint256>& vBlockHash, std::vector<uint2048>& vBloom, std::vector<bool>& vFound)
+{
+    CReadLock rlock(rwAccess);
+
+    vBloom.assign(vBlockHash.size(), uint2048());
+    vFound.assign(vBlockHash.size(), false);
+
+    std::vector<bytes> vKey;
+    vKey.reserve(vBlockHash.size());
+    for (const uint256& hashBlock : vBlockHash)
+    {
+        hnbase::CBufStream ssKey;
+        ssKey << DB_LOGBLOOM_KEY_NAME_BLOCK << hashBlock;
+        vKey.push_back(ssKey.GetBytes());
+    }
+
+    CKVDBMultiValue mvValue;
+    if (!MultiRead(vKey, mvValue))
+    {
+        return false;
+    }
+
+    try
+    {
+        for (std::size_t i = 0; i < vBlockHash.size(); i++)
+        {
+            bytes btBloom;
+            if (mvValue.GetValue(i, btBloom) && btBloom.size() == LOG_BLOOM_BITS / 8)
+            {
+                vBloom[i] = uint2048(btBloom);
+                vFound[i] = true;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CForkLogBloomDB::AddSection(const uint256& hashSectionLast, const std::map<uint16, bytes>& mapRow)
+{
+    CWriteLock wlock(rwAccess);
+    if (!TxnBegin())
+    {
+        return false;
+    }
+
+    for (const auto& kv : mapRow)
+    {
+        hnbase::CBufStream ssKey, ssValue;
+        ssKey << DB_LOGBLOOM_KEY_NAME_ROW << hashSectionLast << kv.first;
+        ssValue << kv.second;
+        if (!Write(ssKey, ssValue))
+        {
+            TxnAbort();
+            return false;
+        }
+    }
+
+    hnbase::CBufStream ssKey, ssValue;
+    ssKey << DB_LOGBLOOM_KEY_NAME_SECTION << hashSectionLast;
+    ssValue << (uint16)mapRow.size();
+    if (!Write(ssKey, ssValue))
+    {
+        TxnAbort();
+        return false;
+    }
+
+    if (!TxnCommit())
+    {
+        TxnAbort();
+        return false;
+    }
+    return true;
+}
+
+bool CForkLogBloomDB::ExistSection(const uint256& hashSectionLast)
+{
+    CReadLock rlock(rwAccess);
+
+    hnbase::CBufStream ssKey, ssValue;
+    ssKey << DB_LOGBLOOM_KEY_NAME_SECTION << hashSectionLast;
+    return Read(ssKey, ssValue);
+}
+
+bool CForkLogBloomDB::RetrieveSectionRows(const uint256& hashSectionLast, const std::set<uint16>& setBit, std::map<uint16, bytes>& mapRow)
+{
+    CReadLock rlock(rwAccess);
+
+    std::vector<bytes> vKey;
+    std::vector<uint16> vBit(setBit.begin(), setBit.end());
+    vKey.reserve(vBit.size());
+    for (const uint16 nBit : vBit)
+    {
+        hnbase::CBufStream ssKey;
+        ssKey << DB_LOGBLOOM_KEY_NAME_ROW << hashSectionLast << nBit;
+        vKey.push_back(ssKey.GetBytes());
+    }
+
+    CKVDBMultiValue mvValue;
+    if (!MultiRead(vKey, mvValue))
+    {
+        return false;
+    }
+
+    try
+    {
+        for (std::size_t i = 0; i < vBit.size(); i++)
+        {
+            bytes btRow;
+            if (mvValue.GetValue(i, btRow))
+            {
+                mapRow[vBit[i]] = btRow;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////
+// CLogBloomDB
+
+bool CLogBloomDB::Initialize(const boost::filesystem::path& pathData)
+{
+    pathLogBloom = pathData / "logbloom";
+
+    if (!boost::filesystem::exists(pathLogBloom))
+    {
+        boost::filesystem::create_directories(pathLogBloom);
+    }
+
+    if (!boost::filesystem::is_directory(pathLogBloom))
+    {
+        return false;
+    }
+    return true;
+}
+
+void CLogBloomDB::Deinitialize()
+{
+    CWriteLock wlock(rwAccess);
+    mapLogBloomDB.clear();
+}
+
+bool CLogBloomDB::ExistFork(const uint256& hashFork)
+{
+    CReadLock rlock(rwAccess);
+    return (mapLogBloomDB.find(hashFork) != mapLogBloomDB.end());
+}
+
+bool CLogBloomDB::LoadFork(const uint256& hashFork)
+{
+    CWriteLock wlock(rwAccess);
+
+    auto it = mapLogBloomDB.find(hashFork);
+    if (it != mapLogBloomDB.end())
+    {
+        return true;
+    }
+
+    std::shared_ptr<CForkLogBloomDB> spLogBloom(new CForkLogBloomDB());
+    if (spLogBloom == nullptr)
+    {
+        return false;
+    }
+    if (!spLogBloom->Initialize(hashFork, pathLogBloom / hashFork.GetHex()))
+    {
+        return false;
+    }
+    mapLogBloomDB.insert(make_pair(hashFork, spLogBloom));
+    return true;
+}
+
+void CLogBloomDB::RemoveFork(const uint256& hashFork)
+{
+    CWriteLock wlock(rwAccess);
+
+    auto it = mapLogBloomDB.find(hashFork);
+    if (it != mapLogBloomDB.end())
+    {
+        it->second->RemoveAll();
+        mapLogBloomDB.erase(it);
+    }
+
+    boost::filesystem::path forkPath = pathLogBloom / hashFork.GetHex();
+    if (boost::filesystem::exists(forkPath))
+    {
+        boost::filesystem::remove_all(forkPath);
+    }
+}
+
+bool CLogBloomDB::AddNewFork(const uint256& hashFork)
+{
+    RemoveFork(hashFork);
+    return LoadFork(hashFork);
+}
+
+void CLogBloomDB::Clear()
+{
+    CWriteLock wlock(rwAccess);
+
+    auto it = mapLogBloomDB.begin();
+    while (it != mapLogBloomDB.end())
+    {
+        it->second->RemoveAll();
+        mapLogBloomDB.erase(it++);
+    }
+}
+
+bool CLogBloomDB::AddBlockBloom(const uint256& hashFork, const uint256& hashBlock, const uint2048& nLogsBloom)
+{
+    std::shared_ptr<CForkLogBloomDB> spLogBloom = GetForkDB(hashFork);
+    if (spLogBloom == nullptr)
+    {
+        return false;
+    }
+    return spLogBloom->AddBlockBloom(hashBlock, nLogsBloom);
+}
+
+bool CLogBloomDB::FilterBlocks(const uint256& hashFork, const CLogsFilter& logsFilter, const std::vector<std::pair<uint64, uint256>>& vBlock, std::vector<uint256>& vMatchBlock)
+{
+    CLogBloomMatcher matcher(logsFilter);
+    std::shared_ptr<CForkLogBloomDB> spLogBloom = GetForkDB(hashFork);
+    if (matcher.IsMatchAll() || spLogBloom == nullptr)
+    {
+        for (const auto& kv : vBlock)
+        {
+            vMatchBlock.push_back(kv.second);
+        }
+        return true;
+    }
+
+    std::size_t nBegin = 0;
+    while (nBegin < vBlock.size())
+    {
+        const uint64 nNumber = vBlock[nBegin].first;
+        const std::size_t nEnd = std::min(vBlock.size(), (std::size_t)(nBegin + LOG_BLOOM_SECTION_SIZE - nNumber % LOG_BLOOM_SECTION_SIZE));
+        if (nNumber % LOG_BLOOM_SECTION_SIZE == 0 && nEnd - nBegin == LOG_BLOOM_SECTION_SIZE
+            && vBlock[nEnd - 1].first == nNumber + LOG_BLOOM_SECTION_SIZE - 1
+            && FilterSection(*spLogBloom, matcher, vBlock, nBegin, vMatchBlock))
+        {
+            nBegin = nEnd;
+            continue;
+        }
+        FilterBlockBlooms(*spLogBloom, matcher, vBlock, nBegin, nEnd, vMatchBlock);
+        nBegin = nEnd;
+    }
+    return true;
+}
+
+//------------------------------------------
+std::shared_ptr<CForkLogBloomDB> CLogBloomDB::GetForkDB(const uint256& hashFork)
+{
+    CReadLock rlock(rwAccess);
+
+    auto it = mapLogBloomDB.find(hashFork);
+    if (it == mapLogBloomDB.end())
+    {
+        return nullptr;
+    }
+    return it->second;
+}
+
+bool CLogBloomDB::FilterSection(CForkLogBloomDB& db, const CLogBloomMatcher& matcher, const std::vector<std::pair<uint64, uint256>>& vBlock, const std::size_t nBegin, std::vector<uint256>& vMatchBlock)
+{
+    const uint256& hashSectionLast = vBlock[nBegin + LOG_BLOOM_SECTION_SIZE - 1].second;
+    std::set<uint16> setBit;
+    matcher.GetBitIndexes(setBit);
+
+    std::map<uint16, bytes> mapRow;
+    if (db.ExistSection(hashSectionLast))
+    {
+        if (!db.RetrieveSectionRows(hashSectionLast, setBit, mapRow))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // first query over this section, transpose the block blooms and keep the rows for next time
+        std::vector<uint256> vBlockHash;
+        vBlockHash.reserve(LOG_BLOOM_SECTION_SIZE);
+        for (std::size_t i = nBegin; i < nBegin + LOG_BLOOM_SECTION_SIZE; i++)
+        {
+            vBlockHash.push_back(vBlock[i].second);
+        }
+        std::vector<uint2048> vBloom;
+        std::vector<bool> vFound;
+        if (!db.RetrieveBlockBlooms(vBlockHash, vBloom, vFound)
+            || std::find(vFound.begin(), vFound.end(), false) != vFound.end())
+        {
+            return false;
+        }
+
+        CLogBloomSectionBuilder builder;
+        for (std::size_t i = 0; i < vBloom.size(); i++)
+        {
+            builder.AddBloom(i, vBloom[i]);
+        }
+        std::map<uint16, bytes> mapAllRow;
+        builder.GetRows(mapAllRow);
+        if (!db.AddSection(hashSectionLast, mapAllRow))
+        {
+            StdLog("CLogBloomDB", "Filter section: Add section fail, section last block: %s", hashSectionLast.ToString().c_str());
+        }
+        for (const uint16 nBit : setBit)
+        {
+            auto it = mapAllRow.find(nBit);
+            if (it != mapAllRow.end())
+            {
+                mapRow.insert(*it);
+            }
+        }
+    }
+
+    bytes btMatch;
+    matcher.MatchSection(mapRow, btMatch);
+    for (std::size_t i = 0; i < LOG_BLOOM_SECTION_SIZE; i++)
+    {
+        if (btMatch[i / 8] & (0x01 << (i % 8)))
+        {
+            vMatchBlock.push_back(vBlock[nBegin + i].second);
+        }
+    }
+    return true;
+}
+
+void CLogBloomDB::FilterBlockBlooms(CForkLogBloomDB& db, const CLogBloomMatcher& matcher, const std::vector<std::pair<uint64, uint256>>& vBlock, const std::size_t nBegin, const std::size_t nEnd, std::vector<uint256>& vMatchBlock)
+{
+    std::vector<uint256> vBlockHash;
+    vBlockHash.reserve(nEnd - nBegin);
+    for (std::size_t i = nBegin; i < nEnd; i++)
+    {
+        vBlockHash.push_back(vBlock[i].second);
+    }
+    std::vector<uint2048> vBloom;
+    std::vector<bool> vFound;
+    if (!db.RetrieveBlockBlooms(vBlockHash, vBloom, vFound))
+    {
+        vFound.assign(vBlockHash.size(), false);
+    }
+    for (std::size_t i = 0; i < vBlockHash.size(); i++)
+    {
+        // blocks without a stored bloom are kept, their receipts decide
+        if (!vFound[i] || matcher.Match(vBloom[i]))
+        {
+            vMatchBlock.push_back(vBlockHash[i]);
+        }
+    }
+}
+
+} // namespace storage
+} // namespace hashahead
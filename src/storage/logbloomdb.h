@@ -0,0 +1,109 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef STORAGE_LOGBLOOMDB_H
+#define STORAGE_LOGBLOOMDB_H
+
+#include <boost/thread/thread.hpp>
+
+#include "hnbase.h"
+#include "transaction.h"
+
+namespace hashahead
+{
+namespace storage
+{
+
+enum
+{
+    LOG_BLOOM_BITS = 2048,
+    LOG_BLOOM_SECTION_SIZE = 4096,
+    LOG_BLOOM_SECTION_ROW_BYTES = LOG_BLOOM_SECTION_SIZE / 8
+};
+
+// Filter addresses and topics reduced to bloom bit positions
+class CLogBloomMatcher
+{
+public:
+    CLogBloomMatcher(const CLogsFilter& logsFilter);
+
+    bool IsMatchAll() const;
+    bool Match(const uint2048& nLogsBloom) const;
+    void GetBitIndexes(std::set<uint16>& setBit) const;
+    // mapRow: bit index -> section row, missing rows are all zero; btMatch: one bit per block of the section
+    void MatchSection(const std::map<uint16, bytes>& mapRow, bytes& btMatch) const;
+
+    static void GetElementBits(const unsigned char* pData, const std::size_t nSize, std::vector<uint16>& vBit);
+
+protected:
+    // AND across groups, OR across the alternatives of a group, AND across the bits of an alternative
+    std::vector<std::vector<std::vector<uint16>>> vGroup;
+};
+
+// Transposes the blooms of one section into one row per bloom bit
+class CLogBloomSectionBuilder
+{
+public:
+    CLogBloomSectionBuilder();
+
+    void AddBloom(const uint32 nOffset, const uint2048& nLogsBloom);
+    void GetRows(std::map<uint16, bytes>& mapRow) const;
+
+protected:
+    std::vector<bytes> vRow;
+};
+
+class CForkLogBloomDB : public hnbase::CKVDB
+{
+public:
+    CForkLogBloomDB();
+    ~CForkLogBloomDB();
+
+    bool Initialize(const uint256& hashForkIn, const boost::filesystem::path& pathData);
+    void Deinitialize();
+
+    bool AddBlockBloom(const uint256& hashBlock, const uint2048& nLogsBloom);
+    // vFound[i] is false when the block was saved before the index existed
+    bool RetrieveBlockBlooms(const std::vector<uint256>& vBlockHash, std::vector<uint2048>& vBloom, std::vector<bool>& vFound);
+    bool AddSection(const uint256& hashSectionLast, const std::map<uint16, bytes>& mapRow);
+    bool ExistSection(const uint256& hashSectionLast);
+    bool RetrieveSectionRows(const uint256& hashSectionLast, const std::set<uint16>& setBit, std::map<uint16, bytes>& mapRow);
+
+protected:
+    uint256 hashFork;
+    hnbase::CRWAccess rwAccess;
+};
+
+class CLogBloomDB
+{
+public:
+    CLogBloomDB() {}
+    bool Initialize(const boost::filesystem::path& pathData);
+    void Deinitialize();
+
+    bool ExistFork(const uint256& hashFork);
+    bool LoadFork(const uint256& hashFork);
+    void RemoveFork(const uint256& hashFork);
+    bool AddNewFork(const uint256& hashFork);
+    void Clear();
+
+    bool AddBlockBloom(const uint256& hashFork, const uint256& hashBlock, const uint2048& nLogsBloom);
+    // vBlock: (block number, block hash) of one chain in ascending order, vMatchBlock: blocks that may hold matching logs
+    bool FilterBlocks(const uint256& hashFork, const CLogsFilter& logsFilter, const std::vector<std::pair<uint64, uint256>>& vBlock, std::vector<uint256>& vMatchBlock);
+
+protected:
+    std::shared_ptr<CForkLogBloomDB> GetForkDB(const uint256& hashFork);
+    bool FilterSection(CForkLogBloomDB& db, const CLogBloomMatcher& matcher, const std::vector<std::pair<uint64, uint256>>& vBlock, const std::size_t nBegin, std::vector<uint256>& vMatchBlock);
+    void FilterBlockBlooms(CForkLogBloomDB& db, const CLogBloomMatcher& matcher, const std::vector<std::pair<uint64, uint256>>& vBlock, const std::size_t nBegin, const std::size_t nEnd, std::vector<uint256>& vMatchBlock);
+
+protected:
+    boost::filesystem::path pathLogBloom;
+    hnbase::CRWAccess rwAccess;
+    std::map<uint256, std::shared_ptr<CForkLogBloomDB>> mapLogBloomDB;
+};
+
+} // namespace storage
+} // namespace hashahead
+
+#endif //STORAGE_LOGBLOOMDB_H
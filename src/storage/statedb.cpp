@@ -73,7 +73,7 @@ CForkStateDB::~CForkStateDB()
 
 bool CForkStateDB::Initialize(const boost::filesystem::path& pathData, const bool fPruneIn)
 {
-    if (!dbTrie.Initialize(pathData))
+    if (!dbTrie.Initialize(pathData, fPruneIn))
     {
         return false;
     }
@@ -111,7 +111,7 @@ bool CForkStateDB::AddBlockState(const uint32 nBlockHeight, const uint256& hashP
     }
     AddPrevRoot(hashPrevRoot, statusBlockRoot, mapKv);
 
-    if (!dbTrie.AddNewTrie(hashPrevRoot, mapKv, hashBlockRoot))
+    if (!dbTrie.AddNewTrie(hashPrevRoot, mapKv, hashBlockRoot, nBlockHeight))
     {
         StdLog("CForkStateDB", "Add block state: Add new trie failed, prev root: %s", hashPrevRoot.ToString().c_str());
         return false;
@@ -199,8 +199,17 @@ bool CForkStateDB::VerifyState(const uint256& hashRoot, const bool fVerifyAllNod
     return true;
 }
 
-bool CForkStateDB::ClearStateUnavailableNode(const uint32 nClearRefHeight)
+bool CForkStateDB::ClearStateUnavailableNode(const uint32 nClearRefHeight, const uint64 nMaxNodeCount, CTriePruneStat& statPrune)
 {
+    if (!fPrune)
+    {
+        return false;
+    }
+    if (!dbTrie.PruneJournal(nClearRefHeight, nMaxNodeCount, statPrune))
+    {
+        StdLog("CForkStateDB", "Clear state unavailable node: Prune journal failed, clear height: %d", nClearRefHeight);
+        return false;
+    }
     return true;
 }
 
@@ -211,7 +220,12 @@ bool CForkStateDB::ListStateRootKv(std::vector<std::pair<uint256, bytesmap>>& vR
 
 bool CForkStateDB::AddStateKvTrie(const uint32 nBlockHeight, const uint256& hashPrevRoot, const bytesmap& mapKv, uint256& hashNewRoot)
 {
-    return dbTrie.AddNewTrie(hashPrevRoot, mapKv, hashNewRoot);
+    if (!dbTrie.AddNewTrie(hashPrevRoot, mapKv, hashNewRoot, nBlockHeight))
+    {
+        StdLog("CForkStateDB", "Add state kv trie: Add new trie failed, prev root: %s", hashPrevRoot.ToString().c_str());
+        return false;
+    }
+    return true;
 }
 
 //-------------------------------------------------------------------------------------------
@@ -403,14 +417,14 @@ bool CStateDB::VerifyState(const uint256& hashFork, const uint256& hashRoot, con
     return false;
 }
 
-bool CStateDB::ClearStateUnavailableNode(const uint256& hashFork, const uint32 nClearRefHeight)
+bool CStateDB::ClearStateUnavailableNode(const uint256& hashFork, const uint32 nClearRefHeight, const uint64 nMaxNodeCount, CTriePruneStat& statPrune)
 {
     CReadLock rlock(rwAccess);
 
     auto it = mapStateDB.find(hashFork);
     if (it != mapStateDB.end())
     {
-        return it->second->ClearStateUnavailableNode(nClearRefHeight);
+        return it->second->ClearStateUnavailableNode(nClearRefHeight, nMaxNodeCount, statPrune);
     }
     return false;
 }
@@ -45,7 +45,7 @@ public:
     bool RetrieveDestState(const uint256& hashBlockRoot, const CDestination& dest, CDestState& state);
     bool ListDestState(const uint256& hashBlockRoot, std::map<CDestination, CDestState>& mapBlockState);
     bool VerifyState(const uint256& hashRoot, const bool fVerifyAllNode = true);
-    bool ClearStateUnavailableNode(const uint32 nClearRefHeight);
+    bool ClearStateUnavailableNode(const uint32 nClearRefHeight, const uint64 nMaxNodeCount, CTriePruneStat& statPrune);
 
     bool ListStateRootKv(std::vector<std::pair<uint256, bytesmap>>& vRootKv);
     bool AddStateKvTrie(const uint32 nBlockHeight, const uint256& hashPrevRoot, const bytesmap& mapKv, uint256& hashNewRoot);
@@ -80,7 +80,7 @@ public:
     bool RetrieveDestState(const uint256& hashFork, const uint256& hashBlockRoot, const CDestination& dest, CDestState& state);
     bool ListDestState(const uint256& hashFork, const uint256& hashBlockRoot, std::map<CDestination, CDestState>& mapBlockState);
     bool VerifyState(const uint256& hashFork, const uint256& hashRoot, const bool fVerifyAllNode = true);
-    bool ClearStateUnavailableNode(const uint256& hashFork, const uint32 nClearRefHeight);
+    bool ClearStateUnavailableNode(const uint256& hashFork, const uint32 nClearRefHeight, const uint64 nMaxNodeCount, CTriePruneStat& statPrune);
 
     bool ListStateRootKv(const uint256& hashFork, std::vector<std::pair<uint256, bytesmap>>& vRootKv);
     bool AddStateKvTrie(const uint256& hashFork, const uint32 nBlockHeight, const uint256& hashPrevRoot, const bytesmap& mapKv, uint256& hashNewRoot);
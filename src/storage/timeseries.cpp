@@ -4,6 +4,17 @@
 
 #include "timeseries.h"
 
+#include <boost/bind.hpp>
+
+#if defined(WIN32) || defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 using namespace hnbase;
 
@@ -14,6 +25,318 @@ namespace hashahead
 namespace storage
 {
 
+//////////////////////////////
+// CTimeSeriesSyncPolicy
+
+bool CTimeSeriesSyncPolicy::Parse(const string& strPolicy)
+{
+    if (strPolicy.empty() || strPolicy == "none")
+    {
+        nMode = SYNC_NONE;
+        nParam = 0;
+        return true;
+    }
+    if (strPolicy == "block")
+    {
+        nMode = SYNC_RECORD;
+        nParam = 0;
+        return true;
+    }
+    size_t nPos = strPolicy.find(':');
+    if (nPos == string::npos || nPos + 1 >= strPolicy.size()
+        || strPolicy.find_first_not_of("0123456789", nPos + 1) != string::npos)
+    {
+        return false;
+    }
+    const string strMode = strPolicy.substr(0, nPos);
+    const uint64 nValue = strtoull(strPolicy.c_str() + nPos + 1, nullptr, 10);
+    if (nValue == 0 || nValue > 0xFFFFFFFF)
+    {
+        return false;
+    }
+    if (strMode == "ms")
+    {
+        nMode = SYNC_INTERVAL;
+    }
+    else if (strMode == "bytes")
+    {
+        nMode = SYNC_BYTES;
+    }
+    else
+    {
+        return false;
+    }
+    nParam = (uint32)nValue;
+    return true;
+}
+
+//////////////////////////////
+// CTimeSeriesWriter
+
+CTimeSeriesWriter::CTimeSeriesWriter()
+#if defined(WIN32) || defined(_WIN32)
+  : fp(nullptr),
+#else
+  : fd(-1),
+#endif
+    nFile(0), nSize(0), nAllocSize(0), nUnsyncedBytes(0), nLastSyncTime(0)
+{
+}
+
+CTimeSeriesWriter::~CTimeSeriesWriter()
+{
+    Close();
+}
+
+bool CTimeSeriesWriter::Open(const string& strPath, const uint32 nFileIn)
+{
+    Close();
+#if defined(WIN32) || defined(_WIN32)
+    fp = fopen(strPath.c_str(), "ab");
+    if (fp == nullptr)
+    {
+        StdError("TimeSeriesWriter", "Open: fopen fail, file: %s", strPath.c_str());
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long nEnd = ftell(fp);
+#else
+    fd = open(strPath.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0)
+    {
+        StdError("TimeSeriesWriter", "Open: open fail, file: %s, errno: %d", strPath.c_str(), errno);
+        return false;
+    }
+    off_t nEnd = lseek(fd, 0, SEEK_END);
+#endif
+    if (nEnd < 0)
+    {
+        StdError("TimeSeriesWriter", "Open: get file size fail, file: %s", strPath.c_str());
+        Close();
+        return false;
+    }
+    nFile = nFileIn;
+    nSize = (uint32)nEnd;
+    nAllocSize = nSize;
+    nUnsyncedBytes = 0;
+    nLastSyncTime = GetTimeMillis();
+    return true;
+}
+
+void CTimeSeriesWriter::Close()
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+    if (policy.nMode != CTimeSeriesSyncPolicy::SYNC_NONE)
+    {
+        Sync();
+    }
+#if defined(WIN32) || defined(_WIN32)
+    fclose(fp);
+    fp = nullptr;
+#else
+    if (nAllocSize > nSize)
+    {
+        // release the preallocated space beyond the data
+        if (ftruncate(fd, nSize) != 0)
+        {
+            StdError("TimeSeriesWriter", "Close: ftruncate fail, nFile: %d, errno: %d", nFile, errno);
+        }
+    }
+    close(fd);
+    fd = -1;
+#endif
+    nFile = 0;
+    nSize = 0;
+    nAllocSize = 0;
+    nUnsyncedBytes = 0;
+}
+
+bool CTimeSeriesWriter::IsOpen() const
+{
+#if defined(WIN32) || defined(_WIN32)
+    return (fp != nullptr);
+#else
+    return (fd >= 0);
+#endif
+}
+
+bool CTimeSeriesWriter::Append(const vector<pair<const char*, size_t>>& vBuf)
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+    size_t nTotal = 0;
+    for (const auto& buf : vBuf)
+    {
+        nTotal += buf.second;
+    }
+    Preallocate(nTotal);
+
+#if defined(WIN32) || defined(_WIN32)
+    for (const auto& buf : vBuf)
+    {
+        if (fwrite(buf.first, 1, buf.second, fp) != buf.second)
+        {
+            StdError("TimeSeriesWriter", "Append: fwrite fail, nFile: %d", nFile);
+            return false;
+        }
+    }
+    if (fflush(fp) != 0)
+    {
+        StdError("TimeSeriesWriter", "Append: fflush fail, nFile: %d", nFile);
+        return false;
+    }
+#else
+    vector<struct iovec> vIov;
+    vIov.reserve(vBuf.size());
+    for (const auto& buf : vBuf)
+    {
+        if (buf.second > 0)
+        {
+            vIov.push_back({ (void*)buf.first, buf.second });
+        }
+    }
+    size_t nIov = 0;
+    while (nIov < vIov.size())
+    {
+        const int nCount = (int)min(vIov.size() - nIov, (size_t)IOV_MAX);
+        ssize_t nWritten = writev(fd, &vIov[nIov], nCount);
+        if (nWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            StdError("TimeSeriesWriter", "Append: writev fail, nFile: %d, errno: %d", nFile, errno);
+            // drop the partial records, WalkThrough would truncate them on restart anyway
+            if (ftruncate(fd, nSize) != 0)
+            {
+                StdError("TimeSeriesWriter", "Append: ftruncate fail, nFile: %d, errno: %d", nFile, errno);
+            }
+            return false;
+        }
+        while (nWritten > 0 && nIov < vIov.size())
+        {
+            if ((size_t)nWritten >= vIov[nIov].iov_len)
+            {
+                nWritten -= vIov[nIov].iov_len;
+                nIov++;
+            }
+            else
+            {
+                vIov[nIov].iov_base = (char*)vIov[nIov].iov_base + nWritten;
+                vIov[nIov].iov_len -= nWritten;
+                nWritten = 0;
+            }
+        }
+    }
+#endif
+    nSize += (uint32)nTotal;
+    nUnsyncedBytes += nTotal;
+    return true;
+}
+
+bool CTimeSeriesWriter::Commit()
+{
+    switch (policy.nMode)
+    {
+    case CTimeSeriesSyncPolicy::SYNC_RECORD:
+        return Sync();
+    case CTimeSeriesSyncPolicy::SYNC_INTERVAL:
+        if (GetTimeMillis() - nLastSyncTime >= policy.nParam)
+        {
+            return Sync();
+        }
+        break;
+    case CTimeSeriesSyncPolicy::SYNC_BYTES:
+        if (nUnsyncedBytes >= policy.nParam)
+        {
+            return Sync();
+        }
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool CTimeSeriesWriter::Sync()
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+    if (nUnsyncedBytes > 0)
+    {
+#if defined(WIN32) || defined(_WIN32)
+        if (fflush(fp) != 0 || _commit(_fileno(fp)) != 0)
+#elif defined(__linux__)
+        if (fdatasync(fd) != 0)
+#else
+        if (fsync(fd) != 0)
+#endif
+        {
+            StdError("TimeSeriesWriter", "Sync: sync fail, nFile: %d", nFile);
+            return false;
+        }
+        nUnsyncedBytes = 0;
+    }
+    nLastSyncTime = GetTimeMillis();
+    return true;
+}
+
+void CTimeSeriesWriter::Preallocate(const size_t nNeeded)
+{
+#if defined(__linux__)
+    if (nSize + nNeeded <= nAllocSize)
+    {
+        return;
+    }
+    // keep the file size unchanged, so WalkThrough still sees the end of data
+    uint64 nNewAllocSize = nSize + nNeeded + PREALLOC_SIZE;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, nAllocSize, nNewAllocSize - nAllocSize) == 0)
+    {
+        nAllocSize = nNewAllocSize;
+    }
+    else
+    {
+        nAllocSize = nSize + nNeeded;
+    }
+#endif
+}
+
+//////////////////////////////
+// CTimeSeriesMappedFile
+
+CTimeSeriesMappedFile::CTimeSeriesMappedFile()
+{
+}
+
+CTimeSeriesMappedFile::~CTimeSeriesMappedFile()
+{
+}
+
+bool CTimeSeriesMappedFile::Open(const std::string& strPath)
+{
+    try
+    {
+        boost::interprocess::file_mapping fm(strPath.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region mr(fm, boost::interprocess::read_only);
+        fileMapping.swap(fm);
+        mappedRegion.swap(mr);
+    }
+    catch (std::exception& e)
+    {
+        StdError("TimeSeriesMappedFile", "Open: map file fail, file: %s, msg: %s", strPath.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
 //////////////////////////////
 // CTimeSeriesBase
 
@@ -171,6 +494,7 @@ bool CTimeSeriesBase::TruncateFile(const string& pathFile, uint32 nOffset)
 
 bool CTimeSeriesBase::RepairFile(uint32 nFile, uint32 nOffset)
 {
+    ReleaseFile(nFile);
     if (nOffset > 0)
     {
         std::string pathFile;
@@ -194,6 +518,7 @@ bool CTimeSeriesBase::RepairFile(uint32 nFile, uint32 nOffset)
 
 void CTimeSeriesBase::ClearAllFile()
 {
+    ReleaseFile(1);
     fs::remove_all(pathLocation);
     fs::create_directories(pathLocation);
     nLastFile = 1;
@@ -249,18 +574,23 @@ bool CTimeSeriesBase::CopyFileToPath(const uint32 nFile, const uint32 nCopySize,
     return true;
 }
 
+void CTimeSeriesBase::ReleaseFile(const uint32 nBeginFile)
+{
+}
+
 //////////////////////////////
 // CTimeSeriesCached
 
 const uint32 CTimeSeriesCached::nMagicNum = 0x8A5CA1E8;
 
 CTimeSeriesCached::CTimeSeriesCached()
-  : cacheStream(FILE_CACHE_SIZE)
+  : pThreadSync(nullptr), fSyncThreadExit(false), cacheBlock(DEFAULT_CACHE_SIZE, DEFAULT_CACHE_PIN_COUNT, CACHE_SHARD_COUNT), nSealedFile(0)
 {
 }
 
 CTimeSeriesCached::~CTimeSeriesCached()
 {
+    StopSyncThread();
 }
 
 bool CTimeSeriesCached::Initialize(const fs::path& pathLocationIn, const string& strPrefixIn)
@@ -271,19 +601,51 @@ bool CTimeSeriesCached::Initialize(const fs::path& pathLocationIn, const string&
         return false;
     }
 
-    {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
+    ReleaseFile(1);
 
-        ResetCache();
-    }
+    boost::unique_lock<boost::mutex> lock(mtxWriter);
+    nSealedFile = nLastFile - 1;
     return true;
 }
 
 void CTimeSeriesCached::Deinitialize()
 {
-    boost::unique_lock<boost::mutex> lock(mtxCache);
+    StopSyncThread();
+    if (!Sync())
+    {
+        StdError("TimeSeriesCached", "Deinitialize: Sync fail");
+    }
+    ReleaseFile(1);
+}
+
+void CTimeSeriesCached::SetSyncPolicy(const CTimeSeriesSyncPolicy& policy)
+{
+    StopSyncThread();
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWriter);
+        writer.SetSyncPolicy(policy);
+    }
+    // Append only checks the interval when the next record arrives, the thread covers idle periods
+    if (policy.nMode == CTimeSeriesSyncPolicy::SYNC_INTERVAL)
+    {
+        StartSyncThread(policy.nParam);
+    }
+}
+
+bool CTimeSeriesCached::Sync()
+{
+    boost::unique_lock<boost::mutex> lock(mtxWriter);
+    return (!writer.IsOpen() || writer.Sync());
+}
 
-    ResetCache();
+void CTimeSeriesCached::SetCacheParam(const size_t nCacheBytes, const size_t nPinCount)
+{
+    cacheBlock.Reset(nCacheBytes, nPinCount, CACHE_SHARD_COUNT);
+}
+
+void CTimeSeriesCached::GetCacheStat(CBlockCacheStat& stat)
+{
+    cacheBlock.GetStat(stat);
 }
 
 bool CTimeSeriesCached::CopyToPath(const uint32 nLastFile, const uint32 nLastFileSize, const fs::path& pathDst)
@@ -322,6 +684,7 @@ bool CTimeSeriesCached::CopyToPath(const uint32 nLastFile, const uint32 nLastFil
 
 bool CTimeSeriesCached::RecoveryFile(const fs::path& pathSrc)
 {
+    ReleaseFile(1);
     try
     {
         for (const auto& entry : fs::directory_iterator(pathSrc))
@@ -344,36 +707,268 @@ bool CTimeSeriesCached::RecoveryFile(const fs::path& pathSrc)
     return true;
 }
 
-void CTimeSeriesCached::ResetCache()
+bool CTimeSeriesCached::WriteRecord(const char* pData, const vector<uint32>& vSize, vector<CDiskPos>& vPos, vector<uint32>& vCrc, const bool fWriteCache)
 {
-    cacheStream.Clear();
-    mapCachePos.clear();
+    // Writers that arrive while a group is being written queue up, the one at the head
+    // then appends and syncs everything queued as the next group for all of them.
+    CWriteRequest req(pData, vSize);
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWriteQueue);
+        queWrite.push_back(&req);
+        while (!req.fDone && queWrite.front() != &req)
+        {
+            condWriteQueue.wait(lock);
+        }
+    }
+    if (!req.fDone)
+    {
+        boost::unique_lock<boost::mutex> lockWriter(mtxWriter);
+        vector<CWriteRequest*> vGroup;
+        {
+            boost::unique_lock<boost::mutex> lock(mtxWriteQueue);
+            vGroup.assign(queWrite.begin(), queWrite.end());
+        }
+        const bool fResult = AppendGroup(vGroup);
+        {
+            boost::unique_lock<boost::mutex> lock(mtxWriteQueue);
+            for (CWriteRequest* pReq : vGroup)
+            {
+                pReq->fResult = fResult;
+                pReq->fDone = true;
+                queWrite.pop_front();
+            }
+        }
+        condWriteQueue.notify_all();
+    }
+    if (!req.fResult)
+    {
+        return false;
+    }
+
+    const size_t nBeginPos = vPos.size();
+    vPos.insert(vPos.end(), req.vPos.begin(), req.vPos.end());
+    vCrc.insert(vCrc.end(), req.vCrc.begin(), req.vCrc.end());
+    if (fWriteCache)
+    {
+        // newly appended records are the chain tip, keep them pinned
+        const char* p = pData;
+        for (size_t i = 0; i < vSize.size(); i++)
+        {
+            WriteToCache(p, vSize[i], vPos[nBeginPos + i], true);
+            p += vSize[i];
+        }
+    }
+    return true;
 }
 
-bool CTimeSeriesCached::VacateCache(uint32 nNeeded)
+bool CTimeSeriesCached::AppendGroup(const vector<CWriteRequest*>& vGroup)
 {
-    const size_t nHdrSize = 12;
+    const uint32 nHeadSize = sizeof(uint32) * 3;
+    size_t nRecordCount = 0;
+    for (const CWriteRequest* pReq : vGroup)
+    {
+        nRecordCount += pReq->vSize.size();
+    }
+    vector<uint32> vHead(nRecordCount * 3);
+    vector<pair<const char*, size_t>> vBuf;
+    vBuf.reserve(nRecordCount * 2);
 
-    while (cacheStream.GetBufFreeSpace() < nNeeded + nHdrSize)
+    // records that fit into the current file are written together
+    uint32* pHead = vHead.data();
+    uint32 nOffset = 0;
+    for (CWriteRequest* pReq : vGroup)
     {
-        CDiskPos diskpos;
-        uint32 nSize = 0;
+        pReq->vPos.reserve(pReq->vSize.size());
+        pReq->vCrc.reserve(pReq->vSize.size());
+        const char* p = pReq->pData;
+        for (const uint32 nSize : pReq->vSize)
+        {
+            if (!vBuf.empty() && (uint64)nOffset + nHeadSize + nSize > MAX_FILE_SIZE)
+            {
+                if (!writer.Append(vBuf))
+                {
+                    writer.Close();
+                    return false;
+                }
+                vBuf.clear();
+            }
+            if (vBuf.empty())
+            {
+                if (!PrepareWriter(nSize))
+                {
+                    return false;
+                }
+                nOffset = writer.GetSize();
+            }
+            pHead[0] = nMagicNum;
+            pHead[1] = nSize;
+            pHead[2] = hashahead::crypto::crc24q((const unsigned char*)p, (int)nSize);
+            vBuf.push_back(make_pair((const char*)pHead, nHeadSize));
+            vBuf.push_back(make_pair(p, nSize));
 
-        try
+            nOffset += nHeadSize;
+            pReq->vPos.push_back(CDiskPos(writer.GetFile(), nOffset));
+            pReq->vCrc.push_back(pHead[2]);
+            nOffset += nSize;
+            p += nSize;
+            pHead += 3;
+        }
+    }
+    if (!vBuf.empty() && !writer.Append(vBuf))
+    {
+        writer.Close();
+        return false;
+    }
+    if (!writer.Commit())
+    {
+        writer.Close();
+        return false;
+    }
+    return true;
+}
+
+bool CTimeSeriesCached::PrepareWriter(const uint32 nWriteSize)
+{
+    if (writer.IsOpen() && writer.GetFile() == nLastFile
+        && (uint64)writer.GetSize() + nWriteSize + 8 <= MAX_FILE_SIZE)
+    {
+        return true;
+    }
+
+    uint32 nFile;
+    std::string strPath;
+    if (!GetLastFilePath(nFile, strPath, nWriteSize))
+    {
+        return false;
+    }
+    if (nFile > nSealedFile + 1)
+    {
+        nSealedFile = nFile - 1;
+    }
+    if (writer.IsOpen() && writer.GetFile() == nFile)
+    {
+        return true;
+    }
+    return writer.Open(strPath, nFile);
+}
+
+void CTimeSeriesCached::ReleaseFile(const uint32 nBeginFile)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWriter);
+        if (writer.IsOpen() && writer.GetFile() >= nBeginFile)
+        {
+            writer.Close();
+        }
+    }
+    if (nBeginFile > 0 && nSealedFile >= nBeginFile)
+    {
+        nSealedFile = nBeginFile - 1;
+    }
+    cacheBlock.Clear();
+    std::vector<SHP_TS_MAPPED_FILE> vReleased;
+    for (CMappedFileShard& shard : arrayMappedShard)
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(shard.mtxShard);
+        for (auto it = shard.mapFile.lower_bound(nBeginFile); it != shard.mapFile.end(); ++it)
         {
-            cacheStream.Rewind();
-            cacheStream >> diskpos >> nSize;
+            vReleased.push_back(it->second);
         }
-        catch (exception& e)
+        shard.mapFile.erase(shard.mapFile.lower_bound(nBeginFile), shard.mapFile.end());
+    }
+    // Readers hold a mapping only for the duration of one read. The caller may truncate or
+    // remove the files next, so wait until every released mapping is unmapped to avoid SIGBUS.
+    std::vector<std::weak_ptr<CTimeSeriesMappedFile>> vWaitRelease(vReleased.begin(), vReleased.end());
+    vReleased.clear();
+    boost::unique_lock<boost::mutex> lock(mtxMappedRelease);
+    for (const std::weak_ptr<CTimeSeriesMappedFile>& wpMappedFile : vWaitRelease)
+    {
+        while (!wpMappedFile.expired())
         {
-            StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
+            condMappedRelease.wait(lock);
         }
+    }
+}
 
-        mapCachePos.erase(diskpos);
-        cacheStream.Consume(nSize + nHdrSize);
+void CTimeSeriesCached::StartSyncThread(const uint32 nIntervalMs)
+{
+    fSyncThreadExit = false;
+    pThreadSync = new boost::thread(boost::bind(&CTimeSeriesCached::SyncThreadFunc, this, nIntervalMs));
+}
+
+void CTimeSeriesCached::StopSyncThread()
+{
+    if (pThreadSync == nullptr)
+    {
+        return;
     }
-    return true;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxSyncThread);
+        fSyncThreadExit = true;
+    }
+    condSyncThread.notify_all();
+    pThreadSync->join();
+    delete pThreadSync;
+    pThreadSync = nullptr;
+}
+
+void CTimeSeriesCached::SyncThreadFunc(const uint32 nIntervalMs)
+{
+    boost::unique_lock<boost::mutex> lock(mtxSyncThread);
+    while (!fSyncThreadExit)
+    {
+        condSyncThread.wait_for(lock, boost::chrono::milliseconds(nIntervalMs));
+        if (fSyncThreadExit)
+        {
+            break;
+        }
+        lock.unlock();
+        if (!Sync())
+        {
+            StdError("TimeSeriesCached", "Sync thread: Sync fail");
+        }
+        lock.lock();
+    }
+}
+
+SHP_TS_MAPPED_FILE CTimeSeriesCached::GetMappedFile(const uint32 nFile)
+{
+    if (nFile == 0 || nFile > nSealedFile)
+    {
+        return nullptr;
+    }
+    CMappedFileShard& shard = arrayMappedShard[nFile % MAPPED_FILE_SHARD_COUNT];
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(shard.mtxShard);
+        auto it = shard.mapFile.find(nFile);
+        if (it != shard.mapFile.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::string strPath;
+    if (!GetFilePath(nFile, strPath))
+    {
+        return nullptr;
+    }
+    // the last reader to drop a mapping wakes ReleaseFile
+    SHP_TS_MAPPED_FILE ptrMappedFile(new CTimeSeriesMappedFile(), [this](CTimeSeriesMappedFile* pMappedFile) {
+        delete pMappedFile;
+        boost::unique_lock<boost::mutex> lock(mtxMappedRelease);
+        condMappedRelease.notify_all();
+    });
+    if (!ptrMappedFile->Open(strPath))
+    {
+        return nullptr;
+    }
+
+    boost::unique_lock<boost::shared_mutex> wlock(shard.mtxShard);
+    if (nFile > nSealedFile)
+    {
+        return nullptr;
+    }
+    return shard.mapFile.insert(std::make_pair(nFile, ptrMappedFile)).first->second;
 }
 
 //////////////////////////////
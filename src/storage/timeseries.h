@@ -5,9 +5,16 @@
 #ifndef STORAGE_TIMESERIES_H
 #define STORAGE_TIMESERIES_H
 
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <deque>
 #include <hnbase.h>
+#include <memory>
 
 #include "crc24q.h"
 #include "uint256.h"
@@ -63,6 +70,100 @@ public:
     virtual bool Walk(const T& t, uint32 nFile, uint32 nOffset) = 0;
 };
 
+// Read-only memory mapping of a sealed data file
+class CTimeSeriesMappedFile
+{
+public:
+    CTimeSeriesMappedFile();
+    ~CTimeSeriesMappedFile();
+
+    bool Open(const std::string& strPath);
+    const char* GetData() const
+    {
+        return (const char*)mappedRegion.get_address();
+    }
+    std::size_t GetSize() const
+    {
+        return mappedRegion.get_size();
+    }
+
+protected:
+    boost::interprocess::file_mapping fileMapping;
+    boost::interprocess::mapped_region mappedRegion;
+};
+typedef std::shared_ptr<CTimeSeriesMappedFile> SHP_TS_MAPPED_FILE;
+
+class CTimeSeriesSyncPolicy
+{
+public:
+    enum
+    {
+        SYNC_NONE = 0,
+        SYNC_RECORD = 1,
+        SYNC_INTERVAL = 2,
+        SYNC_BYTES = 3
+    };
+    CTimeSeriesSyncPolicy(const uint8 nModeIn = SYNC_NONE, const uint32 nParamIn = 0)
+      : nMode(nModeIn), nParam(nParamIn) {}
+
+    // none | block | ms:<n> | bytes:<n>
+    bool Parse(const std::string& strPolicy);
+
+public:
+    uint8 nMode;
+    uint32 nParam;
+};
+
+// Append-only writer of the active data file, the file is kept open and
+// preallocated, a batch of records is written with one system call and
+// the sync policy is applied once per commit
+class CTimeSeriesWriter
+{
+public:
+    CTimeSeriesWriter();
+    ~CTimeSeriesWriter();
+
+    bool Open(const std::string& strPath, const uint32 nFileIn);
+    void Close();
+    bool IsOpen() const;
+    uint32 GetFile() const
+    {
+        return nFile;
+    }
+    uint32 GetSize() const
+    {
+        return nSize;
+    }
+    void SetSyncPolicy(const CTimeSeriesSyncPolicy& policyIn)
+    {
+        policy = policyIn;
+    }
+    bool Append(const std::vector<std::pair<const char*, std::size_t>>& vBuf);
+    // Applies the sync policy to what was appended since the last commit
+    bool Commit();
+    bool Sync();
+
+protected:
+    void Preallocate(const std::size_t nNeeded);
+
+protected:
+    enum
+    {
+        PREALLOC_SIZE = 0x1000000
+    };
+#if defined(WIN32) || defined(_WIN32)
+    FILE* fp;
+#else
+    int fd;
+#endif
+    uint32 nFile;
+    uint32 nSize;
+    uint64 nAllocSize;
+    uint64 nUnsyncedBytes;
+    int64 nLastSyncTime;
+    CTimeSeriesSyncPolicy policy;
+};
+
 class CTimeSeriesBase
 {
 public:
@@ -81,6 +182,7 @@ protected:
     bool RemoveFollowUpFile(uint32 nBeginFile);
     bool TruncateFile(const std::string& pathFile, uint32 nOffset);
     bool CopyFileToPath(const uint32 nFile, const uint32 nCopySize, const fs::path& pathDst);
+    virtual void ReleaseFile(const uint32 nBeginFile);
 
 protected:
     enum
@@ -93,8 +195,27 @@ protected:
     uint32 nLastFile;
 };
 
+class CDiskPosHash
+{
+public:
+    std::size_t operator()(const CDiskPos& pos) const
+    {
+        return ((std::size_t)pos.nFile * 0x9E3779B1) ^ pos.nOffset;
+    }
+};
+
+typedef hnbase::CSegmentedLruCache<CDiskPos, std::shared_ptr<const bytes>, CDiskPosHash> CBlockCache;
+typedef CBlockCache::CStat CBlockCacheStat;
+
 class CTimeSeriesCached : public CTimeSeriesBase
 {
+public:
+    enum
+    {
+        DEFAULT_CACHE_SIZE = 0x2000000,
+        DEFAULT_CACHE_PIN_COUNT = 64
+    };
+
 public:
     CTimeSeriesCached();
     ~CTimeSeriesCached();
@@ -104,41 +225,27 @@ public:
     bool CopyToPath(const uint32 nLastFile, const uint32 nLastFileSize, const fs::path& pathDst);
     bool RecoveryFile(const fs::path& pathSrc);
 
+    void SetSyncPolicy(const CTimeSeriesSyncPolicy& policy);
+    bool Sync();
+    void SetCacheParam(const std::size_t nCacheBytes, const std::size_t nPinCount);
+    void GetCacheStat(CBlockCacheStat& stat);
+
     template <typename T>
     bool Write(const T& t, uint32& nFile, uint32& nOffset, uint32& nCrc, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
         hnbase::CBufStream ss;
         ss << t;
 
-        std::string pathFile;
-        if (!GetLastFilePath(nFile, pathFile, ss.GetSize()))
+        std::vector<uint32> vSize(1, ss.GetSize());
+        std::vector<CDiskPos> vPos;
+        std::vector<uint32> vCrc;
+        if (!WriteRecord(ss.GetData(), vSize, vPos, vCrc, fWriteCache))
         {
             return false;
         }
-        try
-        {
-            hnbase::CFileStream fs(pathFile.c_str());
-            fs.SeekToEnd();
-            uint32 nSize = ss.GetSize();
-            nCrc = hashahead::crypto::crc24q((const unsigned char*)(ss.GetData()), (int)(ss.GetSize()));
-            fs << nMagicNum << nSize << nCrc;
-            nOffset = fs.GetCurPos();
-            fs.Write(ss.GetData(), ss.GetSize());
-        }
-        catch (std::exception& e)
-        {
-            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-        if (fWriteCache)
-        {
-            if (!WriteToCache(ss.GetData(), ss.GetSize(), CDiskPos(nFile, nOffset)))
-            {
-                ResetCache();
-            }
-        }
+        nFile = vPos[0].nFile;
+        nOffset = vPos[0].nOffset;
+        nCrc = vCrc[0];
         return true;
     }
     template <typename T>
@@ -149,119 +256,54 @@ public:
     template <typename T>
     bool Read(T& t, const uint32 nFile, const uint32 nOffset, const bool fBlock, const bool fWriteCache)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        if (ReadFromCache(t, CDiskPos(nFile, nOffset)))
+        const CDiskPos pos(nFile, nOffset);
+        if (ReadFromCache(t, pos))
         {
             return true;
         }
 
-        if (!ReadDirect(t, nFile, nOffset, fBlock))
+        SHP_TS_MAPPED_FILE ptrMappedFile = GetMappedFile(nFile);
+        if (ptrMappedFile)
         {
-            return false;
-        }
-
-        if (fWriteCache)
-        {
-            if (!WriteToCache(t, CDiskPos(nFile, nOffset)))
+            const char* pData = nullptr;
+            uint32 nSize = 0;
+            if (!ReadMapped(t, *ptrMappedFile, nFile, nOffset, fBlock, pData, nSize))
             {
-                ResetCache();
+                return false;
+            }
+            if (fWriteCache)
+            {
+                WriteToCache(pData, nSize, pos, false);
             }
-        }
-        return true;
-    }
-    template <typename T>
-    bool Read(T& t, const CDiskPos& pos, const bool fBlock, const bool fWriteCache)
-    {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        if (ReadFromCache(t, pos))
-        {
             return true;
         }
 
-        if (!ReadDirect(t, pos.nFile, pos.nOffset, fBlock))
+        if (!ReadFile(t, nFile, nOffset, fBlock))
         {
             return false;
         }
-
         if (fWriteCache)
         {
-            if (!WriteToCache(t, pos))
-            {
-                ResetCache();
-            }
+            WriteToCache(t, pos);
         }
         return true;
     }
     template <typename T>
+    bool Read(T& t, const CDiskPos& pos, const bool fBlock, const bool fWriteCache)
+    {
+        return Read(t, pos.nFile, pos.nOffset, fBlock, fWriteCache);
+    }
+    template <typename T>
     bool ReadDirect(T& t, const uint32 nFile, const uint32 nOffset, const bool fBlock)
     {
-        std::string pathFile;
-        if (!GetFilePath(nFile, pathFile))
+        SHP_TS_MAPPED_FILE ptrMappedFile = GetMappedFile(nFile);
+        if (ptrMappedFile)
         {
-            hnbase::StdError("TimeSeriesCached", "Read direct: Get file path fail, nFile: %d, nOffset: %d", nFile, nOffset);
-            return false;
+            const char* pData = nullptr;
+            uint32 nSize = 0;
+            return ReadMapped(t, *ptrMappedFile, nFile, nOffset, fBlock, pData, nSize);
         }
-        uint8* pReadBuf = nullptr;
-        try
-        {
-            hnbase::CFileStream fs(pathFile.c_str());
-            if (!fBlock)
-            {
-                fs.Seek(nOffset);
-                fs >> t;
-            }
-            else
-            {
-                fs.Seek(nOffset - sizeof(uint32) * 3);
-                uint32 nReadMagicNum, nBlockSize, nReadCrc;
-                fs >> nReadMagicNum >> nBlockSize >> nReadCrc;
-                if (nReadMagicNum != nMagicNum || nBlockSize == 0 || nBlockSize >= MAX_FILE_SIZE)
-                {
-                    hnbase::StdError("TimeSeriesCached", "Read direct: nMagicNum or nBlockSize error, nReadMagicNum: 0x%x, nMagicNum: 0x%x, nBlockSize: %d, nFile: %d, nOffset: %d",
-                                     nReadMagicNum, nMagicNum, nBlockSize, nFile, nOffset);
-                    return false;
-                }
-                pReadBuf = (uint8*)malloc(nBlockSize);
-                if (pReadBuf == nullptr)
-                {
-                    hnbase::StdError("TimeSeriesCached", "Read direct: malloc fail, nFile: %d, nOffset: %d", nFile, nOffset);
-                    return false;
-                }
-                fs.Read((char*)pReadBuf, nBlockSize);
-                if (nReadCrc != hashahead::crypto::crc24q(pReadBuf, nBlockSize))
-                {
-                    hnbase::StdError("TimeSeriesCached", "Read direct: Crc error, read crc: 0x%8.8x, calc crc: 0x%8.8x, nFile: %d, nOffset: %d",
-                                     nReadCrc, hashahead::crypto::crc24q(pReadBuf, nBlockSize), nFile, nOffset);
-                    free(pReadBuf);
-                    pReadBuf = nullptr;
-                    return false;
-                }
-                hnbase::CBufStream bs;
-                bs.Write((const char*)pReadBuf, nBlockSize);
-                free(pReadBuf);
-                pReadBuf = nullptr;
-                bs >> t;
-                if (bs.size() > 0)
-                {
-                    hnbase::StdError("TimeSeriesCached", "Read direct: Remaining data is greater than 0, surplus: %ld, nBlockSize: %ld, nFile: %d, nOffset: %d",
-                                     bs.size(), nBlockSize, nFile, nOffset);
-                    return false;
-                }
-            }
-        }
-        catch (std::exception& e)
-        {
-            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
-            if (pReadBuf)
-            {
-                free(pReadBuf);
-                pReadBuf = nullptr;
-            }
-            return false;
-        }
-        return true;
+        return ReadFile(t, nFile, nOffset, fBlock);
     }
     template <typename T>
     bool WalkThrough(CTSWalker<T>& walker, uint32& nLastFileRet, uint32& nLastPosRet, bool fRepairFile)
@@ -486,71 +528,220 @@ public:
     }
 
 protected:
-    void ResetCache();
-    bool VacateCache(uint32 nNeeded);
-    template <typename T>
-    bool WriteToCache(const T& t, const CDiskPos& diskpos)
+    class CWriteRequest
     {
-        hnbase::CBufStream ss;
-        ss << t;
-        return WriteToCache(ss.GetData(), ss.GetSize(), diskpos);
-    }
-    bool WriteToCache(const char* pData, const uint32 nSize, const CDiskPos& diskpos)
+    public:
+        CWriteRequest(const char* pDataIn, const std::vector<uint32>& vSizeIn)
+          : pData(pDataIn), vSize(vSizeIn), fDone(false), fResult(false) {}
+
+    public:
+        const char* pData;
+        const std::vector<uint32>& vSize;
+        std::vector<CDiskPos> vPos;
+        std::vector<uint32> vCrc;
+        bool fDone;
+        bool fResult;
+    };
+
+    bool WriteRecord(const char* pData, const std::vector<uint32>& vSize, std::vector<CDiskPos>& vPos, std::vector<uint32>& vCrc, const bool fWriteCache);
+    bool AppendGroup(const std::vector<CWriteRequest*>& vGroup);
+    bool PrepareWriter(const uint32 nWriteSize);
+    void ReleaseFile(const uint32 nBeginFile) override;
+    SHP_TS_MAPPED_FILE GetMappedFile(const uint32 nFile);
+    void StartSyncThread(const uint32 nIntervalMs);
+    void StopSyncThread();
+    void SyncThreadFunc(const uint32 nIntervalMs);
+    template <typename T>
+    bool ReadFile(T& t, const uint32 nFile, const uint32 nOffset, const bool fBlock)
     {
-        if (mapCachePos.count(diskpos))
-        {
-            return true;
-        }
-        if (!VacateCache(nSize))
+        std::string pathFile;
+        if (!GetFilePath(nFile, pathFile))
         {
+            hnbase::StdError("TimeSeriesCached", "Read file: Get file path fail, nFile: %d, nOffset: %d", nFile, nOffset);
             return false;
         }
+        uint8* pReadBuf = nullptr;
         try
         {
-            std::size_t nPos;
-            cacheStream << diskpos << nSize;
-            nPos = cacheStream.GetWritePos();
-            cacheStream.Write(pData, nSize);
-            mapCachePos.insert(std::make_pair(diskpos, nPos));
-            return true;
+            hnbase::CFileStream fs(pathFile.c_str());
+            if (!fBlock)
+            {
+                fs.Seek(nOffset);
+                fs >> t;
+            }
+            else
+            {
+                fs.Seek(nOffset - sizeof(uint32) * 3);
+                uint32 nReadMagicNum, nBlockSize, nReadCrc;
+                fs >> nReadMagicNum >> nBlockSize >> nReadCrc;
+                if (nReadMagicNum != nMagicNum || nBlockSize == 0 || nBlockSize >= MAX_FILE_SIZE)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read file: nMagicNum or nBlockSize error, nReadMagicNum: 0x%x, nMagicNum: 0x%x, nBlockSize: %d, nFile: %d, nOffset: %d",
+                                     nReadMagicNum, nMagicNum, nBlockSize, nFile, nOffset);
+                    return false;
+                }
+                pReadBuf = (uint8*)malloc(nBlockSize);
+                if (pReadBuf == nullptr)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read file: malloc fail, nFile: %d, nOffset: %d", nFile, nOffset);
+                    return false;
+                }
+                fs.Read((char*)pReadBuf, nBlockSize);
+                if (nReadCrc != hashahead::crypto::crc24q(pReadBuf, nBlockSize))
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read file: Crc error, read crc: 0x%8.8x, calc crc: 0x%8.8x, nFile: %d, nOffset: %d",
+                                     nReadCrc, hashahead::crypto::crc24q(pReadBuf, nBlockSize), nFile, nOffset);
+                    free(pReadBuf);
+                    pReadBuf = nullptr;
+                    return false;
+                }
+                hnbase::CBufStream bs;
+                bs.Write((const char*)pReadBuf, nBlockSize);
+                free(pReadBuf);
+                pReadBuf = nullptr;
+                bs >> t;
+                if (bs.size() > 0)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read file: Remaining data is greater than 0, surplus: %ld, nBlockSize: %ld, nFile: %d, nOffset: %d",
+                                     bs.size(), nBlockSize, nFile, nOffset);
+                    return false;
+                }
+            }
         }
         catch (std::exception& e)
         {
             hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+            if (pReadBuf)
+            {
+                free(pReadBuf);
+                pReadBuf = nullptr;
+            }
+            return false;
         }
-        return false;
+        return true;
     }
     template <typename T>
-    bool ReadFromCache(T& t, const CDiskPos& diskpos)
+    bool ReadMapped(T& t, const CTimeSeriesMappedFile& mappedFile, const uint32 nFile, const uint32 nOffset, const bool fBlock, const char*& pData, uint32& nSize)
     {
-        std::map<CDiskPos, size_t>::iterator it = mapCachePos.find(diskpos);
-        if (it != mapCachePos.end())
+        const uint32 nHeadSize = sizeof(uint32) * 3;
+        const std::size_t nFileSize = mappedFile.GetSize();
+        try
         {
-            if (cacheStream.Seek((*it).second))
+            if (!fBlock)
             {
-                try
+                if (nOffset >= nFileSize)
                 {
-                    cacheStream >> t;
-                    return true;
+                    hnbase::StdError("TimeSeriesCached", "Read mapped: nOffset error, nFileSize: %lu, nFile: %d, nOffset: %d", nFileSize, nFile, nOffset);
+                    return false;
                 }
-                catch (std::exception& e)
+                pData = mappedFile.GetData() + nOffset;
+                hnbase::CFlatReadStream rs((const uint8*)pData, nFileSize - nOffset);
+                rs >> t;
+                nSize = (uint32)rs.GetReadPos();
+            }
+            else
+            {
+                if (nOffset < nHeadSize || nOffset > nFileSize)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read mapped: nOffset error, nFileSize: %lu, nFile: %d, nOffset: %d", nFileSize, nFile, nOffset);
+                    return false;
+                }
+                uint32 nReadMagicNum, nBlockSize, nReadCrc;
                 {
-                    hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+                    hnbase::CFlatReadStream rs((const uint8*)(mappedFile.GetData() + nOffset - nHeadSize), nHeadSize);
+                    rs >> nReadMagicNum >> nBlockSize >> nReadCrc;
                 }
+                if (nReadMagicNum != nMagicNum || nBlockSize == 0 || nBlockSize > nFileSize - nOffset)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read mapped: nMagicNum or nBlockSize error, nReadMagicNum: 0x%x, nMagicNum: 0x%x, nBlockSize: %d, nFile: %d, nOffset: %d",
+                                     nReadMagicNum, nMagicNum, nBlockSize, nFile, nOffset);
+                    return false;
+                }
+                pData = mappedFile.GetData() + nOffset;
+                uint32 nCalcCrc = hashahead::crypto::crc24q((const unsigned char*)pData, nBlockSize);
+                if (nReadCrc != nCalcCrc)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read mapped: Crc error, read crc: 0x%8.8x, calc crc: 0x%8.8x, nFile: %d, nOffset: %d",
+                                     nReadCrc, nCalcCrc, nFile, nOffset);
+                    return false;
+                }
+                hnbase::CFlatReadStream rs((const uint8*)pData, nBlockSize);
+                rs >> t;
+                if (rs.GetSize() > 0)
+                {
+                    hnbase::StdError("TimeSeriesCached", "Read mapped: Remaining data is greater than 0, surplus: %ld, nBlockSize: %ld, nFile: %d, nOffset: %d",
+                                     rs.GetSize(), nBlockSize, nFile, nOffset);
+                    return false;
+                }
+                nSize = nBlockSize;
             }
-            ResetCache();
         }
+        catch (std::exception& e)
+        {
+            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+            return false;
+        }
+        return true;
+    }
+    template <typename T>
+    void WriteToCache(const T& t, const CDiskPos& diskpos)
+    {
+        hnbase::CBufStream ss;
+        ss << t;
+        WriteToCache(ss.GetData(), ss.GetSize(), diskpos, false);
+    }
+    void WriteToCache(const char* pData, const uint32 nSize, const CDiskPos& diskpos, const bool fPin)
+    {
+        cacheBlock.AddNew(diskpos, std::make_shared<const bytes>(pData, pData + nSize), nSize, fPin);
+    }
+    template <typename T>
+    bool ReadFromCache(T& t, const CDiskPos& diskpos)
+    {
+        std::shared_ptr<const bytes> ptrData;
+        if (!cacheBlock.Retrieve(diskpos, ptrData))
+        {
+            return false;
+        }
+        try
+        {
+            hnbase::CFlatReadStream rs(*ptrData);
+            rs >> t;
+            return true;
+        }
+        catch (std::exception& e)
+        {
+            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        }
+        cacheBlock.Remove(diskpos);
         return false;
     }
 
 protected:
     enum
     {
-        FILE_CACHE_SIZE = 0x2000000
+        MAPPED_FILE_SHARD_COUNT = 16,
+        CACHE_SHARD_COUNT = 4
+    };
+    class CMappedFileShard
+    {
+    public:
+        boost::shared_mutex mtxShard;
+        std::map<uint32, SHP_TS_MAPPED_FILE> mapFile;
     };
-    boost::mutex mtxCache;
-    hnbase::CCircularStream cacheStream;
-    std::map<CDiskPos, std::size_t> mapCachePos;
+    boost::mutex mtxWriteQueue;
+    boost::condition_variable condWriteQueue;
+    std::deque<CWriteRequest*> queWrite;
+    boost::mutex mtxWriter;
+    CTimeSeriesWriter writer;
+    boost::mutex mtxSyncThread;
+    boost::condition_variable condSyncThread;
+    boost::thread* pThreadSync;
+    bool fSyncThreadExit;
+    CBlockCache cacheBlock;
+    boost::mutex mtxMappedRelease;
+    boost::condition_variable condMappedRelease;
+    CMappedFileShard arrayMappedShard[MAPPED_FILE_SHARD_COUNT];
+    std::atomic<uint32> nSealedFile;
     static const uint32 nMagicNum;
 };
 
@@ -4,7 +4,10 @@
 
 #include "triedb.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/range/adaptor/reversed.hpp>
+#include <set>
 
 #include "leveldbeng.h"
 
@@ -23,6 +26,21 @@ namespace storage
 
 const uint8 TDB_KEY_TYPE_TRIE_KEY = 0x10;
 const uint8 TDB_KEY_TYPE_EXT_KEY = 0x20;
+const uint8 TDB_KEY_TYPE_NODE_REF = 0x30;       // [node hash] -> reference count
+const uint8 TDB_KEY_TYPE_ROOT_JOURNAL = 0x40;   // [height][root hash] -> commit count
+const uint8 TDB_KEY_TYPE_JOURNAL_HEIGHT = 0x41; // lowest height with journaled roots
+const uint8 TDB_KEY_TYPE_STORE_VERSION = 0x50;  // node store layout, written once legacy branches are migrated
+
+const std::size_t TRIE_NODE_CACHE_MAX_BYTES = 256 * 1024 * 1024;
+const std::size_t TRIE_NODE_CACHE_SHARD_COUNT = 32;
+
+const std::size_t TRIE_BULK_UPDATE_MIN_COUNT = 256;
+
+// Approximate resident size of a decoded node: encoded payload plus object and LRU bookkeeping.
+static std::size_t GetNodeCacheSize(const std::size_t nStreamSize)
+{
+    return nStreamSize + sizeof(CTrieValue) + sizeof(uint256) * 2 + 64;
+}
 
 //////////////////////////////
 // CKeyNibble
@@ -89,11 +107,11 @@ uint256 CTrieBranch::GetNextHash(const uint8 n) const
         return uint256();
     }
     x--;
-    if (x >= branchNext.size())
+    if (x >= nNextCount)
     {
         return uint256();
     }
-    return branchNext[x];
+    return branchHash[x];
 }
 
 void CTrieBranch::SetNextHash(const uint8 n, const uint256& hash)
@@ -103,17 +121,19 @@ void CTrieBranch::SetNextHash(const uint8 n, const uint256& hash)
         return;
     }
     uint8 x = keyIndexNext[n];
-    if (x == 0 || x - 1 >= branchNext.size())
+    if (x == 0 || x - 1 >= nNextCount)
     {
         if (hash != 0)
         {
-            branchNext.push_back(hash);
-            keyIndexNext[n] = branchNext.size();
+            // appends like the legacy vectors did, including the one byte index truncation, so node hashes stay unchanged
+            branchHash.insert(branchHash.begin() + nNextCount, hash);
+            nNextCount++;
+            keyIndexNext[n] = (uint8)nNextCount;
         }
     }
     else
     {
-        branchNext[x - 1] = hash;
+        branchHash[x - 1] = hash;
         if (hash == 0)
         {
             keyIndexNext[n] = 0;
@@ -133,11 +153,11 @@ uint256 CTrieBranch::GetValueHash(const uint8 n) const
         return uint256();
     }
     x--;
-    if (x >= branchValue.size())
+    if (x >= branchHash.size() - nNextCount)
     {
         return uint256();
     }
-    return branchValue[x];
+    return branchHash[nNextCount + x];
 }
 
 void CTrieBranch::SetValueHash(const uint8 n, const uint256& hash)
@@ -147,17 +167,17 @@ void CTrieBranch::SetValueHash(const uint8 n, const uint256& hash)
         return;
     }
     uint8 x = keyIndexValue[n];
-    if (x == 0 || x - 1 >= branchValue.size())
+    if (x == 0 || x - 1 >= branchHash.size() - nNextCount)
     {
         if (hash != 0)
         {
-            branchValue.push_back(hash);
-            keyIndexValue[n] = branchValue.size();
+            branchHash.push_back(hash);
+            keyIndexValue[n] = (uint8)(branchHash.size() - nNextCount);
         }
     }
     else
     {
-        branchValue[x - 1] = hash;
+        branchHash[nNextCount + x - 1] = hash;
         if (hash == 0)
         {
             keyIndexValue[n] = 0;
@@ -165,6 +185,137 @@ void CTrieBranch::SetValueHash(const uint8 n, const uint256& hash)
     }
 }
 
+// Compact layout, v1:
+//   [uint16 next mask][uint16 value mask][uint8 next count][uint8 value count]
+//   [one index byte per set mask bit, next then value][packed hashes]
+void CTrieBranch::GetCompactStream(CBufStream& ssValue) const
+{
+    const uint8 nValueCount = branchHash.size() - nNextCount;
+    uint16 nNextMask = 0;
+    uint16 nValueMask = 0;
+    uint8 btIndex[32];
+    std::size_t nIndexCount = 0;
+    for (uint8 i = 0; i < 16; i++)
+    {
+        if (keyIndexNext[i] != 0)
+        {
+            nNextMask |= (1 << i);
+            btIndex[nIndexCount++] = keyIndexNext[i];
+        }
+    }
+    for (uint8 i = 0; i < 16; i++)
+    {
+        if (keyIndexValue[i] != 0)
+        {
+            nValueMask |= (1 << i);
+            btIndex[nIndexCount++] = keyIndexValue[i];
+        }
+    }
+    ssValue << nNextMask << nValueMask << (uint8)nNextCount << nValueCount;
+    ssValue.Write((const char*)btIndex, nIndexCount);
+    if (!branchHash.empty())
+    {
+        ssValue.Write((const char*)branchHash[0].begin(), branchHash.size() * sizeof(uint256));
+    }
+}
+
+bool CTrieBranch::SetCompactData(const uint8* pData, const std::size_t nSize, std::size_t& nUsed)
+{
+    if (nSize < 6)
+    {
+        return false;
+    }
+    uint16 nNextMask, nValueMask;
+    memcpy(&nNextMask, pData, sizeof(uint16));
+    memcpy(&nValueMask, pData + 2, sizeof(uint16));
+    const uint8 nNextCountIn = pData[4];
+    const uint8 nValueCountIn = pData[5];
+    const std::size_t nHashCount = nNextCountIn + nValueCountIn;
+
+    std::size_t nPos = 6;
+    const std::size_t nIndexCount = __builtin_popcount(nNextMask) + __builtin_popcount(nValueMask);
+    if (nSize < nPos + nIndexCount + nHashCount * sizeof(uint256))
+    {
+        return false;
+    }
+    for (uint8 i = 0; i < 16; i++)
+    {
+        keyIndexNext[i] = ((nNextMask >> i) & 1) ? pData[nPos++] : 0;
+        if (keyIndexNext[i] > nNextCountIn)
+        {
+            return false;
+        }
+    }
+    for (uint8 i = 0; i < 16; i++)
+    {
+        keyIndexValue[i] = ((nValueMask >> i) & 1) ? pData[nPos++] : 0;
+        if (keyIndexValue[i] > nValueCountIn)
+        {
+            return false;
+        }
+    }
+    nNextCount = nNextCountIn;
+    branchHash.resize(nHashCount);
+    if (nHashCount > 0)
+    {
+        memcpy(branchHash[0].begin(), pData + nPos, nHashCount * sizeof(uint256));
+        nPos += nHashCount * sizeof(uint256);
+    }
+    nUsed = nPos;
+    return true;
+}
+
+void CTrieBranch::Serialize(CStream& s, SaveType& opt)
+{
+    CVarInt varIndex((uint64)keyIndexNext.size());
+    s.Serialize(varIndex, opt);
+    s.Write((const char*)keyIndexNext.data(), keyIndexNext.size());
+    s.Serialize(varIndex, opt);
+    s.Write((const char*)keyIndexValue.data(), keyIndexValue.size());
+
+    CVarInt varNext((uint64)nNextCount);
+    s.Serialize(varNext, opt);
+    for (std::size_t i = 0; i < nNextCount; i++)
+    {
+        s.Serialize(branchHash[i], opt);
+    }
+    CVarInt varValue((uint64)(branchHash.size() - nNextCount));
+    s.Serialize(varValue, opt);
+    for (std::size_t i = nNextCount; i < branchHash.size(); i++)
+    {
+        s.Serialize(branchHash[i], opt);
+    }
+}
+
+void CTrieBranch::Serialize(CStream& s, LoadType& opt)
+{
+    std::vector<uint8> vIndexNext, vIndexValue;
+    std::vector<uint256> vNext, vValue;
+    s.Serialize(vIndexNext, opt);
+    s.Serialize(vIndexValue, opt);
+    s.Serialize(vNext, opt);
+    s.Serialize(vValue, opt);
+    if (vIndexNext.size() != keyIndexNext.size() || vIndexValue.size() != keyIndexValue.size())
+    {
+        throw std::runtime_error("trie branch index size error");
+    }
+    std::copy(vIndexNext.begin(), vIndexNext.end(), keyIndexNext.begin());
+    std::copy(vIndexValue.begin(), vIndexValue.end(), keyIndexValue.begin());
+    // out of range indexes read as empty slots, as they always did
+    nNextCount = vNext.size();
+    branchHash.swap(vNext);
+    branchHash.insert(branchHash.end(), vValue.begin(), vValue.end());
+}
+
+void CTrieBranch::Serialize(CStream& s, std::size_t& serSize)
+{
+    CVarInt varIndex((uint64)keyIndexNext.size());
+    CVarInt varNext((uint64)nNextCount);
+    CVarInt varValue((uint64)(branchHash.size() - nNextCount));
+    serSize += GetSerializeSize(varIndex) * 2 + keyIndexNext.size() + keyIndexValue.size()
+               + GetSerializeSize(varNext) + GetSerializeSize(varValue) + branchHash.size() * sizeof(uint256);
+}
+
 //////////////////////////////
 // CTrieExtension
 
@@ -175,7 +326,7 @@ void CTrieExtension::SetKey(const std::vector<uint8>& vKeyNibble)
     flag = ((flag & 0xF0) | nNibbleFlag);
 }
 
-void CTrieExtension::GetKey(std::vector<uint8>& vKeyNibble)
+void CTrieExtension::GetKey(std::vector<uint8>& vKeyNibble) const
 {
     CKeyNibble::Byte2Nibble(key, (flag & 0x0F), vKeyNibble);
 }
@@ -312,6 +463,41 @@ bool CTrieValue::SetStream(CBufStream& ssValue)
     return false;
 }
 
+bool CTrieValue::SetStoreStream(CBufStream& ssValue, bool& fLegacy)
+{
+    fLegacy = false;
+    if (ssValue.GetSize() == 0)
+    {
+        return false;
+    }
+    const uint8* pData = (const uint8*)ssValue.GetData();
+    if (pData[0] != STORE_BRANCH_COMPACT_V1)
+    {
+        fLegacy = (pData[0] == TYPE_BRANCH);
+        return SetStream(ssValue);
+    }
+    std::size_t nUsed = 0;
+    if (!vaBranch.SetCompactData(pData + 1, ssValue.GetSize() - 1, nUsed))
+    {
+        StdError("CTrieValue", "Set store stream: compact branch data error");
+        return false;
+    }
+    ssValue.consume(nUsed + 1);
+    type = TYPE_BRANCH;
+    return true;
+}
+
+bool CTrieValue::GetStoreStream(CBufStream& ssValue) const
+{
+    if (type == TYPE_BRANCH && vaBranch.IsCompactable())
+    {
+        ssValue << (uint8)STORE_BRANCH_COMPACT_V1;
+        vaBranch.GetCompactStream(ssValue);
+        return true;
+    }
+    return GetStream(ssValue);
+}
+
 bool CTrieValue::GetStream(CBufStream& ssValue) const
 {
     ssValue << type;
@@ -377,10 +563,53 @@ const uint256 CTrieValue::CalcHash()
     return uint256();
 }
 
+void CTrieValue::GetChildHash(std::vector<uint256>& vChildHash) const
+{
+    switch (type)
+    {
+    case TYPE_BRANCH:
+        for (uint8 i = 0; i < 16; i++)
+        {
+            const uint256 hashNext = vaBranch.GetNextHash(i);
+            if (hashNext != 0)
+            {
+                vChildHash.push_back(hashNext);
+            }
+            const uint256 hashValue = vaBranch.GetValueHash(i);
+            if (hashValue != 0)
+            {
+                vChildHash.push_back(hashValue);
+            }
+        }
+        break;
+    case TYPE_EXTENSION:
+        if (vaExtension.GetNextHash() != 0)
+        {
+            vChildHash.push_back(vaExtension.GetNextHash());
+        }
+        if (vaExtension.GetValueHash() != 0)
+        {
+            vChildHash.push_back(vaExtension.GetValueHash());
+        }
+        break;
+    }
+}
+
 //////////////////////////////
 // CTrieDB
 
-bool CTrieDB::Initialize(const boost::filesystem::path& pathData)
+CTrieNodeCache& CTrieDB::GetNodeCache()
+{
+    static CTrieNodeCache cacheNode(TRIE_NODE_CACHE_MAX_BYTES, TRIE_NODE_CACHE_SHARD_COUNT);
+    return cacheNode;
+}
+
+void CTrieDB::GetNodeCacheStat(CTrieNodeCache::CStat& stat)
+{
+    GetNodeCache().GetStat(stat);
+}
+
+bool CTrieDB::Initialize(const boost::filesystem::path& pathData, const bool fJournalIn)
 {
     CLevelDBArguments args;
     args.path = pathData.string();
@@ -391,6 +620,16 @@ bool CTrieDB::Initialize(const boost::filesystem::path& pathData)
         delete engine;
         return false;
     }
+    fJournal = fJournalIn;
+
+    static std::atomic<uint32> nNextCacheId(0);
+    nCacheId = ++nNextCacheId;
+
+    // legacy nodes stay readable, a failed migration is retried on the next start
+    if (!MigrateLegacyNodes())
+    {
+        StdLog("CTrieDB", "Initialize: Migrate legacy nodes fail, path: %s", args.path.c_str());
+    }
     return true;
 }
 
@@ -402,6 +641,8 @@ void CTrieDB::Deinitialize()
 void CTrieDB::Clear()
 {
     RemoveAll();
+    // the node cache is shared by every trie db, drop only the entries of this one
+    GetNodeCache().RemoveRange(CTrieNodeCacheKey(nCacheId, uint256()), CTrieNodeCacheKey(nCacheId + 1, uint256()));
 }
 
 bool CTrieDB::AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot)
@@ -415,14 +656,16 @@ bool CTrieDB::AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList,
         return false;
     }
 
+    std::map<uint256, std::size_t> mapCacheSize;
     for (auto& kv : mapCacheNode)
     {
-        if (!SetDbNodeValue(kv.first, kv.second))
+        if (!SetDbNodeValue(kv.first, kv.second, mapCacheSize))
         {
             StdLog("CTrieDB", "Add new trie: Set db node value fail, prev root: %s", hashPrevRoot.GetHex().c_str());
             return false;
         }
     }
+    AddNodeCache(mapCacheNode, mapCacheSize);
 
 #ifdef TEST_STAT
     static int64 nTotalAddNodeCount = 0;
@@ -432,6 +675,154 @@ bool CTrieDB::AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList,
     return true;
 }
 
+bool CTrieDB::AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, const uint32 nJournalHeight)
+{
+    if (!fJournal)
+    {
+        return AddNewTrie(hashPrevRoot, mapKvList, hashNewRoot);
+    }
+
+    hnbase::CWriteLock wlock(rwAccess);
+
+    std::map<uint256, CTrieValue> mapCacheNode;
+    if (!CreateTrieNodeList(hashPrevRoot, mapKvList, hashNewRoot, mapCacheNode))
+    {
+        StdLog("CTrieDB", "Add new trie: Create trie node list fail, prev root: %s", hashPrevRoot.GetHex().c_str());
+        return false;
+    }
+    if (hashNewRoot == 0)
+    {
+        return true;
+    }
+
+    if (!TxnBegin())
+    {
+        StdLog("CTrieDB", "Add new trie: Txn begin fail, prev root: %s", hashPrevRoot.GetHex().c_str());
+        return false;
+    }
+    std::map<uint256, std::size_t> mapCacheSize;
+    if (!AddJournalNodeRef(hashNewRoot, nJournalHeight, mapCacheNode, mapCacheSize))
+    {
+        TxnAbort();
+        StdLog("CTrieDB", "Add new trie: Add journal node ref fail, prev root: %s", hashPrevRoot.GetHex().c_str());
+        return false;
+    }
+    if (!TxnCommit())
+    {
+        StdLog("CTrieDB", "Add new trie: Txn commit fail, prev root: %s", hashPrevRoot.GetHex().c_str());
+        return false;
+    }
+    // Only nodes that reached the database may be served from the cache
+    AddNodeCache(mapCacheNode, mapCacheSize);
+    return true;
+}
+
+bool CTrieDB::PruneJournal(const uint32 nPruneHeight, const uint64 nMaxNodeCount, CTriePruneStat& stat)
+{
+    hnbase::CWriteLock wlock(rwAccess);
+
+    uint32 nHeight = 0;
+    if (!ReadJournalHeight(nHeight))
+    {
+        return true;
+    }
+    while (nHeight < nPruneHeight && (nMaxNodeCount == 0 || stat.nNodeCount < nMaxNodeCount))
+    {
+        std::vector<std::pair<uint256, uint32>> vRoot;
+        CBufStream ssKeyBegin, ssKeyPrefix;
+        ssKeyPrefix << TDB_KEY_TYPE_ROOT_JOURNAL << nHeight;
+        ssKeyBegin << TDB_KEY_TYPE_ROOT_JOURNAL << nHeight;
+        auto funcWalker = [&](CBufStream& ssKey, CBufStream& ssValue) -> bool {
+            try
+            {
+                uint8 nKeyType;
+                uint32 nKeyHeight;
+                uint256 hashRoot;
+                uint32 nCommitCount;
+                ssKey >> nKeyType >> nKeyHeight >> hashRoot;
+                ssValue >> nCommitCount;
+                vRoot.push_back(std::make_pair(hashRoot, nCommitCount));
+            }
+            catch (std::exception& e)
+            {
+                StdError(__PRETTY_FUNCTION__, e.what());
+                return false;
+            }
+            return true;
+        };
+        if (!WalkThroughOfPrefix(ssKeyBegin, ssKeyPrefix, funcWalker))
+        {
+            StdLog("CTrieDB", "Prune journal: Walk journal fail, height: %d", nHeight);
+            return false;
+        }
+
+        if (!TxnBegin())
+        {
+            StdLog("CTrieDB", "Prune journal: Txn begin fail, height: %d", nHeight);
+            return false;
+        }
+        // Writes are batched until commit, so the counts changed at this height are tracked in memory.
+        std::map<uint256, uint32> mapRef;
+        for (const auto& kv : vRoot)
+        {
+            if (!ReleaseJournalRoot(kv.first, kv.second, mapRef, stat))
+            {
+                TxnAbort();
+                StdLog("CTrieDB", "Prune journal: Release root fail, height: %d, root: %s", nHeight, kv.first.GetHex().c_str());
+                return false;
+            }
+            CBufStream ssKey;
+            ssKey << TDB_KEY_TYPE_ROOT_JOURNAL << nHeight << kv.first;
+            if (!Erase(ssKey))
+            {
+                TxnAbort();
+                StdLog("CTrieDB", "Prune journal: Erase root journal fail, height: %d, root: %s", nHeight, kv.first.GetHex().c_str());
+                return false;
+            }
+            stat.nRootCount++;
+        }
+        for (const auto& kv : mapRef)
+        {
+            CBufStream ssKey;
+            ssKey << TDB_KEY_TYPE_NODE_REF << kv.first;
+            bool fRet = false;
+            if (kv.second == 0)
+            {
+                fRet = Erase(ssKey);
+            }
+            else
+            {
+                CBufStream ssValue;
+                ssValue << kv.second;
+                fRet = Write(ssKey, ssValue);
+            }
+            if (!fRet)
+            {
+                TxnAbort();
+                StdLog("CTrieDB", "Prune journal: Update node ref fail, height: %d, node: %s", nHeight, kv.first.GetHex().c_str());
+                return false;
+            }
+        }
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_JOURNAL_HEIGHT;
+        ssValue << (nHeight + 1);
+        if (!Write(ssKey, ssValue))
+        {
+            TxnAbort();
+            StdLog("CTrieDB", "Prune journal: Write journal height fail, height: %d", nHeight);
+            return false;
+        }
+        nHeight++;
+        if (!TxnCommit())
+        {
+            StdLog("CTrieDB", "Prune journal: Txn commit fail, height: %d", nHeight - 1);
+            return false;
+        }
+        stat.nHeightCount++;
+    }
+    return true;
+}
+
 bool CTrieDB::CreateCacheTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode)
 {
     hnbase::CReadLock rlock(rwAccess);
@@ -442,14 +833,16 @@ bool CTrieDB::SaveCacheTrie(std::map<uint256, CTrieValue>& mapCacheNode)
 {
     hnbase::CWriteLock wlock(rwAccess);
 
+    std::map<uint256, std::size_t> mapCacheSize;
     for (auto& kv : mapCacheNode)
     {
-        if (!SetDbNodeValue(kv.first, kv.second))
+        if (!SetDbNodeValue(kv.first, kv.second, mapCacheSize))
         {
             StdLog("CTrieDB", "Save cache trie: Set db node value fail");
             return false;
         }
     }
+    AddNodeCache(mapCacheNode, mapCacheSize);
     return true;
 }
 
@@ -461,6 +854,112 @@ bool CTrieDB::Retrieve(const uint256& hashRoot, const bytes& btKey, bytes& btVal
     return GetKeyValue(hashRoot, nbKeyNibble, btValue);
 }
 
+bool CTrieDB::RetrieveBatch(const uint256& hashRoot, const std::vector<bytes>& vKey, bytesmap& mapValue)
+{
+    hnbase::CReadLock rlock(rwAccess);
+
+    if (hashRoot == 0)
+    {
+        return true;
+    }
+
+    // All keys descend the trie one node per round, the nodes of a round are
+    // fetched with one multi-get and shared top levels are read only once.
+    struct CKeyLookup
+    {
+        const bytes* pKey;
+        bytes nbKey;
+        std::size_t nPos;
+        uint256 hash;
+    };
+    std::vector<CKeyLookup> vLookup(vKey.size());
+    std::vector<std::size_t> vActive;
+    vActive.reserve(vKey.size());
+    for (std::size_t i = 0; i < vKey.size(); i++)
+    {
+        CKeyLookup& lookup = vLookup[i];
+        lookup.pKey = &vKey[i];
+        CKeyNibble::Byte2Nibble(vKey[i], 0, lookup.nbKey);
+        lookup.nPos = 0;
+        lookup.hash = hashRoot;
+        if (!lookup.nbKey.empty())
+        {
+            vActive.push_back(i);
+        }
+    }
+
+    while (!vActive.empty())
+    {
+        std::map<uint256, CTrieValue> mapNode;
+        {
+            std::vector<uint256> vHash;
+            vHash.reserve(vActive.size());
+            for (const std::size_t i : vActive)
+            {
+                vHash.push_back(vLookup[i].hash);
+            }
+            std::sort(vHash.begin(), vHash.end());
+            vHash.erase(std::unique(vHash.begin(), vHash.end()), vHash.end());
+            if (!GetDbNodeValues(vHash, mapNode))
+            {
+                StdLog("CTrieDB", "Retrieve batch: Get db node values fail, root: %s", hashRoot.GetHex().c_str());
+                return false;
+            }
+        }
+
+        std::vector<std::size_t> vNext;
+        for (const std::size_t i : vActive)
+        {
+            CKeyLookup& lookup = vLookup[i];
+            auto it = mapNode.find(lookup.hash);
+            if (it == mapNode.end())
+            {
+                StdLog("CTrieDB", "Retrieve batch: Get db node fail, hash: %s", lookup.hash.GetHex().c_str());
+                return false;
+            }
+            const CTrieValue& value = it->second;
+            if (lookup.nPos >= lookup.nbKey.size())
+            {
+                if (value.type == CTrieValue::TYPE_VALUE)
+                {
+                    mapValue[*lookup.pKey] = value.vaValue;
+                }
+                continue;
+            }
+
+            const std::size_t nRemain = lookup.nbKey.size() - lookup.nPos;
+            if (value.type == CTrieValue::TYPE_BRANCH)
+            {
+                const uint8 n = lookup.nbKey[lookup.nPos];
+                lookup.hash = (nRemain == 1 ? value.vaBranch.GetValueHash(n) : value.vaBranch.GetNextHash(n));
+                lookup.nPos++;
+            }
+            else if (value.type == CTrieValue::TYPE_EXTENSION)
+            {
+                bytes nbNodeKey;
+                value.vaExtension.GetKey(nbNodeKey);
+                if (nRemain < nbNodeKey.size() || !std::equal(nbNodeKey.begin(), nbNodeKey.end(), lookup.nbKey.begin() + lookup.nPos))
+                {
+                    continue;
+                }
+                lookup.hash = (nRemain == nbNodeKey.size() ? value.vaExtension.GetValueHash() : value.vaExtension.GetNextHash());
+                lookup.nPos += nbNodeKey.size();
+            }
+            else
+            {
+                StdLog("CTrieDB", "Retrieve batch: node type error, type: %d", value.type);
+                return false;
+            }
+            if (lookup.hash != 0)
+            {
+                vNext.push_back(i);
+            }
+        }
+        vActive.swap(vNext);
+    }
+    return true;
+}
+
 bool CTrieDB::WalkThroughTrie(const uint256& hashRoot, CTrieDBWalker& walker, const bytes& btKeyPrefix, const bytes& btBeginKeyTail, const bool fReverse)
 {
     hnbase::CReadLock rlock(rwAccess);
@@ -518,7 +1017,7 @@ bool CTrieDB::CheckTrie(const std::vector<uint256>& vCheckRoot)
         CTrieListDBWalker walker;
         bytes nbBeginKey;
         bool fWalkOver = false;
-        if (!WalkThroughNode(hashRoot, bytes(), nbBeginKey, false, bytes(), walker, mapCacheNode, 0, fWalkOver))
+        if (!WalkThroughNode(hashRoot, bytes(), nbBeginKey, false, bytes(), walker, mapCacheNode, 0, fWalkOver, false))
         {
             return false;
         }
@@ -535,7 +1034,7 @@ bool CTrieDB::CheckTrieNode(const uint256& hashRoot, std::map<uint256, CTrieValu
         CTrieListDBWalker walker;
         bytes nbBeginKey;
         bool fWalkOver = false;
-        if (!WalkThroughNode(hashRoot, bytes(), nbBeginKey, false, bytes(), walker, mapCacheNode, 0, fWalkOver))
+        if (!WalkThroughNode(hashRoot, bytes(), nbBeginKey, false, bytes(), walker, mapCacheNode, 0, fWalkOver, false))
         {
             return false;
         }
@@ -550,7 +1049,7 @@ bool CTrieDB::VerifyTrieRootNode(const uint256& hashRoot)
     if (hashRoot != 0)
     {
         CTrieValue value;
-        if (!GetDbNodeValue(hashRoot, value))
+        if (!GetDbNodeValue(hashRoot, value, false))
         {
             return false;
         }
@@ -603,6 +1102,19 @@ bool CTrieDB::CreateTrieNodeList(const uint256& hashPrevRoot, const bytesmap& ma
         hashNewRoot = hashPrevRoot;
         return true;
     }
+    if (mapKvList.size() >= TRIE_BULK_UPDATE_MIN_COUNT && mapCacheNode.empty())
+    {
+        bool fBulk = false;
+        if (!CreateTrieNodeListBulk(hashPrevRoot, mapKvList, hashNewRoot, mapCacheNode, fBulk))
+        {
+            StdLog("CTrieDB", "Create trie node list: Bulk update fail, prev root: %s", hashPrevRoot.GetHex().c_str());
+            return false;
+        }
+        if (fBulk)
+        {
+            return true;
+        }
+    }
     uint256 hashRoot = hashPrevRoot;
     for (const auto& kv : mapKvList)
     {
@@ -618,28 +1130,149 @@ bool CTrieDB::CreateTrieNodeList(const uint256& hashPrevRoot, const bytesmap& ma
     return true;
 }
 
-bool CTrieDB::AddNode(uint256& hashRoot, const bytes& nbKeyNibble, const bytes& btValue, std::map<uint256, CTrieValue>& mapCacheNode)
+// Bulk update below a branch root. Keys under different leading nibbles only meet at the root,
+// so each subtrie is updated by a task of the shared worker pool with the same per-key steps as the serial path.
+// The root then replays each child's hash changes in nibble order. Branch layout depends on
+// insertion order, so this yields the same nodes and root hash as inserting key by key.
+// fBulk is false when the trie shape does not allow it and the caller must use the serial path.
+bool CTrieDB::CreateTrieNodeListBulk(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode, bool& fBulk)
 {
-    TRIE_NODE_PATH path;
-    std::vector<uint256> vRemove;
-    if (!GetNodePath(hashRoot, nbKeyNibble, path, vRemove, mapCacheNode))
+    class CSubTrie
     {
-        StdLog("CTrieDB", "Add node: Get node path fail, root hash: %s", hashRoot.GetHex().c_str());
-        return false;
-    }
+    public:
+        CSubTrie()
+          : nNibble(0), fResult(false) {}
 
-    CTrieKeyValue kvValue;
-    kvValue.nKvType = CTrieKeyValue::KV_TYPE_NEW;
-    kvValue.value.type = CTrieValue::TYPE_VALUE;
-    kvValue.value.vaValue = btValue;
-    kvValue.CalcValueHash();
-    path.push_back(kvValue);
+    public:
+        uint8 nNibble;
+        bytesmap::const_iterator itBegin;
+        bytesmap::const_iterator itEnd;
+        std::vector<uint256> vRootHash;
+        std::map<uint256, CTrieValue> mapNode;
+        bool fResult;
+    };
 
-    uint256 hashPrevOld;
-    for (int64 i = path.size() - 2; i >= 0; i--)
+    fBulk = false;
+    if (hashPrevRoot == 0 || mapKvList.begin()->first.empty())
     {
-        CTrieKeyValue& kv = path[i];
-        switch (kv.value.type)
+        return true;
+    }
+    CTrieValue valueRoot;
+    if (!GetDbNodeValue(hashPrevRoot, valueRoot))
+    {
+        StdLog("CTrieDB", "Create trie node list bulk: Get root fail, root: %s", hashPrevRoot.GetHex().c_str());
+        return false;
+    }
+    if (valueRoot.type != CTrieValue::TYPE_BRANCH)
+    {
+        return true;
+    }
+
+    std::vector<CSubTrie> vSubTrie;
+    for (auto it = mapKvList.begin(); it != mapKvList.end(); ++it)
+    {
+        const uint8 nNibble = (it->first[0] >> 4);
+        if (vSubTrie.empty() || vSubTrie.back().nNibble != nNibble)
+        {
+            if (!vSubTrie.empty())
+            {
+                vSubTrie.back().itEnd = it;
+            }
+            vSubTrie.push_back(CSubTrie());
+            vSubTrie.back().nNibble = nNibble;
+            vSubTrie.back().itBegin = it;
+        }
+    }
+    vSubTrie.back().itEnd = mapKvList.end();
+    if (vSubTrie.size() < 2)
+    {
+        return true;
+    }
+
+    // sub tries run on the shared worker pool, the caller takes part
+    CWorkerPool::GetShared().ParallelFor(vSubTrie.size(), [&](const std::size_t nIndex) {
+        CSubTrie& sub = vSubTrie[nIndex];
+        uint256 hashSubRoot = valueRoot.vaBranch.GetNextHash(sub.nNibble);
+        sub.fResult = true;
+        for (auto it = sub.itBegin; it != sub.itEnd; ++it)
+        {
+            bytes nbKeyNibble;
+            CKeyNibble::Byte2Nibble(it->first, 0, nbKeyNibble);
+            nbKeyNibble.erase(nbKeyNibble.begin());
+
+            const uint256 hashPrevSubRoot = hashSubRoot;
+            if (!AddNode(hashSubRoot, nbKeyNibble, it->second, sub.mapNode))
+            {
+                sub.fResult = false;
+                break;
+            }
+            if (hashSubRoot != hashPrevSubRoot)
+            {
+                sub.vRootHash.push_back(hashSubRoot);
+            }
+        }
+    });
+
+    std::size_t nRemainUpdate = 0;
+    for (const CSubTrie& sub : vSubTrie)
+    {
+        if (!sub.fResult)
+        {
+            StdLog("CTrieDB", "Create trie node list bulk: Add node fail, nibble: %d, prev root: %s", sub.nNibble, hashPrevRoot.GetHex().c_str());
+            return false;
+        }
+        nRemainUpdate += sub.vRootHash.size();
+    }
+
+    for (const CSubTrie& sub : vSubTrie)
+    {
+        for (const uint256& hash : sub.vRootHash)
+        {
+            valueRoot.vaBranch.SetNextHash(sub.nNibble, hash);
+            --nRemainUpdate;
+            if (hash == 0 && nRemainUpdate > 0 && valueRoot.CalcHash() == 0)
+            {
+                // The serial path would restart from an empty trie here
+                return true;
+            }
+        }
+    }
+
+    for (CSubTrie& sub : vSubTrie)
+    {
+        mapCacheNode.insert(sub.mapNode.begin(), sub.mapNode.end());
+    }
+    hashNewRoot = valueRoot.CalcHash();
+    if (hashNewRoot != hashPrevRoot && hashNewRoot != 0)
+    {
+        mapCacheNode[hashNewRoot] = valueRoot;
+    }
+    fBulk = true;
+    return true;
+}
+
+bool CTrieDB::AddNode(uint256& hashRoot, const bytes& nbKeyNibble, const bytes& btValue, std::map<uint256, CTrieValue>& mapCacheNode)
+{
+    TRIE_NODE_PATH path;
+    std::vector<uint256> vRemove;
+    if (!GetNodePath(hashRoot, nbKeyNibble, path, vRemove, mapCacheNode))
+    {
+        StdLog("CTrieDB", "Add node: Get node path fail, root hash: %s", hashRoot.GetHex().c_str());
+        return false;
+    }
+
+    CTrieKeyValue kvValue;
+    kvValue.nKvType = CTrieKeyValue::KV_TYPE_NEW;
+    kvValue.value.type = CTrieValue::TYPE_VALUE;
+    kvValue.value.vaValue = btValue;
+    kvValue.CalcValueHash();
+    path.push_back(kvValue);
+
+    uint256 hashPrevOld;
+    for (int64 i = path.size() - 2; i >= 0; i--)
+    {
+        CTrieKeyValue& kv = path[i];
+        switch (kv.value.type)
         {
         case CTrieValue::TYPE_BRANCH:
             if (kv.nKvType == CTrieKeyValue::KV_TYPE_SHARE || kv.nKvType == CTrieKeyValue::KV_TYPE_OLD)
@@ -670,153 +1303,513 @@ bool CTrieDB::AddNode(uint256& hashRoot, const bytes& nbKeyNibble, const bytes&
         }
     }
 
-    uint256 hashPrev = kvValue.hashValue;
-    bool fIsValue = true;
-
-    for (int64 i = path.size() - 2; i >= 0; i--)
+    uint256 hashPrev = kvValue.hashValue;
+    bool fIsValue = true;
+
+    for (int64 i = path.size() - 2; i >= 0; i--)
+    {
+        CTrieKeyValue& kv = path[i];
+        switch (kv.value.type)
+        {
+        case CTrieValue::TYPE_BRANCH:
+            if (kv.nKvType == CTrieKeyValue::KV_TYPE_SHARE || kv.nKvType == CTrieKeyValue::KV_TYPE_NEW)
+            {
+                if (kv.keyNew.size() > 0)
+                {
+                    if (fIsValue)
+                    {
+                        if (hashPrev != 0 && kv.value.vaBranch.GetValueHash(kv.keyNew[0]) == hashPrev)
+                        {
+#ifdef TEST_FLAG
+                            std::string strValue(btValue.begin(), btValue.end());
+                            printf("Add node: Branch value same, value: %s, vaue hash: %s\n", strValue.c_str(), hashPrev.GetHex().c_str());
+#endif
+                            return true;
+                        }
+                        kv.value.vaBranch.SetValueHash(kv.keyNew[0], hashPrev);
+                        fIsValue = false;
+                    }
+                    else
+                    {
+                        kv.value.vaBranch.SetNextHash(kv.keyNew[0], hashPrev);
+                    }
+                }
+                kv.CalcValueHash();
+                hashPrev = kv.hashValue;
+            }
+            break;
+        case CTrieValue::TYPE_EXTENSION:
+            if (kv.nKvType == CTrieKeyValue::KV_TYPE_SHARE || kv.nKvType == CTrieKeyValue::KV_TYPE_NEW)
+            {
+                if (fIsValue)
+                {
+                    if (hashPrev != 0 && kv.value.vaExtension.GetValueHash() == hashPrev)
+                    {
+#ifdef TEST_FLAG
+                        std::string strValue(btValue.begin(), btValue.end());
+                        printf("Add node: Extension value same, value: %s, vaue hash: %s\n", strValue.c_str(), hashPrev.GetHex().c_str());
+#endif
+                        return true;
+                    }
+                    kv.value.vaExtension.SetValueHash(hashPrev);
+                    fIsValue = false;
+                }
+                else
+                {
+                    kv.value.vaExtension.SetNextHash(hashPrev);
+                }
+                kv.CalcValueHash();
+                hashPrev = kv.hashValue;
+            }
+            break;
+        case CTrieValue::TYPE_VALUE:
+        default:
+            StdLog("CTrieDB", "Add node: New node type error, type: %d, hash: %s", kv.value.type, kv.hashValue.GetHex().c_str());
+            return false;
+        }
+    }
+    hashRoot = hashPrev;
+
+    for (const uint256& hash : vRemove)
+    {
+        mapCacheNode.erase(hash);
+    }
+
+    for (std::size_t i = 0; i < path.size(); i++)
+    {
+        const CTrieKeyValue& kv = path[i];
+        if (kv.hashValue != 0)
+        {
+            mapCacheNode[kv.hashValue] = kv.value;
+        }
+    }
+    return true;
+}
+
+bool CTrieDB::GetNodeValue(const uint256& hash, CTrieValue& value, bool& fCache, std::map<uint256, CTrieValue>& mapCacheNode)
+{
+    if (hash == 0)
+    {
+        return false;
+    }
+    auto it = mapCacheNode.find(hash);
+    if (it != mapCacheNode.end())
+    {
+        value = it->second;
+        fCache = true;
+    }
+    else
+    {
+        if (!GetDbNodeValue(hash, value))
+        {
+            return false;
+        }
+        fCache = false;
+    }
+    return true;
+}
+
+void CTrieDB::AddNodeCache(const std::map<uint256, CTrieValue>& mapCacheNode, const std::map<uint256, std::size_t>& mapCacheSize)
+{
+    CTrieNodeCache& cacheNode = GetNodeCache();
+    for (const auto& kv : mapCacheSize)
+    {
+        auto it = mapCacheNode.find(kv.first);
+        if (it != mapCacheNode.end())
+        {
+            cacheNode.AddNew(GetCacheKey(kv.first), it->second, kv.second);
+        }
+    }
+}
+
+bool CTrieDB::SetDbNodeValue(const uint256& hash, const CTrieValue& value, std::map<uint256, std::size_t>& mapCacheSize)
+{
+    CBufStream ssKey, ssValue;
+    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+    if (!value.GetStoreStream(ssValue))
+    {
+        StdLog("CTrieDB", "Set db node value: Get stream fail, hash: %s", hash.GetHex().c_str());
+        return false;
+    }
+    const std::size_t nSize = GetNodeCacheSize(ssValue.GetSize());
+    if (!Write(ssKey, ssValue))
+    {
+        StdLog("CTrieDB", "Set db node value: Write fail, hash: %s", hash.GetHex().c_str());
+        return false;
+    }
+    mapCacheSize[hash] = nSize;
+    return true;
+}
+
+bool CTrieDB::GetDbNodeValue(const uint256& hash, CTrieValue& value, const bool fUseCache)
+{
+    CTrieNodeCache& cacheNode = GetNodeCache();
+    if (fUseCache && cacheNode.Retrieve(GetCacheKey(hash), value))
+    {
+        return true;
+    }
+    CBufStream ssKey, ssValue;
+    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+    if (!Read(ssKey, ssValue))
+    {
+        StdLog("CTrieDB", "Get db node value: Read fail, hash: %s", hash.GetHex().c_str());
+        return false;
+    }
+    const std::size_t nSize = GetNodeCacheSize(ssValue.GetSize());
+    bool fLegacy = false;
+    if (!value.SetStoreStream(ssValue, fLegacy))
+    {
+        StdLog("CTrieDB", "Get db node value: Set stream fail, hash: %s", hash.GetHex().c_str());
+        return false;
+    }
+    if (fUseCache)
+    {
+        cacheNode.AddNew(GetCacheKey(hash), value, nSize);
+    }
+    return true;
+}
+
+bool CTrieDB::GetDbNodeValues(const std::vector<uint256>& vHash, std::map<uint256, CTrieValue>& mapValue)
+{
+    CTrieNodeCache& cacheNode = GetNodeCache();
+    std::vector<uint256> vReadHash;
+    std::vector<bytes> vKey;
+    vReadHash.reserve(vHash.size());
+    vKey.reserve(vHash.size());
+    for (const uint256& hash : vHash)
+    {
+        CTrieValue value;
+        if (cacheNode.Retrieve(GetCacheKey(hash), value))
+        {
+            mapValue.insert(std::make_pair(hash, value));
+            continue;
+        }
+        CBufStream ssKey;
+        ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+        vReadHash.push_back(hash);
+        vKey.push_back(ssKey.GetBytes());
+    }
+    if (vKey.empty())
+    {
+        return true;
+    }
+    CKVDBMultiValue mvValue;
+    if (!MultiRead(vKey, mvValue))
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < vReadHash.size(); i++)
+    {
+        CBufStream ssValue;
+        if (mvValue.GetValue(i, ssValue))
+        {
+            const std::size_t nSize = GetNodeCacheSize(ssValue.GetSize());
+            CTrieValue value;
+            bool fLegacy = false;
+            if (!value.SetStoreStream(ssValue, fLegacy))
+            {
+                StdLog("CTrieDB", "Get db node values: Set stream fail, hash: %s", vReadHash[i].GetHex().c_str());
+                return false;
+            }
+            cacheNode.AddNew(GetCacheKey(vReadHash[i]), value, nSize);
+            mapValue.insert(std::make_pair(vReadHash[i], value));
+        }
+    }
+    return true;
+}
+
+// One pass over every stored node at startup, before the db serves readers or commits.
+// Branches still in the legacy layout are rewritten in the compact layout; the node hash
+// does not depend on the storage layout, so references and roots stay valid.
+bool CTrieDB::MigrateLegacyNodes()
+{
+    hnbase::CWriteLock wlock(rwAccess);
+
+    {
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_STORE_VERSION;
+        uint32 nVersion = 0;
+        if (Read(ssKey, ssValue))
+        {
+            ssValue >> nVersion;
+            if (nVersion >= STORE_VERSION_COMPACT)
+            {
+                return true;
+            }
+        }
+    }
+
+    int64 nBeginTime = GetTimeMillis();
+    uint64 nNodeCount = 0;
+    uint64 nMigrateCount = 0;
+    bool fWriteFail = false;
+    CBufStream ssKeyBegin, ssKeyPrefix;
+    ssKeyBegin << TDB_KEY_TYPE_TRIE_KEY;
+    ssKeyPrefix << TDB_KEY_TYPE_TRIE_KEY;
+    auto funcWalker = [&](CBufStream& ssKey, CBufStream& ssValue) -> bool {
+        nNodeCount++;
+        CTrieValue value;
+        bool fLegacy = false;
+        try
+        {
+            if (!value.SetStoreStream(ssValue, fLegacy) || !fLegacy)
+            {
+                return true;
+            }
+        }
+        catch (std::exception& e)
+        {
+            StdError(__PRETTY_FUNCTION__, e.what());
+            return true;
+        }
+        CBufStream ssStore;
+        if (!value.GetStoreStream(ssStore) || !Write(ssKey, ssStore))
+        {
+            fWriteFail = true;
+            return false;
+        }
+        if (++nMigrateCount % 100000 == 0)
+        {
+            StdLog("CTrieDB", "Migrate legacy nodes: migrated: %lu, scanned: %lu", nMigrateCount, nNodeCount);
+        }
+        return true;
+    };
+    if (!WalkThroughOfPrefix(ssKeyBegin, ssKeyPrefix, funcWalker) || fWriteFail)
+    {
+        StdLog("CTrieDB", "Migrate legacy nodes: Walk fail, migrated: %lu, scanned: %lu", nMigrateCount, nNodeCount);
+        return false;
+    }
+
+    CBufStream ssKey, ssValue;
+    ssKey << TDB_KEY_TYPE_STORE_VERSION;
+    ssValue << (uint32)STORE_VERSION_COMPACT;
+    if (!Write(ssKey, ssValue))
+    {
+        StdLog("CTrieDB", "Migrate legacy nodes: Write store version fail");
+        return false;
+    }
+    if (nMigrateCount > 0)
+    {
+        StdLog("CTrieDB", "Migrate legacy nodes: migrated: %lu, scanned: %lu, time: %ld ms", nMigrateCount, nNodeCount, GetTimeMillis() - nBeginTime);
+    }
+    return true;
+}
+
+bool CTrieDB::RemoveDbNodeValue(const uint256& hash)
+{
+    GetNodeCache().Remove(GetCacheKey(hash));
+    CBufStream ssKey;
+    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+    return Erase(ssKey);
+}
+
+// Reference counts cover only nodes written by journaled commits: a node counts its parents'
+// links plus one pin per journaled commit of a root. Nodes without a count predate journaling
+// or came from an unjournaled commit; they are never deleted.
+bool CTrieDB::AddJournalNodeRef(const uint256& hashRoot, const uint32 nJournalHeight, const std::map<uint256, CTrieValue>& mapCacheNode, std::map<uint256, std::size_t>& mapCacheSize)
+{
+    std::vector<uint256> vCacheHash;
+    std::vector<bytes> vKey;
+    vCacheHash.reserve(mapCacheNode.size());
+    vKey.reserve(mapCacheNode.size());
+    for (const auto& kv : mapCacheNode)
+    {
+        CBufStream ssKey;
+        ssKey << TDB_KEY_TYPE_TRIE_KEY << kv.first;
+        vCacheHash.push_back(kv.first);
+        vKey.push_back(ssKey.GetBytes());
+    }
+    CKVDBMultiValue mvValue;
+    if (!vKey.empty() && !MultiRead(vKey, mvValue))
+    {
+        return false;
+    }
+    std::set<uint256> setNewNode;
+    for (std::size_t i = 0; i < vCacheHash.size(); i++)
+    {
+        if (!mvValue.IsFound(i))
+        {
+            setNewNode.insert(vCacheHash[i]);
+        }
+    }
+
+    // A new node links its children once, however many parents reach it.
+    std::map<uint256, uint32> mapRefDelta;
+    std::vector<uint256> vExpand;
+    mapRefDelta[hashRoot]++;
+    if (setNewNode.count(hashRoot))
     {
-        CTrieKeyValue& kv = path[i];
-        switch (kv.value.type)
+        vExpand.push_back(hashRoot);
+    }
+    std::set<uint256> setExpanded;
+    while (!vExpand.empty())
+    {
+        const uint256 hash = vExpand.back();
+        vExpand.pop_back();
+        if (!setExpanded.insert(hash).second)
         {
-        case CTrieValue::TYPE_BRANCH:
-            if (kv.nKvType == CTrieKeyValue::KV_TYPE_SHARE || kv.nKvType == CTrieKeyValue::KV_TYPE_NEW)
-            {
-                if (kv.keyNew.size() > 0)
-                {
-                    if (fIsValue)
-                    {
-                        if (hashPrev != 0 && kv.value.vaBranch.GetValueHash(kv.keyNew[0]) == hashPrev)
-                        {
-#ifdef TEST_FLAG
-                            std::string strValue(btValue.begin(), btValue.end());
-                            printf("Add node: Branch value same, value: %s, vaue hash: %s\n", strValue.c_str(), hashPrev.GetHex().c_str());
-#endif
-                            return true;
-                        }
-                        kv.value.vaBranch.SetValueHash(kv.keyNew[0], hashPrev);
-                        fIsValue = false;
-                    }
-                    else
-                    {
-                        kv.value.vaBranch.SetNextHash(kv.keyNew[0], hashPrev);
-                    }
-                }
-                kv.CalcValueHash();
-                hashPrev = kv.hashValue;
-            }
-            break;
-        case CTrieValue::TYPE_EXTENSION:
-            if (kv.nKvType == CTrieKeyValue::KV_TYPE_SHARE || kv.nKvType == CTrieKeyValue::KV_TYPE_NEW)
+            continue;
+        }
+        const CTrieValue& value = mapCacheNode.at(hash);
+        if (!SetDbNodeValue(hash, value, mapCacheSize))
+        {
+            return false;
+        }
+        std::vector<uint256> vChildHash;
+        value.GetChildHash(vChildHash);
+        for (const uint256& hashChild : vChildHash)
+        {
+            mapRefDelta[hashChild]++;
+            if (setNewNode.count(hashChild))
             {
-                if (fIsValue)
-                {
-                    if (hashPrev != 0 && kv.value.vaExtension.GetValueHash() == hashPrev)
-                    {
-#ifdef TEST_FLAG
-                        std::string strValue(btValue.begin(), btValue.end());
-                        printf("Add node: Extension value same, value: %s, vaue hash: %s\n", strValue.c_str(), hashPrev.GetHex().c_str());
-#endif
-                        return true;
-                    }
-                    kv.value.vaExtension.SetValueHash(hashPrev);
-                    fIsValue = false;
-                }
-                else
-                {
-                    kv.value.vaExtension.SetNextHash(hashPrev);
-                }
-                kv.CalcValueHash();
-                hashPrev = kv.hashValue;
+                vExpand.push_back(hashChild);
             }
-            break;
-        case CTrieValue::TYPE_VALUE:
-        default:
-            StdLog("CTrieDB", "Add node: New node type error, type: %d, hash: %s", kv.value.type, kv.hashValue.GetHex().c_str());
+        }
+    }
+
+    for (const auto& kv : mapRefDelta)
+    {
+        uint32 nRef = 0;
+        if (!setNewNode.count(kv.first) && !ReadNodeRef(kv.first, nRef))
+        {
+            continue;
+        }
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_NODE_REF << kv.first;
+        ssValue << (uint32)(nRef + kv.second);
+        if (!Write(ssKey, ssValue))
+        {
             return false;
         }
     }
-    hashRoot = hashPrev;
 
-    for (const uint256& hash : vRemove)
     {
-        mapCacheNode.erase(hash);
+        uint32 nCommitCount = 0;
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_ROOT_JOURNAL << nJournalHeight << hashRoot;
+        if (Read(ssKey, ssValue) && ssValue.GetSize() == sizeof(uint32))
+        {
+            ssValue >> nCommitCount;
+        }
+        ssValue.Clear();
+        ssValue << (uint32)(nCommitCount + 1);
+        if (!Write(ssKey, ssValue))
+        {
+            return false;
+        }
     }
 
-    for (std::size_t i = 0; i < path.size(); i++)
+    uint32 nBeginHeight = 0;
+    if (!ReadJournalHeight(nBeginHeight) || nJournalHeight < nBeginHeight)
     {
-        const CTrieKeyValue& kv = path[i];
-        if (kv.hashValue != 0)
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_JOURNAL_HEIGHT;
+        ssValue << nJournalHeight;
+        if (!Write(ssKey, ssValue))
         {
-            mapCacheNode[kv.hashValue] = kv.value;
+            return false;
         }
     }
     return true;
 }
 
-bool CTrieDB::GetNodeValue(const uint256& hash, CTrieValue& value, bool& fCache, std::map<uint256, CTrieValue>& mapCacheNode)
+bool CTrieDB::ReleaseJournalRoot(const uint256& hashRoot, const uint32 nCommitCount, std::map<uint256, uint32>& mapRef, CTriePruneStat& stat)
 {
-    if (hash == 0)
-    {
-        return false;
-    }
-    auto it = mapCacheNode.find(hash);
-    if (it != mapCacheNode.end())
-    {
-        value = it->second;
-        fCache = true;
-    }
-    else
+    std::vector<std::pair<uint256, uint32>> vRelease;
+    vRelease.push_back(std::make_pair(hashRoot, nCommitCount));
+    while (!vRelease.empty())
     {
-        if (!GetDbNodeValue(hash, value))
+        const uint256 hash = vRelease.back().first;
+        const uint32 nRelease = vRelease.back().second;
+        vRelease.pop_back();
+
+        auto it = mapRef.find(hash);
+        if (it == mapRef.end())
         {
-            return false;
+            uint32 nRef = 0;
+            if (!ReadNodeRef(hash, nRef))
+            {
+                continue;
+            }
+            it = mapRef.insert(std::make_pair(hash, nRef)).first;
+        }
+        if (it->second == 0)
+        {
+            StdLog("CTrieDB", "Release journal root: Node already released, hash: %s", hash.GetHex().c_str());
+            continue;
+        }
+        if (it->second > nRelease)
+        {
+            it->second -= nRelease;
+            continue;
+        }
+        it->second = 0;
+
+        CBufStream ssKey, ssValue;
+        ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+        if (Read(ssKey, ssValue))
+        {
+            stat.nByteCount += ssKey.GetSize() + ssValue.GetSize();
+            CTrieValue value;
+            bool fLegacy = false;
+            if (!value.SetStoreStream(ssValue, fLegacy))
+            {
+                StdLog("CTrieDB", "Release journal root: Set stream fail, hash: %s", hash.GetHex().c_str());
+                return false;
+            }
+            std::vector<uint256> vChildHash;
+            value.GetChildHash(vChildHash);
+            for (const uint256& hashChild : vChildHash)
+            {
+                vRelease.push_back(std::make_pair(hashChild, 1));
+            }
+            RemoveDbNodeValue(hash);
+            stat.nNodeCount++;
         }
-        fCache = false;
     }
     return true;
 }
 
-bool CTrieDB::SetDbNodeValue(const uint256& hash, const CTrieValue& value)
+bool CTrieDB::ReadNodeRef(const uint256& hash, uint32& nRef)
 {
     CBufStream ssKey, ssValue;
-    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
-    if (!value.GetStream(ssValue))
+    ssKey << TDB_KEY_TYPE_NODE_REF << hash;
+    if (!Read(ssKey, ssValue))
     {
-        StdLog("CTrieDB", "Set db node value: Get stream fail, hash: %s", hash.GetHex().c_str());
         return false;
     }
-    if (!Write(ssKey, ssValue))
+    try
     {
-        StdLog("CTrieDB", "Set db node value: Write fail, hash: %s", hash.GetHex().c_str());
+        ssValue >> nRef;
+    }
+    catch (std::exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
         return false;
     }
     return true;
 }
 
-bool CTrieDB::GetDbNodeValue(const uint256& hash, CTrieValue& value)
+bool CTrieDB::ReadJournalHeight(uint32& nHeight)
 {
     CBufStream ssKey, ssValue;
-    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
+    ssKey << TDB_KEY_TYPE_JOURNAL_HEIGHT;
     if (!Read(ssKey, ssValue))
     {
-        StdLog("CTrieDB", "Get db node value: Read fail, hash: %s", hash.GetHex().c_str());
         return false;
     }
-    if (!value.SetStream(ssValue))
+    try
     {
-        StdLog("CTrieDB", "Get db node value: Set stream fail, hash: %s", hash.GetHex().c_str());
+        ssValue >> nHeight;
+    }
+    catch (std::exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
         return false;
     }
     return true;
 }
 
-bool CTrieDB::RemoveDbNodeValue(const uint256& hash)
-{
-    CBufStream ssKey;
-    ssKey << TDB_KEY_TYPE_TRIE_KEY << hash;
-    return Erase(ssKey);
-}
-
 bool CTrieDB::GetNodePath(const uint256& hashRoot, const bytes& nbKeyNibble, TRIE_NODE_PATH& path, std::vector<uint256>& vRemove, std::map<uint256, CTrieValue>& mapCacheNode)
 {
     uint256 hash = hashRoot;
@@ -1192,7 +2185,7 @@ bool CTrieDB::WalkerAll(CBufStream& ssKey, CBufStream& ssValue, CTrieDBWalker& w
 }
 
 bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix, bytes& nbBeginKey, const bool fReverse, const bytes& nbPrevKey,
-                              CTrieDBWalker& walker, std::map<uint256, CTrieValue>& mapCacheNode, const uint32 nDepth, bool& fWalkOver)
+                              CTrieDBWalker& walker, std::map<uint256, CTrieValue>& mapCacheNode, const uint32 nDepth, bool& fWalkOver, const bool fUseCache)
 {
     if (fWalkOver)
     {
@@ -1207,7 +2200,7 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
     }
     else
     {
-        if (!GetDbNodeValue(hashNode, value))
+        if (!GetDbNodeValue(hashNode, value, fUseCache))
         {
             StdLog("CTrieDB", "Walk Through Node: Get Db Node Value fail, hash: %s", hashNode.GetHex().c_str());
 #ifdef TEST_FLAG
@@ -1279,7 +2272,7 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
                 strValue.assign(btValue.begin(), btValue.end());
                 printf("Walk Through Node: Branch node: key: %x, value: %s\n", nBranchKey, strValue.c_str());
 #endif
-                if (!WalkThroughNode(hashValue, nbNextKeyPrefix, nbBeginKey, fReverse, nbNextKey, walker, mapCacheNode, nDepth + 1, fWalkOver))
+                if (!WalkThroughNode(hashValue, nbNextKeyPrefix, nbBeginKey, fReverse, nbNextKey, walker, mapCacheNode, nDepth + 1, fWalkOver, fUseCache))
                 {
                     return false;
                 }
@@ -1290,7 +2283,7 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
 #ifdef TEST_FLAG
                 printf("Walk Through Node: Branch node: key: %x, next hash: %s\n", nBranchKey, hashSub.GetHex().c_str());
 #endif
-                if (!WalkThroughNode(hashSub, nbNextKeyPrefix, nbBeginKey, fReverse, nbNextKey, walker, mapCacheNode, nDepth + 1, fWalkOver))
+                if (!WalkThroughNode(hashSub, nbNextKeyPrefix, nbBeginKey, fReverse, nbNextKey, walker, mapCacheNode, nDepth + 1, fWalkOver, fUseCache))
                 {
                     return false;
                 }
@@ -1347,7 +2340,7 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
             strValue.assign(btValue.begin(), btValue.end());
             printf("Walk Through Node: Extension node: key: %s, value: %s\n", strKey.c_str(), strValue.c_str());
 #endif
-            if (!WalkThroughNode(hashValue, nbNextKeyPrefix, nbBeginKey, fReverse, nbKey, walker, mapCacheNode, nDepth + 1, fWalkOver))
+            if (!WalkThroughNode(hashValue, nbNextKeyPrefix, nbBeginKey, fReverse, nbKey, walker, mapCacheNode, nDepth + 1, fWalkOver, fUseCache))
             {
                 return false;
             }
@@ -1358,7 +2351,7 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
 #ifdef TEST_FLAG
             printf("Walk Through Node: Extension node: key: %s, next hash: %s\n", strKey.c_str(), hashSub.GetHex().c_str());
 #endif
-            if (!WalkThroughNode(hashSub, nbNextKeyPrefix, nbBeginKey, fReverse, nbKey, walker, mapCacheNode, nDepth + 1, fWalkOver))
+            if (!WalkThroughNode(hashSub, nbNextKeyPrefix, nbBeginKey, fReverse, nbKey, walker, mapCacheNode, nDepth + 1, fWalkOver, fUseCache))
             {
                 return false;
             }
@@ -1385,5 +2378,225 @@ bool CTrieDB::WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix,
     return true;
 }
 
+//////////////////////////////
+// CTrieIterator
+
+CTrieIterator::CTrieIterator(CTrieDB& dbTrieIn, const uint256& hashRootIn, const bytes& btKeyPrefixIn)
+  : dbTrie(dbTrieIn), hashRoot(hashRootIn), btKeyPrefix(btKeyPrefixIn), fValid(false)
+{
+}
+
+bool CTrieIterator::SeekToFirst()
+{
+    return Seek(btKeyPrefix);
+}
+
+bool CTrieIterator::Seek(const bytes& btKey)
+{
+    hnbase::CReadLock rlock(dbTrie.rwAccess);
+
+    vStack.clear();
+    fValid = false;
+    if (hashRoot == 0)
+    {
+        return true;
+    }
+    bytes nbTarget;
+    CKeyNibble::Byte2Nibble((btKey < btKeyPrefix ? btKeyPrefix : btKey), 0, nbTarget);
+    if (!SeekNode(nbTarget))
+    {
+        StdLog("CTrieIterator", "Seek: Seek node fail, root: %s", hashRoot.GetHex().c_str());
+        vStack.clear();
+        return false;
+    }
+    return FindNext();
+}
+
+bool CTrieIterator::Next()
+{
+    hnbase::CReadLock rlock(dbTrie.rwAccess);
+    if (!fValid)
+    {
+        return false;
+    }
+    return FindNext();
+}
+
+bool CTrieIterator::PushNode(const uint256& hash, const bytes& nbPath, CFrame*& pFrame)
+{
+    CFrame frame;
+    if (!dbTrie.GetDbNodeValue(hash, frame.value))
+    {
+        StdLog("CTrieIterator", "Push node: Get db node value fail, hash: %s", hash.GetHex().c_str());
+        return false;
+    }
+    if (frame.value.type != CTrieValue::TYPE_BRANCH && frame.value.type != CTrieValue::TYPE_EXTENSION)
+    {
+        StdLog("CTrieIterator", "Push node: Node type error, type: %d, hash: %s", frame.value.type, hash.GetHex().c_str());
+        return false;
+    }
+    frame.nbPath = nbPath;
+    vStack.push_back(frame);
+    pFrame = &vStack.back();
+    return true;
+}
+
+// Build the stack so that the next FindNext returns the first key not less than nbTarget.
+// Branch slot 2n is the value of nibble n and slot 2n+1 its subtree; extension slot 0 is the value and 1 the subtree.
+// nPos is the last consumed slot.
+bool CTrieIterator::SeekNode(const bytes& nbTarget)
+{
+    CFrame* pFrame = nullptr;
+    if (!PushNode(hashRoot, bytes(), pFrame))
+    {
+        return false;
+    }
+    while (pFrame != nullptr)
+    {
+        CFrame& frame = *pFrame;
+        pFrame = nullptr;
+        const std::size_t nDepth = frame.nbPath.size();
+        if (frame.value.type == CTrieValue::TYPE_BRANCH)
+        {
+            if (nDepth >= nbTarget.size())
+            {
+                frame.nPos = -1;
+                break;
+            }
+            const uint8 n = nbTarget[nDepth];
+            if (nDepth + 1 == nbTarget.size())
+            {
+                frame.nPos = n * 2 - 1;
+                break;
+            }
+            frame.nPos = n * 2 + 1;
+            const uint256 hashNext = frame.value.vaBranch.GetNextHash(n);
+            if (hashNext != 0)
+            {
+                bytes nbPath = frame.nbPath;
+                nbPath.push_back(n);
+                if (!PushNode(hashNext, nbPath, pFrame))
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            bytes nbKey;
+            frame.value.vaExtension.GetKey(nbKey);
+            const std::size_t nRemain = (nDepth < nbTarget.size() ? nbTarget.size() - nDepth : 0);
+            const std::size_t nCmpSize = std::min(nbKey.size(), nRemain);
+            const int nCmp = (nCmpSize == 0 ? 0 : memcmp(nbKey.data(), nbTarget.data() + nDepth, nCmpSize));
+            if (nCmp < 0)
+            {
+                // Whole subtree is less than the target
+                frame.nPos = 1;
+                break;
+            }
+            if (nCmp > 0 || nRemain <= nbKey.size())
+            {
+                // Whole subtree is not less than the target
+                frame.nPos = -1;
+                break;
+            }
+            frame.nPos = 1;
+            const uint256 hashNext = frame.value.vaExtension.GetNextHash();
+            if (hashNext != 0)
+            {
+                bytes nbPath = frame.nbPath;
+                nbPath.insert(nbPath.end(), nbKey.begin(), nbKey.end());
+                if (!PushNode(hashNext, nbPath, pFrame))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool CTrieIterator::FindNext()
+{
+    fValid = false;
+    while (!vStack.empty())
+    {
+        CFrame& frame = vStack.back();
+        frame.nPos++;
+
+        bytes nbKey = frame.nbPath;
+        uint256 hashValue, hashNext;
+        if (frame.value.type == CTrieValue::TYPE_BRANCH)
+        {
+            if (frame.nPos >= 32)
+            {
+                vStack.pop_back();
+                continue;
+            }
+            const uint8 n = frame.nPos / 2;
+            nbKey.push_back(n);
+            if ((frame.nPos & 1) == 0)
+            {
+                hashValue = frame.value.vaBranch.GetValueHash(n);
+            }
+            else
+            {
+                hashNext = frame.value.vaBranch.GetNextHash(n);
+            }
+        }
+        else
+        {
+            if (frame.nPos >= 2)
+            {
+                vStack.pop_back();
+                continue;
+            }
+            bytes nbExtKey;
+            frame.value.vaExtension.GetKey(nbExtKey);
+            nbKey.insert(nbKey.end(), nbExtKey.begin(), nbExtKey.end());
+            if (frame.nPos == 0)
+            {
+                hashValue = frame.value.vaExtension.GetValueHash();
+            }
+            else
+            {
+                hashNext = frame.value.vaExtension.GetNextHash();
+            }
+        }
+
+        if (hashNext != 0)
+        {
+            CFrame* pFrame = nullptr;
+            if (!PushNode(hashNext, nbKey, pFrame))
+            {
+                vStack.clear();
+                return false;
+            }
+        }
+        else if (hashValue != 0)
+        {
+            CTrieValue value;
+            if (!dbTrie.GetDbNodeValue(hashValue, value) || value.type != CTrieValue::TYPE_VALUE)
+            {
+                StdLog("CTrieIterator", "Find next: Get value fail, hash: %s", hashValue.GetHex().c_str());
+                vStack.clear();
+                return false;
+            }
+            btCurrKey.clear();
+            CKeyNibble::Nibble2Byte(nbKey, btCurrKey);
+            if (btCurrKey.size() < btKeyPrefix.size() || !std::equal(btKeyPrefix.begin(), btKeyPrefix.end(), btCurrKey.begin()))
+            {
+                // Keys are ordered, so the prefix range is exhausted
+                vStack.clear();
+                return true;
+            }
+            btCurrValue = value.vaValue;
+            fValid = true;
+            return true;
+        }
+    }
+    return true;
+}
+
 } // namespace storage
 } // namespace hashahead
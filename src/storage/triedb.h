@@ -5,7 +5,9 @@
 #ifndef STORAGE_TRIEDB_H
 #define STORAGE_TRIEDB_H
 
+#include <array>
 #include <map>
+#include <set>
 
 #include "destination.h"
 #include "hnbase.h"
@@ -31,17 +33,25 @@ class CTrieBranch
 {
     friend class hnbase::CStream;
 
+public:
+    // Slot counts the compact layout can hold, larger branches are stored in the legacy layout
+    enum
+    {
+        MAX_SLOT_COUNT = 0xFF
+    };
+
 protected:
-    std::vector<uint8> keyIndexNext;
-    std::vector<uint8> keyIndexValue;
-    std::vector<uint256> branchNext;
-    std::vector<uint256> branchValue;
+    std::array<uint8, 16> keyIndexNext;
+    std::array<uint8, 16> keyIndexValue;
+    uint32 nNextCount;
+    std::vector<uint256> branchHash; // next hashes followed by value hashes
 
 public:
     CTrieBranch()
+      : nNextCount(0)
     {
-        keyIndexNext.resize(16);
-        keyIndexValue.resize(16);
+        keyIndexNext.fill(0);
+        keyIndexValue.fill(0);
     }
 
     uint256 GetNextHash(const uint8 n) const;
@@ -50,15 +60,18 @@ public:
     uint256 GetValueHash(const uint8 n) const;
     void SetValueHash(const uint8 n, const uint256& hash);
 
-protected:
-    template <typename O>
-    void Serialize(hnbase::CStream& s, O& opt)
+    bool IsCompactable() const
     {
-        s.Serialize(keyIndexNext, opt);
-        s.Serialize(keyIndexValue, opt);
-        s.Serialize(branchNext, opt);
-        s.Serialize(branchValue, opt);
+        return (nNextCount <= MAX_SLOT_COUNT && branchHash.size() - nNextCount <= MAX_SLOT_COUNT);
     }
+    void GetCompactStream(hnbase::CBufStream& ssValue) const;
+    bool SetCompactData(const uint8* pData, const std::size_t nSize, std::size_t& nUsed);
+
+protected:
+    // Legacy layout: four length-prefixed vectors. It is the preimage of the node hash and must stay unchanged.
+    void Serialize(hnbase::CStream& s, hnbase::SaveType& opt);
+    void Serialize(hnbase::CStream& s, hnbase::LoadType& opt);
+    void Serialize(hnbase::CStream& s, std::size_t& serSize);
 };
 
 class CTrieExtension
@@ -75,7 +88,7 @@ public:
       : flag(0) {}
 
     void SetKey(const std::vector<uint8>& vKeyNibble);
-    void GetKey(std::vector<uint8>& vKeyNibble);
+    void GetKey(std::vector<uint8>& vKeyNibble) const;
     void SetNextHash(const uint256& hash);
     void SetValueHash(const uint256& hash);
     uint256 GetNextHash() const;
@@ -100,13 +113,21 @@ public:
         TYPE_EXTENSION = 2,
         TYPE_VALUE = 3
     };
+    enum
+    {
+        STORE_BRANCH_COMPACT_V1 = 0x81
+    };
 
     CTrieValue()
       : type(0) {}
 
     bool SetStream(hnbase::CBufStream& ssValue);
     bool GetStream(hnbase::CBufStream& ssValue) const;
+    // Storage encoding: branches use the compact layout, other nodes the hash layout.
+    bool SetStoreStream(hnbase::CBufStream& ssValue, bool& fLegacy);
+    bool GetStoreStream(hnbase::CBufStream& ssValue) const;
     const uint256 CalcHash();
+    void GetChildHash(std::vector<uint256>& vChildHash) const;
 
 public:
     uint8 type;
@@ -163,21 +184,69 @@ public:
     }
 };
 
+//////////////////////////////////////////////////////////////
+// CTriePruneStat
+
+class CTriePruneStat
+{
+public:
+    CTriePruneStat()
+      : nHeightCount(0), nRootCount(0), nNodeCount(0), nByteCount(0) {}
+
+public:
+    uint32 nHeightCount;
+    uint64 nRootCount;
+    uint64 nNodeCount;
+    uint64 nByteCount;
+};
+
+//////////////////////////////////////////////////////////////
+// CTrieNodeCache
+
+// [cache id of the owning CTrieDB][node hash]
+typedef std::pair<uint32, uint256> CTrieNodeCacheKey;
+
+class CTrieNodeHashShard
+{
+public:
+    std::size_t operator()(const CTrieNodeCacheKey& key) const
+    {
+        return (std::size_t)(key.second.Get64() ^ key.first);
+    }
+};
+
+// Decoded trie nodes shared by every CTrieDB instance. Entries are keyed by the owning
+// database as well, a node cached for one database says nothing about another one.
+typedef hnbase::CShardedLruCache<CTrieNodeCacheKey, CTrieValue, CTrieNodeHashShard> CTrieNodeCache;
+
 //////////////////////////////////////////////////////////////
 // CTrieDB
 
+class CTrieIterator;
+
 class CTrieDB : public hnbase::CKVDB
 {
+    friend class CTrieIterator;
+
 public:
-    CTrieDB() {}
-    bool Initialize(const boost::filesystem::path& pathData);
+    CTrieDB()
+      : fJournal(false), nCacheId(0) {}
+    static CTrieNodeCache& GetNodeCache();
+    static void GetNodeCacheStat(CTrieNodeCache::CStat& stat);
+    bool Initialize(const boost::filesystem::path& pathData, const bool fJournalIn = false);
     void Deinitialize();
     void Clear();
 
     bool AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot);
+    // Journaled commit: the new root is pinned at nJournalHeight and its nodes are reference counted.
+    bool AddNewTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, const uint32 nJournalHeight);
+    // Unpin the roots journaled below nPruneHeight and delete the nodes no longer referenced.
+    // Stops at a height boundary once nMaxNodeCount nodes are deleted (0: no limit).
+    bool PruneJournal(const uint32 nPruneHeight, const uint64 nMaxNodeCount, CTriePruneStat& stat);
     bool CreateCacheTrie(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode);
     bool SaveCacheTrie(std::map<uint256, CTrieValue>& mapCacheNode);
     bool Retrieve(const uint256& hashRoot, const bytes& btKey, bytes& btValue);
+    bool RetrieveBatch(const uint256& hashRoot, const std::vector<bytes>& vKey, bytesmap& mapValue);
     bool WalkThroughTrie(const uint256& hashRoot, CTrieDBWalker& walker, const bytes& btKeyPrefix = bytes(), const bytes& btBeginKeyTail = bytes(), const bool fReverse = false);
     bool WalkThroughAll(CTrieDBWalker& walker);
     bool CheckTrie(const std::vector<uint256>& vCheckRoot);
@@ -191,21 +260,93 @@ public:
 
 protected:
     bool CreateTrieNodeList(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode);
+    bool CreateTrieNodeListBulk(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode, bool& fBulk);
     bool AddNode(uint256& hashRoot, const bytes& nbKeyNibble, const bytes& btValue, std::map<uint256, CTrieValue>& mapCacheNode);
     bool GetNodeValue(const uint256& hash, CTrieValue& value, bool& fCache, std::map<uint256, CTrieValue>& mapCacheNode);
-    bool SetDbNodeValue(const uint256& hash, const CTrieValue& value);
-    bool GetDbNodeValue(const uint256& hash, CTrieValue& value);
+    CTrieNodeCacheKey GetCacheKey(const uint256& hash) const
+    {
+        return CTrieNodeCacheKey(nCacheId, hash);
+    }
+    void AddNodeCache(const std::map<uint256, CTrieValue>& mapCacheNode, const std::map<uint256, std::size_t>& mapCacheSize);
+    bool SetDbNodeValue(const uint256& hash, const CTrieValue& value, std::map<uint256, std::size_t>& mapCacheSize);
+    bool GetDbNodeValue(const uint256& hash, CTrieValue& value, const bool fUseCache = true);
+    bool GetDbNodeValues(const std::vector<uint256>& vHash, std::map<uint256, CTrieValue>& mapValue);
+    bool MigrateLegacyNodes();
     bool RemoveDbNodeValue(const uint256& hash);
+    bool AddJournalNodeRef(const uint256& hashRoot, const uint32 nJournalHeight, const std::map<uint256, CTrieValue>& mapCacheNode, std::map<uint256, std::size_t>& mapCacheSize);
+    bool ReleaseJournalRoot(const uint256& hashRoot, const uint32 nCommitCount, std::map<uint256, uint32>& mapRef, CTriePruneStat& stat);
+    bool ReadNodeRef(const uint256& hash, uint32& nRef);
+    bool ReadJournalHeight(uint32& nHeight);
     bool GetNodePath(const uint256& hashRoot, const bytes& nbKeyNibble, TRIE_NODE_PATH& path, std::vector<uint256>& vRemove, std::map<uint256, CTrieValue>& mapCacheNode);
     bool GetBranchPath(bytes& syKey, uint256& hash, CTrieValue& value, TRIE_NODE_PATH& path);
     bool GetExtensionPath(bytes& syKey, uint256& hash, CTrieValue& value, TRIE_NODE_PATH& path);
     bool GetKeyValue(const uint256& hashRoot, const bytes& nbKey, bytes& btValue);
     bool WalkerAll(hnbase::CBufStream& ssKey, hnbase::CBufStream& ssValue, CTrieDBWalker& walker);
     bool WalkThroughNode(const uint256& hashNode, const bytes& nbKeyPrefix, bytes& nbBeginKey, const bool fReverse, const bytes& nbPrevKey,
-                         CTrieDBWalker& walker, std::map<uint256, CTrieValue>& mapCacheNode, const uint32 nDepth, bool& fWalkOver);
+                         CTrieDBWalker& walker, std::map<uint256, CTrieValue>& mapCacheNode, const uint32 nDepth, bool& fWalkOver, const bool fUseCache = true);
 
 protected:
+    enum
+    {
+        STORE_VERSION_COMPACT = 1
+    };
+
     hnbase::CRWAccess rwAccess;
+    bool fJournal;
+    uint32 nCacheId;
+};
+
+//////////////////////////////////////////////////////////////
+// CTrieIterator
+
+// Pull-style ordered scan of one trie root. Memory is bounded by the trie depth:
+// only the nodes on the current path are held. The root must not be pruned while iterating.
+class CTrieIterator
+{
+public:
+    CTrieIterator(CTrieDB& dbTrieIn, const uint256& hashRootIn, const bytes& btKeyPrefixIn = bytes());
+
+    bool SeekToFirst();
+    bool Seek(const bytes& btKey);
+    bool Next();
+    bool IsValid() const
+    {
+        return fValid;
+    }
+    const bytes& GetKey() const
+    {
+        return btCurrKey;
+    }
+    const bytes& GetValue() const
+    {
+        return btCurrValue;
+    }
+
+protected:
+    class CFrame
+    {
+    public:
+        CFrame()
+          : nPos(-1) {}
+
+    public:
+        CTrieValue value;
+        bytes nbPath;
+        int nPos;
+    };
+
+    bool PushNode(const uint256& hash, const bytes& nbPath, CFrame*& pFrame);
+    bool SeekNode(const bytes& nbTarget);
+    bool FindNext();
+
+protected:
+    CTrieDB& dbTrie;
+    const uint256 hashRoot;
+    const bytes btKeyPrefix;
+    std::vector<CFrame> vStack;
+    bool fValid;
+    bytes btCurrKey;
+    bytes btCurrValue;
 };
 
 } // namespace storage
@@ -21,6 +21,97 @@ namespace storage
 const uint8 DB_TXINDEX_KEY_NAME_TXINDEX = 0x01;
 const uint8 DB_TXINDEX_KEY_NAME_TXRECEIPT = 0x02;
 const uint8 DB_TXINDEX_KEY_NAME_TXPOS = 0x03;
+const uint8 DB_TXINDEX_KEY_NAME_BLOCKRECEIPT = 0x04;
+
+//////////////////////////////
+// CPackedBlockReceipts
+
+void CPackedBlockReceipts::Pack(const std::vector<CTransactionReceipt>& vTxReceipt)
+{
+    vTxid.clear();
+    vOffset.clear();
+    btReceiptData.clear();
+    vTxid.reserve(vTxReceipt.size());
+    vOffset.reserve(vTxReceipt.size());
+
+    for (const auto& receipt : vTxReceipt)
+    {
+        bytes btReceipt, btCompressed;
+        FlatSerialize(receipt, btReceipt);
+        BtCompress(btReceipt, btCompressed);
+
+        vTxid.push_back(receipt.txid);
+        vOffset.push_back((uint32)btReceiptData.size());
+        btReceiptData.insert(btReceiptData.end(), btCompressed.begin(), btCompressed.end());
+    }
+}
+
+bool CPackedBlockReceipts::GetReceipt(const std::size_t nIndex, CTransactionReceipt& receipt) const
+{
+    return UncompressReceipt(vOffset, btReceiptData.data(), btReceiptData.size(), nIndex, receipt);
+}
+
+bool CPackedBlockReceipts::GetAllReceipts(std::vector<CTransactionReceipt>& vTxReceipt) const
+{
+    vTxReceipt.reserve(vTxReceipt.size() + vOffset.size());
+    for (std::size_t i = 0; i < vOffset.size(); i++)
+    {
+        CTransactionReceipt receipt;
+        if (!GetReceipt(i, receipt))
+        {
+            return false;
+        }
+        vTxReceipt.push_back(receipt);
+    }
+    return true;
+}
+
+std::size_t CPackedBlockReceipts::GetCount() const
+{
+    return vOffset.size();
+}
+
+bool CPackedBlockReceipts::SliceReceipt(const uint8* pData, const std::size_t nSize, const std::size_t nIndex, CTransactionReceipt& receipt)
+{
+    try
+    {
+        // same layout as Serialize: offset table, then the length prefixed receipt data
+        CFlatReadStream ss(pData, nSize);
+        std::vector<uint32> vOffsetRead;
+        CVarInt varDataSize;
+        ss >> vOffsetRead >> varDataSize;
+        if (varDataSize.GetValue() > ss.GetSize())
+        {
+            return false;
+        }
+        return UncompressReceipt(vOffsetRead, pData + ss.GetReadPos(), varDataSize.GetValue(), nIndex, receipt);
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return false;
+}
+
+bool CPackedBlockReceipts::UncompressReceipt(const std::vector<uint32>& vOffsetIn, const uint8* pData, const std::size_t nDataSize, const std::size_t nIndex, CTransactionReceipt& receipt)
+{
+    if (nIndex >= vOffsetIn.size())
+    {
+        return false;
+    }
+    const std::size_t nBegin = vOffsetIn[nIndex];
+    const std::size_t nEnd = (nIndex + 1 < vOffsetIn.size() ? vOffsetIn[nIndex + 1] : nDataSize);
+    if (nBegin > nEnd || nEnd > nDataSize)
+    {
+        return false;
+    }
+    bytes btReceipt;
+    if (!BtUncompress(bytes(pData + nBegin, pData + nEnd), btReceipt))
+    {
+        return false;
+    }
+    return FlatDeserialize(btReceipt.data(), btReceipt.size(), receipt);
+}
 
 //////////////////////////////
 // CForkTxIndexDB
@@ -75,11 +166,13 @@ bool CForkTxIndexDB::AddBlockTxIndexReceipt(const uint256& hashBlock, const std:
         }
     }
 
-    for (const auto& receipt : vTxReceipts)
+    // one packed record per block, the tx position written on the long chain carries the index into it
+    CPackedBlockReceipts packReceipts;
+    packReceipts.Pack(vTxReceipts);
     {
         hnbase::CBufStream ssKey, ssValue;
-        ssKey << DB_TXINDEX_KEY_NAME_TXRECEIPT << hashBlock << receipt.txid;
-        ssValue << receipt;
+        ssKey << DB_TXINDEX_KEY_NAME_BLOCKRECEIPT << hashBlock;
+        ssValue << packReceipts;
 
         if (!Write(ssKey, ssValue))
         {
@@ -115,11 +208,32 @@ bool CForkTxIndexDB::UpdateTxIndexBlockLongChain(const std::vector<uint256>& vRe
         }
     }
 
+    // receipt index of each tx in its block's packed record, blocks saved before packed receipts have none
+    std::map<uint256, std::map<uint256, std::size_t>> mapBlockReceiptIndex;
     for (const auto& kv : mapNewTx)
     {
+        auto it = mapBlockReceiptIndex.find(kv.second);
+        if (it == mapBlockReceiptIndex.end())
+        {
+            it = mapBlockReceiptIndex.insert(std::make_pair(kv.second, std::map<uint256, std::size_t>())).first;
+            CPackedBlockReceipts packReceipts;
+            if (RetrievePackedReceipts(kv.second, packReceipts))
+            {
+                for (std::size_t i = 0; i < packReceipts.vTxid.size(); i++)
+                {
+                    it->second.insert(std::make_pair(packReceipts.vTxid[i], i));
+                }
+            }
+        }
+
         hnbase::CBufStream ssKey, ssValue;
         ssKey << DB_TXINDEX_KEY_NAME_TXPOS << kv.first;
         ssValue << kv.second;
+        auto mt = it->second.find(kv.first);
+        if (mt != it->second.end())
+        {
+            ssValue << CVarInt((uint64)mt->second);
+        }
         if (!Write(ssKey, ssValue))
         {
             TxnAbort();
@@ -180,6 +294,8 @@ bool CForkTxIndexDB::RetrieveTxReceipt(const uint256& txid, CTransactionReceipt&
 {
     CReadLock rlock(rwAccess);
     uint256 hashBlock;
+    bool fPacked = false;
+    CVarInt varIndex;
     try
     {
         hnbase::CBufStream ssKey, ssValue;
@@ -189,6 +305,11 @@ bool CForkTxIndexDB::RetrieveTxReceipt(const uint256& txid, CTransactionReceipt&
             return false;
         }
         ssValue >> hashBlock;
+        if (ssValue.GetSize() > 0)
+        {
+            ssValue >> varIndex;
+            fPacked = true;
+        }
     }
     catch (std::exception& e)
     {
@@ -196,6 +317,27 @@ bool CForkTxIndexDB::RetrieveTxReceipt(const uint256& txid, CTransactionReceipt&
         return false;
     }
 
+    if (fPacked)
+    {
+        try
+        {
+            hnbase::CBufStream ssKey, ssValue;
+            ssKey << DB_TXINDEX_KEY_NAME_BLOCKRECEIPT << hashBlock;
+            if (!Read(ssKey, ssValue))
+            {
+                StdLog("CForkTxIndexDB", "Retrieve Tx Receipt: Read packed receipts fail, txid: %s, block: %s", txid.ToString().c_str(), hashBlock.ToString().c_str());
+                return false;
+            }
+            return CPackedBlockReceipts::SliceReceipt((const uint8*)ssValue.GetData(), ssValue.GetSize(), varIndex.GetValue(), txReceipt);
+        }
+        catch (std::exception& e)
+        {
+            hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+            return false;
+        }
+    }
+
+    // blocks saved before packed receipts keep one record per tx
     try
     {
         hnbase::CBufStream ssKey, ssValue;
@@ -214,6 +356,69 @@ bool CForkTxIndexDB::RetrieveTxReceipt(const uint256& txid, CTransactionReceipt&
     return true;
 }
 
+bool CForkTxIndexDB::RetrieveBlockTxReceipts(const uint256& hashBlock, const std::vector<uint256>& vTxid, std::vector<CTransactionReceipt>& vTxReceipt)
+{
+    CReadLock rlock(rwAccess);
+
+    CPackedBlockReceipts packReceipts;
+    if (RetrievePackedReceipts(hashBlock, packReceipts))
+    {
+        std::map<uint256, std::size_t> mapTxIndex;
+        for (std::size_t i = 0; i < packReceipts.vTxid.size(); i++)
+        {
+            mapTxIndex.insert(std::make_pair(packReceipts.vTxid[i], i));
+        }
+        for (const uint256& txid : vTxid)
+        {
+            auto it = mapTxIndex.find(txid);
+            if (it != mapTxIndex.end())
+            {
+                CTransactionReceipt receipt;
+                if (!packReceipts.GetReceipt(it->second, receipt))
+                {
+                    StdLog("CForkTxIndexDB", "Retrieve Block Tx Receipts: Get packed receipt fail, txid: %s, block: %s", txid.ToString().c_str(), hashBlock.ToString().c_str());
+                    return false;
+                }
+                vTxReceipt.push_back(receipt);
+            }
+        }
+        return true;
+    }
+
+    std::vector<bytes> vKey;
+    vKey.reserve(vTxid.size());
+    for (const uint256& txid : vTxid)
+    {
+        hnbase::CBufStream ssKey;
+        ssKey << DB_TXINDEX_KEY_NAME_TXRECEIPT << hashBlock << txid;
+        vKey.push_back(ssKey.GetBytes());
+    }
+
+    CKVDBMultiValue mvValue;
+    if (!MultiRead(vKey, mvValue))
+    {
+        return false;
+    }
+
+    try
+    {
+        for (std::size_t i = 0; i < vTxid.size(); i++)
+        {
+            CTransactionReceipt receipt;
+            if (mvValue.GetValue(i, receipt))
+            {
+                vTxReceipt.push_back(receipt);
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
 bool CForkTxIndexDB::VerifyTxIndex(const uint256& hashPrevBlock, const uint256& hashBlock, uint256& hashRoot, const bool fVerifyAllNode)
 {
     return true;
@@ -233,7 +438,8 @@ bool CForkTxIndexDB::WalkThroughSnapshotTxIndex(const uint256& hashLastBlock, Wa
             uint8 nKeyType;
             ssKey >> nKeyType;
             uint256 hashBlock;
-            if (nKeyType == DB_TXINDEX_KEY_NAME_TXINDEX || nKeyType == DB_TXINDEX_KEY_NAME_TXRECEIPT)
+            if (nKeyType == DB_TXINDEX_KEY_NAME_TXINDEX || nKeyType == DB_TXINDEX_KEY_NAME_TXRECEIPT
+                || nKeyType == DB_TXINDEX_KEY_NAME_BLOCKRECEIPT)
             {
                 ssKey >> hashBlock;
             }
@@ -268,6 +474,27 @@ bool CForkTxIndexDB::WriteTxIndexKvData(const bytes& btKey, const bytes& btValue
     return Write(ssKey, ssValue);
 }
 
+//------------------------------------------
+bool CForkTxIndexDB::RetrievePackedReceipts(const uint256& hashBlock, CPackedBlockReceipts& packReceipts)
+{
+    try
+    {
+        hnbase::CBufStream ssKey, ssValue;
+        ssKey << DB_TXINDEX_KEY_NAME_BLOCKRECEIPT << hashBlock;
+        if (!Read(ssKey, ssValue))
+        {
+            return false;
+        }
+        ssValue >> packReceipts;
+        return (packReceipts.vTxid.size() == packReceipts.vOffset.size());
+    }
+    catch (std::exception& e)
+    {
+        hnbase::StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return false;
+}
+
 //////////////////////////////
 // CTxIndexDB
 
@@ -406,6 +633,18 @@ bool CTxIndexDB::RetrieveTxReceipt(const uint256& hashFork, const uint256& txid,
     return false;
 }
 
+bool CTxIndexDB::RetrieveBlockTxReceipts(const uint256& hashFork, const uint256& hashBlock, const std::vector<uint256>& vTxid, std::vector<CTransactionReceipt>& vTxReceipt)
+{
+    CReadLock rlock(rwAccess);
+
+    auto it = mapTxIndexDB.find(hashFork);
+    if (it != mapTxIndexDB.end())
+    {
+        return it->second->RetrieveBlockTxReceipts(hashBlock, vTxid, vTxReceipt);
+    }
+    return false;
+}
+
 bool CTxIndexDB::VerifyTxIndex(const uint256& hashFork, const uint256& hashPrevBlock, const uint256& hashBlock, uint256& hashRoot, const bool fVerifyAllNode)
 {
     CReadLock rlock(rwAccess);
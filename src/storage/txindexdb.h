@@ -16,6 +16,39 @@ namespace hashahead
 namespace storage
 {
 
+// Receipts of one block in a single record, each compressed on its own and located by index through an offset table
+class CPackedBlockReceipts
+{
+    friend class hnbase::CStream;
+
+public:
+    CPackedBlockReceipts() {}
+
+    void Pack(const std::vector<CTransactionReceipt>& vTxReceipt);
+    bool GetReceipt(const std::size_t nIndex, CTransactionReceipt& receipt) const;
+    bool GetAllReceipts(std::vector<CTransactionReceipt>& vTxReceipt) const;
+    std::size_t GetCount() const;
+    // Reads one receipt straight from a serialized record, the tx list and the other receipts are not decoded
+    static bool SliceReceipt(const uint8* pData, const std::size_t nSize, const std::size_t nIndex, CTransactionReceipt& receipt);
+
+protected:
+    static bool UncompressReceipt(const std::vector<uint32>& vOffsetIn, const uint8* pData, const std::size_t nDataSize, const std::size_t nIndex, CTransactionReceipt& receipt);
+
+public:
+    std::vector<uint32> vOffset;
+    bytes btReceiptData;
+    std::vector<uint256> vTxid;
+
+protected:
+    template <typename O>
+    void Serialize(hnbase::CStream& s, O& opt)
+    {
+        s.Serialize(vOffset, opt);
+        s.Serialize(btReceiptData, opt);
+        s.Serialize(vTxid, opt);
+    }
+};
+
 class CForkTxIndexDB : public hnbase::CKVDB
 {
 public:
@@ -29,10 +62,14 @@ public:
     bool UpdateTxIndexBlockLongChain(const std::vector<uint256>& vRemoveTx, const std::map<uint256, uint256>& mapNewTx);
     bool RetrieveTxIndex(const uint256& txid, uint256& hashTxAtBlock, CTxIndex& txIndex);
     bool RetrieveTxReceipt(const uint256& txid, CTransactionReceipt& txReceipt);
+    bool RetrieveBlockTxReceipts(const uint256& hashBlock, const std::vector<uint256>& vTxid, std::vector<CTransactionReceipt>& vTxReceipt);
     bool VerifyTxIndex(const uint256& hashPrevBlock, const uint256& hashBlock, uint256& hashRoot, const bool fVerifyAllNode = true);
     bool WalkThroughSnapshotTxIndex(const uint256& hashLastBlock, WalkerTxIndexKvFunc fnWalker);
     bool WriteTxIndexKvData(const bytes& btKey, const bytes& btValue);
 
+protected:
+    bool RetrievePackedReceipts(const uint256& hashBlock, CPackedBlockReceipts& packReceipts);
+
 protected:
     uint256 hashFork;
     hnbase::CRWAccess rwAccess;
@@ -55,6 +92,7 @@ public:
     bool UpdateTxIndexBlockLongChain(const uint256& hashFork, const std::vector<uint256>& vRemoveTx, const std::map<uint256, uint256>& mapNewTx);
     bool RetrieveTxIndex(const uint256& hashFork, const uint256& txid, uint256& hashTxAtBlock, CTxIndex& txIndex);
     bool RetrieveTxReceipt(const uint256& hashFork, const uint256& txid, CTransactionReceipt& txReceipt);
+    bool RetrieveBlockTxReceipts(const uint256& hashFork, const uint256& hashBlock, const std::vector<uint256>& vTxid, std::vector<CTransactionReceipt>& vTxReceipt);
     bool VerifyTxIndex(const uint256& hashFork, const uint256& hashPrevBlock, const uint256& hashBlock, uint256& hashRoot, bool fVerifyAllNode = true);
     bool WalkThroughSnapshotTxIndex(const uint256& hashFork, const uint256& hashLastBlock, WalkerTxIndexKvFunc fnWalker);
     bool WriteTxIndexKvData(const uint256& hashFork, const bytes& btKey, const bytes& btValue);
@@ -0,0 +1,305 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/test/unit_test.hpp>
+
+#include "chnblock.h"
+#include "chnusertx.h"
+#include "crypto.h"
+#include "schedule.h"
+#include "test_big.h"
+
+using namespace std;
+using namespace hnbase;
+using namespace hashahead;
+
+//./build-release/test/test_big --log_level=all --run_test=chnsync_tests/usertxknownfiltertest
+//./build-release/test/test_big --log_level=all --run_test=chnsync_tests/cmpctblockfillertest
+//./build-release/test/test_big --log_level=all --run_test=chnsync_tests/stalledblocktest
+
+BOOST_FIXTURE_TEST_SUITE(chnsync_tests, BasicUtfSetup)
+
+static uint64 MakeShortId(const uint64 n)
+{
+    return crypto::CryptoHash(&n, sizeof(n)).Get64(0);
+}
+
+BOOST_AUTO_TEST_CASE(usertxknownfiltertest)
+{
+    const uint64 nGenCount = CUserTxKnownFilter::GENERATION_ENTRY_COUNT;
+    const uint64 nProbeCount = 100000;
+    CUserTxKnownFilter filter;
+
+    BOOST_CHECK(!filter.Contains(MakeShortId(0)));
+
+    // generation A fills the current generation
+    for (uint64 i = 0; i < nGenCount; i++)
+    {
+        filter.Insert(MakeShortId(i));
+    }
+    for (uint64 i = 0; i < nGenCount; i++)
+    {
+        BOOST_CHECK(filter.Contains(MakeShortId(i)));
+    }
+
+    // false positives on ids never inserted stay far below one in ten thousand
+    std::size_t nFalsePositive = 0;
+    for (uint64 i = 0; i < nProbeCount; i++)
+    {
+        if (filter.Contains(MakeShortId(nGenCount * 4 + i)))
+        {
+            nFalsePositive++;
+        }
+    }
+    BOOST_CHECK(nFalsePositive < nProbeCount / 10000);
+
+    // generation B rolls over once, A is still known as the previous generation
+    for (uint64 i = nGenCount; i < nGenCount * 2; i++)
+    {
+        filter.Insert(MakeShortId(i));
+    }
+    for (uint64 i = 0; i < nGenCount * 2; i++)
+    {
+        BOOST_CHECK(filter.Contains(MakeShortId(i)));
+    }
+
+    // the next insert rolls over again and forgets A as a whole
+    filter.Insert(MakeShortId(nGenCount * 2));
+    BOOST_CHECK(filter.Contains(MakeShortId(nGenCount * 2)));
+    std::size_t nForgotten = 0;
+    for (uint64 i = 0; i < nGenCount; i++)
+    {
+        if (!filter.Contains(MakeShortId(i)))
+        {
+            nForgotten++;
+        }
+    }
+    BOOST_CHECK(nForgotten > nGenCount - nGenCount / 1000);
+    for (uint64 i = nGenCount; i < nGenCount * 2; i++)
+    {
+        BOOST_CHECK(filter.Contains(MakeShortId(i)));
+    }
+
+    // false positives stay low with both generations in use
+    nFalsePositive = 0;
+    for (uint64 i = 0; i < nProbeCount; i++)
+    {
+        if (filter.Contains(MakeShortId(nGenCount * 4 + i)))
+        {
+            nFalsePositive++;
+        }
+    }
+    BOOST_CHECK(nFalsePositive < nProbeCount / 10000);
+}
+
+static CTransaction MakeTx(const uint64 nNonce)
+{
+    CTransaction tx;
+    tx.SetNonce(nNonce);
+    tx.SetAmount(uint256(nNonce + 1));
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(cmpctshortidtest)
+{
+    const uint64 nBlockSeed = 1;
+    const uint256 hashBlock = crypto::CryptoHash(&nBlockSeed, sizeof(nBlockSeed));
+    const uint256 hashOtherBlock = crypto::CryptoHash(&hashBlock, sizeof(hashBlock));
+    const CCmpctShortIdKey keyShortId(hashBlock, 100);
+
+    // the same block and salt give the same ids on both sides, another salt or block gives others
+    std::set<uint64> setShortId;
+    for (uint64 i = 0; i < 1000; i++)
+    {
+        const uint256 txid = MakeTx(i).GetHash();
+        const uint64 nShortId = keyShortId.GetShortId(txid);
+        BOOST_CHECK(nShortId == CCmpctShortIdKey(hashBlock, 100).GetShortId(txid));
+        BOOST_CHECK(nShortId != CCmpctShortIdKey(hashBlock, 101).GetShortId(txid));
+        BOOST_CHECK(nShortId != CCmpctShortIdKey(hashOtherBlock, 100).GetShortId(txid));
+        setShortId.insert(nShortId);
+    }
+    BOOST_CHECK(setShortId.size() == 1000);
+}
+
+BOOST_AUTO_TEST_CASE(cmpctblockfillertest)
+{
+    const uint64 nSalt = 100;
+    CBlock block;
+    for (uint64 i = 0; i < 6; i++)
+    {
+        block.vtx.push_back(MakeTx(i));
+    }
+    const uint256 hashBlock = block.GetHash();
+
+    // txs 0 and 3 are prefilled, the others go as short ids
+    const std::vector<CTransaction> vPrefilledTx = { block.vtx[0], block.vtx[3] };
+    std::vector<uint64> vShortId;
+    const CCmpctShortIdKey keyShortId(hashBlock, nSalt);
+    for (const std::size_t i : { 1, 2, 4, 5 })
+    {
+        vShortId.push_back(keyShortId.GetShortId(block.vtx[i].GetHash()));
+    }
+
+    // prefilled indexes must match the txs, be in range and be unique
+    {
+        CCmpctBlockFiller filler(hashBlock, nSalt);
+        BOOST_CHECK(!filler.SetPrefilledTx(vPrefilledTx, { 0 }, vShortId.size()));
+        BOOST_CHECK(!filler.SetPrefilledTx(vPrefilledTx, { 0, 6 }, vShortId.size()));
+        BOOST_CHECK(!filler.SetPrefilledTx(vPrefilledTx, { 3, 3 }, vShortId.size()));
+        BOOST_CHECK(!filler.SetPrefilledTx(vPrefilledTx, { 0, 3 }, vShortId.size() - 2));
+    }
+
+    CCmpctBlockFiller filler(hashBlock, nSalt);
+    BOOST_CHECK(filler.SetPrefilledTx(vPrefilledTx, { 0, 3 }, vShortId.size()));
+    BOOST_CHECK(filler.vtx.size() == 6);
+    BOOST_CHECK(filler.vtx[0].GetHash() == block.vtx[0].GetHash() && filler.vtx[3].GetHash() == block.vtx[3].GetHash());
+
+    // tx 5 is not in the pool, the short id of tx 2 is listed by two pool entries and matches neither
+    const std::vector<uint256> vPoolTxid = { block.vtx[1].GetHash(), block.vtx[2].GetHash(), block.vtx[2].GetHash(), block.vtx[4].GetHash(), MakeTx(100).GetHash() };
+    filler.SetPoolTxid(vPoolTxid);
+    std::vector<std::pair<uint32, uint256>> vMatch;
+    filler.MatchShortId(vShortId, vMatch);
+    BOOST_CHECK(vMatch.size() == 4);
+    BOOST_CHECK(vMatch[0].first == 1 && vMatch[0].second == block.vtx[1].GetHash());
+    BOOST_CHECK(vMatch[1].first == 2 && vMatch[1].second == 0);
+    BOOST_CHECK(vMatch[2].first == 4 && vMatch[2].second == block.vtx[4].GetHash());
+    BOOST_CHECK(vMatch[3].first == 5 && vMatch[3].second == 0);
+
+    // the unresolved txs are requested by ascending unique index
+    std::vector<uint32> vMissIndex;
+    for (const auto& match : vMatch)
+    {
+        if (match.second == 0)
+        {
+            vMissIndex.push_back(match.first);
+        }
+    }
+    BOOST_CHECK(vMissIndex == std::vector<uint32>({ 2, 5 }));
+    BOOST_CHECK(CCmpctBlockFiller::CheckTxIndex(vMissIndex, block.vtx.size()));
+    BOOST_CHECK(!CCmpctBlockFiller::CheckTxIndex({ 5, 2 }, block.vtx.size()));
+    BOOST_CHECK(!CCmpctBlockFiller::CheckTxIndex({ 2, 2 }, block.vtx.size()));
+    BOOST_CHECK(!CCmpctBlockFiller::CheckTxIndex({ 2, 6 }, block.vtx.size()));
+    BOOST_CHECK(!CCmpctBlockFiller::CheckTxIndex({ 0, 1, 2, 3, 4, 5, 6 }, block.vtx.size()));
+
+    // a pool tx taken for the wrong short id changes the block hash, which sends the full block request
+    CBlock blockRebuilt = block;
+    blockRebuilt.vtx = filler.vtx;
+    blockRebuilt.vtx[1] = block.vtx[1];
+    blockRebuilt.vtx[2] = MakeTx(100);
+    blockRebuilt.vtx[4] = block.vtx[4];
+    blockRebuilt.vtx[5] = block.vtx[5];
+    BOOST_CHECK(blockRebuilt.GetHash() != hashBlock);
+    blockRebuilt.vtx[2] = block.vtx[2];
+    BOOST_CHECK(blockRebuilt.GetHash() == hashBlock);
+}
+
+BOOST_AUTO_TEST_CASE(blockwindowtest)
+{
+    CInvPeer peer;
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MIN_PEER_BLOCK_WINDOW);
+
+    // a window delivered far inside the target time at most doubles, up to the cap
+    std::size_t nWindow = CInvPeer::MIN_PEER_BLOCK_WINDOW;
+    for (int i = 0; i < 6; i++)
+    {
+        peer.StartBlockWindow(peer.GetBlockWindow());
+        peer.nWindowStartTime = GetTimeMillis() - 10;
+        peer.ReceivedBlock(1000);
+        nWindow = std::min(nWindow * 2, (std::size_t)CInvPeer::MAX_PEER_BLOCK_WINDOW);
+        BOOST_CHECK(peer.GetBlockWindow() == nWindow);
+    }
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MAX_PEER_BLOCK_WINDOW);
+
+    // nothing is resized while blocks of the window are still assigned
+    const network::CInv inv(network::CInv::MSG_BLOCK, CBlock::CreateBlockHash(1, 1, 0, uint256(1)));
+    peer.StartBlockWindow(peer.GetBlockWindow());
+    peer.nWindowStartTime = GetTimeMillis() - 64000;
+    peer.Assign(inv);
+    peer.ReceivedBlock(1000);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MAX_PEER_BLOCK_WINDOW);
+
+    // a slow window is sized down to the measured rate, not below the minimum
+    peer.Completed(inv);
+    peer.ReceivedBlock(1000);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MIN_PEER_BLOCK_WINDOW);
+
+    // 4 blocks in 2 target times sizes the next window to 2 blocks per target time
+    peer.nBlockWindow = 8;
+    peer.StartBlockWindow(4);
+    peer.nWindowStartTime = GetTimeMillis() - CInvPeer::BLOCK_WINDOW_TARGET_TIME * 2;
+    peer.ReceivedBlock(1000);
+    BOOST_CHECK(peer.GetBlockWindow() == 2);
+
+    // a shrink halves the window and drops the window being measured
+    peer.nBlockWindow = CInvPeer::MAX_PEER_BLOCK_WINDOW;
+    peer.StartBlockWindow(peer.GetBlockWindow());
+    peer.ShrinkBlockWindow();
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MAX_PEER_BLOCK_WINDOW / 2);
+    peer.nWindowStartTime = GetTimeMillis() - 10;
+    peer.ReceivedBlock(1000);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MAX_PEER_BLOCK_WINDOW / 2);
+    for (int i = 0; i < 6; i++)
+    {
+        peer.ShrinkBlockWindow();
+    }
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MIN_PEER_BLOCK_WINDOW);
+}
+
+// Moves the assign time back instead of waiting for it
+class CScheduleTest : public CSchedule
+{
+public:
+    void DelayAssign(const network::CInv& inv, const int64 nTime)
+    {
+        mapState[inv].nAssignTime -= nTime;
+    }
+    void SetGetDataCount(const network::CInv& inv, const int nCount)
+    {
+        mapState[inv].nGetDataCount = nCount;
+    }
+    CInvPeer& GetPeer(const uint64 nNonce)
+    {
+        return mapPeer[nNonce];
+    }
+};
+
+BOOST_AUTO_TEST_CASE(stalledblocktest)
+{
+    const uint64 nPeerA = 1;
+    const uint64 nPeerB = 2;
+    const network::CInv inv(network::CInv::MSG_BLOCK, CBlock::CreateBlockHash(1, 1, 0, uint256(1)));
+    CScheduleTest sched;
+    BOOST_CHECK(sched.AddNewInv(inv, nPeerA));
+    BOOST_CHECK(sched.AddNewInv(inv, nPeerB));
+    sched.GetPeer(nPeerA).nBlockWindow = 8;
+
+    std::vector<network::CInv> vInv;
+    bool fMissingPrev = false;
+    bool fEmpty = false;
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeerA, vInv, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == 1 && vInv[0] == inv);
+    BOOST_CHECK(sched.GetPeer(nPeerA).GetAssigned(network::CInv::MSG_BLOCK).count(inv.nHash));
+
+    // another peer does not take the block while the first is inside the wait time
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeerB, vInv, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.empty());
+
+    // a stalled peer loses the block to the next peer scheduled and its window is halved
+    sched.DelayAssign(inv, CSchedule::MAX_BLOCK_ASSIGN_WAIT_TIME);
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeerB, vInv, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == 1 && vInv[0] == inv);
+    BOOST_CHECK(sched.GetPeer(nPeerB).GetAssigned(network::CInv::MSG_BLOCK).count(inv.nHash));
+    BOOST_CHECK(!sched.GetPeer(nPeerA).IsAssigned());
+    BOOST_CHECK(sched.GetPeer(nPeerA).GetBlockWindow() == 4);
+
+    // past the regetdata limit a stalled block is dropped instead of moving on
+    sched.SetGetDataCount(inv, CSchedule::MAX_REGETDATA_COUNT);
+    sched.DelayAssign(inv, CSchedule::MAX_BLOCK_ASSIGN_WAIT_TIME);
+    sched.ScheduleBlockInv(nPeerA, vInv, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.empty());
+    BOOST_CHECK(!sched.Exists(inv));
+    BOOST_CHECK(!sched.GetPeer(nPeerB).IsAssigned());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -57,4 +57,76 @@ BOOST_AUTO_TEST_CASE(merkletreetest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkletreebench)
+{
+    // pair at a time reference, the layout every prove relies on
+    auto funcBuildReference = [](std::vector<uint256>& vMerkleTree) -> uint256 {
+        std::size_t nLayerHeadIndex = 0;
+        for (std::size_t nSize = vMerkleTree.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        {
+            for (std::size_t i = 0; i < nSize; i += 2)
+            {
+                std::size_t i2 = std::min(i + 1, nSize - 1);
+                vMerkleTree.push_back(crypto::CryptoHash(vMerkleTree[nLayerHeadIndex + i], vMerkleTree[nLayerHeadIndex + i2]));
+            }
+            nLayerHeadIndex += nSize;
+        }
+        return (vMerkleTree.empty() ? uint64(0) : vMerkleTree.back());
+    };
+
+    std::vector<uint256> vPair;
+    for (size_t i = 0; i < 14; i++)
+    {
+        uint256 h(i + 1);
+        vPair.push_back(crypto::CryptoHash(h.begin(), h.size()));
+    }
+    std::vector<uint256> vPairHash(7);
+    crypto::CryptoHashPairs(vPair.data(), 7, vPairHash.data());
+    for (size_t i = 0; i < 7; i++)
+    {
+        BOOST_CHECK(vPairHash[i] == crypto::CryptoHash(vPair[i * 2], vPair[i * 2 + 1]));
+    }
+
+    for (const size_t nLeafCount : { (size_t)1000, (size_t)100000 })
+    {
+        std::vector<uint256> vLeaf;
+        for (size_t i = 0; i < nLeafCount; i++)
+        {
+            uint256 h(i + 1);
+            vLeaf.push_back(crypto::CryptoHash(h.begin(), h.size()));
+        }
+
+        const int nLoop = (nLeafCount > 10000 ? 5 : 200);
+        std::vector<uint256> vReference;
+        int64 nBeginTime = GetTimeMillis();
+        for (int i = 0; i < nLoop; i++)
+        {
+            vReference = vLeaf;
+            funcBuildReference(vReference);
+        }
+        int64 nReferenceTime = GetTimeMillis() - nBeginTime;
+
+        std::vector<uint256> vMerkleTree;
+        nBeginTime = GetTimeMillis();
+        for (int i = 0; i < nLoop; i++)
+        {
+            vMerkleTree = vLeaf;
+            CMerkleTree::BuildMerkleTree(vMerkleTree);
+        }
+        int64 nLayerTime = GetTimeMillis() - nBeginTime;
+
+        BOOST_CHECK(vMerkleTree == vReference);
+        BOOST_CHECK(vMerkleTree.size() == CMerkleTree::GetMerkleTreeSize(nLeafCount));
+        for (const size_t nIndex : { (size_t)0, nLeafCount / 3, nLeafCount - 1 })
+        {
+            MERKLE_PROVE_DATA vMerkleProve;
+            BOOST_CHECK(CMerkleTree::BuildMerkleProve(nIndex, vMerkleTree, nLeafCount, vMerkleProve));
+            BOOST_CHECK(CMerkleTree::VerifyMerkleProve(vMerkleTree.back(), vMerkleProve, vLeaf[nIndex]));
+        }
+
+        std::cout << "merkle tree leaves: " << nLeafCount << ", x" << nLoop << ": pair at a time " << nReferenceTime
+                  << " ms, layer at a time " << nLayerTime << " ms" << std::endl;
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,279 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <thread>
+
+#include "hnbase.h"
+#include "test_big.h"
+
+using namespace std;
+using namespace hnbase;
+using boost::asio::ip::tcp;
+
+//./build-release/test/test_big --log_level=all --run_test=peernet_tests/tunnelmuxtest
+//./build-release/test/test_big --log_level=all --run_test=peernet_tests/tunnelloopbackbench
+//./build-release/test/test_big --log_level=all --run_test=peernet_tests/iotimerwheeltest
+
+BOOST_FIXTURE_TEST_SUITE(peernet_tests, BasicUtfSetup)
+
+static bytes MakeTunnelPayload(const uint8 nTunnelId, const uint32 nSeq, const std::size_t nSize)
+{
+    bytes btPayload(nSize);
+    for (std::size_t i = 0; i < nSize; i++)
+    {
+        btPayload[i] = (uint8)(nTunnelId * 31 + nSeq * 7 + i);
+    }
+    return btPayload;
+}
+
+BOOST_AUTO_TEST_CASE(tunnelmuxtest)
+{
+    const std::vector<std::size_t> vSize = { 1, 255, 256, 257, 1200, 65535, 65536, 65537, 300000 };
+    const std::vector<uint8> vTunnelId = { 0, 3, 8 };
+
+    // small frames, large frames, and a switch to large frames while packets are queued
+    for (int nMode = 0; nMode < 3; nMode++)
+    {
+        CPeerTunnelMux muxSend;
+        CPeerTunnelMux muxRecv;
+        muxSend.SetLargeFrame(nMode == 1);
+
+        // every packet carries its own tunnel id, sequence and size, the body is checked against them
+        std::map<uint8, uint32> mapSendSeq;
+        for (std::size_t i = 0; i < vSize.size(); i++)
+        {
+            for (const uint8 nTunnelId : vTunnelId)
+            {
+                uint32 nSeq = mapSendSeq[nTunnelId]++;
+                CBufStream ss;
+                ss << nTunnelId << nSeq << (uint32)vSize[i];
+                bytes btPayload = MakeTunnelPayload(nTunnelId, nSeq, vSize[i]);
+                ss.Write((char*)btPayload.data(), btPayload.size());
+                BOOST_CHECK(muxSend.WriteStream(nTunnelId, ss));
+            }
+        }
+        CBufStream ssInvalid("x");
+        BOOST_CHECK(!muxSend.WriteStream(CPeerTunnelMux::TUNNEL_ID_MAX + 1, ssInvalid));
+
+        CBufStream ssWire;
+        std::vector<boost::asio::const_buffer> vSend;
+        std::size_t nWriteCount = 0;
+        while (muxSend.PrepareSend(vSend))
+        {
+            BOOST_CHECK(vSend.size() <= CPeerTunnelMux::SEND_FRAME_COUNT * 2);
+            for (const boost::asio::const_buffer& buf : vSend)
+            {
+                ssWire.Write((const char*)buf.data(), buf.size());
+            }
+            vSend.clear();
+            muxSend.CompleteSend();
+            if (nMode == 2 && ++nWriteCount == 2)
+            {
+                muxSend.SetLargeFrame(true);
+            }
+        }
+
+        // feed the wire in uneven pieces so frames are split across reads
+        CBufStream ssFrame;
+        CBufStream ssRecvPacket;
+        std::size_t nPiece = 1;
+        while (ssWire.GetSize() > 0)
+        {
+            ssWire.TransferStream(ssFrame, nPiece);
+            BOOST_CHECK(muxRecv.AddRecvFrame(ssFrame, ssRecvPacket));
+            nPiece = (nPiece * 7 + 3) % 70001 + 1;
+        }
+        BOOST_CHECK(ssFrame.GetSize() == 0);
+
+        std::map<uint8, uint32> mapRecvSeq;
+        std::size_t nPacketCount = 0;
+        while (ssRecvPacket.GetSize() > 0)
+        {
+            uint8 nTunnelId;
+            uint32 nSeq, nSize;
+            ssRecvPacket >> nTunnelId >> nSeq >> nSize;
+            BOOST_CHECK(nSeq == mapRecvSeq[nTunnelId]++);
+            BOOST_CHECK(nSize == vSize[nSeq]);
+            BOOST_CHECK(ssRecvPacket.GetSize() >= nSize);
+            bytes btPayload = MakeTunnelPayload(nTunnelId, nSeq, nSize);
+            BOOST_CHECK(memcmp(ssRecvPacket.GetData(), btPayload.data(), nSize) == 0);
+            ssRecvPacket.consume(nSize);
+            nPacketCount++;
+        }
+        BOOST_CHECK(nPacketCount == vSize.size() * vTunnelId.size());
+    }
+
+    // a zero packet size is a protocol violation
+    CPeerTunnelMux muxRecv;
+    CBufStream ssFrame;
+    CBufStream ssRecvPacket;
+    const uint8 btBadFrame[] = { 2, 3, 0, 0, 0, 0 };
+    ssFrame.Write((const char*)btBadFrame, sizeof(btBadFrame));
+    BOOST_CHECK(!muxRecv.AddRecvFrame(ssFrame, ssRecvPacket));
+}
+
+BOOST_AUTO_TEST_CASE(tunnelloopbackbench)
+{
+    const uint8 nTunnelId = 3;
+    const std::size_t nBlockCount = 8;
+    const std::size_t nBlockSize = 4 * 1024 * 1024;
+    std::vector<bytes> vBlock;
+    for (std::size_t i = 0; i < nBlockCount; i++)
+    {
+        vBlock.push_back(MakeTunnelPayload(nTunnelId, i, nBlockSize));
+    }
+
+    // fBulkRead false replays the old receive path: one read for the frame header and one for the body
+    auto funcLoopback = [&](const bool fLargeFrame, const bool fBulkRead, std::size_t& nReadCount) -> int64 {
+        boost::asio::io_service ioService;
+        tcp::acceptor acceptor(ioService, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        tcp::socket sockSend(ioService);
+        tcp::socket sockRecv(ioService);
+        sockSend.connect(acceptor.local_endpoint());
+        acceptor.accept(sockRecv);
+
+        const int64 nBeginTime = GetTimeMillis();
+        std::thread threadSend([&]() {
+            CPeerTunnelMux muxSend;
+            muxSend.SetLargeFrame(fLargeFrame);
+            for (const bytes& btBlock : vBlock)
+            {
+                CBufStream ss((const char*)btBlock.data(), btBlock.size());
+                muxSend.WriteStream(nTunnelId, ss);
+            }
+            std::vector<boost::asio::const_buffer> vSend;
+            while (muxSend.PrepareSend(vSend))
+            {
+                boost::asio::write(sockSend, vSend);
+                vSend.clear();
+                muxSend.CompleteSend();
+            }
+        });
+
+        CPeerTunnelMux muxRecv;
+        CBufStream ssFrame;
+        CBufStream ssRecvPacket;
+        std::size_t nBlockRecv = 0;
+        nReadCount = 0;
+        while (nBlockRecv < vBlock.size())
+        {
+            if (fBulkRead)
+            {
+                std::size_t n = sockRecv.read_some(ssFrame.prepare(CPeerTunnelMux::RECV_BUFFER_SIZE));
+                ssFrame.commit(n);
+                nReadCount++;
+            }
+            else
+            {
+                std::size_t n = boost::asio::read(sockRecv, ssFrame.prepare(2));
+                ssFrame.commit(n);
+                const uint8* p = (const uint8*)ssFrame.GetData();
+                n = boost::asio::read(sockRecv, ssFrame.prepare((std::size_t)p[1] + 1));
+                ssFrame.commit(n);
+                nReadCount += 2;
+            }
+            if (!muxRecv.AddRecvFrame(ssFrame, ssRecvPacket))
+            {
+                break;
+            }
+            while (nBlockRecv < vBlock.size() && ssRecvPacket.GetSize() >= nBlockSize)
+            {
+                BOOST_CHECK(memcmp(ssRecvPacket.GetData(), vBlock[nBlockRecv].data(), nBlockSize) == 0);
+                ssRecvPacket.consume(nBlockSize);
+                nBlockRecv++;
+            }
+        }
+        threadSend.join();
+        BOOST_CHECK(nBlockRecv == vBlock.size());
+        return GetTimeMillis() - nBeginTime;
+    };
+
+    std::size_t nOldReadCount = 0;
+    int64 nOldTime = funcLoopback(false, false, nOldReadCount);
+    std::size_t nSmallReadCount = 0;
+    int64 nSmallTime = funcLoopback(false, true, nSmallReadCount);
+    std::size_t nLargeReadCount = 0;
+    int64 nLargeTime = funcLoopback(true, true, nLargeReadCount);
+
+    BOOST_CHECK(nOldReadCount == nBlockCount * nBlockSize / 256 * 2 + nBlockCount * 2);
+    BOOST_CHECK(nLargeReadCount < nOldReadCount / 100);
+
+    const double dMBytes = (double)(nBlockCount * nBlockSize) / (1024 * 1024);
+    std::cout << "tunnel loopback " << dMBytes << " MB in " << nBlockSize / 1024 << " KB blocks:" << std::endl
+              << "  256 byte frames, header and body reads: " << nOldReadCount << " reads, " << nOldTime << " ms, "
+              << dMBytes * 1000 / std::max(nOldTime, (int64)1) << " MB/s" << std::endl
+              << "  256 byte frames, 64 KB bulk reads: " << nSmallReadCount << " reads, " << nSmallTime << " ms, "
+              << dMBytes * 1000 / std::max(nSmallTime, (int64)1) << " MB/s" << std::endl
+              << "  64 KB frames, 64 KB bulk reads: " << nLargeReadCount << " reads, " << nLargeTime << " ms, "
+              << dMBytes * 1000 / std::max(nLargeTime, (int64)1) << " MB/s" << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(iotimerwheeltest)
+{
+    CIOTimerWheel wheel;
+    std::vector<uint32> vTimerId;
+
+    // expiry order across slots, 67 shares a slot with 3 but belongs to a later turn of the wheel
+    const uint32 nTimer5 = wheel.AddTimer(1, "t5", 5);
+    const uint32 nTimer3 = wheel.AddTimer(1, "t3", 3);
+    const uint32 nTimer67 = wheel.AddTimer(2, "t67", 3 + CIOTimerWheel::WHEEL_SLOT_COUNT);
+    const uint32 nTimer10 = wheel.AddTimer(2, "t10", 10);
+    const uint32 nTimer4 = wheel.AddTimer(3, "t4", 4);
+
+    wheel.PollExpired(2, vTimerId);
+    BOOST_CHECK(vTimerId.empty());
+
+    wheel.CancelTimer(nTimer10);
+    wheel.PollExpired(10, vTimerId);
+    BOOST_CHECK(vTimerId == std::vector<uint32>({ nTimer3, nTimer4, nTimer5 }));
+
+    // a listed timer canceled before it is taken does not fire
+    wheel.CancelTimer(nTimer4);
+    CIOTimer timer(0, 0, "", 0);
+    BOOST_CHECK(wheel.TakeTimer(nTimer3, timer));
+    BOOST_CHECK(timer.nTimerId == nTimer3 && timer.nNonce == 1 && timer.strFunction == "t3" && timer.nExpiryAt == 3);
+    BOOST_CHECK(!wheel.TakeTimer(nTimer3, timer));
+    BOOST_CHECK(!wheel.TakeTimer(nTimer4, timer));
+    BOOST_CHECK(!wheel.TakeTimer(nTimer10, timer));
+    BOOST_CHECK(wheel.TakeTimer(nTimer5, timer));
+
+    vTimerId.clear();
+    wheel.PollExpired(3 + CIOTimerWheel::WHEEL_SLOT_COUNT - 1, vTimerId);
+    BOOST_CHECK(vTimerId.empty());
+    wheel.PollExpired(3 + CIOTimerWheel::WHEEL_SLOT_COUNT, vTimerId);
+    BOOST_CHECK(vTimerId == std::vector<uint32>({ nTimer67 }));
+    BOOST_CHECK(wheel.TakeTimer(nTimer67, timer));
+
+    // canceling by nonce leaves the timers of other nonces
+    const int64 nNow = 3 + CIOTimerWheel::WHEEL_SLOT_COUNT;
+    const uint32 nTimerA = wheel.AddTimer(9, "a", nNow + 2);
+    const uint32 nTimerB = wheel.AddTimer(8, "b", nNow + 2);
+    const uint32 nTimerC = wheel.AddTimer(9, "c", nNow + 1);
+    wheel.CancelNonceTimers(9);
+    vTimerId.clear();
+    wheel.PollExpired(nNow + 5, vTimerId);
+    BOOST_CHECK(vTimerId == std::vector<uint32>({ nTimerB }));
+    BOOST_CHECK(!wheel.TakeTimer(nTimerA, timer));
+    BOOST_CHECK(!wheel.TakeTimer(nTimerC, timer));
+    BOOST_CHECK(wheel.TakeTimer(nTimerB, timer));
+
+    // an already due timer fires on the next poll, polls further apart than the ring still see every slot
+    const uint32 nTimerDue = wheel.AddTimer(4, "due", nNow);
+    const uint32 nTimerFar = wheel.AddTimer(4, "far", nNow + 5 + CIOTimerWheel::WHEEL_SLOT_COUNT * 3);
+    vTimerId.clear();
+    wheel.PollExpired(nNow + 6, vTimerId);
+    BOOST_CHECK(vTimerId == std::vector<uint32>({ nTimerDue }));
+    vTimerId.clear();
+    wheel.PollExpired(nNow + 5 + CIOTimerWheel::WHEEL_SLOT_COUNT * 4, vTimerId);
+    BOOST_CHECK(vTimerId == std::vector<uint32>({ nTimerFar }));
+
+    wheel.Clear();
+    BOOST_CHECK(!wheel.TakeTimer(nTimerDue, timer));
+    BOOST_CHECK(!wheel.TakeTimer(nTimerFar, timer));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
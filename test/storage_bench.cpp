@@ -0,0 +1,179 @@
+// Copyright (c) 2021-2025 The HashAhead developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+
+#include "base_tests.h"
+#include "hnbase.h"
+#include "leveldbeng.h"
+#include "test_big.h"
+#include "uint256.h"
+
+using namespace std;
+using namespace hnbase;
+using namespace hashahead;
+using namespace hashahead::storage;
+
+// Benchmarks, built into test_bench so they stay out of the test_big run
+
+BOOST_FIXTURE_TEST_SUITE(storage_bench, BasicUtfSetup)
+
+//./build-release/test/test_bench --log_level=all --run_test=storage_bench/kvdbreadbench
+
+class CBenchKVDB : public hnbase::CKVDB
+{
+public:
+    bool Initialize(const std::string& strPath)
+    {
+        CLevelDBArguments args;
+        args.path = strPath;
+        CLevelDBEngine* engine = new CLevelDBEngine(args);
+        if (!Open(engine))
+        {
+            delete engine;
+            return false;
+        }
+        return true;
+    }
+    bool Put(const uint64 nKey, const uint256& hashValue)
+    {
+        return Write(nKey, hashValue);
+    }
+    bool Get(const uint64 nKey, uint256& hashValue)
+    {
+        return Read(nKey, hashValue);
+    }
+    bool MultiGet(const std::vector<uint64>& vKey, std::vector<uint256>& vValue)
+    {
+        std::vector<bytes> vKeyData;
+        for (const uint64 nKey : vKey)
+        {
+            CBufStream ssKey;
+            ssKey << nKey;
+            vKeyData.push_back(ssKey.GetBytes());
+        }
+        CKVDBMultiValue mvValue;
+        if (!MultiRead(vKeyData, mvValue))
+        {
+            return false;
+        }
+        vValue.resize(vKey.size());
+        for (std::size_t i = 0; i < vKey.size(); i++)
+        {
+            if (!mvValue.GetValue(i, vValue[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool CountAll(uint64& nCount)
+    {
+        return WalkThrough([&](CBufStream&, CBufStream&) -> bool {
+            nCount++;
+            return true;
+        });
+    }
+};
+
+BOOST_AUTO_TEST_CASE(kvdbreadbench)
+{
+    const uint64 nKeyCount = 100000;
+    const uint64 nReadPerThread = 200000;
+
+    std::string fullpath = GetOutPath("kvdbreadbench");
+    CBenchKVDB db;
+    BOOST_CHECK(db.Initialize(fullpath));
+    db.RemoveAll();
+
+    BOOST_CHECK(db.TxnBegin());
+    for (uint64 i = 0; i < nKeyCount; i++)
+    {
+        BOOST_CHECK(db.Put(i, uint256(i + 1)));
+    }
+    BOOST_CHECK(db.TxnCommit());
+
+    for (int nThreads : { 1, 2, 4, 8 })
+    {
+        std::atomic<uint64> nFail(0);
+        int64 nBeginTime = GetTimeMillis();
+        std::vector<boost::thread> vThread;
+        for (int n = 0; n < nThreads; n++)
+        {
+            vThread.emplace_back([&, n]() {
+                uint64 nKey = n * 7919;
+                for (uint64 i = 0; i < nReadPerThread; i++)
+                {
+                    nKey = (nKey * 6364136223846793005ULL + 1442695040888963407ULL);
+                    uint64 nIndex = nKey % nKeyCount;
+                    uint256 hashValue;
+                    if (!db.Get(nIndex, hashValue) || hashValue != uint256(nIndex + 1))
+                    {
+                        nFail++;
+                    }
+                }
+            });
+        }
+        for (auto& t : vThread)
+        {
+            t.join();
+        }
+        int64 nUseTime = std::max(GetTimeMillis() - nBeginTime, (int64)1);
+        uint64 nTotalRead = nReadPerThread * nThreads;
+        cout << "kvdb read bench: threads: " << nThreads << ", reads: " << nTotalRead << ", time: " << nUseTime
+             << " ms, reads/s: " << nTotalRead * 1000 / nUseTime << endl;
+        BOOST_CHECK(nFail == 0);
+    }
+
+    // per-key read vs multi-get over 10k keys
+    {
+        std::vector<uint64> vKey;
+        for (uint64 i = 0; i < 10000; i++)
+        {
+            vKey.push_back((i * 7919) % nKeyCount);
+        }
+
+        int64 nBeginTime = GetTimeMillis();
+        for (int n = 0; n < 10; n++)
+        {
+            for (const uint64 nKey : vKey)
+            {
+                uint256 hashValue;
+                BOOST_CHECK(db.Get(nKey, hashValue) && hashValue == uint256(nKey + 1));
+            }
+        }
+        int64 nReadTime = GetTimeMillis() - nBeginTime;
+
+        nBeginTime = GetTimeMillis();
+        for (int n = 0; n < 10; n++)
+        {
+            std::vector<uint256> vValue;
+            BOOST_CHECK(db.MultiGet(vKey, vValue));
+            for (std::size_t i = 0; i < vKey.size(); i++)
+            {
+                BOOST_CHECK(vValue[i] == uint256(vKey[i] + 1));
+            }
+        }
+        int64 nMultiGetTime = GetTimeMillis() - nBeginTime;
+        cout << "kvdb 10x10k keys: read time: " << nReadTime << " ms, multi-get time: " << nMultiGetTime << " ms" << endl;
+    }
+
+    // walk with a concurrent writer, the walk sees the snapshot taken when it started
+    uint64 nWalkCount = 0;
+    boost::thread thrWrite([&]() {
+        for (uint64 i = nKeyCount; i < nKeyCount + 1000; i++)
+        {
+            db.Put(i, uint256(i + 1));
+        }
+    });
+    BOOST_CHECK(db.CountAll(nWalkCount));
+    thrWrite.join();
+    BOOST_CHECK(nWalkCount >= nKeyCount && nWalkCount <= nKeyCount + 1000);
+
+    db.RemoveAll();
+    db.Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
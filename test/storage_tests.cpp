@@ -2,13 +2,22 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <atomic>
 #include <boost/test/unit_test.hpp>
+#include <thread>
 
+#include "base_tests.h"
 #include "block.h"
+#include "blockdb.h"
+#include "blockindexarena.h"
+#include "committask.h"
 #include "dbstruct.h"
 #include "destination.h"
+#include "leveldbeng.h"
+#include "logbloomdb.h"
 #include "test_big.h"
 #include "timeseries.h"
+#include "txindexdb.h"
 
 using namespace std;
 using namespace hnbase;
@@ -166,4 +175,875 @@ BOOST_AUTO_TEST_CASE(fileread)
     free(pBuf);
 }
 
+class CTestKVDB : public hnbase::CKVDB
+{
+public:
+    bool Initialize(const std::string& strPath)
+    {
+        CLevelDBArguments args;
+        args.path = strPath;
+        CLevelDBEngine* engine = new CLevelDBEngine(args);
+        if (!Open(engine))
+        {
+            delete engine;
+            return false;
+        }
+        return true;
+    }
+    bool Put(const uint64 nKey, const uint256& hashValue)
+    {
+        return Write(nKey, hashValue);
+    }
+    bool Get(const uint64 nKey, uint256& hashValue)
+    {
+        return Read(nKey, hashValue);
+    }
+    bool Walk(WalkerFunc fnWalker)
+    {
+        return WalkThrough(fnWalker);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(kvdbwalkreentrytest)
+{
+    std::string fullpath = GetOutPath("kvdbwalkreentrytest");
+    CTestKVDB db;
+    BOOST_CHECK(db.Initialize(fullpath));
+    db.RemoveAll();
+    for (uint64 i = 0; i < 16; i++)
+    {
+        BOOST_CHECK(db.Put(i, uint256(i + 1)));
+    }
+
+    // a writer queued on the engine lock must not block reads issued from the walk callback
+    boost::thread thrRemove;
+    std::atomic<bool> fRemoved(false);
+    uint64 nWalkCount = 0;
+    bool fReadOk = true;
+    BOOST_CHECK(db.Walk([&](CBufStream& ssKey, CBufStream& ssValue) -> bool {
+        if (nWalkCount == 0)
+        {
+            thrRemove = boost::thread([&]() {
+                db.RemoveAll();
+                fRemoved = true;
+            });
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+        }
+        uint64 nKey;
+        uint256 hashValue;
+        ssKey >> nKey;
+        fReadOk = fReadOk && db.Get(nKey, hashValue) && hashValue == uint256(nKey + 1);
+        fReadOk = fReadOk && !db.RemoveAll();
+        return (++nWalkCount < 4);
+    }));
+    thrRemove.join();
+    BOOST_CHECK(fReadOk);
+    BOOST_CHECK(nWalkCount == 4);
+    BOOST_CHECK(fRemoved);
+
+    uint256 hashValue;
+    BOOST_CHECK(!db.Get(0, hashValue));
+    db.Close();
+}
+
+class CBytesWalker : public CTSWalker<bytes>
+{
+public:
+    CBytesWalker()
+      : nCount(0) {}
+
+    bool Walk(const bytes& btData, uint32 nFile, uint32 nOffset) override
+    {
+        vPos.push_back(CDiskPos(nFile, nOffset));
+        nCount++;
+        return true;
+    }
+
+public:
+    uint32 nCount;
+    std::vector<CDiskPos> vPos;
+};
+
+BOOST_AUTO_TEST_CASE(appendwritetest)
+{
+    path pathTs = path(GetOutPath("appendwritetest"));
+    remove_all(pathTs);
+
+    CTimeSeriesSyncPolicy policy;
+    BOOST_CHECK(policy.Parse("none") && policy.nMode == CTimeSeriesSyncPolicy::SYNC_NONE);
+    BOOST_CHECK(policy.Parse("block") && policy.nMode == CTimeSeriesSyncPolicy::SYNC_RECORD);
+    BOOST_CHECK(policy.Parse("bytes:4096") && policy.nMode == CTimeSeriesSyncPolicy::SYNC_BYTES && policy.nParam == 4096);
+    BOOST_CHECK(!policy.Parse("ms:") && !policy.Parse("ms:0") && !policy.Parse("sec:10") && !policy.Parse("ms:1x"));
+    BOOST_CHECK(policy.Parse("ms:50") && policy.nMode == CTimeSeriesSyncPolicy::SYNC_INTERVAL && policy.nParam == 50);
+
+    std::vector<bytes> vData;
+    for (uint32 i = 0; i < 300; i++)
+    {
+        vData.push_back(bytes(100 + i * 3, (uint8)i));
+    }
+
+    std::vector<CDiskPos> vPos;
+    {
+        CTimeSeriesCached tsData;
+        BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+        tsData.SetSyncPolicy(policy);
+        for (uint32 i = 0; i < vData.size(); i++)
+        {
+            CDiskPos pos;
+            uint32 nCrc;
+            BOOST_CHECK(tsData.Write(vData[i], pos, nCrc));
+            vPos.push_back(pos);
+        }
+        // the idle sync thread of the ms:<n> policy runs while nothing is appended
+        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+        BOOST_CHECK(tsData.Sync());
+
+        for (std::size_t i = 0; i < vData.size(); i++)
+        {
+            bytes btData;
+            BOOST_CHECK(tsData.Read(btData, vPos[i], true, false) && btData == vData[i]);
+            BOOST_CHECK(tsData.ReadDirect(btData, vPos[i].nFile, vPos[i].nOffset, true) && btData == vData[i]);
+        }
+        tsData.Deinitialize();
+    }
+
+    // preallocated space is released on close, the file ends at the last record
+    CBufStream ssLast;
+    ssLast << vData.back();
+    uint64 nFileSize = file_size(pathTs / "block_000001.dat");
+    BOOST_CHECK(nFileSize == vPos.back().nOffset + ssLast.GetSize());
+
+    // a torn record at the end is cut by WalkThrough, then appending continues
+    {
+        FILE* fp = fopen((pathTs / "block_000001.dat").string().c_str(), "ab");
+        BOOST_CHECK(fp != nullptr);
+        const uint32 nTorn[2] = { 0x8A5CA1E8, 1000 };
+        fwrite(nTorn, 1, sizeof(nTorn), fp);
+        fclose(fp);
+    }
+    CTimeSeriesCached tsData;
+    BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+    uint32 nLastFile = 0, nLastPos = 0;
+    CBytesWalker walker;
+    BOOST_CHECK(tsData.WalkThrough(walker, nLastFile, nLastPos, true));
+    BOOST_CHECK(walker.nCount == vData.size() && walker.vPos == vPos);
+    BOOST_CHECK(file_size(pathTs / "block_000001.dat") == nFileSize);
+
+    CDiskPos pos;
+    uint32 nCrc;
+    BOOST_CHECK(tsData.Write(vData[0], pos, nCrc));
+    BOOST_CHECK(pos.nFile == 1 && pos.nOffset == nFileSize + 12);
+    bytes btData;
+    BOOST_CHECK(tsData.Read(btData, pos, true, false) && btData == vData[0]);
+    tsData.Deinitialize();
+
+    remove_all(pathTs);
+}
+
+BOOST_AUTO_TEST_CASE(groupwritetest)
+{
+    path pathTs = path(GetOutPath("groupwritetest"));
+    remove_all(pathTs);
+
+    const int nThreadCount = 8;
+    const int nWriteCount = 200;
+    std::vector<std::vector<bytes>> vThreadData(nThreadCount);
+    std::vector<std::vector<CDiskPos>> vThreadPos(nThreadCount);
+    for (int n = 0; n < nThreadCount; n++)
+    {
+        for (int i = 0; i < nWriteCount; i++)
+        {
+            vThreadData[n].push_back(bytes(50 + i, (uint8)(n * 31 + i)));
+        }
+    }
+
+    CTimeSeriesCached tsData;
+    BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+    tsData.SetSyncPolicy(CTimeSeriesSyncPolicy(CTimeSeriesSyncPolicy::SYNC_RECORD));
+
+    // concurrent writers share group commits, every record still gets its own position
+    std::atomic<int> nFailCount(0);
+    std::vector<std::thread> vThread;
+    for (int n = 0; n < nThreadCount; n++)
+    {
+        vThread.push_back(std::thread([&, n]() {
+            for (const bytes& btData : vThreadData[n])
+            {
+                CDiskPos pos;
+                uint32 nCrc;
+                if (!tsData.Write(btData, pos, nCrc, false))
+                {
+                    nFailCount++;
+                }
+                vThreadPos[n].push_back(pos);
+            }
+        }));
+    }
+    for (std::thread& t : vThread)
+    {
+        t.join();
+    }
+    BOOST_CHECK(nFailCount == 0);
+
+    std::set<CDiskPos> setPos;
+    for (int n = 0; n < nThreadCount; n++)
+    {
+        for (int i = 0; i < nWriteCount; i++)
+        {
+            setPos.insert(vThreadPos[n][i]);
+            bytes btData;
+            BOOST_CHECK(tsData.Read(btData, vThreadPos[n][i], true, false) && btData == vThreadData[n][i]);
+        }
+    }
+    BOOST_CHECK(setPos.size() == (std::size_t)nThreadCount * nWriteCount);
+    tsData.Deinitialize();
+
+    remove_all(pathTs);
+}
+
+BOOST_AUTO_TEST_CASE(blockcachetest)
+{
+    // 100 bytes budget in one shard, 2 pins
+    CSegmentedLruCache<int, int> cache(100, 2, 1);
+    int nValue = 0;
+
+    // hot entries are promoted to the protected segment by a second hit
+    for (int i = 0; i < 4; i++)
+    {
+        cache.AddNew(i, i, 10);
+        BOOST_CHECK(cache.Retrieve(i, nValue) && nValue == i);
+    }
+
+    // a long scan only churns the probation segment
+    for (int i = 100; i < 200; i++)
+    {
+        cache.AddNew(i, i, 10);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        BOOST_CHECK(cache.Retrieve(i, nValue) && nValue == i);
+    }
+    BOOST_CHECK(!cache.Retrieve(100, nValue));
+    BOOST_CHECK(cache.Retrieve(199, nValue));
+
+    // pinned entries survive eviction until newer pins release them
+    cache.AddNew(1000, 1000, 10, true);
+    cache.AddNew(1001, 1001, 10, true);
+    for (int i = 200; i < 300; i++)
+    {
+        cache.AddNew(i, i, 10);
+    }
+    BOOST_CHECK(cache.Retrieve(1000, nValue) && cache.Retrieve(1001, nValue));
+    cache.AddNew(1002, 1002, 10, true);
+    for (int i = 300; i < 400; i++)
+    {
+        cache.AddNew(i, i, 10);
+    }
+    BOOST_CHECK(!cache.Retrieve(1000, nValue));
+    BOOST_CHECK(cache.Retrieve(1001, nValue) && cache.Retrieve(1002, nValue));
+
+    // entries larger than the budget are only cached when pinned
+    cache.AddNew(2000, 2000, 1000);
+    BOOST_CHECK(!cache.Retrieve(2000, nValue));
+
+    CSegmentedLruCache<int, int>::CStat stat;
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nPinnedCount == 2 && stat.nPinnedBytes == 20);
+    BOOST_CHECK(stat.nBytes <= 100);
+    BOOST_CHECK(stat.nEviction > 0 && stat.nHit > 0 && stat.nMiss == 3);
+    BOOST_CHECK(stat.nInsert == 4 + 100 + 100 + 100 + 3);
+
+    cache.Clear();
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nCount == 0 && stat.nBytes == 0);
+
+    // a removed pin gives its slot back, pinning the key again does not take two slots
+    cache.AddNew(1, 1, 30, true);
+    cache.AddNew(2, 2, 30, true);
+    cache.Remove(1);
+    cache.AddNew(1, 1, 30, true);
+    cache.AddNew(1, 1, 30, true);
+    cache.AddNew(3, 3, 30, true);
+    for (int i = 400; i < 500; i++)
+    {
+        cache.AddNew(i, i, 10);
+    }
+    BOOST_CHECK(!cache.Retrieve(2, nValue));
+    BOOST_CHECK(cache.Retrieve(1, nValue) && cache.Retrieve(3, nValue));
+
+    // pinned bytes count against the budget
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nPinnedCount == 2 && stat.nPinnedBytes == 60);
+    BOOST_CHECK(stat.nBytes <= 100);
+
+    // an entry larger than its shard's share of the budget is cached
+    CSegmentedLruCache<int, int> cacheShard(100, 0, 4);
+    cacheShard.AddNew(7, 7, 60);
+    BOOST_CHECK(cacheShard.Retrieve(7, nValue) && nValue == 7);
+    for (int i = 0; i < 100; i++)
+    {
+        cacheShard.AddNew(i + 100, i, 5);
+    }
+    cacheShard.GetStat(stat);
+    BOOST_CHECK(stat.nBytes <= 100);
+}
+
+//./build-release/test/test_big --log_level=all --run_test=storage_tests/mappedreadbench
+
+BOOST_AUTO_TEST_CASE(mappedreadbench)
+{
+    const uint32 nRecordCount = 2000;
+    const uint32 nReadPerThread = 100000;
+
+    path pathTs = path(GetOutPath("mappedreadbench"));
+    remove_all(pathTs);
+
+    std::vector<CDiskPos> vPos;
+    {
+        CTimeSeriesCached tsData;
+        BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+        for (uint32 i = 0; i < nRecordCount; i++)
+        {
+            bytes btData(1024 + (i % 7) * 512, (uint8)i);
+            CDiskPos pos;
+            uint32 nCrc;
+            BOOST_CHECK(tsData.Write(btData, pos, nCrc, false));
+            vPos.push_back(pos);
+        }
+        tsData.Deinitialize();
+    }
+
+    // the next data file seals block_000001.dat, reads of it go through the mapping
+    {
+        FILE* fp = fopen((pathTs / "block_000002.dat").string().c_str(), "w+");
+        BOOST_CHECK(fp != nullptr);
+        fclose(fp);
+    }
+
+    CTimeSeriesCached tsData;
+    BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+    for (uint32 i = 0; i < nRecordCount; i++)
+    {
+        bytes btData;
+        BOOST_CHECK(tsData.ReadDirect(btData, vPos[i].nFile, vPos[i].nOffset, true));
+        BOOST_CHECK(btData == bytes(1024 + (i % 7) * 512, (uint8)i));
+    }
+
+    for (int nThreads : { 1, 2, 4, 8 })
+    {
+        std::atomic<uint64> nFail(0);
+        int64 nBeginTime = GetTimeMillis();
+        std::vector<boost::thread> vThread;
+        for (int n = 0; n < nThreads; n++)
+        {
+            vThread.emplace_back([&, n]() {
+                uint64 nKey = n * 7919;
+                for (uint32 i = 0; i < nReadPerThread; i++)
+                {
+                    nKey = (nKey * 6364136223846793005ULL + 1442695040888963407ULL);
+                    uint32 nIndex = (nKey >> 16) % nRecordCount;
+                    bytes btData;
+                    if (!tsData.Read(btData, vPos[nIndex], true, false) || btData.size() != 1024 + (nIndex % 7) * 512 || btData[0] != (uint8)nIndex)
+                    {
+                        nFail++;
+                    }
+                }
+            });
+        }
+        for (auto& t : vThread)
+        {
+            t.join();
+        }
+        int64 nUseTime = std::max(GetTimeMillis() - nBeginTime, (int64)1);
+        uint64 nTotalRead = (uint64)nReadPerThread * nThreads;
+        cout << "mapped read bench: threads: " << nThreads << ", reads: " << nTotalRead << ", time: " << nUseTime
+             << " ms, reads/s: " << nTotalRead * 1000 / nUseTime << endl;
+        BOOST_CHECK(nFail == 0);
+    }
+    tsData.Deinitialize();
+
+    // crc is checked on the mapped data
+    {
+        hnbase::CFileStream fs((pathTs / "block_000001.dat").string().c_str());
+        fs.Seek(vPos[10].nOffset + 100);
+        uint8 nByte = 0xFF;
+        fs << nByte;
+    }
+    BOOST_CHECK(tsData.Initialize(pathTs, "block"));
+    bytes btData;
+    BOOST_CHECK(!tsData.Read(btData, vPos[10], true, false));
+    BOOST_CHECK(tsData.Read(btData, vPos[11], true, false));
+    tsData.Deinitialize();
+
+    remove_all(pathTs);
+}
+
+// Counts the bytes a container asks for, so its memory is measured rather than estimated
+template <typename T>
+class CCountingAllocator
+{
+public:
+    typedef T value_type;
+
+    CCountingAllocator(std::size_t& nBytesIn)
+      : pBytes(&nBytesIn) {}
+    template <typename U>
+    CCountingAllocator(const CCountingAllocator<U>& other)
+      : pBytes(other.pBytes) {}
+
+    T* allocate(const std::size_t n)
+    {
+        *pBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, const std::size_t n)
+    {
+        *pBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+    template <typename U>
+    bool operator==(const CCountingAllocator<U>& other) const
+    {
+        return (pBytes == other.pBytes);
+    }
+    template <typename U>
+    bool operator!=(const CCountingAllocator<U>& other) const
+    {
+        return (pBytes != other.pBytes);
+    }
+
+public:
+    std::size_t* pBytes;
+};
+
+BOOST_AUTO_TEST_CASE(blockindexarenatest)
+{
+    const int nBlockCount = 100000;
+    CBlockIndexArena arena(nBlockCount / 4);
+
+    std::vector<uint256> vHash;
+    for (int i = 0; i < nBlockCount; i++)
+    {
+        CBlockIndex index;
+        index.hashBlock = CBlock::CreateBlockHash(1, i, 0, crypto::CryptoHash(&i, sizeof(i)));
+        index.hashPrev = (vHash.empty() ? uint256() : vHash.back());
+        index.nNumber = i;
+        index.nTimeStamp = 1700000000 + i;
+        index.nChainTrust = uint256(i);
+        index.nMoneySupply = uint256(i * 10);
+        index.nFile = i / 1000;
+        index.nOffset = i;
+        arena.AddNew(index);
+        vHash.push_back(index.hashBlock);
+    }
+    BOOST_CHECK(arena.GetCount() == nBlockCount);
+
+    // hot fields stay resident, cold fields are only cached for the newest blocks
+    CBlockIndex index;
+    BOOST_CHECK(arena.Exists(vHash[0]));
+    BOOST_CHECK(!arena.Retrieve(vHash[0], index));
+    BOOST_CHECK(arena.Retrieve(vHash[nBlockCount - 1], index));
+    BOOST_CHECK(index.hashPrev == vHash[nBlockCount - 2]);
+    BOOST_CHECK(index.nNumber == nBlockCount - 1);
+    BOOST_CHECK(index.nOffset == nBlockCount - 1);
+    BOOST_CHECK(index.nMoneySupply == uint256((nBlockCount - 1) * 10));
+    BlockIndexPtr pIndexLast = arena.Retrieve(vHash[nBlockCount - 1]);
+    BOOST_CHECK(pIndexLast && pIndexLast->nChainTrust == uint256(nBlockCount - 1));
+
+    // an evicted block is served from its resident record, only the cold fields are loaded, once
+    int nLoadCount = 0;
+    arena.SetLoader([&](const uint256& hashBlock, CBlockIndex& indexLoad) {
+        nLoadCount++;
+        indexLoad.hashBlock = hashBlock;
+        indexLoad.nMoneySupply = uint256(0);
+        return true;
+    });
+    BlockIndexPtr pIndexFirst = arena.Retrieve(vHash[0]);
+    BOOST_CHECK(pIndexFirst && pIndexFirst->nTimeStamp == 1700000000 && pIndexFirst->nMoneySupply == uint256(0));
+    BOOST_CHECK(arena.Retrieve(vHash[0], index));
+    BOOST_CHECK(nLoadCount == 1);
+    BOOST_CHECK(arena.Retrieve(vHash[nBlockCount - 1], index));
+    BOOST_CHECK(nLoadCount == 1);
+    arena.SetLoader(CBlockIndexArena::LoadFunc());
+
+    // removed slots are reused
+    for (int i = 0; i < nBlockCount; i += 2)
+    {
+        arena.Remove(vHash[i]);
+    }
+    BOOST_CHECK(arena.GetCount() == nBlockCount / 2);
+    BOOST_CHECK(!arena.Exists(vHash[0]));
+    BOOST_CHECK(arena.Exists(vHash[1]));
+    CBlockIndexArena::CStat statBefore;
+    arena.GetStat(statBefore);
+    for (int i = 0; i < nBlockCount; i += 2)
+    {
+        index.hashBlock = vHash[i];
+        arena.AddNew(index);
+    }
+    CBlockIndexArena::CStat stat;
+    arena.GetStat(stat);
+    BOOST_CHECK(stat.nCount == nBlockCount);
+    BOOST_CHECK(stat.nArenaBytes <= statBefore.nArenaBytes + nBlockCount * sizeof(uint32));
+    for (int i = 0; i < nBlockCount; i++)
+    {
+        BOOST_CHECK(arena.Exists(vHash[i]));
+    }
+
+
+    // the same blocks held the old way, every allocation counted
+    std::size_t nMapBytes = 0;
+    {
+        typedef CCountingAllocator<std::pair<const uint256, BlockIndexPtr>> MapAllocator;
+        std::size_t nAllocBytes = 0;
+        CCountingAllocator<CBlockIndex> alloc(nAllocBytes);
+        const MapAllocator allocMap(alloc);
+        std::map<uint256, BlockIndexPtr, std::less<uint256>, MapAllocator> mapIndex(allocMap);
+        for (int i = 0; i < nBlockCount; i++)
+        {
+            mapIndex.insert(std::make_pair(vHash[i], std::allocate_shared<CBlockIndex>(alloc)));
+        }
+        BOOST_CHECK(mapIndex.size() == nBlockCount);
+        nMapBytes = nAllocBytes;
+    }
+
+    // the cold cache is bounded by its count, not by the number of blocks
+    cout << "block index memory, count: " << stat.nCount << ", arena: " << stat.nArenaBytes << ", table: " << stat.nTableBytes
+         << ", cold cached: " << stat.nColdCount << ", resident bytes per block: " << (stat.nArenaBytes + stat.nTableBytes) / stat.nCount
+         << ", std::map bytes per block: " << nMapBytes / stat.nCount << endl;
+    BOOST_CHECK(stat.nColdCount <= nBlockCount / 4);
+    BOOST_CHECK(stat.nArenaBytes + stat.nTableBytes < nMapBytes);
+}
+
+BOOST_AUTO_TEST_CASE(blockindexcheckpointtest)
+{
+    const int nBlockCount = 20000;
+    CBlockIndexArena arena;
+    for (int i = 0; i < nBlockCount; i++)
+    {
+        CBlockIndex index;
+        index.hashBlock = CBlock::CreateBlockHash(1, i, 0, crypto::CryptoHash(&i, sizeof(i)));
+        index.nNumber = i;
+        index.nChainTrust = uint256(i);
+        index.nMoneySupply = uint256(i * 10);
+        arena.AddNew(index);
+    }
+
+    const path pathFile = path(GetOutPath("indexcheckpoint.dat"));
+    CBlockIndexCheckpoint checkpoint;
+    checkpoint.nVerifyCount = nBlockCount;
+    checkpoint.nVerifyCrc = 0x12345678;
+    checkpoint.mapForkLast[uint256(1)] = CBlock::CreateBlockHash(1, nBlockCount - 1, 0, uint256(2));
+    BOOST_CHECK(checkpoint.Save(pathFile, arena));
+
+    int64 nBeginTime = GetTimeMillis();
+    CBlockIndexArena arenaLoad;
+    CBlockIndexCheckpoint checkpointLoad;
+    BOOST_CHECK(checkpointLoad.Load(pathFile, arenaLoad));
+    cout << "load index checkpoint, count: " << arenaLoad.GetCount() << ", time: " << GetTimeMillis() - nBeginTime << " ms" << endl;
+    BOOST_CHECK(checkpointLoad.nVerifyCount == checkpoint.nVerifyCount);
+    BOOST_CHECK(checkpointLoad.nVerifyCrc == checkpoint.nVerifyCrc);
+    BOOST_CHECK(checkpointLoad.mapForkLast == checkpoint.mapForkLast);
+    BOOST_CHECK(arenaLoad.GetCount() == nBlockCount);
+
+    // only the resident fields come back, the cold ones are read through the loader on first use
+    const int n = nBlockCount / 2;
+    const uint256 hashBlock = CBlock::CreateBlockHash(1, n, 0, crypto::CryptoHash(&n, sizeof(n)));
+    CBlockIndex index;
+    BOOST_CHECK(arenaLoad.Exists(hashBlock));
+    BOOST_CHECK(!arenaLoad.Retrieve(hashBlock, index));
+    arenaLoad.SetLoader([&](const uint256& hashBlockIn, CBlockIndex& indexLoad) { return arena.Retrieve(hashBlockIn, indexLoad); });
+    CBlockIndex indexLoad;
+    BOOST_CHECK(arenaLoad.Retrieve(hashBlock, indexLoad));
+    BOOST_CHECK(indexLoad.nNumber == (uint64)n && indexLoad.nChainTrust == uint256(n) && indexLoad.nMoneySupply == uint256(n * 10));
+
+    // a damaged checkpoint is rejected
+    {
+        FILE* f = fopen(pathFile.string().c_str(), "r+b");
+        BOOST_CHECK(f != nullptr);
+        fseek(f, 100, SEEK_SET);
+        int c = fgetc(f);
+        fseek(f, 100, SEEK_SET);
+        fputc(c ^ 0xFF, f);
+        fclose(f);
+    }
+    CBlockIndexArena arenaBad;
+    CBlockIndexCheckpoint checkpointBad;
+    BOOST_CHECK(!checkpointBad.Load(pathFile, arenaBad));
+    BOOST_CHECK(arenaBad.GetCount() == 0);
+    boost::filesystem::remove(pathFile);
+}
+
+BOOST_AUTO_TEST_CASE(logbloomindexbench)
+{
+    const uint64 nBlockCount = 100000;
+    const uint256 hashFork(1);
+    const CDestination destTarget(uint160(0x5a5a5a5a));
+    const CDestination destMissing(uint160(0x3c3c3c3c));
+
+    CLogBloomDB db;
+    BOOST_CHECK(db.Initialize(path(GetOutPath("logbloombench"))));
+    BOOST_CHECK(db.AddNewFork(hashFork));
+
+    std::vector<std::pair<uint64, uint256>> vBlock;
+    std::set<uint256> setTargetBlock;
+    for (uint64 i = 0; i < nBlockCount; i++)
+    {
+        const uint256 hashBlock = crypto::CryptoHash(&i, sizeof(i));
+        vBlock.push_back(std::make_pair(i, hashBlock));
+        if (i == nBlockCount / 2)
+        {
+            // saved before the index existed, always a candidate
+            setTargetBlock.insert(hashBlock);
+            continue;
+        }
+
+        uint2048 nBlockLogsBloom;
+        for (uint64 n = 0; n < 3; n++)
+        {
+            CTransactionLogs logs;
+            logs.address = CDestination(uint160(i * 3 + n + 0x100000000));
+            logs.topics.push_back(crypto::CryptoHash(&n, sizeof(n)));
+            nBlockLogsBloom |= logs.GetLogsBloom();
+        }
+        if (i % 2000 == 7)
+        {
+            CTransactionLogs logs;
+            logs.address = destTarget;
+            nBlockLogsBloom |= logs.GetLogsBloom();
+            setTargetBlock.insert(hashBlock);
+        }
+        BOOST_CHECK(db.AddBlockBloom(hashFork, hashBlock, nBlockLogsBloom));
+    }
+
+    CLogsFilter logsFilter;
+    logsFilter.setAddress.insert(destTarget);
+    for (int nRound = 0; nRound < 2; nRound++)
+    {
+        int64 nBeginTime = GetTimeMillis();
+        std::vector<uint256> vMatchBlock;
+        BOOST_CHECK(db.FilterBlocks(hashFork, logsFilter, vBlock, vMatchBlock));
+        cout << "log bloom filter " << (nRound == 0 ? "building sections" : "indexed") << ", blocks: " << nBlockCount
+             << ", candidates: " << vMatchBlock.size() << ", time: " << GetTimeMillis() - nBeginTime << " ms" << endl;
+
+        std::set<uint256> setMatchBlock(vMatchBlock.begin(), vMatchBlock.end());
+        for (const uint256& hashBlock : setTargetBlock)
+        {
+            BOOST_CHECK(setMatchBlock.count(hashBlock));
+        }
+        BOOST_CHECK(vMatchBlock.size() < setTargetBlock.size() + nBlockCount / 100);
+    }
+
+    // a partial range at both ends goes through the block blooms
+    {
+        std::vector<std::pair<uint64, uint256>> vPart(vBlock.begin() + 100, vBlock.begin() + 9000);
+        std::vector<uint256> vMatchBlock;
+        BOOST_CHECK(db.FilterBlocks(hashFork, logsFilter, vPart, vMatchBlock));
+        std::set<uint256> setMatchBlock(vMatchBlock.begin(), vMatchBlock.end());
+        for (std::size_t i = 0; i < vPart.size(); i++)
+        {
+            if (setTargetBlock.count(vPart[i].second))
+            {
+                BOOST_CHECK(setMatchBlock.count(vPart[i].second));
+            }
+        }
+    }
+
+    CLogsFilter logsFilterMissing;
+    logsFilterMissing.setAddress.insert(destMissing);
+    std::vector<uint256> vMatchBlock;
+    BOOST_CHECK(db.FilterBlocks(hashFork, logsFilterMissing, vBlock, vMatchBlock));
+    BOOST_CHECK(vMatchBlock.size() < nBlockCount / 100);
+
+    db.Clear();
+    db.Deinitialize();
+}
+
+BOOST_AUTO_TEST_CASE(blocklogsbloomtest)
+{
+    const uint256 hashFork(1);
+    const CDestination destTarget(uint160(0x5a5a5a5a));
+    const CDestination destMissing(uint160(0x3c3c3c3c));
+
+    CBlockDB db;
+    BOOST_CHECK(db.BdInitialize(path(GetOutPath("blocklogsbloom")), hashFork, false, false, false, false));
+    db.RemoveAll();
+    BOOST_CHECK(db.AddNewFork(hashFork));
+
+    std::vector<std::pair<uint64, uint256>> vBlock;
+    for (uint64 i = 0; i < 8; i++)
+    {
+        const uint256 hashBlock = crypto::CryptoHash(&i, sizeof(i));
+        vBlock.push_back(std::make_pair(i, hashBlock));
+
+        std::map<uint256, CTxIndex> mapTxIndex;
+        std::map<uint256, CTransactionReceipt> mapTxReceipt;
+        for (uint32 n = 0; n < 3; n++)
+        {
+            CTransactionReceipt receipt;
+            receipt.nTxIndex = n;
+            const uint64 nTxSeed = i * 16 + n + 0x1000;
+            receipt.txid = crypto::CryptoHash(&nTxSeed, sizeof(nTxSeed));
+
+            CTransactionLogs logs;
+            logs.address = ((i == 5 && n == 2) ? destTarget : CDestination(uint160(i * 3 + n + 0x100000000)));
+            logs.topics.push_back(uint256(n));
+            receipt.vLogs.push_back(logs);
+            // nLogsBloom stays empty, as the block executor leaves it
+            mapTxReceipt[receipt.txid] = receipt;
+            mapTxIndex[receipt.txid] = CTxIndex(i, n, 1, n * 100);
+        }
+        BOOST_CHECK(db.AddBlockTxIndexReceipt(hashFork, hashBlock, mapTxIndex, mapTxReceipt));
+    }
+
+    CLogsFilter logsFilter;
+    logsFilter.setAddress.insert(destTarget);
+    std::vector<uint256> vMatchBlock;
+    BOOST_CHECK(db.FilterLogsBloomBlock(hashFork, logsFilter, vBlock, vMatchBlock));
+    BOOST_CHECK(vMatchBlock.size() == 1 && vMatchBlock[0] == vBlock[5].second);
+
+    CLogsFilter logsFilterMissing;
+    logsFilterMissing.setAddress.insert(destMissing);
+    vMatchBlock.clear();
+    BOOST_CHECK(db.FilterLogsBloomBlock(hashFork, logsFilterMissing, vBlock, vMatchBlock));
+    BOOST_CHECK(vMatchBlock.empty());
+
+    db.RemoveAll();
+    db.BdDeinitialize();
+}
+
+BOOST_AUTO_TEST_CASE(packedreceiptstest)
+{
+    const uint256 hashFork(1);
+    const uint256 hashBlock = crypto::CryptoHash(hashFork.begin(), hashFork.size());
+
+    std::vector<CTransactionReceipt> vTxReceipt;
+    std::map<uint256, CTxIndex> mapTxIndex;
+    std::map<uint256, uint256> mapTxBlock;
+    std::size_t nSingleSize = 0;
+    for (uint32 i = 0; i < 300; i++)
+    {
+        CTransactionReceipt receipt;
+        receipt.nReceiptType = (i % 3 == 0 ? CTransactionReceipt::RECEIPT_TYPE_COMMON : CTransactionReceipt::RECEIPT_TYPE_CONTRACT);
+        receipt.nTxIndex = i;
+        receipt.txid = crypto::CryptoHash(&i, sizeof(i));
+        receipt.nBlockNumber = 100;
+        receipt.nTxGasUsed = uint256(21000 + i);
+        receipt.from = CDestination(uint160(i + 1));
+        receipt.to = CDestination(uint160(0x1000));
+        for (uint32 n = 0; n < i % 4; n++)
+        {
+            CTransactionLogs logs;
+            logs.address = CDestination(uint160(0x1000));
+            logs.topics.push_back(uint256(n));
+            logs.data = bytes(32, (uint8)n);
+            receipt.vLogs.push_back(logs);
+        }
+        vTxReceipt.push_back(receipt);
+        mapTxIndex[receipt.txid] = CTxIndex(100, i, 1, i * 100);
+        mapTxBlock[receipt.txid] = hashBlock;
+
+        CBufStream ss;
+        ss << receipt;
+        nSingleSize += ss.GetSize();
+    }
+
+    CPackedBlockReceipts packReceipts;
+    packReceipts.Pack(vTxReceipt);
+    bytes btPacked;
+    FlatSerialize(packReceipts, btPacked);
+    cout << "packed receipts, count: " << vTxReceipt.size() << ", per tx records: " << nSingleSize << " bytes, packed: " << btPacked.size() << " bytes" << endl;
+    BOOST_CHECK(btPacked.size() < nSingleSize);
+
+    CPackedBlockReceipts packLoad;
+    BOOST_CHECK(FlatDeserialize(btPacked.data(), btPacked.size(), packLoad));
+    BOOST_CHECK(packLoad.GetCount() == vTxReceipt.size());
+    for (std::size_t i = 0; i < vTxReceipt.size(); i += 37)
+    {
+        CTransactionReceipt receipt;
+        BOOST_CHECK(packLoad.GetReceipt(i, receipt));
+        CBufStream ss1, ss2;
+        ss1 << vTxReceipt[i];
+        ss2 << receipt;
+        BOOST_CHECK(ss1.GetBytes() == ss2.GetBytes());
+    }
+    CTransactionReceipt receiptNone;
+    BOOST_CHECK(!packLoad.GetReceipt(vTxReceipt.size(), receiptNone));
+
+    // one receipt straight from the serialized record
+    CTransactionReceipt receiptSlice;
+    BOOST_CHECK(CPackedBlockReceipts::SliceReceipt(btPacked.data(), btPacked.size(), 123, receiptSlice));
+    BOOST_CHECK(receiptSlice.txid == vTxReceipt[123].txid && receiptSlice.vLogs.size() == 123 % 4);
+    BOOST_CHECK(!CPackedBlockReceipts::SliceReceipt(btPacked.data(), btPacked.size(), vTxReceipt.size(), receiptNone));
+    BOOST_CHECK(!CPackedBlockReceipts::SliceReceipt(btPacked.data(), btPacked.size() / 2, 123, receiptNone));
+
+    // by tx through the per-tx index, and the whole block in one read
+    CForkTxIndexDB db;
+    BOOST_CHECK(db.Initialize(hashFork, path(GetOutPath("packedreceipts"))));
+    db.RemoveAll();
+    BOOST_CHECK(db.AddBlockTxIndexReceipt(hashBlock, mapTxIndex, vTxReceipt));
+    BOOST_CHECK(db.UpdateTxIndexBlockLongChain(std::vector<uint256>(), mapTxBlock));
+
+    CTransactionReceipt receipt;
+    BOOST_CHECK(db.RetrieveTxReceipt(vTxReceipt[200].txid, receipt));
+    BOOST_CHECK(receipt.nTxIndex == 200 && receipt.vLogs.size() == 200 % 4);
+
+    std::vector<uint256> vTxid;
+    for (std::size_t i = vTxReceipt.size(); i > 0; i--)
+    {
+        vTxid.push_back(vTxReceipt[i - 1].txid);
+    }
+    std::vector<CTransactionReceipt> vTxReceiptLoad;
+    BOOST_CHECK(db.RetrieveBlockTxReceipts(hashBlock, vTxid, vTxReceiptLoad));
+    BOOST_CHECK(vTxReceiptLoad.size() == vTxReceipt.size());
+    BOOST_CHECK(vTxReceiptLoad.front().nTxGasUsed == vTxReceipt.back().nTxGasUsed);
+
+    db.RemoveAll();
+    db.Deinitialize();
+}
+
+BOOST_AUTO_TEST_CASE(dbcommittaskstest)
+{
+    // stands in for one leveldb write batch per database
+    auto funcWrite = [](const int nTimeMs, const bool fResult) {
+        return [nTimeMs, fResult]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(nTimeMs));
+            return fResult;
+        };
+    };
+
+    int64 nSerialWall = 0;
+    for (const bool fParallel : { false, true })
+    {
+        CDbCommitTasks tasks;
+        tasks.AddTask("block number", funcWrite(20, true));
+        tasks.AddTask("tx index", funcWrite(40, true));
+        tasks.AddTask("address tx", funcWrite(40, true));
+        std::vector<std::string> vFailTask;
+        BOOST_CHECK(tasks.Run(fParallel, vFailTask));
+        BOOST_CHECK(vFailTask.empty());
+        BOOST_CHECK(tasks.GetWallTimeUs() >= (fParallel ? 40000 : 100000));
+        if (fParallel && CWorkerPool::GetShared().GetConcurrency() > 2)
+        {
+            BOOST_CHECK(tasks.GetWallTimeUs() < nSerialWall);
+        }
+        else
+        {
+            nSerialWall = tasks.GetWallTimeUs();
+        }
+        cout << "commit tasks, parallel: " << fParallel << ", wall: " << tasks.GetWallTimeUs() << " us" << endl;
+    }
+
+    // a failed write does not stop the others, every failure is reported
+    std::atomic<int> nRunCount(0);
+    CDbCommitTasks tasks;
+    tasks.AddTask("a", [&]() { nRunCount++; return false; });
+    tasks.AddTask("b", [&]() { nRunCount++; return true; });
+    tasks.AddTask("c", [&]() -> bool { nRunCount++; throw std::runtime_error("write error"); });
+    std::vector<std::string> vFailTask;
+    BOOST_CHECK(!tasks.Run(true, vFailTask));
+    BOOST_CHECK(nRunCount == 3);
+    BOOST_CHECK(vFailTask.size() == 2 && vFailTask[0] == "a" && vFailTask[1] == "c");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,8 +6,10 @@
 #include <set>
 #include <vector>
 
+#include "block.h"
 #include "destination.h"
 #include "structure/tree.h"
+#include "transaction.h"
 #include "test_big.h"
 
 using namespace std;
@@ -250,4 +252,166 @@ BOOST_AUTO_TEST_CASE(streamtest)
     cout << "c: " << cb2.c << endl;
 }
 
+BOOST_AUTO_TEST_CASE(flatstreambench)
+{
+    CTransaction tx;
+    tx.SetChainId(201);
+    tx.SetNonce(12345);
+    tx.SetFromAddress(CDestination(uint256(1)));
+    tx.SetToAddress(CDestination(uint256(2)));
+    tx.SetAmount(uint256(1000000));
+    tx.SetGasPrice(uint256(100));
+    tx.SetGasLimit(uint256(21000));
+    tx.AddTxData(CTransaction::DF_COMMON, bytes(128, 0x5a));
+
+    CBlock block;
+    block.nVersion = 1;
+    block.nType = CBlock::BLOCK_PRIMARY;
+    block.nTimeStamp = 1700000000;
+    block.nNumber = 100;
+    block.nHeight = 100;
+    block.hashPrev = uint256(3);
+    block.txMint = tx;
+    for (int i = 0; i < 2000; i++)
+    {
+        tx.SetNonce(i);
+        block.vtx.push_back(tx);
+    }
+
+    // flat output must be byte-identical to the iostream stream
+    CBufStream ssTx;
+    ssTx << tx;
+    bytes btTx;
+    FlatSerialize(tx, btTx);
+    BOOST_CHECK(btTx == ssTx.GetBytes());
+    BOOST_CHECK(GetSerializeSize(tx) == btTx.size());
+
+    CBufStream ssBlock;
+    ssBlock << block;
+    bytes btBlock;
+    FlatSerialize(block, btBlock);
+    BOOST_CHECK(btBlock == ssBlock.GetBytes());
+    BOOST_CHECK(GetSerializeSize(block) == btBlock.size());
+
+    CTransaction txOut;
+    BOOST_CHECK(FlatDeserialize(btTx.data(), btTx.size(), txOut));
+    BOOST_CHECK(txOut == tx);
+    BOOST_CHECK(!FlatDeserialize(btTx.data(), btTx.size() - 1, txOut));
+
+    CBlock blockOut;
+    BOOST_CHECK(FlatDeserialize(btBlock.data(), btBlock.size(), blockOut));
+    BOOST_CHECK(blockOut.GetHash() == block.GetHash());
+    BOOST_CHECK(blockOut.vtx.size() == block.vtx.size());
+
+    const int nLoop = 20;
+    int64 nBeginTime = GetTimeMillis();
+    for (int i = 0; i < nLoop; i++)
+    {
+        CBufStream ss;
+        ss << block;
+        CBlock blockTemp;
+        ss >> blockTemp;
+    }
+    int64 nBufTime = GetTimeMillis() - nBeginTime;
+
+    nBeginTime = GetTimeMillis();
+    for (int i = 0; i < nLoop; i++)
+    {
+        bytes btData;
+        FlatSerialize(block, btData);
+        CBlock blockTemp;
+        FlatDeserialize(btData.data(), btData.size(), blockTemp);
+    }
+    int64 nFlatTime = GetTimeMillis() - nBeginTime;
+
+    cout << "block size: " << btBlock.size() << ", round trip x" << nLoop << ": buf stream " << nBufTime << " ms, flat stream " << nFlatTime << " ms" << endl;
+}
+
+BOOST_AUTO_TEST_CASE(hashcachetest)
+{
+    CTransaction tx;
+    tx.SetTxType(CTransaction::TX_TOKEN);
+    tx.SetChainId(201);
+    tx.SetNonce(1);
+    tx.SetFromAddress(CDestination(uint256(1)));
+    tx.SetToAddress(CDestination(uint256(2)));
+    tx.SetAmount(uint256(1000000));
+    tx.SetGasPrice(uint256(100));
+    tx.SetGasLimit(uint256(21000));
+    tx.AddTxData(CTransaction::DF_COMMON, bytes(128, 0x5a));
+
+    const uint64 nHitPrev = CTransaction::GetHashCacheStat().GetHitCount();
+    const uint256 txid = tx.GetHash();
+    BOOST_CHECK(tx.GetHash() == txid);
+    BOOST_CHECK(CTransaction::GetHashCacheStat().GetHitCount() == nHitPrev + 1);
+
+    // every mutator drops the memoized hash
+    CTransaction txCopy = tx;
+    BOOST_CHECK(txCopy.GetHash() == txid);
+    txCopy.SetNonce(2);
+    BOOST_CHECK(txCopy.GetHash() != txid);
+    BOOST_CHECK(tx.GetHash() == txid);
+    txCopy.SetNonce(1);
+    BOOST_CHECK(txCopy.GetHash() == txid);
+    txCopy.AddTxData(CTransaction::DF_COMMON, bytes(128, 0x5b));
+    BOOST_CHECK(txCopy.GetHash() != txid);
+
+    // loading over an object with a memoized hash
+    bytes btTx;
+    FlatSerialize(tx, btTx);
+    BOOST_CHECK(FlatDeserialize(btTx.data(), btTx.size(), txCopy));
+    BOOST_CHECK(txCopy.GetHash() == txid);
+
+    CBlock block;
+    block.nType = CBlock::BLOCK_PRIMARY;
+    block.nTimeStamp = 1700000000;
+    block.nNumber = 100;
+    block.nHeight = 100;
+    block.hashPrev = uint256(3);
+    block.txMint = tx;
+    for (int i = 0; i < 2000; i++)
+    {
+        tx.SetNonce(i + 2);
+        block.vtx.push_back(tx);
+    }
+
+    const uint256 hashBlock = block.GetHash();
+    BOOST_CHECK(block.GetHash() == hashBlock);
+
+    // public fields are changed in place, the cached tx root must not go stale
+    block.vtx[100].SetNonce(100000);
+    const uint256 hashChanged = block.GetHash();
+    BOOST_CHECK(hashChanged != hashBlock);
+    bytes btBlock;
+    FlatSerialize(block, btBlock);
+    CBlock blockOut;
+    BOOST_CHECK(FlatDeserialize(btBlock.data(), btBlock.size(), blockOut));
+    BOOST_CHECK(blockOut.GetHash() == hashChanged);
+    block.vtx.pop_back();
+    BOOST_CHECK(block.GetHash() != hashChanged);
+    block.nTimeStamp++;
+    BOOST_CHECK(block.GetHash() != hashChanged);
+
+    const int nLoop = 100;
+    const uint64 nCalcPrev = CTransaction::GetHashCacheStat().GetCalcCount();
+    int64 nBeginTime = GetTimeMillis();
+    for (int i = 0; i < nLoop; i++)
+    {
+        block.GetHash();
+    }
+    int64 nCachedTime = GetTimeMillis() - nBeginTime;
+    BOOST_CHECK(CTransaction::GetHashCacheStat().GetCalcCount() == nCalcPrev);
+
+    nBeginTime = GetTimeMillis();
+    for (int i = 0; i < nLoop; i++)
+    {
+        CBlock blockTemp;
+        FlatDeserialize(btBlock.data(), btBlock.size(), blockTemp);
+        blockTemp.GetHash();
+    }
+    int64 nLoadTime = GetTimeMillis() - nBeginTime;
+
+    cout << "block hash x" << nLoop << ": memoized " << nCachedTime << " ms, load and hash " << nLoadTime << " ms" << endl;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -20,6 +20,7 @@ using namespace boost::filesystem;
 //./build-release/test/test_big --log_level=all --run_test=triedb_tests/basetest
 //./build-release/test/test_big --log_level=all --run_test=triedb_tests/shorttest
 //./build-release/test/test_big --log_level=all --run_test=triedb_tests/stresstest
+//./build-release/test/test_big --log_level=all --run_test=triedb_tests/bulkupdatebench
 
 BOOST_FIXTURE_TEST_SUITE(triedb_tests, BasicUtfSetup)
 
@@ -668,6 +669,388 @@ BOOST_AUTO_TEST_CASE(stattrienode)
     db.Deinitialize();
 }
 
+BOOST_AUTO_TEST_CASE(nodecachetest)
+{
+    cout << GetLocalTime() << "  triedb node cache test.........." << endl;
+
+    {
+        CTrieNodeCache cacheNode(1000, 1);
+        std::vector<uint256> vHash;
+        for (uint32 i = 0; i < 20; i++)
+        {
+            CTrieValue value;
+            value.type = CTrieValue::TYPE_VALUE;
+            value.vaValue = GetBytes(std::to_string(i));
+            vHash.push_back(value.CalcHash());
+            cacheNode.AddNew(CTrieNodeCacheKey(0, vHash.back()), value, 100);
+        }
+
+        CTrieNodeCache::CStat stat;
+        cacheNode.GetStat(stat);
+        BOOST_CHECK(stat.nCount == 10 && stat.nBytes == 1000);
+
+        CTrieValue value;
+        BOOST_CHECK(!cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[0]), value));
+        BOOST_CHECK(cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[10]), value));
+        BOOST_CHECK(value.vaValue == GetBytes("10"));
+
+        CTrieValue valueNew;
+        valueNew.type = CTrieValue::TYPE_VALUE;
+        cacheNode.AddNew(CTrieNodeCacheKey(0, valueNew.CalcHash()), valueNew, 100);
+        BOOST_CHECK(cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[10]), value));
+        BOOST_CHECK(!cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[11]), value));
+
+        cacheNode.Remove(CTrieNodeCacheKey(0, vHash[10]));
+        BOOST_CHECK(!cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[10]), value));
+
+        cacheNode.GetStat(stat);
+        BOOST_CHECK(stat.nHit == 2 && stat.nMiss == 3);
+
+        // a range removal drops one database id and keeps the others
+        cacheNode.AddNew(CTrieNodeCacheKey(1, vHash[12]), value, 100);
+        cacheNode.AddNew(CTrieNodeCacheKey(2, vHash[12]), value, 100);
+        cacheNode.RemoveRange(CTrieNodeCacheKey(1, uint256()), CTrieNodeCacheKey(2, uint256()));
+        BOOST_CHECK(!cacheNode.Retrieve(CTrieNodeCacheKey(1, vHash[12]), value));
+        BOOST_CHECK(cacheNode.Retrieve(CTrieNodeCacheKey(2, vHash[12]), value));
+        BOOST_CHECK(cacheNode.Retrieve(CTrieNodeCacheKey(0, vHash[19]), value));
+    }
+
+    std::string fullpath = GetOutPath("triedb_tests");
+
+    CTrieDB db;
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath)));
+
+    uint256 hashRoot;
+    {
+        bytesmap mapKv;
+        for (uint32 i = 0; i < 1000; i++)
+        {
+            mapKv.insert(make_pair(GetBytes("key" + std::to_string(i)), GetBytes("value" + std::to_string(i))));
+        }
+        BOOST_CHECK(db.AddNewTrie(uint256(), mapKv, hashRoot));
+    }
+
+    CTrieNodeCache::CStat statPrev;
+    CTrieDB::GetNodeCacheStat(statPrev);
+    for (uint32 i = 0; i < 1000; i++)
+    {
+        bytes btValue;
+        BOOST_CHECK(db.Retrieve(hashRoot, GetBytes("key" + std::to_string(i)), btValue));
+        BOOST_CHECK(btValue == GetBytes("value" + std::to_string(i)));
+    }
+    CTrieNodeCache::CStat stat;
+    CTrieDB::GetNodeCacheStat(stat);
+    printf("Node cache: hit: %lu, miss: %lu, count: %lu, bytes: %lu\n",
+           stat.nHit - statPrev.nHit, stat.nMiss - statPrev.nMiss, stat.nCount, stat.nBytes);
+    BOOST_CHECK(stat.nHit > statPrev.nHit);
+
+    {
+        // Nodes cached for one database must not be served to another one
+        CTrieDB dbOther;
+        BOOST_CHECK(dbOther.Initialize(boost::filesystem::path(fullpath + "_other")));
+        bytes btValue;
+        BOOST_CHECK(!dbOther.Retrieve(hashRoot, GetBytes("key0"), btValue));
+        BOOST_CHECK(!dbOther.VerifyTrieRootNode(hashRoot));
+
+        // clearing one database leaves the cached nodes of the others
+        CTrieNodeCache::CStat statBeforeClear, statAfterClear;
+        CTrieDB::GetNodeCacheStat(statBeforeClear);
+        dbOther.Clear();
+        CTrieDB::GetNodeCacheStat(statAfterClear);
+        BOOST_CHECK(statBeforeClear.nCount > 0 && statAfterClear.nCount == statBeforeClear.nCount);
+        dbOther.Deinitialize();
+    }
+
+    db.Clear();
+    db.Deinitialize();
+}
+
+BOOST_AUTO_TEST_CASE(branchencodetest)
+{
+    cout << GetLocalTime() << "  triedb branch encode test.........." << endl;
+
+    CTrieValue value;
+    value.type = CTrieValue::TYPE_BRANCH;
+    for (uint8 i = 0; i < 16; i += 3)
+    {
+        value.vaBranch.SetNextHash(i, uint256((uint64)(i + 1)));
+        value.vaBranch.SetValueHash(15 - i, uint256((uint64)(i + 100)));
+    }
+    value.vaBranch.SetNextHash(3, uint256());
+    const uint256 hashNode = value.CalcHash();
+
+    CBufStream ssLegacy, ssStore;
+    BOOST_CHECK(value.GetStream(ssLegacy));
+    BOOST_CHECK(value.GetStoreStream(ssStore));
+    printf("Branch size: legacy: %lu, compact: %lu\n", ssLegacy.GetSize(), ssStore.GetSize());
+    BOOST_CHECK(ssStore.GetSize() < ssLegacy.GetSize());
+
+    bool fLegacy = true;
+    CTrieValue valueCompact;
+    BOOST_CHECK(valueCompact.SetStoreStream(ssStore, fLegacy));
+    BOOST_CHECK(!fLegacy);
+    BOOST_CHECK(valueCompact.CalcHash() == hashNode);
+
+    CTrieValue valueLegacy;
+    BOOST_CHECK(valueLegacy.SetStoreStream(ssLegacy, fLegacy));
+    BOOST_CHECK(fLegacy);
+    BOOST_CHECK(valueLegacy.CalcHash() == hashNode);
+
+    for (uint8 i = 0; i < 16; i++)
+    {
+        BOOST_CHECK(valueCompact.vaBranch.GetNextHash(i) == value.vaBranch.GetNextHash(i));
+        BOOST_CHECK(valueCompact.vaBranch.GetValueHash(i) == value.vaBranch.GetValueHash(i));
+    }
+
+    // The hash preimage must match the legacy vectors byte for byte, including slots released
+    // and set again and branches with more slots than one index byte can address
+    class CLegacyBranch
+    {
+    public:
+        CLegacyBranch()
+          : vIndexNext(16), vIndexValue(16) {}
+        void Set(std::vector<uint8>& vIndex, std::vector<uint256>& vHash, const uint8 n, const uint256& hash)
+        {
+            uint8 x = vIndex[n];
+            if (x == 0 || x - 1 >= vHash.size())
+            {
+                if (hash != 0)
+                {
+                    vHash.push_back(hash);
+                    vIndex[n] = vHash.size();
+                }
+            }
+            else
+            {
+                vHash[x - 1] = hash;
+                if (hash == 0)
+                {
+                    vIndex[n] = 0;
+                }
+            }
+        }
+
+    public:
+        std::vector<uint8> vIndexNext;
+        std::vector<uint8> vIndexValue;
+        std::vector<uint256> vNext;
+        std::vector<uint256> vValue;
+    };
+
+    CTrieValue valueChurn;
+    valueChurn.type = CTrieValue::TYPE_BRANCH;
+    CLegacyBranch branchLegacy;
+    for (uint32 i = 0; i < 300; i++)
+    {
+        valueChurn.vaBranch.SetNextHash(1, uint256((uint64)(i + 1)));
+        branchLegacy.Set(branchLegacy.vIndexNext, branchLegacy.vNext, 1, uint256((uint64)(i + 1)));
+        valueChurn.vaBranch.SetNextHash(1, uint256());
+        branchLegacy.Set(branchLegacy.vIndexNext, branchLegacy.vNext, 1, uint256());
+        valueChurn.vaBranch.SetValueHash(2, uint256((uint64)(i + 1)));
+        branchLegacy.Set(branchLegacy.vIndexValue, branchLegacy.vValue, 2, uint256((uint64)(i + 1)));
+        if (i % 2 == 0)
+        {
+            valueChurn.vaBranch.SetValueHash(2, uint256());
+            branchLegacy.Set(branchLegacy.vIndexValue, branchLegacy.vValue, 2, uint256());
+        }
+    }
+    valueChurn.vaBranch.SetNextHash(4, uint256((uint64)1000));
+    branchLegacy.Set(branchLegacy.vIndexNext, branchLegacy.vNext, 4, uint256((uint64)1000));
+
+    CBufStream ssChurn, ssExpected;
+    BOOST_CHECK(valueChurn.GetStream(ssChurn));
+    ssExpected << (uint8)CTrieValue::TYPE_BRANCH << branchLegacy.vIndexNext << branchLegacy.vIndexValue << branchLegacy.vNext << branchLegacy.vValue;
+    BOOST_CHECK(ssChurn.GetBytes() == ssExpected.GetBytes());
+    BOOST_CHECK(!valueChurn.vaBranch.IsCompactable());
+
+    // oversized branches fall back to the legacy layout and load back unchanged
+    const uint256 hashChurn = valueChurn.CalcHash();
+    CBufStream ssChurnStore;
+    BOOST_CHECK(valueChurn.GetStoreStream(ssChurnStore));
+    CTrieValue valueChurnLoad;
+    BOOST_CHECK(valueChurnLoad.SetStoreStream(ssChurnStore, fLegacy));
+    BOOST_CHECK(fLegacy);
+    BOOST_CHECK(valueChurnLoad.CalcHash() == hashChurn);
+    BOOST_CHECK(valueChurnLoad.vaBranch.GetNextHash(4) == valueChurn.vaBranch.GetNextHash(4));
+    BOOST_CHECK(valueChurnLoad.vaBranch.GetValueHash(2) == uint256((uint64)300));
+}
+
+BOOST_AUTO_TEST_CASE(iteratortest)
+{
+    cout << GetLocalTime() << "  triedb iterator test.........." << endl;
+
+    std::string fullpath = GetOutPath("triedb_tests");
+
+    CTrieDB db;
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath)));
+
+    uint256 hashRoot;
+    bytesmap mapKv;
+    for (uint32 i = 0; i < 1000; i++)
+    {
+        std::string strPrefix = ((i % 3) ? "key" : "val");
+        mapKv.insert(make_pair(GetBytes(strPrefix + std::to_string(i)), GetBytes("value" + std::to_string(i))));
+    }
+    BOOST_CHECK(db.AddNewTrie(uint256(), mapKv, hashRoot));
+
+    {
+        CTrieIterator it(db, hashRoot);
+        BOOST_CHECK(it.SeekToFirst());
+        auto mt = mapKv.begin();
+        for (; it.IsValid() && mt != mapKv.end(); it.Next(), ++mt)
+        {
+            BOOST_CHECK(it.GetKey() == mt->first && it.GetValue() == mt->second);
+        }
+        BOOST_CHECK(!it.IsValid() && mt == mapKv.end());
+    }
+
+    {
+        CTrieIterator it(db, hashRoot, GetBytes("key"));
+        BOOST_CHECK(it.Seek(GetBytes("key5")));
+        auto mt = mapKv.lower_bound(GetBytes("key5"));
+        size_t nCount = 0;
+        for (; it.IsValid(); it.Next(), ++mt, ++nCount)
+        {
+            BOOST_CHECK(it.GetKey() == mt->first);
+        }
+        BOOST_CHECK(mt == mapKv.lower_bound(GetBytes("val")));
+        BOOST_CHECK(nCount > 0);
+    }
+
+    db.Clear();
+    db.Deinitialize();
+}
+
+BOOST_AUTO_TEST_CASE(journalprunetest)
+{
+    cout << GetLocalTime() << "  triedb journal prune test.........." << endl;
+
+    std::string fullpath = GetOutPath("triedb_tests");
+
+    CTrieDB db;
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath), true));
+
+    std::vector<uint256> vRoot;
+    uint256 hashRoot;
+    for (uint32 nHeight = 1; nHeight <= 40; nHeight++)
+    {
+        bytesmap mapKv;
+        for (uint32 i = 0; i < 20; i++)
+        {
+            mapKv[GetBytes("key" + std::to_string(rand() % 200))] = GetBytes("value" + std::to_string(rand() % 5));
+        }
+        if (nHeight % 4 == 0)
+        {
+            bytesmap mapSideKv = mapKv;
+            mapSideKv[GetBytes("side")] = GetBytes("value");
+            uint256 hashSideRoot;
+            BOOST_CHECK(db.AddNewTrie(hashRoot, mapSideKv, hashSideRoot, nHeight));
+        }
+        uint256 hashNewRoot;
+        BOOST_CHECK(db.AddNewTrie(hashRoot, mapKv, hashNewRoot, nHeight));
+        hashRoot = hashNewRoot;
+        vRoot.push_back(hashRoot);
+    }
+
+    CTriePruneStat statLimit;
+    BOOST_CHECK(db.PruneJournal(40, 1, statLimit));
+    BOOST_CHECK(statLimit.nHeightCount > 0 && statLimit.nHeightCount < 39);
+
+    CTriePruneStat stat;
+    BOOST_CHECK(db.PruneJournal(40, 0, stat));
+    printf("Prune journal: height: %u, root: %lu, node: %lu, bytes: %lu\n",
+           statLimit.nHeightCount + stat.nHeightCount, statLimit.nRootCount + stat.nRootCount,
+           statLimit.nNodeCount + stat.nNodeCount, statLimit.nByteCount + stat.nByteCount);
+    BOOST_CHECK(statLimit.nHeightCount + stat.nHeightCount == 39);
+    BOOST_CHECK(stat.nNodeCount > 0 && stat.nByteCount > 0);
+
+    std::map<uint256, CTrieValue> mapCacheNode;
+    BOOST_CHECK(db.CheckTrieNode(vRoot.back(), mapCacheNode));
+    BOOST_CHECK(!db.VerifyTrieRootNode(vRoot.front()));
+
+    db.Clear();
+    db.Deinitialize();
+}
+
+class CBenchTrieDB : public CTrieDB
+{
+public:
+    bool CreateSerial(const uint256& hashPrevRoot, const bytesmap& mapKvList, uint256& hashNewRoot, std::map<uint256, CTrieValue>& mapCacheNode)
+    {
+        hashNewRoot = hashPrevRoot;
+        for (const auto& kv : mapKvList)
+        {
+            bytes nbKeyNibble;
+            CKeyNibble::Byte2Nibble(kv.first, 0, nbKeyNibble);
+            if (!AddNode(hashNewRoot, nbKeyNibble, kv.second, mapCacheNode))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(bulkupdatebench)
+{
+    cout << GetLocalTime() << "  triedb bulk update bench.........." << endl;
+
+    std::string fullpath = GetOutPath("triedb_tests");
+
+    CBenchTrieDB db;
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath)));
+
+    auto funcRandKey = []() {
+        bytes btKey(20);
+        for (uint8& b : btKey)
+        {
+            b = rand();
+        }
+        return btKey;
+    };
+
+    uint256 hashRoot;
+    {
+        bytesmap mapKv;
+        for (uint32 i = 0; i < 100000; i++)
+        {
+            mapKv.insert(make_pair(funcRandKey(), GetBytes("value" + std::to_string(i))));
+        }
+        BOOST_CHECK(db.AddNewTrie(uint256(), mapKv, hashRoot));
+    }
+
+    for (const uint32 nCount : { 1000, 10000, 100000 })
+    {
+        bytesmap mapKv;
+        for (uint32 i = 0; i < nCount; i++)
+        {
+            mapKv.insert(make_pair(funcRandKey(), GetBytes("update" + std::to_string(i))));
+        }
+
+        uint256 hashSerialRoot, hashBulkRoot;
+        std::map<uint256, CTrieValue> mapSerialNode, mapBulkNode;
+
+        CTrieDB::GetNodeCache().Clear();
+        int64 nTimeSerial = GetTimeMillis();
+        BOOST_CHECK(db.CreateSerial(hashRoot, mapKv, hashSerialRoot, mapSerialNode));
+        nTimeSerial = GetTimeMillis() - nTimeSerial;
+
+        CTrieDB::GetNodeCache().Clear();
+        int64 nTimeBulk = GetTimeMillis();
+        BOOST_CHECK(db.CreateCacheTrie(hashRoot, mapKv, hashBulkRoot, mapBulkNode));
+        nTimeBulk = GetTimeMillis() - nTimeBulk;
+
+        BOOST_CHECK(hashSerialRoot == hashBulkRoot);
+        printf("Update %u keys: serial: %ld ms, bulk: %ld ms, nodes: %lu\n", nCount, nTimeSerial, nTimeBulk, mapBulkNode.size());
+
+        BOOST_CHECK(db.SaveCacheTrie(mapBulkNode));
+        hashRoot = hashBulkRoot;
+    }
+
+    db.Clear();
+    db.Deinitialize();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 //./build/test/test_big --log_level=all --run_test=triedb_tests/basetest
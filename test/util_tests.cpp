@@ -4,12 +4,16 @@
 
 #include "util.h"
 
+#include <atomic>
 #include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
 
 #include "forkcontext.h"
 #include "param.h"
 #include "profile.h"
 #include "test_big.h"
+#include "workerpool.h"
 
 using namespace hnbase;
 using namespace hashahead;
@@ -132,4 +136,53 @@ BOOST_AUTO_TEST_CASE(reverse_hex_string_test)
     BOOST_CHECK(ReverseHexNumericString("0x123") == std::string("0x2301"));
 }
 
+BOOST_AUTO_TEST_CASE(workerpooltest)
+{
+    CWorkerPool pool(3);
+    BOOST_CHECK(pool.GetConcurrency() == 4);
+
+    // every index runs exactly once, also with far more tasks than threads
+    std::vector<int> vRun(1000, 0);
+    pool.ParallelFor(vRun.size(), [&](const std::size_t i) { vRun[i]++; });
+    bool fOnce = true;
+    for (const int n : vRun)
+    {
+        fOnce = fOnce && (n == 1);
+    }
+    BOOST_CHECK(fOnce);
+
+    // a task may start a nested loop on the same pool
+    std::atomic<int> nNested(0);
+    pool.ParallelFor(8, [&](const std::size_t) {
+        pool.ParallelFor(8, [&](const std::size_t) { nNested++; });
+    });
+    BOOST_CHECK(nNested == 64);
+
+    // the other tasks still finish and the exception reaches the caller
+    std::atomic<int> nDone(0);
+    bool fThrow = false;
+    try
+    {
+        pool.ParallelFor(16, [&](const std::size_t i) {
+            if (i == 5)
+            {
+                throw std::runtime_error("task error");
+            }
+            nDone++;
+        });
+    }
+    catch (std::runtime_error&)
+    {
+        fThrow = true;
+    }
+    BOOST_CHECK(fThrow);
+    BOOST_CHECK(nDone == 15);
+
+    // no workers, the caller runs everything
+    CWorkerPool poolSerial(0);
+    std::atomic<int> nSerial(0);
+    poolSerial.ParallelFor(10, [&](const std::size_t) { nSerial++; });
+    BOOST_CHECK(nSerial == 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()